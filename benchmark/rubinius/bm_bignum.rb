@@ -0,0 +1,49 @@
+require 'benchmark'
+
+total = (ENV['TOTAL'] || 100_000).to_i
+
+# Just past Fixnum range, where IDs, hashes and checksums end up.
+a = 2 ** 62 + 12345
+b = 2 ** 61 + 678
+mask = 2 ** 64 - 1
+big = 3 ** 200
+
+Benchmark.bmbm do |x|
+  x.report("add/sub 62 bit") do
+    total.times { a + b - b }
+  end
+
+  x.report("mul to 124 bit") do
+    total.times { a * b }
+  end
+
+  x.report("div/mod 62 bit") do
+    total.times { a / 12345; a % 678 }
+  end
+
+  x.report("compare") do
+    total.times { a > b; a == b }
+  end
+
+  x.report("64 bit checksum") do
+    sum = 0
+    total.times { |i| sum = (sum * 31 + i) & mask }
+  end
+
+  x.report("fnv-1a 64") do
+    h = 0xcbf29ce484222325
+    total.times { |i| h = ((h ^ (i & 0xff)) * 0x100000001b3) & mask }
+  end
+
+  x.report("shift/xor") do
+    total.times { (a << 3) ^ (a >> 7) }
+  end
+
+  x.report("mul 300 digit") do
+    (total / 10).times { big * big }
+  end
+
+  x.report("allocate and drop") do
+    total.times { a + 1; b + 1; a + b }
+  end
+end
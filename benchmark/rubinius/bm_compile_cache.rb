@@ -0,0 +1,22 @@
+require 'benchmark'
+
+total = (ENV['TOTAL'] || 50).to_i
+
+dir = "/tmp/bm_compile_cache.#{Process.pid}"
+Dir.mkdir dir
+
+source = File.read(File.join(File.dirname(__FILE__), "..", "..", "lib", "set.rb"))
+files = (0...total).map do |i|
+  name = "#{dir}/source#{i}.rb"
+  File.open(name, "w") { |f| f.puts "# #{i}", source }
+  name
+end
+
+cache = Compile::Cache.new "#{dir}/cache", Compile::Cache::DefaultSize
+
+Benchmark.bm(20) do |x|
+  x.report("compile and store") { files.each { |f| cache.load f } }
+  x.report("load from cache") { files.each { |f| cache.load f } }
+end
+
+system "rm -rf #{dir}"
@@ -0,0 +1,66 @@
+require 'benchmark'
+
+total = (ENV['TOTAL'] || 1_000_000).to_i
+
+module Config
+  module Limits
+    MAX = 10
+  end
+
+  class Reader
+    STEP = 1
+
+    def local(n)
+      i = 0
+      while i < n
+        Limits
+        i += 1
+      end
+    end
+
+    def top_level(n)
+      i = 0
+      while i < n
+        Hash
+        String
+        i += 1
+      end
+    end
+
+    def scoped(n)
+      i = 0
+      while i < n
+        Config::Limits::MAX
+        i += 1
+      end
+    end
+  end
+end
+
+class SubReader < Config::Reader
+  def inherited(n)
+    i = 0
+    while i < n
+      STEP
+      i += 1
+    end
+  end
+end
+
+Benchmark.bmbm do |x|
+  x.report("constant in the lexical scope") do
+    Config::Reader.new.local total
+  end
+
+  x.report("top level constants") do
+    Config::Reader.new.top_level total
+  end
+
+  x.report("scoped constant") do
+    Config::Reader.new.scoped total
+  end
+
+  x.report("constant from a superclass") do
+    SubReader.new.inherited total
+  end
+end
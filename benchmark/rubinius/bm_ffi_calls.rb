@@ -0,0 +1,39 @@
+require 'benchmark'
+
+# Calls small C functions through FFI, and prints calls per second for
+# each after the benchmark.
+
+total = (ENV['TOTAL'] || 200_000).to_i
+
+module FFICalls
+  attach_function "getpid", :getpid, [], :int
+  attach_function "abs", :abs, [:int], :int
+  attach_function "labs", :labs, [:long], :long
+  attach_function "strlen", :strlen, [:string], :long
+  attach_function "memchr", :memchr, [:string, :int, :long], :pointer
+  attach_function "floor", :floor, [:double], :double
+  attach_function "ldexp", :ldexp, [:double, :int], :double
+end
+
+str = "subtend"
+
+calls = {
+  "getpid()"           => lambda { total.times { FFICalls.getpid } },
+  "abs(int)"           => lambda { total.times { FFICalls.abs(-3) } },
+  "labs(long)"         => lambda { total.times { FFICalls.labs(-3) } },
+  "strlen(string)"     => lambda { total.times { FFICalls.strlen(str) } },
+  "memchr(str,int,long)" => lambda { total.times { FFICalls.memchr(str, 116, 7) } },
+  "floor(double)"      => lambda { total.times { FFICalls.floor(2.5) } },
+  "ldexp(double,int)"  => lambda { total.times { FFICalls.ldexp(1.5, 3) } }
+}
+names = ["getpid()", "abs(int)", "labs(long)", "strlen(string)",
+         "memchr(str,int,long)", "floor(double)", "ldexp(double,int)"]
+
+results = Benchmark.bmbm do |x|
+  names.each { |name| x.report(name, &calls[name]) }
+end
+
+puts
+names.each_with_index do |name, i|
+  puts "%-22s %12.0f calls/sec" % [name, total / results[i].real]
+end
@@ -0,0 +1,35 @@
+require 'benchmark'
+
+# Field access through FFI::Struct and MemoryPointer.
+
+total = (ENV['TOTAL'] || 100_000).to_i
+
+class BenchPair < FFI::Struct
+  layout :count, :int, 0, :total, :long, 8, :ratio, :double, 16
+end
+
+pair = BenchPair.new
+ints = MemoryPointer.new :int, 64
+ints.write_array_of_int((0...64).to_a)
+
+Benchmark.bmbm do |x|
+  x.report("struct int field read") do
+    total.times { pair[:count] }
+  end
+
+  x.report("struct fields write") do
+    total.times { |i| pair[:count] = i; pair[:total] = i; pair[:ratio] = 0.5 }
+  end
+
+  x.report("read_int") do
+    total.times { ints.read_int }
+  end
+
+  x.report("read_array_of_int(64)") do
+    (total / 64).times { ints.read_array_of_int(64) }
+  end
+
+  x.report("File.stat") do
+    (total / 10).times { File.stat(__FILE__).size }
+  end
+end
@@ -0,0 +1,60 @@
+require 'benchmark'
+
+total = (ENV['TOTAL'] || 1_000_000).to_i
+
+Benchmark.bmbm do |x|
+  x.report("a * b") do
+    i = 0
+    while i < total
+      i * 3
+      i += 1
+    end
+  end
+
+  x.report("a / b, a % b") do
+    i = 0
+    while i < total
+      i / 7
+      i % 7
+      i += 1
+    end
+  end
+
+  x.report("a <= b, a >= b") do
+    i = 0
+    while i <= total
+      i >= 5
+      i += 1
+    end
+  end
+
+  x.report("lcg") do
+    s = 1
+    total.times { s = (s * 1103515245 + 12345) % 2147483648 }
+  end
+
+  x.report("gcd") do
+    i = 1
+    while i <= total / 10
+      a, b = i * 7, i + 91
+      a, b = b, a % b while b > 0
+      i += 1
+    end
+  end
+
+  x.report("a * b overflowing") do
+    i = 0
+    while i < total / 10
+      i * 1152921504606846975
+      i += 1
+    end
+  end
+
+  x.report("a << b") do
+    i = 0
+    while i < total
+      i << 5
+      i += 1
+    end
+  end
+end
@@ -0,0 +1,28 @@
+require 'benchmark'
+
+# Keeps a sliding window of recently allocated objects alive, so most
+# objects live through a few young collections and then die. Run it with
+#
+#   RBX=rbx.debug.gc shotgun/rubinius benchmark/rubinius/bm_gc_tenure.rb
+#   RBX="rbx.debug.gc;rbx.gc.adaptive" shotgun/rubinius benchmark/rubinius/bm_gc_tenure.rb
+#
+# and compare the tenured counts of the [GC Y ...] lines.
+
+total = (ENV['TOTAL'] || 200_000).to_i
+window_size = (ENV['WINDOW'] || 20_000).to_i
+
+Benchmark.bmbm do |x|
+  x.report("sliding window") do
+    window = []
+    total.times do |i|
+      window << [i, "x#{i}", [i]]
+      window.shift if window.size > window_size
+    end
+  end
+
+  x.report("short lived") do
+    total.times do |i|
+      [i, "x#{i}", [i]]
+    end
+  end
+end
@@ -0,0 +1,67 @@
+require 'benchmark'
+
+# Hash workloads shaped like decoded JSON: many small hashes with String
+# keys that are built once, read a few times and walked.
+
+total = (ENV['TOTAL'] || 20_000).to_i
+
+fields = %w[id name email created_at updated_at active score tags]
+records = (0...100).map do |i|
+  h = {}
+  fields.each_with_index { |f,j| h[f] = i * j }
+  h
+end
+big = {}
+10_000.times { |i| big["key#{i}"] = i }
+
+Benchmark.bmbm do |x|
+  x.report("build") do
+    total.times do |i|
+      h = {}
+      fields.each { |f| h[f] = i }
+    end
+  end
+
+  x.report("lookup") do
+    total.times do |i|
+      h = records[i % 100]
+      fields.each { |f| h[f] }
+    end
+  end
+
+  x.report("lookup missing") do
+    total.times do |i|
+      records[i % 100]["missing"]
+    end
+  end
+
+  x.report("each_pair") do
+    total.times do |i|
+      records[i % 100].each_pair { |k,v| k; v }
+    end
+  end
+
+  x.report("keys/values") do
+    total.times do |i|
+      h = records[i % 100]
+      h.keys
+      h.values
+    end
+  end
+
+  x.report("dup") do
+    total.times { |i| records[i % 100].dup }
+  end
+
+  x.report("delete/insert") do
+    h = records[0].dup
+    total.times do |i|
+      h.delete("name")
+      h["name"] = i
+    end
+  end
+
+  x.report("big each") do
+    (total / 1000).times { big.each { |k,v| v } }
+  end
+end
@@ -0,0 +1,104 @@
+require 'benchmark'
+
+total = (ENV['TOTAL'] || 1_000_000).to_i
+
+class Point
+  def initialize(x, y)
+    @x = x
+    @y = y
+  end
+
+  def x; @x; end
+  def y; @y; end
+
+  def move(dx)
+    @x = @x + dx
+  end
+
+  def sum(n)
+    i = 0
+    while i < n
+      @x + @y
+      i += 1
+    end
+  end
+
+  def step(n)
+    i = 0
+    while i < n
+      @y = @x
+      i += 1
+    end
+  end
+end
+
+class Wide
+  def initialize
+    @a = @b = @c = @d = @e = @f = 0
+  end
+
+  def sum(n)
+    i = 0
+    while i < n
+      @f + @e
+      i += 1
+    end
+  end
+end
+
+class Point3 < Point
+  def initialize(x, y, z)
+    @z = z
+    super(x, y)
+  end
+end
+
+Benchmark.bmbm do |x|
+  x.report("@ivar read in a loop") do
+    Point.new(1, 2).sum total
+  end
+
+  x.report("@ivar write in a loop") do
+    Point.new(1, 2).step total
+  end
+
+  x.report("6th @ivar read in a loop") do
+    Wide.new.sum total
+  end
+
+  x.report("@ivar reader") do
+    pt = Point.new 1, 2
+    i = 0
+    while i < total
+      pt.x
+      pt.y
+      i += 1
+    end
+  end
+
+  x.report("@ivar write method") do
+    pt = Point.new 1, 2
+    i = 0
+    while i < total
+      pt.move 1
+      i += 1
+    end
+  end
+
+  x.report("new object, 2 ivars") do
+    i = 0
+    while i < total / 2
+      Point.new i, i
+      i += 1
+    end
+  end
+
+  x.report("two layouts, one call site") do
+    pts = [Point.new(1, 2), Point3.new(1, 2, 3)]
+    i = 0
+    while i < total
+      pts[i & 1].x
+      i += 1
+    end
+  end
+end
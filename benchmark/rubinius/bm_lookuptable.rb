@@ -26,6 +26,14 @@ end
 keys = table.keys
 strings = table.values
 
+# enough tables that they don't all fit in the cache, like the method
+# tables walked by method lookup in a large program
+tables = (0...5000).map do |i|
+  t = LookupTable.new
+  keys.each_with_index { |k,j| t[k] = j if (i + j) % 3 != 0 }
+  t
+end
+
 Benchmark.bmbm do |x|
   x.report("loop") do
     total.times { |i| keys.each {} }
@@ -37,6 +45,13 @@ Benchmark.bmbm do |x|
     end
   end
 
+  x.report("LookupTable#[] many tables") do
+    total.times do |i|
+      t = tables[i % 5000]
+      keys.each { |k| t[k] }
+    end
+  end
+
   x.report("Hash#[]") do
     total.times do
       keys.each { |k| hash[k] }
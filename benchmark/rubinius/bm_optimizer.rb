@@ -0,0 +1,69 @@
+# optimize: fold peephole jumps dead_code
+#
+# Code shaped the way the optimizer passes find it in the kernel. Change
+# the line above to "# optimize: none" to time the same methods as the
+# compiler emits them without the passes.
+
+require 'benchmark'
+
+total = (ENV['TOTAL'] || 1_000_000).to_i
+
+class OptimizerBench
+  BITS = 8
+
+  def folded(n)
+    i = 0
+    sum = 0
+    while i < n
+      sum = i * 2 + 60 * 60 * 24 - (1 << 4)
+      i += 1
+    end
+    sum
+  end
+
+  def locals(n)
+    i = 0
+    while i < n
+      a = i
+      b = a
+      c = b
+      i = c + 1
+    end
+    i
+  end
+
+  def branches(n)
+    i = 0
+    odd = 0
+    while i < n
+      if i % 2 == 1
+        odd += 1
+      elsif i > n
+        return nil
+      else
+        odd
+      end
+      i += 1
+    end
+    odd
+  end
+
+  def unused(n)
+    i = 0
+    while i < n
+      nil
+      self
+      i += 1
+    end
+    i
+  end
+end
+
+bench = OptimizerBench.new
+
+Benchmark.bmbm do |x|
+  x.report("constant folding") { bench.folded total }
+  x.report("local reload") { bench.locals total }
+  x.report("threaded branches") { bench.branches total }
+  x.report("unused values") { bench.unused total }
+end
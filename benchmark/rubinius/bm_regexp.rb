@@ -0,0 +1,62 @@
+require 'benchmark'
+
+total = (ENV['TOTAL'] || 100_000).to_i
+
+line = "GET /images/logo.png HTTP/1.1 200 4312 Mozilla/5.0 (X11; Linux)"
+text = (line + "\n") * 64
+miss = "x" * 1024
+
+Benchmark.bmbm do |x|
+  x.report("=~ literal hit") do
+    total.times { line =~ /HTTP/ }
+  end
+
+  x.report("=~ literal miss (1 KB)") do
+    (total / 10).times { miss =~ /HTTP/ }
+  end
+
+  x.report("=~ literal prefix") do
+    total.times { line =~ /HTTP\/1\.\d/ }
+  end
+
+  x.report("=~ \\A anchored") do
+    total.times { line =~ /\AGET / }
+  end
+
+  x.report("=~ no prefix") do
+    total.times { line =~ /\d+ \d+/ }
+  end
+
+  x.report("=~ case insensitive") do
+    total.times { line =~ /mozilla/i }
+  end
+
+  x.report("match? literal") do
+    total.times { /HTTP/.match?(line) }
+  end
+
+  x.report("match? no prefix") do
+    total.times { /\d+ \d+/.match?(line) }
+  end
+
+  x.report("=== in case") do
+    total.times do
+      case line
+      when /^POST/ then 1
+      when /^GET/  then 2
+      end
+    end
+  end
+
+  x.report("scan literal (64 lines)") do
+    (total / 100).times { text.scan(/HTTP/) }
+  end
+
+  x.report("split on regexp") do
+    (total / 10).times { line.split(/ /) }
+  end
+
+  x.report("gsub literal") do
+    (total / 10).times { line.gsub(/HTTP/, "http") }
+  end
+end
@@ -0,0 +1,41 @@
+require 'benchmark'
+
+# Building 1 MB response bodies out of small pieces.
+
+total = (ENV['TOTAL'] || 10).to_i
+
+size = 1024 * 1024
+line = "<li class=\"item\">" + ("x" * 60) + "</li>\n"
+lines = size / line.size
+
+Benchmark.bmbm do |x|
+  x.report("<< lines") do
+    total.times do
+      body = ""
+      lines.times { body << line }
+    end
+  end
+
+  x.report("<< interpolated lines") do
+    total.times do
+      body = ""
+      lines.times { |i| body << "<li id=\"#{i}\">#{line}</li>" }
+    end
+  end
+
+  x.report("<< 64 KB chunks") do
+    chunk = "y" * 65536
+    total.times do
+      body = ""
+      16.times { body << chunk }
+    end
+  end
+
+  x.report("Array#join") do
+    total.times do
+      parts = []
+      lines.times { parts << line }
+      parts.join
+    end
+  end
+end
@@ -0,0 +1,42 @@
+require 'benchmark'
+
+# String#hash and String#to_sym throughput, for short identifier-like
+# strings and for larger keys.
+
+total = (ENV['TOTAL'] || 100_000).to_i
+
+short = (0...1000).map { |i| "ident_#{i}" }
+long = (0...100).map { |i| "#{i}:" + ("payload" * 64) }
+names = (0...1000).map { |i| "method_name_#{i}" }
+names.each { |n| n.to_sym }
+
+Benchmark.bmbm do |x|
+  x.report("hash short") do
+    total.times do |i|
+      short[i % 1000].dup.hash
+    end
+  end
+
+  x.report("hash 450 bytes") do
+    (total / 10).times do |i|
+      long[i % 100].dup.hash
+    end
+  end
+
+  x.report("to_sym existing") do
+    total.times do |i|
+      names[i % 1000].to_sym
+    end
+  end
+
+  x.report("to_sym new") do
+    (total / 10).times do |i|
+      "fresh_symbol_#{i}".to_sym
+    end
+  end
+
+  x.report("big Hash with String keys") do
+    h = {}
+    (total / 10).times { |i| h[short[i % 1000] + i.to_s] = i }
+  end
+end
@@ -0,0 +1,42 @@
+require 'benchmark'
+
+# Taking pieces out of a large String: lines of a 1 MB document, fixed
+# size fields and regexp captures.
+
+total = (ENV['TOTAL'] || 10).to_i
+
+line = "GET /items/" + ("x" * 60) + " HTTP/1.1\n"
+doc = line * (1024 * 1024 / line.size)
+lines = doc.size / line.size
+
+Benchmark.bmbm do |x|
+  x.report("each_line") do
+    total.times { doc.each_line { |l| l } }
+  end
+
+  x.report("slice 64 byte fields") do
+    total.times do
+      i = 0
+      while i < lines
+        doc[i * line.size, 64]
+        i += 1
+      end
+    end
+  end
+
+  x.report("split") do
+    total.times { doc.split("\n") }
+  end
+
+  x.report("regexp captures") do
+    total.times do
+      i = 0
+      while i < 2000
+        m = /GET (\S+) (HTTP\S+)/.match(line)
+        m[1]
+        m[2]
+        i += 1
+      end
+    end
+  end
+end
@@ -0,0 +1,40 @@
+require 'benchmark'
+
+# String and Array functions of the C API, each called in a loop from C.
+
+total = (ENV['TOTAL'] || 100).to_i
+
+ext = File.dirname(__FILE__) + '/subtend_api'
+system "./shotgun/rubinius compile #{ext}.c > /dev/null"
+require ext
+
+api = SubtendAPI.new
+str = "subtend " * 8
+other = "subtend " * 7 + "subtenD "
+ary = (1..16).to_a
+
+Benchmark.bmbm do |x|
+  x.report("rb_str_cat x1000") do
+    total.times { api.str_cat 1000 }
+  end
+
+  x.report("rb_str_cmp x1000") do
+    total.times { api.str_cmp str, other, 1000 }
+  end
+
+  x.report("rb_str_substr x1000") do
+    total.times { api.str_substr str, 1000 }
+  end
+
+  x.report("rb_ary_shift + unshift x1000") do
+    total.times { api.ary_rotate ary, 1000 }
+  end
+
+  x.report("rb_ary_reverse x1000") do
+    total.times { api.ary_reverse ary, 1000 }
+  end
+
+  x.report("rb_ary_dup x1000") do
+    total.times { api.ary_dup ary, 1000 }
+  end
+end
@@ -0,0 +1,27 @@
+require 'benchmark'
+
+# Calls into a C extension, which make handles for the VALUEs they see.
+
+total = (ENV['TOTAL'] || 20_000).to_i
+
+ext = File.dirname(__FILE__) + '/subtend_calls'
+system "./shotgun/rubinius compile #{ext}.c > /dev/null"
+require ext
+
+calls = SubtendCalls.new
+ary = calls.strings 100
+obj = Object.new
+
+Benchmark.bmbm do |x|
+  x.report("identity") do
+    total.times { calls.identity obj }
+  end
+
+  x.report("rb_str_new2 + rb_ary_push x100") do
+    (total / 10).times { calls.strings 100 }
+  end
+
+  x.report("rb_ary_entry x100") do
+    (total / 10).times { calls.entries ary }
+  end
+end
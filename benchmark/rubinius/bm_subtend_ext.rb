@@ -0,0 +1,45 @@
+require 'benchmark'
+
+# Calls into the extensions the subtend specs use. Most of these methods
+# never call back into Ruby; rb_yield and rb_funcall do every time.
+
+total = (ENV['TOTAL'] || 20_000).to_i
+
+ext = File.dirname(__FILE__) + '/../../spec/subtend/ext/'
+%w[subtend_array subtend_hash subtend_object subtend_block].each do |name|
+  system "./shotgun/rubinius compile #{ext}#{name}.c > /dev/null"
+  require ext + name
+end
+
+arrays = SubtendArray.new
+hashes = SubtendHash.new
+objects = SubtendObject.new
+blocks = SubtendBlock.new
+ary = [1, 2, 3]
+hsh = { :a => 1 }
+
+Benchmark.bmbm do |x|
+  x.report("new_array") do
+    total.times { arrays.new_array }
+  end
+
+  x.report("rb_ary_entry") do
+    total.times { arrays.rb_ary_entry ary, 1 }
+  end
+
+  x.report("hash access") do
+    total.times { hashes.access hsh, :a }
+  end
+
+  x.report("rb_obj_is_kind_of") do
+    total.times { objects.rb_obj_is_kind_of ary, Array }
+  end
+
+  x.report("rb_yield") do
+    total.times { blocks.do_yield { |i| i } }
+  end
+
+  x.report("rb_inspect (rb_funcall)") do
+    total.times { objects.rb_inspect ary }
+  end
+end
@@ -0,0 +1,74 @@
+#include <ruby.h>
+
+/* Native methods for bm_subtend_api.rb. Each calls one C API function
+ * count times. */
+
+static VALUE sa_str_cat(VALUE self, VALUE count) {
+  VALUE str;
+  long i, n = FIX2INT(count);
+
+  str = rb_str_new2("");
+  for(i = 0; i < n; i++) {
+    rb_str_cat(str, "subtend", 7);
+  }
+  return str;
+}
+
+static VALUE sa_str_cmp(VALUE self, VALUE a, VALUE b, VALUE count) {
+  long i, n = FIX2INT(count);
+  int ret = 0;
+
+  for(i = 0; i < n; i++) {
+    ret = rb_str_cmp(a, b);
+  }
+  return INT2FIX(ret);
+}
+
+static VALUE sa_str_substr(VALUE self, VALUE str, VALUE count) {
+  long i, n = FIX2INT(count);
+  VALUE last = Qnil;
+
+  for(i = 0; i < n; i++) {
+    last = rb_str_substr(str, i % 8, 32);
+  }
+  return last;
+}
+
+static VALUE sa_ary_rotate(VALUE self, VALUE ary, VALUE count) {
+  long i, n = FIX2INT(count);
+
+  for(i = 0; i < n; i++) {
+    rb_ary_unshift(ary, rb_ary_shift(ary));
+  }
+  return ary;
+}
+
+static VALUE sa_ary_reverse(VALUE self, VALUE ary, VALUE count) {
+  long i, n = FIX2INT(count);
+
+  for(i = 0; i < n; i++) {
+    rb_ary_reverse(ary);
+  }
+  return ary;
+}
+
+static VALUE sa_ary_dup(VALUE self, VALUE ary, VALUE count) {
+  long i, n = FIX2INT(count);
+  VALUE last = Qnil;
+
+  for(i = 0; i < n; i++) {
+    last = rb_ary_dup(ary);
+  }
+  return last;
+}
+
+void Init_subtend_api() {
+  VALUE cls;
+  cls = rb_define_class("SubtendAPI", rb_cObject);
+  rb_define_method(cls, "str_cat", sa_str_cat, 1);
+  rb_define_method(cls, "str_cmp", sa_str_cmp, 3);
+  rb_define_method(cls, "str_substr", sa_str_substr, 2);
+  rb_define_method(cls, "ary_rotate", sa_ary_rotate, 2);
+  rb_define_method(cls, "ary_reverse", sa_ary_reverse, 2);
+  rb_define_method(cls, "ary_dup", sa_ary_dup, 2);
+}
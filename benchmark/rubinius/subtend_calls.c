@@ -0,0 +1,37 @@
+#include <ruby.h>
+
+/* Native methods for bm_subtend_calls.rb. */
+
+static VALUE sc_identity(VALUE self, VALUE obj) {
+  return obj;
+}
+
+/* Makes a handle for every element and every String it creates. */
+static VALUE sc_strings(VALUE self, VALUE count) {
+  VALUE ary;
+  long i, n = FIX2INT(count);
+
+  ary = rb_ary_new();
+  for(i = 0; i < n; i++) {
+    rb_ary_push(ary, rb_str_new2("subtend"));
+  }
+  return ary;
+}
+
+static VALUE sc_entries(VALUE self, VALUE ary) {
+  long i, n = FIX2INT(rb_funcall(ary, rb_intern("size"), 0));
+  VALUE last = Qnil;
+
+  for(i = 0; i < n; i++) {
+    last = rb_ary_entry(ary, i);
+  }
+  return last;
+}
+
+void Init_subtend_calls() {
+  VALUE cls;
+  cls = rb_define_class("SubtendCalls", rb_cObject);
+  rb_define_method(cls, "identity", sc_identity, 1);
+  rb_define_method(cls, "strings", sc_strings, 1);
+  rb_define_method(cls, "entries", sc_entries, 1);
+}
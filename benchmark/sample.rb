@@ -0,0 +1,41 @@
+# Runs one benchmark file for benchmark/suite.rb and writes how long it
+# took, and what the VM counted meanwhile, to the file named by
+# BENCH_SAMPLE, one "name value" pair per line.
+#
+#   BENCH_SAMPLE=out shotgun/rubinius benchmark/sample.rb FILE [ARGS]
+#
+# Only the time spent in FILE is measured, not starting the VM. Under a
+# VM other than Rubinius only the time is written.
+
+StatNames = %w[cache_hits cache_misses cache_used cache_collisions
+               inline_cache_hits inline_cache_stale inline_const_hits
+               young_collections major_collections gc_usecs
+               young_bytes tenured_objects mature_bytes]
+
+def bench_stats
+  return [] unless defined?(Rubinius)
+  stats = Rubinius::VM.stats
+  return [] unless stats
+  (0...StatNames.size).map { |i| stats[i] }
+end
+
+out = ENV['BENCH_SAMPLE'] or raise "BENCH_SAMPLE is not set"
+file = ARGV.shift
+$0 = file
+
+before = bench_stats
+start = Time.now
+
+at_exit do
+  elapsed = Time.now - start
+  after = bench_stats
+
+  File.open out, "w" do |f|
+    f.puts "time #{elapsed}"
+    after.each_with_index do |value, i|
+      f.puts "#{StatNames[i]} #{value - before[i]}"
+    end
+  end
+end
+
+load file
@@ -0,0 +1,294 @@
+#!/usr/bin/env ruby
+#
+# Runs the benchmark suites under benchmark/ and writes the results as
+# JSON, optionally comparing them against an earlier run.
+#
+#   ruby benchmark/suite.rb [options] [DIR ...]
+#
+#   -t TARGET    VM to run, shotgun/rubinius by default
+#   -w N         throwaway runs of each benchmark first (1)
+#   -n N         measured runs of each benchmark (5)
+#   -g REGEX     only run benchmarks whose name matches REGEX
+#   -T SECS      give up on a run after SECS seconds (300)
+#   -o FILE      write the results to FILE
+#   -b FILE      compare against the results in FILE
+#   -r FILE      don't run anything, use the results in FILE
+#
+# DIR is a directory under benchmark/, all of them by default. Every
+# bm_*.rb file in it is a benchmark, except in directories that describe
+# theirs with bm-*.yaml files, like alioth/. Each run is a separate
+# process started through benchmark/sample.rb, which reports the time
+# spent in the benchmark and the GC and method cache counters from
+# Rubinius::VM.stats. The warmup runs also leave the .rbc files behind,
+# so compiling isn't measured.
+#
+# The results have the mean time of each benchmark with a 95% confidence
+# interval, and the mean of each counter. Against a baseline, a
+# benchmark that got slower is a regression when Welch's t-test says the
+# difference is significant at 95% and it is more than 1% of the old
+# time, so small and noisy differences don't fail a build. The script
+# exits with 1 if there are regressions or a benchmark failed.
+
+begin
+  require 'json'
+rescue LoadError
+  require 'rubygems'
+  require 'json'
+end
+require 'optparse'
+require 'tmpdir'
+
+class BenchmarkSuite
+  Root = File.expand_path(File.dirname(__FILE__))
+  Sampler = File.join(Root, "sample.rb")
+
+  # Arguments the benchmarks need, see bin/bm
+  Arguments = {
+    "borasky/bm_MatrixBenchmark.rb" => "64"
+  }
+
+  # Two-sided 95% critical values of Student's t by degrees of freedom
+  TTable = [nil, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+            2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110,
+            2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056,
+            2.052, 2.048, 2.045, 2.042]
+
+  MinChange = 0.01
+
+  def self.t_critical(df)
+    df = df.floor
+    return TTable[1] if df < 1
+    TTable[df] || 1.960
+  end
+
+  def self.mean(values)
+    values.inject(0.0) { |sum, v| sum + v } / values.size
+  end
+
+  def self.variance(values)
+    return 0.0 if values.size < 2
+    m = mean values
+    values.inject(0.0) { |sum, v| sum + (v - m) ** 2 } / (values.size - 1)
+  end
+
+  # Half the width of the 95% confidence interval of the mean.
+  def self.ci95(values)
+    return 0.0 if values.size < 2
+    t_critical(values.size - 1) * Math.sqrt(variance(values) / values.size)
+  end
+
+  # Whether the means of +a+ and +b+ differ at 95% by Welch's t-test.
+  def self.significant?(a, b)
+    va = variance(a) / a.size
+    vb = variance(b) / b.size
+    diff = (mean(a) - mean(b)).abs
+    return diff > 0 if va + vb == 0
+
+    t = diff / Math.sqrt(va + vb)
+    df = (va + vb) ** 2 / (va ** 2 / ([a.size - 1, 1].max) +
+                           vb ** 2 / ([b.size - 1, 1].max))
+    t > t_critical(df)
+  end
+
+  Benchmark = Struct.new(:name, :dir, :file, :args, :input)
+
+  def initialize(options)
+    @target = options[:target]
+    @target = File.expand_path(@target) if @target.index("/")
+    @warmup = options[:warmup]
+    @samples = options[:samples]
+    @timeout = options[:timeout]
+    @grep = options[:grep]
+  end
+
+  def find(dirs)
+    benchmarks = []
+
+    dirs.each do |name|
+      dir = File.join Root, name
+      configs = Dir["#{dir}/bm-*.yaml"].sort
+
+      if configs.empty?
+        Dir["#{dir}/bm_*.rb"].sort.each do |file|
+          key = "#{name}/#{File.basename(file)}"
+          benchmarks << Benchmark.new(key, dir, file, Arguments[key], nil)
+        end
+      else
+        require 'yaml'
+        configs.each do |config|
+          yaml = YAML.load_file config
+          next unless yaml["rbx"]
+          key = "#{name}/#{File.basename(yaml['rbx'])}"
+          benchmarks << Benchmark.new(key, dir, File.join(dir, yaml["rbx"]),
+                                      yaml["commandline"], yaml["input"])
+        end
+      end
+    end
+
+    benchmarks.reject { |b| @grep and b.name !~ @grep }
+  end
+
+  # Runs +bench+ once and returns the Hash sample.rb wrote, or a String
+  # saying why there isn't one.
+  def sample(bench)
+    out = File.join Dir.tmpdir, "bench_sample.#{Process.pid}"
+    File.unlink out if File.exist? out
+
+    pid = fork do
+      Dir.chdir bench.dir
+      ENV["BENCH_SAMPLE"] = out
+      STDIN.reopen(bench.input || "/dev/null")
+      STDOUT.reopen("/dev/null", "w")
+      STDERR.reopen("/dev/null", "w")
+      exec "#{@target} #{Sampler} #{bench.file} #{bench.args}"
+    end
+
+    deadline = Time.now + @timeout
+    until Process.waitpid(pid, Process::WNOHANG)
+      if Time.now > deadline
+        Process.kill "KILL", pid
+        Process.waitpid pid
+        return "timed out after #{@timeout}s"
+      end
+      sleep 0.05
+    end
+
+    return "exited with #{$?.exitstatus}" unless $?.success?
+    return "wrote no results" unless File.exist? out
+
+    result = {}
+    File.readlines(out).each do |line|
+      name, value = line.split
+      result[name] = value.index(".") ? value.to_f : value.to_i
+    end
+    File.unlink out
+    result
+  end
+
+  def measure(bench)
+    @warmup.times do
+      error = sample(bench)
+      return { "error" => error } if error.kind_of? String
+    end
+
+    runs = []
+    @samples.times do
+      run = sample(bench)
+      return { "error" => run } if run.kind_of? String
+      runs << run
+    end
+
+    times = runs.map { |r| r["time"] }
+    counters = {}
+    runs.first.each_key do |name|
+      next if name == "time"
+      counters[name] = BenchmarkSuite.mean(runs.map { |r| r[name] })
+    end
+
+    { "times" => times,
+      "mean" => BenchmarkSuite.mean(times),
+      "ci95" => BenchmarkSuite.ci95(times),
+      "stddev" => Math.sqrt(BenchmarkSuite.variance(times)),
+      "counters" => counters }
+  end
+
+  def run(dirs)
+    results = {}
+
+    find(dirs).each do |bench|
+      STDOUT.print bench.name.ljust(44)
+      STDOUT.flush
+      result = results[bench.name] = measure(bench)
+      puts BenchmarkSuite.describe(result)
+    end
+
+    { "target" => @target,
+      "date" => Time.now.strftime("%Y-%m-%d %H:%M:%S"),
+      "warmup" => @warmup,
+      "samples" => @samples,
+      "benchmarks" => results }
+  end
+
+  def self.describe(result)
+    return "failed: #{result['error']}" if result["error"]
+
+    line = "%9.4fs +/- %6.4f" % [result["mean"], result["ci95"]]
+    counters = result["counters"]
+    if counters["young_collections"]
+      line << "  %6d GCs %4d major %9.1fM young" %
+        [counters["young_collections"], counters["major_collections"],
+         counters["young_bytes"] / 1048576.0]
+    end
+    line
+  end
+
+  # Prints how each benchmark in +current+ compares with +baseline+ and
+  # returns the names of the ones that got significantly slower.
+  def self.compare(baseline, current)
+    regressions = []
+    puts "", "%-44s %10s %10s %8s" % ["compared to baseline", "before", "after", "change"]
+
+    current["benchmarks"].sort.each do |name, now|
+      old = baseline["benchmarks"][name]
+      next unless old and old["times"] and now["times"]
+
+      change = (now["mean"] - old["mean"]) / old["mean"]
+      verdict = ""
+      if change.abs > MinChange and significant?(old["times"], now["times"])
+        verdict = change > 0 ? "REGRESSION" : "faster"
+        regressions << name if change > 0
+      end
+
+      puts "%-44s %9.4fs %9.4fs %+7.1f%% %s" %
+        [name, old["mean"], now["mean"], change * 100, verdict]
+    end
+
+    regressions
+  end
+end
+
+if $0 == __FILE__
+  options = { :target => "shotgun/rubinius", :warmup => 1, :samples => 5,
+              :timeout => 300 }
+  output = baseline = previous = nil
+
+  OptionParser.new do |opts|
+    opts.banner = "Usage: ruby benchmark/suite.rb [options] [DIR ...]"
+    opts.on("-t", "--target TARGET", "VM to run") { |t| options[:target] = t }
+    opts.on("-w", "--warmup N", Integer, "Throwaway runs") { |n| options[:warmup] = n }
+    opts.on("-n", "--samples N", Integer, "Measured runs") { |n| options[:samples] = n }
+    opts.on("-g", "--grep REGEX", "Only matching benchmarks") { |g| options[:grep] = Regexp.new(g) }
+    opts.on("-T", "--timeout SECS", Integer, "Limit on one run") { |n| options[:timeout] = n }
+    opts.on("-o", "--output FILE", "Write the results to FILE") { |f| output = f }
+    opts.on("-b", "--baseline FILE", "Compare against FILE") { |f| baseline = f }
+    opts.on("-r", "--results FILE", "Use the results in FILE") { |f| previous = f }
+  end.parse!
+
+  dirs = ARGV.empty? ? Dir["#{BenchmarkSuite::Root}/*/"].map { |d| File.basename d }.sort : ARGV
+
+  if previous
+    results = JSON.parse(File.read(previous))
+  else
+    results = BenchmarkSuite.new(options).run(dirs)
+  end
+
+  if output
+    File.open(output, "w") { |f| f.puts JSON.pretty_generate(results) }
+    puts "", "Wrote #{output}"
+  end
+
+  failed = results["benchmarks"].select { |name, r| r["error"] }
+  regressions = []
+
+  if baseline
+    if File.exist? baseline
+      regressions = BenchmarkSuite.compare(JSON.parse(File.read(baseline)), results)
+    else
+      puts "", "No baseline at #{baseline}, nothing to compare"
+    end
+  end
+
+  puts "", "#{results['benchmarks'].size} benchmarks, #{failed.size} failed, " \
+           "#{regressions.size} regressions"
+  exit 1 unless failed.empty? and regressions.empty?
+end
@@ -1,7 +1,7 @@
 # Requires: Object#hash
 
 class Hash
-  ivar_as_index :__ivars__ => 0, :keys => 1, :values => 2, :bins => 3, :entries => 4, :default => 5, :default_proc => 6
+  ivar_as_index :__ivars__ => 0, :index => 1, :values => 2, :bins => 3, :entries => 4, :default => 5, :default_proc => 6, :used => 7
 
   def self.allocate
     Ruby.primitive :allocate_hash
@@ -24,10 +24,8 @@ class Hash
     hsh
   end
 
+  # Storage is set up by Hash.allocate.
   def initialize
-    @bins = 16
-    @values = Tuple.new(@bins)
-    @entries = 0
   end
 
   def set_by_hash(hsh, key, val)
@@ -51,12 +49,14 @@ class Hash
   end
 
   def [](key)
+    Ruby.primitive :hash_aref
     code, hk, val, nxt = get_by_hash(key.hash, key)
     return nil unless code
     return val
   end
 
   def []=(key, val)
+    Ruby.primitive :hash_aset
     set_by_hash key.hash, key, val
   end
 
@@ -73,12 +73,8 @@ class Hash
   def each
     i = 0
     while i < @values.fields
-      tup = @values[i]
-      while tup
-        yield tup.at(1), tup.at(2)
-        tup = tup.at(3)
-      end
-      i += 1
+      yield @values.at(i + 1), @values.at(i + 2) if @values.at(i)
+      i += 3
     end
     self
   end
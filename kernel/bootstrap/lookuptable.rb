@@ -6,24 +6,11 @@
 # entry in LookupTable is determined by using the == comparison operator
 # in C code. In effect, two keys are equal if they are the same pointer.
 #
-# NOTE: the value used to determine the bin is the "pointer" value of
-# key >> 2. This makes it possible to calculate the bin from Ruby with
-# the same result as in C. For example:
-# 
-#   l = LookupTable.new
-#   loc = :a.hash & (l.bins - 1)  # => 12
-#   class LookupTable
-#     def show
-#       @values
-#     end
-#   end
-#
-#   l[:a] = 1
-#   l.show  # => #<Tuple: nil, ..., nil, #<Tuple: :a, 1, nil>, nil, nil, nil>
-#
-# where ... is ten "nil, " entries. This only works for Objects that
-# are tagged data (see e.g. shotgun/lib/oop.h). This will NOT work with
-# a String, for instance.
+# NOTE: the table is open addressed. Keys and values are stored inline in
+# the @values Tuple, key i at 2 * i and its value at 2 * i + 1, and an empty
+# slot holds undef. A key's home bin is its Symbol index for a Symbol and
+# its "pointer" value >> 2 otherwise, masked by (bins - 1). Keys that
+# collide are stored in the following bins (see shotgun/lib/lookuptable.c).
 #
 # LookupTable is intended to be used with Symbol or Fixnum keys. Internally,
 # String keys are converted to Symbols. LookupTable is NOT intended to be
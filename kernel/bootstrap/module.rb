@@ -78,6 +78,7 @@ class Module
   # because it is more complex than a mere accessor
   def superclass=(other)
     @superclass = other
+    Rubinius::VM.reset_constant_cache
   end
 
   # This may be either an included Module or then
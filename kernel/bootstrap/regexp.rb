@@ -9,6 +9,11 @@ class Regexp
     raise PrimitiveFailure, "primitive failed"
   end
 
+  def search_p(str, start, finish)
+    Ruby.primitive :regexp_search_p
+    raise PrimitiveFailure, "primitive failed"
+  end
+
   def match_start(str, offset) # equiv to MRI's re_match
     Ruby.primitive :regexp_match_start
     raise PrimitiveFailure, "primitive failed"
@@ -1,6 +1,6 @@
 class Sampler
   
-  def activate(hz)
+  def activate(hz, mode)
     Ruby.primitive :sampler_activate
     raise PrimitiveFailure, "primitive failed"
   end
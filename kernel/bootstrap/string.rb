@@ -28,6 +28,12 @@ class String
     raise PrimitiveFailure, "primitive failed"
   end
 
+  # The SHA1 of the bytes, as 40 hex digits.
+  def __sha1__
+    Ruby.primitive :string_sha1
+    raise PrimitiveFailure, "String#__sha1__ primitive failed"
+  end
+
   def append(str)
     Ruby.primitive :string_append
     raise TypeError, "only a String instance is accepted"
@@ -48,6 +54,7 @@ class String
   end
 
   def substring(start, count)
+    Ruby.primitive :string_substring
     return if count < 0 || start > @bytes || -start > @bytes
 
     start += @bytes if start < 0
@@ -4,6 +4,26 @@ class Rubinius::VM
     raise PrimitiveFailure, "primitive failed"
   end
 
+  def self.method_profile_enable(on)
+    Ruby.primitive :method_profile_enable
+    raise PrimitiveFailure, "primitive failed"
+  end
+
+  def self.method_profile_snapshot(reset)
+    Ruby.primitive :method_profile_snapshot
+    raise PrimitiveFailure, "primitive failed"
+  end
+
+  def self.probe_enable(mask)
+    Ruby.primitive :probe_enable
+    raise PrimitiveFailure, "primitive failed"
+  end
+
+  def self.probe_dump(path)
+    Ruby.primitive :probe_dump
+    raise PrimitiveFailure, "primitive failed"
+  end
+
   def self.load_library(path, name)
     Ruby.primitive :load_library
     raise PrimitiveFailure, "primitive failed"
@@ -14,6 +34,11 @@ class Rubinius::VM
     raise PrimitiveFailure, "primitive failed"
   end
 
+  def self.reset_constant_cache
+    Ruby.primitive :reset_constant_cache
+    raise PrimitiveFailure, "primitive failed"
+  end
+
   def self.save_encloser_path
     Ruby.primitive :save_encloser_path
     raise PrimitiveFailure, "primitive failed"
@@ -612,7 +612,7 @@ module Marshal
     end
 
     def prepare_ivar(ivar)
-      ivar.to_s =~ /\A@/ ? ivar : "@#{ivar}".to_sym
+      /\A@/.match?(ivar.to_s) ? ivar : "@#{ivar}".to_sym
     end
 
     def serialize(obj)
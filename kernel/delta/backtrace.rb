@@ -53,9 +53,9 @@ class Backtrace
 
   def color_from_loc(loc, first)
     return @first_color if first
-    if loc =~ /kernel/
+    if /kernel/.match? loc
       @kernel_color
-    elsif loc =~ /\(eval\)/
+    elsif /\(eval\)/.match? loc
       @eval_color
     else
       ""
@@ -62,6 +62,14 @@ module Compile
     return 0
   end
 
+  # The Config flags that are set on the compiler. They change the code it
+  # generates; none are set until it has been loaded.
+  def self.compiler_flags
+    return [] unless @compiler and @compiler != :loading
+    config = @compiler::Config
+    config.keys.select { |k| config[k] }.map { |k| k.to_s }.sort
+  end
+
   def self.compile_file(path, flags=nil)
     compiler.compile_file(path, flags)
   end
@@ -93,6 +101,27 @@ module Compile
     end
   end
 
+  ##
+  # The Cache named by RBX_CACHE, or nil when there isn't one.
+
+  def self.cache
+    return @cache unless @cache.nil?
+
+    if dir = ENV['RBX_CACHE'] and !dir.empty?
+      size = ENV['RBX_CACHE_SIZE']
+      size = size ? size.to_i * 1024 * 1024 : Cache::DefaultSize
+      @cache = Cache.new dir, size
+    else
+      @cache = false
+    end
+
+    @cache or nil
+  end
+
+  def self.cache=(cache)
+    @cache = cache
+  end
+
   # Called when we encounter a break keyword that we do not support
   # TODO - This leaves a moderately lame stack trace entry
   def self.__unexpected_break__
@@ -198,6 +227,12 @@ module Compile
             raise LoadError, "Invalid .rbc: #{rbc_path}" unless cm
           end
 
+        # Look the source up by its contents instead of beside it
+        elsif cache = Compile.cache and !options[:recompile]
+          compile_feature(rb, requiring) do
+            cm = cache.load rb_path
+          end
+
         # Prefer compiled whenever possible
         elsif !File.file?(rbc_path) or File.mtime(rb_path) > File.mtime(rbc_path) or options[:recompile]
           if $DEBUG_LOADING
@@ -330,6 +365,145 @@ module Compile
     Ruby.primitive :unmarshal_object
   end
 
+  ##
+  # Compiled scripts kept in a directory by the SHA1 of their source, the
+  # compiler version and the VM build, rather than in a .rbc beside each
+  # source file. An unchanged file therefore finds its compiled code
+  # after a fresh checkout or in a read-only deploy directory, and every
+  # process pointed at the same directory shares it.
+  #
+  # Entries are written under a temporary name and renamed into place, so
+  # concurrent writers of one entry each leave a whole file and readers
+  # never see part of one. A hit touches the entry, and once the directory
+  # grows past its size the least recently used entries are removed.
+
+  class Cache
+    DefaultSize = 256 * 1024 * 1024
+
+    # How many entries are stored between looks at the total size.
+    EvictEvery = 32
+
+    def initialize(dir, size)
+      @dir = dir
+      @size = size
+      @hits = 0
+      @misses = 0
+      @stored = 0
+    end
+
+    attr_reader :dir
+    attr_reader :size
+    attr_reader :hits
+    attr_reader :misses
+
+    # Code compiled with different compiler flags is kept apart too.
+    def version_dir
+      build = "#{Rubinius::RBX_VERSION}-#{Rubinius::BUILDREV}".gsub(/[^\w.-]/, '_')
+      flags = Compile.compiler_flags.join(" ").__sha1__[0, 8]
+      File.join @dir, "#{build}-#{Compile.version_number}-#{flags}"
+    end
+
+    # Where the compiled code for +source+ is kept.
+    def path_for(source)
+      digest = source.__sha1__
+      File.join version_dir, digest[0, 2], "#{digest[2..-1]}.rbc"
+    end
+
+    ##
+    # The script CompiledMethod for the file at +path+, compiled only if
+    # no process has compiled the same source before.
+
+    def load(path)
+      entry = path_for File.read(path)
+
+      if File.file? entry and cm = CompiledMethod.load_from_file(entry, Compile.version_number)
+        @hits += 1
+        touch entry
+        relocate cm, path.to_sym
+        return cm
+      end
+
+      @misses += 1
+      cm = Compile.compile_file path
+      raise LoadError, "Unable to compile: #{path}" unless cm
+
+      store cm, entry
+      cm
+    end
+
+    # The same source can be cached from another path, so the methods get
+    # the file name they're being loaded from.
+    def relocate(cm, file)
+      return if cm.file == file
+
+      cm.file = file
+      cm.child_methods.each { |m| relocate m, file }
+    end
+
+    def touch(entry)
+      now = Time.now
+      File.utime now, now, entry
+    rescue SystemCallError
+    end
+
+    # A read-only cache is still read from; it just never grows.
+    def store(cm, entry)
+      make_dir File.dirname(entry)
+
+      tmp = "#{entry}.#{Process.pid}.tmp"
+      Marshal.dump_to_file cm, tmp, Compile.version_number
+      File.rename tmp, entry
+
+      @stored += 1
+      evict if @stored % EvictEvery == 1
+    rescue SystemCallError
+    end
+
+    def make_dir(dir)
+      return if File.directory? dir
+      make_dir File.dirname(dir)
+      Dir.mkdir dir
+    rescue Errno::EEXIST
+    end
+
+    ##
+    # Removes the least recently used entries, of every version, until
+    # the cache is back to three quarters of its size. Temporary files
+    # left behind by a writer that died go too.
+
+    def evict
+      entries = []
+      total = 0
+      stale = Time.now - 600
+
+      Dir["#{@dir}/*/*/*"].each do |file|
+        stat = File::Stat.stat? file
+        next unless stat and stat.file?
+
+        if file.suffix? ".tmp"
+          remove file if stat.mtime < stale
+        else
+          entries << [stat.mtime, stat.size, file]
+          total += stat.size
+        end
+      end
+
+      return if total <= @size
+
+      entries.sort.each do |mtime, size, file|
+        break if total <= @size * 3 / 4
+        remove file
+        total -= size
+      end
+    end
+
+    # Another process may have removed it first.
+    def remove(file)
+      File.unlink file
+    rescue SystemCallError
+    end
+  end
+
 end       # Compile
 
 module Kernel
@@ -103,7 +103,6 @@ end
 # it has been defined in and so forth.
 
 class CompiledMethod
-  # TODO: Delete/reuse cache (field 14) field from C structure
   ivar_as_index :__ivars__ => 0,
                 :primitive => 1,
                 :required => 2,
@@ -118,6 +117,7 @@ class CompiledMethod
                 :exceptions => 11, 
                 :lines => 12, 
                 :path => 13, 
+                :ivar_cache => 14, 
                 :metadata_container => 15, 
                 :compiled => 16, 
                 :staticscope => 17
@@ -279,6 +279,7 @@ class CompiledMethod
 
   def literals=(tup)
     @literals = tup
+    @ivar_cache = nil
   end
 
   def args=(tup)
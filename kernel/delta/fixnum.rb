@@ -39,10 +39,6 @@ class Fixnum < Integer
     raise RangeError, "Object is out of range for a Fixnum" unless c.is_a?(Fixnum)
     return self >> -c if c < 0
 
-    bits = self.size * 8 - 1
-    if (c > bits || self >> bits - c > 0 || c.kind_of?(Bignum))
-      return __bignum_new__(self) << c
-    end
     __fixnum_left_shift__(c)
   end
 
@@ -1,6 +1,7 @@
 # depends on: enumerable.rb misc.rb class.rb
 
 class Hash
+  ivar_as_index :__ivars__ => 0, :index => 1, :values => 2, :bins => 3, :entries => 4, :default => 5, :default_proc => 6, :used => 7
 
   #--
   # The result of #hash is not allowed to be larger than this.
@@ -60,26 +61,41 @@ class Hash
   end
 
   ##
-  # looks for a key in a bin found by hash_entry
+  # Returns the number of the entry for +key+, or nil. Entry +i+ has its
+  # key at 3 * i + 1 and its value at 3 * i + 2 in @values. The primitive
+  # fails when only #eql? can tell whether a key with the same hash
+  # matches.
+
+  def find_entry(key, hash)
+    Ruby.primitive :hash_find_entry
+    candidates(hash).each do |i|
+      return i if key.eql?(@values.at(i * 3 + 1))
+    end
+    nil
+  end
+  private :find_entry
 
-  def search_bin(entry,hash,key)
-    while entry
-      cur_hash, cur_key, cur_val, nxt = *entry
+  def candidates(hash)
+    Ruby.primitive :hash_candidates
+    raise PrimitiveFailure, "Hash#candidates primitive failed"
+  end
+  private :candidates
 
-      if cur_hash == hash and key.eql?(cur_key)
-        return entry
-      end
+  def append(hash, key, val)
+    Ruby.primitive :hash_append
+    raise PrimitiveFailure, "Hash#append primitive failed"
+  end
+  private :append
 
-      entry = nxt
-    end
-    return Undefined
+  def delete_entry(i)
+    Ruby.primitive :hash_delete_entry
+    raise PrimitiveFailure, "Hash#delete_entry primitive failed"
   end
-  private :search_bin
-  
+  private :delete_entry
+
   def fetch(key, default = Undefined)
-    entry, hash, = hash_entry key
-    entry = search_bin(entry,hash,key)
-    return entry[2] if(entry != Undefined)
+    i = find_entry key, key_hash(key)
+    return @values.at(i * 3 + 2) if i
 
     return yield(key) if block_given?
     return default if !default.equal?(Undefined)
@@ -87,47 +103,24 @@ class Hash
   end
   
   def get_key_cv(key)
-    entry, hash, = hash_entry key
-    entry = search_bin(entry,hash,key)
-    return entry[2] if(entry != Undefined)
+    Ruby.primitive :hash_aref
+    i = find_entry key, key_hash(key)
+    return @values.at(i * 3 + 2) if i
     
     return default(key)
   end
   
   def set_key_cv(key, val)
+    Ruby.primitive :hash_aset
     key = key.dup if key.kind_of?(String)
 
-    redistribute
-    
-    entry, hash, bin = hash_entry key
-    lst = nil
-
-    while entry
-      cur_hash, cur_key, cur_val, nxt = *entry
-
-      # Check if this entry is for the key in question
-      if cur_hash == hash and key.eql?(cur_key)
-        entry.put 2, val
-        return val
-      end
-
-      lst = entry
-      entry = nxt
-    end
-
-    entry = Tuple.new(4)
-    entry.put 0, hash
-    entry.put 1, key
-    entry.put 2, val
-    entry.put 3, nil
-
-    if lst
-      lst.put 3, entry
+    hash = key_hash key
+    if i = find_entry(key, hash)
+      @values.put i * 3 + 2, val
     else
-      @values.put bin, entry
+      append hash, key, val
     end
 
-    @entries += 1
     return val
   end
   alias_method :store, :set_key_cv
@@ -138,7 +131,8 @@ class Hash
   end
 
   def clear()
-    delete_if { true }
+    Ruby.primitive :hash_clear
+    raise PrimitiveFailure, "Hash#clear primitive failed"
   end
 
   def clone
@@ -168,30 +162,8 @@ class Hash
   end
 
   def delete(key)
-    entry, hash, bin = hash_entry key
-    lst = nil
-
-    while entry
-      cur_hash, cur_key, val, nxt = *entry
-
-      # Check if this entry is for the key in question
-      if cur_hash == hash and key.eql?(cur_key)
-
-        # Ok, relink the other entries, leaving this one out.
-        if lst
-          lst.put 3, nxt
-        else
-          @values.put bin, nxt
-        end
-
-        @entries = @entries - 1
-
-        return val
-      end
-
-      lst = entry
-      entry = nxt
-    end
+    i = find_entry key, key_hash(key)
+    return delete_entry(i) if i
 
     return yield(key) if block_given?
     nil
@@ -221,14 +193,18 @@ class Hash
     self
   end
 
+  # Entries are yielded in insertion order. A removed entry has nil in
+  # place of its hash; entries added by the block are not yielded.
+
   def each
     raise LocalJumpError, "no block given" unless block_given? or empty?
 
-    @values.each do |tup|
-      while tup
-        yield([tup.at(1), tup.at(2)])
-        tup = tup.at(3)
-      end
+    values = @values
+    i = 0
+    total = @used * 3
+    while i < total
+      yield([values.at(i + 1), values.at(i + 2)]) if values.at(i)
+      i += 3
     end
     self
   end
@@ -236,11 +212,12 @@ class Hash
   def each_pair
     raise LocalJumpError, "no block given" unless block_given? or empty?
 
-    @values.each do |tup|
-      while tup
-        yield(tup.at(1), tup.at(2))
-        tup = tup.at(3)
-      end
+    values = @values
+    i = 0
+    total = @used * 3
+    while i < total
+      yield(values.at(i + 1), values.at(i + 2)) if values.at(i)
+      i += 3
     end
     self
   end
@@ -283,17 +260,7 @@ class Hash
   end
 
   def key?(key)
-    entry, hash, = hash_entry key
-
-    while entry do # REFACTOR this loop is duplicated many times
-      cur_hash, cur_key, cur_val, nxt = *entry
-
-      return true if cur_hash == hash and key.eql?(cur_key)
-
-      entry = nxt
-    end
-
-    false
+    find_entry(key, key_hash(key)) ? true : false
   end
 
   alias_method :has_key?, :key?
@@ -301,14 +268,8 @@ class Hash
   alias_method :member?, :key?
 
   def keys()
-    out = []
-    @values.each do |tup|
-      while tup
-        out << tup.at(1)
-        tup = tup.at(3)
-      end
-    end
-    out
+    Ruby.primitive :hash_keys
+    raise PrimitiveFailure, "Hash#keys primitive failed"
   end
 
   def merge(other, &block)
@@ -353,8 +314,7 @@ class Hash
   def replace(other)
     other = Type.coerce_to(other, Hash, :to_hash)
     return self if self.equal? other
-    clear
-    other.each_pair { |k, v| self[k] = v }
+    copy_from other
     if other.default_proc
       @default = other.default_proc
       @default_proc = true
@@ -365,6 +325,13 @@ class Hash
     self
   end
 
+  def copy_from(other)
+    Ruby.primitive :hash_replace
+    clear
+    other.each_pair { |k, v| self[k] = v }
+  end
+  private :copy_from
+
   def select()
     raise LocalJumpError, "no block given" unless block_given? or empty?
 
@@ -376,21 +343,10 @@ class Hash
   def shift()
     return default(nil) if empty?
 
-    # TODO: keep around for efficiency?  It's not much faster though.
-    # i = 0
-    # tup = nil
-    # while !tup
-    #   tup = @values.at(i)
-    #   i += 1
-    # end
-    # key = tup.at(1)
-    # out = [key, self[key]]
-    # delete(key)
-    # out
-
-    key = keys.first
-    out = [key, self[key]]
-    delete key
+    i = 0
+    i += 1 until @values.at(i * 3)
+    out = [@values.at(i * 3 + 1), @values.at(i * 3 + 2)]
+    delete_entry i
     out
   end
 
@@ -421,14 +377,8 @@ class Hash
   alias_method :has_value?, :value?
 
   def values()
-    out = []
-    @values.each do |tup|
-      while tup
-        out << tup.at(2)
-        tup = tup.at(3)
-      end
-    end
-    out
+    Ruby.primitive :hash_values
+    raise PrimitiveFailure, "Hash#values primitive failed"
   end
 
   def values_at(*args)
@@ -437,15 +387,11 @@ class Hash
   alias_method :indexes, :values_at
   alias_method :indices, :values_at
 
-  def hash_entry(obj)
+  def key_hash(obj)
     hash = obj.hash
     hash = hash % HASH_MAX unless hash.kind_of? Fixnum
-
-    bin = hash & (@bins - 1)
-
-    entry = @values.at bin
-
-    return entry, hash, bin
+    hash
   end
+  private :key_hash
 
 end
@@ -7,12 +7,13 @@ class IO
   BufferSize = 8096
 
   class Buffer < String
-    ivar_as_index :bytes => 0, :characters => 1, :encoding => 2, :data => 3, :hash => 4, :shared => 5
+    ivar_as_index :bytes => 0, :characters => 1, :encoding => 2, :data => 3, :hash => 4, :shared => 5, :start => 6
 
     # Create a buffer of +size+ bytes. The buffer contains an internal Channel
     # object it uses to fill itself.
     def initialize(size)
       @data = ByteArray.new(size)
+      @start = 0
       @bytes = 0
       @characters = 0
       @encoding = :buffer
@@ -33,6 +34,22 @@ class IO
       @total - @bytes
     end
 
+    # The buffer's bytes are shifted and refilled in place, so substrings
+    # are copies rather than views of its data.
+    def substring(start, count)
+      return if count < 0 || start > @bytes || -start > @bytes
+
+      start += @bytes if start < 0
+      count = @bytes - start if start + count > @bytes
+      count = 0 if count < 0
+
+      str = self.class.template count, 0
+      str.copy_from self, start, count, 0
+      str.taint if self.tainted?
+
+      return str
+    end
+
     # Remove +count+ bytes from the front of the buffer and return them.
     # All other bytes are moved up.
     def shift_front(count)
@@ -151,10 +151,14 @@ class InstructionSet
     {:opcode => :meta_push_0, :args => [], :stack => [0,1]},
     {:opcode => :meta_push_1, :args => [], :stack => [0,1]},
     {:opcode => :meta_push_2, :args => [], :stack => [0,1]},
-    {:opcode => :unused, :args => [], :stack => [0,0]},
-    {:opcode => :unused, :args => [], :stack => [0,0]},
-    {:opcode => :unused, :args => [], :stack => [0,0]},
-    {:opcode => :unused, :args => [], :stack => [0,0]},
+    {:opcode => :meta_send_op_mul, :args => [], :stack => [2,1],
+      :flow => :send, :vm_flags => [:check_interrupts]},
+    {:opcode => :meta_send_op_div, :args => [], :stack => [2,1],
+      :flow => :send, :vm_flags => [:check_interrupts]},
+    {:opcode => :meta_send_op_mod, :args => [], :stack => [2,1],
+      :flow => :send, :vm_flags => [:check_interrupts]},
+    {:opcode => :meta_send_op_le, :args => [], :stack => [2,1],
+      :flow => :send, :vm_flags => [:check_interrupts]},
     {:opcode => :meta_send_op_plus, :args => [], :stack => [2,1],
       :flow => :send, :vm_flags => [:check_interrupts]},
     {:opcode => :meta_send_op_minus, :args => [], :stack => [2,1],
@@ -173,7 +177,8 @@ class InstructionSet
       :stack => [0,1]},
     {:opcode => :set_local_depth, :args => [:depth, :block_local],
       :stack => [1,1], :vm_flags => []},
-    {:opcode => :unused, :args => [], :stack => [0,0]},
+    {:opcode => :meta_send_op_ge, :args => [], :stack => [2,1],
+      :flow => :send, :vm_flags => [:check_interrupts]},
     {:opcode => :send_off_stack, :args => [], :stack => [-133,1],
       :flow => :send, :vm_flags => [:check_interrupts]},
     {:opcode => :locate_method, :args => [], :stack => [3,1]},
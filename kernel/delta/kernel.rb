@@ -241,6 +241,10 @@ module Kernel
 
     return self.to_s unless iv
 
+    # Ivars laid out by shape come back from get_instance_variables
+    # as name, value pairs.
+    iv = get_instance_variables if iv.is_a?(Tuple)
+
     if (iv.is_a?(Hash) or iv.is_a?(Tuple)) and iv.empty?
       return self.to_s
     end
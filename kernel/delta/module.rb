@@ -21,7 +21,11 @@ class Module
   def constants_table ; @constants    ; end
   def encloser        ; @encloser  ; end
   
-  def constants_table=(c) ; @constants = c    ; end
+  def constants_table=(c)
+    @constants = c
+    Rubinius::VM.reset_constant_cache
+  end
+
   def method_table=(m)    ; @method_table = m ; end
 
   def self.nesting
@@ -661,6 +665,7 @@ class Module
       value.set_name_if_necessary(name, self)
     end
     constants_table[normalize_const_name(name)] = value
+    Rubinius::VM.reset_constant_cache
 
     return value
   end
@@ -820,6 +825,7 @@ class Module
     raise ArgumentError, "empty file name" if path.empty?
     trigger = Autoload.new(name, self, path)
     constants_table[name] = trigger
+    Rubinius::VM.reset_constant_cache
     return nil
   end
 
@@ -834,7 +840,9 @@ class Module
   def remove_const(name)
     sym = name.to_sym
     const_missing(name) unless constants_table.has_key?(sym)
-    constants_table.delete(sym)
+    value = constants_table.delete(sym)
+    Rubinius::VM.reset_constant_cache
+    value
   end
 
   private :remove_const
@@ -904,7 +912,7 @@ class Module
   #++
 
   def valid_const_name?(name)
-    name.to_s =~ /^((::)?[A-Z]\w*)+$/ ? true : false
+    /^((::)?[A-Z]\w*)+$/.match? name.to_s
   end
 
   private :valid_const_name?
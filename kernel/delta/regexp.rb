@@ -263,6 +263,17 @@ class Regexp
     search_region(str, count, str.size, true)
   end
 
+  # Returns true if the pattern matches +str+ at or after +pos+. Unlike
+  # #match and #=~ no MatchData is made and $~ is left alone, so use this
+  # when only the answer is needed.
+  def match?(str, pos = 0)
+    return false if str.nil?
+    str = StringValue(str)
+    pos += str.size if pos < 0
+    return false if pos < 0 or pos > str.size
+    search_p(str, pos, str.size)
+  end
+
   class SourceParser
     class Part
       OPTIONS_MAP = {'m' => Regexp::MULTILINE, 'i' => Regexp::IGNORECASE, 'x' => Regexp::EXTENDED}
@@ -1,22 +1,98 @@
 ##
 # Interface to VM's sampling profiler.
+#
+# The VM records the whole stack on every tick and hands back each
+# distinct stack with how many times it was seen. #display prints a flat
+# profile, and with PROFILE_FULL set a call graph, #collapsed prints the
+# stacks in the folded format flamegraph.pl reads and #callgrind writes
+# a file for KCachegrind and callgrind_annotate.
+#
+# In :wall mode (the default) the ticks are wall clock time, so time
+# spent waiting counts; in :cpu mode only time spent on a CPU does.
+# PROFILE_FREQ and PROFILE_MODE set the defaults.
 
 class Sampler
-  def initialize(freq=nil)
+  Modes = { :wall => 0, :cpu => 1 }
+
+  # Kinds of frame, see cpu_sample.c
+  MethodFrame    = 1
+  BlockFrame     = 2
+  PrimitiveFrame = 3
+  GCFrame        = 4
+
+  ##
+  # One distinct place the VM was seen running.
+
+  class Frame
+    attr_reader :kind
+    attr_reader :module_name
+    attr_reader :method_name
+    attr_reader :file
+    attr_reader :line
+
+    def initialize(kind, mod, meta, method, file, line)
+      @kind = kind
+      @module_name = mod
+      @meta = meta
+      @method_name = method
+      @file = file
+      @line = line
+    end
+
+    def name
+      @name ||= case @kind
+                when PrimitiveFrame
+                  "VM.primitive => #{Rubinius::Primitives[@method_name]}"
+                when GCFrame
+                  "VM.garbage_collection"
+                else
+                  name = if @module_name
+                           "#{@module_name}#{@meta ? '.' : '#'}#{@method_name}"
+                         else
+                           @method_name ? @method_name.to_s : "<unknown>"
+                         end
+                  @kind == BlockFrame ? "#{name} {}" : name
+                end
+    end
+
+    def file_name
+      @file ? @file.to_s : "<#{@kind == GCFrame ? 'gc' : 'vm'}>"
+    end
+  end
+
+  attr_reader :frames
+  attr_reader :stacks
+  attr_reader :dropped
+
+  def initialize(freq=nil, mode=nil)
     @frequency = freq
     @frequency ||= ENV['PROFILE_FREQ'].to_i
     @frequency = 100 if @frequency == 0
 
+    @mode = (mode || ENV['PROFILE_MODE'] || :wall).to_sym
+    unless Modes.key? @mode
+      raise ArgumentError, "unknown sampler mode #{@mode}, use wall or cpu"
+    end
+
     @call_graph = ENV['PROFILE_FULL']
   end
 
   def start
-    @start_clock = activate(@frequency)
+    @start_clock = activate(@frequency, Modes[@mode])
     nil
   end
 
+  ##
+  # Stops sampling. #stacks is then an Array of [frames, count], the
+  # frames of each going from the root to where the VM was.
+
   def stop
-    @results, @last_clock, @gc_cycles = terminate()
+    frames, stacks, @total_slices, @gc_slices, @dropped, @last_clock = terminate()
+
+    @frames = frames.to_a.map { |f| Frame.new(*f.to_a) }
+    @stacks = stacks.to_a.map do |stack|
+      [stack.at(0).to_a.map { |i| @frames[i] }, stack.at(1)]
+    end
     nil
   end
 
@@ -43,59 +119,47 @@ class Sampler
       @slices + @descendants_slices
     end
 
-    def count_parent(call)
+    def count_parent(call, count)
       if call
-        @parents[call] += 1
-        call.children[self] += 1
+        @parents[call] += count
+        call.children[self] += count
       end
     end
   end
 
   def display(out=STDOUT)
-    @total_slices = 0
     @calls = Hash.new { |h,k| h[k] = Call.new(k) }
 
-    @results.each do |ent|
-      next unless ent
-
-      @total_slices += 1
-
-      call = find_call(ent)
-      call.slices += 1
-
-      # skip context unwinding for a primitive
-      next if ent.kind_of? Fixnum
+    @stacks.each do |frames, count|
+      call = @calls[frames.last.name]
+      call.slices += count
 
-      if @call_graph
-        # count parents and children
-        call.count_parent(find_call(ent.sender))
+      next unless @call_graph
 
-        # calc descendants
-        seen_calls = { call => 1 }
+      call.count_parent(@calls[frames[-2].name], count) if frames.size > 1
 
-        while true
-          ent = ent.sender
-          break unless ent
+      # calc descendants, counting each call only once per stack
+      seen_calls = { call => 1 }
+      (frames.size - 2).downto(0) do |i|
+        c = @calls[frames[i].name]
+        c.count_parent(@calls[frames[i - 1].name], count) if i > 0
 
-          c = find_call(ent)
-
-          # unwind to the root, but count each call only once
-          unless seen_calls[c]
-            seen_calls[c] = 1
-
-            c.descendants_slices += 1
-          end
+        unless seen_calls[c]
+          seen_calls[c] = 1
+          c.descendants_slices += count
         end
       end
     end
 
-    @calls["VM.garbage_collection"].slices = @gc_cycles
-
-    out << "Total slices: #{@total_slices}, #{@last_clock - @start_clock} clocks\n\n"
+    out << "Total slices: #{@total_slices}, #{@last_clock - @start_clock} clocks"
+    out << ", #{@gc_slices} in GC" if @gc_slices > 0
+    out << ", #{@dropped} dropped" if @dropped > 0
+    out << "\n\n"
     out << "=== FLAT PROFILE ===\n\n"
     out << " % time   slices   name\n"
 
     @calls.sort { |a, b| b[1].slices <=> a[1].slices }.each do |name, call|
+      next if call.slices == 0
       out.printf " %6.2f %8d    %s\n", percent(call.slices), call.slices, name
     end
 
@@ -118,17 +182,74 @@ class Sampler
     nil
   end
 
-  def context_name(entry)
-    # a Fixnum means that a primitive was running
-    if entry.kind_of? Fixnum
-      "VM.primitive => #{Rubinius::Primitives[entry]}"
-    else
-      entry.normalized_name
+  ##
+  # Writes one line per distinct stack, the frame names from the root
+  # separated by ';' and then the count, which is what flamegraph.pl
+  # reads.
+
+  def collapsed(out=STDOUT)
+    folded = Hash.new(0)
+    @stacks.each do |frames, count|
+      folded[frames.map { |f| f.name }.join(";")] += count
     end
+
+    folded.sort.each { |stack, count| out << "#{stack} #{count}\n" }
+    nil
   end
 
-  def find_call(entry)
-    @calls[context_name(entry)]
+  ##
+  # Writes the profile in the callgrind format. The cost of a line is
+  # the slices spent on it, the cost of a call the slices spent below it.
+
+  def callgrind(out=STDOUT)
+    costs = Hash.new { |h,k| h[k] = Hash.new(0) }
+    calls = Hash.new { |h,k| h[k] = Hash.new(0) }
+    files = {}
+
+    @stacks.each do |frames, count|
+      frames.each { |f| files[f.name] ||= f.file_name }
+
+      leaf = frames.last
+      costs[leaf.name][leaf.line] += count
+
+      # a recursive call is only charged once
+      seen = {}
+      0.upto(frames.size - 2) do |i|
+        caller, callee = frames[i], frames[i + 1]
+        key = [caller.name, callee.name, caller.line]
+        next if seen[key]
+        seen[key] = true
+        calls[caller.name][[callee.name, caller.line]] += count
+      end
+    end
+
+    out << "version: 1\n"
+    out << "creator: rubinius sampler\n"
+    out << "positions: line\n"
+    out << "events: Samples\n"
+    out << "summary: #{@total_slices}\n"
+
+    (costs.keys | calls.keys).sort.each do |name|
+      out << "\nfl=#{files[name]}\nfn=#{name}\n"
+      costs[name].sort.each { |line, count| out << "#{line} #{count}\n" }
+      calls[name].sort.each do |(callee, line), count|
+        out << "cfl=#{files[callee]}\ncfn=#{callee}\n"
+        out << "calls=#{count} 0\n#{line} #{count}\n"
+      end
+    end
+    nil
+  end
+
+  Formats = { :flat => :display, :collapsed => :collapsed, :callgrind => :callgrind }
+
+  ##
+  # Writes the profile to +out+ as :flat, :collapsed or :callgrind.
+
+  def write(out, format=:flat)
+    unless writer = Formats[format.to_sym]
+      raise ArgumentError, "unknown profile format #{format}"
+    end
+    __send__ writer, out
   end
 
   def percent(slices)
@@ -23,22 +23,26 @@ class String
                 :encoding   => 2,
                 :data       => 3,
                 :hash       => 4,
-                :shared     => 5)
+                :shared     => 5,
+                :start      => 6)
 
   def bytes     ; @bytes      ; end
   def characters; @characters ; end
   def encoding  ; @encoding   ; end
   def data      ; @data       ; end
+  def start     ; @start      ; end
   def __ivars__ ; nil         ; end
 
   def bytes=(b)     ; @bytes = b      ; end
   def characters=(c); @characters = c ; end
   def encoding=(e)  ; @encoding = e   ; end
   def data=(d)      ; @data = d       ; end
+  def start=(s)     ; @start = s      ; end
 
   def self.allocate
     str = super()
     str.data = ByteArray.new(1)
+    str.start = 0
     str.bytes = 0
     str.characters = 0
     str.encoding = nil
@@ -146,13 +150,11 @@ class String
   #    "abcdef" <=> "abcdefg"   #=> -1
   #    "abcdef" <=> "ABCDEF"    #=> 1
   def <=>(other)
-    if other.kind_of?(String)
-      @data.compare_bytes(other.data, @bytes, other.size)
-    else
-      return unless other.respond_to?(:to_str) && other.respond_to?(:<=>)
-      return unless tmp = (other <=> self)
-      return -tmp # We're not supposed to convert to integer here
-    end
+    Ruby.primitive :string_compare
+
+    return unless other.respond_to?(:to_str) && other.respond_to?(:<=>)
+    return unless tmp = (other <=> self)
+    return -tmp # We're not supposed to convert to integer here
   end
 
   # call-seq:
@@ -175,7 +177,7 @@ class String
     end
 
     return false unless @bytes == other.size
-    return @data.compare_bytes(other.data, @bytes, other.size) == 0
+    return (self <=> other) == 0
   end
   alias_method :===, :==
 
@@ -296,7 +298,7 @@ class String
       index = @bytes + index if index < 0
 
       return if index < 0 || @bytes <= index
-      return @data[index]
+      return @data[@start + index]
     end
   end
   alias_method :slice, :[]
@@ -440,8 +442,8 @@ class String
 
     i = 0
     while i < size
-      a = @data[i]
-      b = to.data[i]
+      a = @data[@start + i]
+      b = to.data[to.start + i]
       i += 1
 
       r = a - b
@@ -500,9 +502,9 @@ class String
     sep = StringValue sep
 
     if (sep == $/ && sep == DEFAULT_RECORD_SEPARATOR) || sep == "\n"
-      c = @data[@bytes-1]
+      c = @data[@start + @bytes-1]
       if c == ?\n
-        @bytes -= 1 if @bytes > 1 && @data[@bytes-2] == ?\r
+        @bytes -= 1 if @bytes > 1 && @data[@start + @bytes-2] == ?\r
       elsif c != ?\r
         return
       end
@@ -511,8 +513,8 @@ class String
       @bytes = @characters = @bytes - 1
     elsif sep.size == 0
       size = @bytes
-      while size > 0 && @data[size-1] == ?\n
-        if size > 1 && @data[size-2] == ?\r
+      while size > 0 && @data[@start + size-1] == ?\n
+        if size > 1 && @data[@start + size-2] == ?\r
           size -= 2
         else
           size -= 1
@@ -580,8 +582,10 @@ class String
 
     table = count_table(*strings).data
 
-    count = i = 0
-    while i < @bytes
+    count = 0
+    i = @start
+    stop = @start + @bytes
+    while i < stop
       count += 1 if table[@data[i]] == 1
       i += 1
     end
@@ -679,7 +683,7 @@ class String
   def each_byte()
     i = 0
     while i < @bytes do
-      yield @data.get_byte(i)
+      yield @data.get_byte(@start + i)
       i += 1
     end
     self
@@ -689,7 +693,7 @@ class String
   def each_char()
     i = 0
     while i < @bytes do
-      yield @data.get_byte(i).chr
+      yield @data.get_byte(@start + i).chr
       i += 1
     end
     self
@@ -737,15 +741,15 @@ class String
 
     last, i = 0, ssize
     while i < size
-      if ssize == 0 && @data[i] == ?\n
-        if @data[i+=1] != ?\n
+      if ssize == 0 && @data[@start + i] == ?\n
+        if @data[@start + (i+=1)] != ?\n
           i += 1
           next
         end
-        i += 1 while i < size && @data[i] == ?\n
+        i += 1 while i < size && @data[@start + i] == ?\n
       end
 
-      if i > 0 && @data[i-1] == newline &&
+      if i > 0 && @data[@start + i-1] == newline &&
           (ssize < 2 || sep.compare_substring(self, i-ssize, ssize) == 0)
         line = substring last, i-last
         line.taint if tainted?
@@ -779,7 +783,7 @@ class String
   def eql?(other)
     Ruby.primitive :string_equal
     return false unless other.is_a?(String) && other.size == @bytes
-    (@data.fetch_bytes(0, @bytes) <=> other.data.fetch_bytes(0, @bytes)) == 0
+    (self <=> other) == 0
   end
 
   # Returns a copy of <i>self</i> with <em>all</em> occurrences of <i>pattern</i>
@@ -933,7 +937,7 @@ class String
     case needle
     when Fixnum
       (offset...self.size).each do |i|
-        return i if @data[i] == needle
+        return i if @data[@start + i] == needle
       end
     when String
       return offset if needle == ""
@@ -943,8 +947,9 @@ class String
       max = @bytes - needle_size
       return if max < 0 # <= 0 maybe?
 
+      first = needle.data[needle.start]
       offset.upto(max) do |i|
-        if @data[i] == needle.data[0]
+        if @data[@start + i] == first
           return i if substring(i, needle_size) == needle
         end
       end
@@ -997,6 +1002,8 @@ class String
     end
     @bytes = size
     @data = str.data
+    @start = 0
+    @shared = nil
     taint if other.tainted?
 
     self
@@ -1017,7 +1024,7 @@ class String
     else
       str = "\""
       i = -1
-      str << @data[i].toprint while (i += 1) < @bytes
+      str << @data[@start + i].toprint while (i += 1) < @bytes
       str << "\""
     end
     str.taint if tainted?
@@ -1061,7 +1068,7 @@ class String
 
     start = 0
     while start < @bytes
-      c = @data[start]
+      c = @data[@start + start]
       if c.isspace or c == 0
         start += 1
       else
@@ -1116,6 +1123,7 @@ class String
     @shared = true
     other.shared!
     @data = other.data
+    @start = other.start
     @bytes = other.bytes
     @characters = other.characters
     @encoding = other.encoding
@@ -1215,7 +1223,7 @@ class String
 
     stop = @bytes - 1
     while stop >= 0
-      c = @data[stop]
+      c = @data[@start + stop]
       if c.isspace || c == 0
         stop -= 1
       else
@@ -1688,7 +1696,7 @@ class String
   def sum(bits = 16)
     bits = Type.coerce_to bits, Integer, :to_int unless bits.__kind_of__ Fixnum
     i, sum = -1, 0
-    sum += @data[i] while (i += 1) < @bytes
+    sum += @data[@start + i] while (i += 1) < @bytes
     sum & ((1 << bits) - 1)
   end
 
@@ -1860,15 +1868,16 @@ class String
     expanded = source.tr_expand! nil
     size = source.size
     src = source.data
+    src_start = source.start
 
     if invert
       replacement.tr_expand! nil
-      r = replacement.data[replacement.size-1]
+      r = replacement.data[replacement.start + replacement.size-1]
       table = Tuple.template 256, r
 
       i = 0
       while i < size
-        table[src[i]] = -1
+        table[src[src_start + i]] = -1
         i += 1
       end
     else
@@ -1876,11 +1885,12 @@ class String
 
       replacement.tr_expand! expanded
       repl = replacement.data
+      repl_start = replacement.start
       rsize = replacement.size
       i = 0
       while i < size
-        r = repl[i] if i < rsize
-        table[src[i]] = r
+        r = repl[repl_start + i] if i < rsize
+        table[src[src_start + i]] = r
         i += 1
       end
     end
@@ -1924,7 +1934,7 @@ class String
     result = ""
     while index < @bytes
       current = index
-      while current < @bytes && @data[current] != ?\\
+      while current < @bytes && @data[@start + current] != ?\\
         current += 1
       end
       result << substring(index, current - index)
@@ -1937,7 +1947,7 @@ class String
       end
       index = current + 1
 
-      result << case (cap = @data[index])
+      result << case (cap = @data[@start + index])
         when ?&
           match[0]
         when ?`
@@ -1962,7 +1972,7 @@ class String
     detect_base = true if base == 0
 
     raise(ArgumentError,
-          "invalid value for Integer: #{inspect}") if check and self =~ /__/
+          "invalid value for Integer: #{inspect}") if check and /__/.match?(self)
 
     s = if check then
           self.strip
@@ -2109,10 +2119,12 @@ class String
     str
   end
 
-  # Unshares shared strings.
+  # Unshares shared strings. A substring view gets a copy of just its own
+  # bytes rather than all of its parent's data.
   def modify!
     if @shared
-      @data = @data.dup
+      @data = @data.fetch_bytes(@start, @bytes)
+      @start = 0
       @shared = nil
     end
   end
@@ -2251,15 +2263,15 @@ class String
     raise ArgumentError, err if self.match(/__/) || self.empty?
     case self
     when /^[-+]?0(\d|_\d)/
-      raise ArgumentError, err if self =~ /[^0-7_]/
+      raise ArgumentError, err if /[^0-7_]/.match?(self)
       to_i(8)
     when /^[-+]?0x[a-f\d]/i
       after = self.match(/^[-+]?0x/i)
-      raise ArgumentError, err if /([^0-9a-f_])/i.match_from(self, after.end(0))
+      raise ArgumentError, err if /([^0-9a-f_])/i.match?(self, after.end(0))
       to_i(16)
     when /^[-+]?0b[01]/i
       after = self.match(/^[-+]?0b/i)
-      raise ArgumentError, err if /[^01_]/.match_from(self, after.end(0))
+      raise ArgumentError, err if /[^01_]/.match?(self, after.end(0))
       to_i(2)
     when /^[-+]?\d/
       raise ArgumentError, err if self.match(/[^0-9_]/)
@@ -4,10 +4,11 @@
 # Stores all of the Symbols.
 
 class SymbolTable
-  ivar_as_index :__ivars__ => 0, :symbols => 1, :strings => 2
+  ivar_as_index :__ivars__ => 0, :symbols => 1, :index => 2, :entries => 3
   def __ivars__; @__ivars__ ; end
   def symbols  ; @symbols   ; end
-  def strings  ; @strings   ; end
+  def index    ; @index     ; end
+  def entries  ; @entries   ; end
 end
 
 class Symbol
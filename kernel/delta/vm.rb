@@ -67,4 +67,73 @@ class Rubinius::VM
   def self.debug_channel
     @debug_channel
   end
+
+  ##
+  # Turns the method profiler on or off. While it's on the VM counts the
+  # calls of every method and block and the time spent in them, without
+  # signals or sampling. RBX=rbx.profile.methods turns it on at startup.
+
+  def self.profile_methods=(on)
+    method_profile_enable on
+  end
+
+  ##
+  # Returns what the method profiler counted since it was turned on or
+  # last reset, as an Array of [method, module, calls, inclusive seconds,
+  # exclusive seconds], the most exclusive time first. The inclusive time
+  # of a method includes the time spent in the methods and blocks it
+  # called, the exclusive time doesn't. Starts counting again from zero
+  # if +reset+ is true.
+
+  def self.method_profile(reset=false)
+    entries, hz = method_profile_snapshot reset
+    hz = hz.to_f
+
+    profile = entries.to_a.map do |e|
+      [e.at(0), e.at(1), e.at(2), e.at(3) / hz, e.at(4) / hz]
+    end
+    profile.sort { |a, b| b[4] <=> a[4] }
+  end
+
+  # The groups of tracing probes, see shotgun/lib/probes.h
+  Probes = {
+    :function => 1,
+    :gc       => 2,
+    :alloc    => 4,
+    :thread   => 8,
+    :io       => 16
+  }
+
+  ##
+  # Turns on the tracing probes in +names+, which are keys of Probes or
+  # :all, and turns off the rest. While they are on the VM records calls
+  # and returns, collections, allocations, thread switches and waits for
+  # I/O into a ring buffer, keeping the newest events. RBX=rbx.probes=names
+  # turns them on at startup, with the names separated by commas, and
+  # writes the events to rbx.probes.output (rbx-probes.out) at exit.
+
+  def self.probes=(names)
+    mask = 0
+    Array(names).each do |name|
+      if name == :all
+        mask |= Probes.values.inject(0) { |m, v| m | v }
+      else
+        bit = Probes[name]
+        raise ArgumentError, "unknown probe: #{name.inspect}" unless bit
+        mask |= bit
+      end
+    end
+
+    probe_enable mask
+    names
+  end
+
+  ##
+  # Writes the events in the probes' ring buffer to +path+ and returns how
+  # many there were. lib/bin/trace turns the file into a timeline or a
+  # Chrome trace.
+
+  def self.dump_probes(path)
+    probe_dump StringValue(path)
+  end
 end
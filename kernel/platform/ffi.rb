@@ -386,6 +386,30 @@ class MemoryPointer
     self + (which * @type_size)
   end
 
+  # Read the value of FFI +type+ at +offset+ bytes past the address
+  # pointed to. +type+ is a type name such as :int, or its FFI::TYPE_*
+  # code. The read is done directly by the VM, not through a C function.
+  #
+  # Example:
+  #   ptr.get_at(4, :short)
+  #
+  # c-equiv:
+  #   *(short*)((char*)ptr + 4);
+  #
+  def get_at(offset, type)
+    Ruby.primitive :memptr_get_at
+    return get_at(offset, FFI.find_type(type)) unless type.kind_of? Fixnum
+    raise ArgumentError, "unable to read type #{type} through #{inspect}"
+  end
+
+  # Write +obj+ as a value of FFI +type+ at +offset+ bytes past the address
+  # pointed to. See #get_at.
+  def put_at(offset, type, obj)
+    Ruby.primitive :memptr_put_at
+    return put_at(offset, FFI.find_type(type), obj) unless type.kind_of? Fixnum
+    raise ArgumentError, "unable to write type #{type} through #{inspect}"
+  end
+
   # Release the memory pointed to back to the OS.
   def free
     self.autorelease = false
@@ -432,29 +456,27 @@ class MemoryPointer
   end
 
   def write_float(obj)
-    # TODO: ffi needs to be fixed for passing [:pointer, double]
-    #       when :pointer is a (double *)
-    self.class.write_float self, Float(obj)
+    put_at 0, FFI::TYPE_DOUBLE, Float(obj)
   end
 
   def read_float
-    self.class.read_float self
+    get_at 0, FFI::TYPE_DOUBLE
   end
 
   def read_array_of_int(length)
-    read_array_of_type(:int, :read_int, length)
+    read_array_of(:int, length)
   end
 
   def write_array_of_int(ary)
-    write_array_of_type(:int, :write_int, ary)
+    write_array_of(:int, ary)
   end
 
   def read_array_of_long(length)
-    read_array_of_type(:long, :read_long, length)
+    read_array_of(:long, length)
   end
 
   def write_array_of_long(ary)
-    write_array_of_type(:long, :write_long, ary)
+    write_array_of(:long, ary)
   end
 
   def read_array_of_type(type, reader, length)
@@ -478,6 +500,32 @@ class MemoryPointer
     self
   end
 
+  # Read +length+ values of FFI +type+ laid out as a C array, without
+  # making a MemoryPointer for each element.
+  def read_array_of(type, length)
+    code = FFI.find_type type
+    size = FFI.type_size type
+    ary = []
+    i = 0
+    while i < length
+      ary << get_at(i * size, code)
+      i += 1
+    end
+    ary
+  end
+
+  # Write the values in +ary+ as a C array of FFI +type+.
+  def write_array_of(type, ary)
+    code = FFI.find_type type
+    size = FFI.type_size type
+    i = 0
+    while i < ary.size
+      put_at i * size, code, ary[i]
+      i += 1
+    end
+    self
+  end
+
   def inspect
     # Don't have this print the data at the location. It can crash everything.
     "#<MemoryPointer address=0x#{address.to_s(16)} size=#{total}>"
@@ -508,8 +556,6 @@ class MemoryPointer
   attach_function "ffi_read_int", :read_int, [:pointer], :int
   attach_function "ffi_write_long", :write_long, [:pointer, :long], :long
   attach_function "ffi_read_long", :read_long, [:pointer], :long
-  attach_function "ffi_write_float", :write_float, [:pointer, :double], :double
-  attach_function "ffi_read_float", :read_float, [:pointer], :double
   attach_function "ffi_read_string", :read_string, [:pointer], :string
   attach_function "ffi_read_string_length", :read_string_length, [:state, :pointer, :int], :object
   attach_function "memcpy", :write_string, [:pointer, :string, :int], :void
@@ -536,9 +582,6 @@ class FFI::Struct
 
   attr_reader :pointer
 
-  attach_function "ffi_get_field", [:pointer, :int, :int], :object
-  attach_function "ffi_set_field", [:pointer, :int, :int, :object], :void
-
   def self.layout(*spec)
     return @layout if spec.size == 0
 
@@ -620,18 +663,14 @@ class FFI::Struct
     offset, type = @cspec[field]
     raise "Unknown field #{field}" unless offset
 
-    if type == FFI::TYPE_CHARARR
-      (@pointer + offset).read_string
-    else
-      self.class.ffi_get_field(@pointer, offset, type)
-    end
+    @pointer.get_at offset, type
   end
 
   def []=(field, val)
     offset, type = @cspec[field]
     raise "Unknown field #{field}" unless offset
 
-    self.class.ffi_set_field(@pointer, offset, type, val)
+    @pointer.put_at offset, type, val
     return val
   end
 
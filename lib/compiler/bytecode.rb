@@ -9,9 +9,10 @@ class Compiler
   # The precursor to a CompiledMethod
 
   class MethodDescription
-    def initialize(gen_class, locals)
+    def initialize(gen_class, locals, optimizer=nil)
       @generator = gen_class.new
       @locals = locals
+      @optimizer = optimizer
       @required = 0
       @optional = 0
       @name = :__unknown__
@@ -31,6 +32,7 @@ class Compiler
     end
 
     def to_cmethod
+      @optimizer.run(@generator) if @optimizer
       @generator.to_cmethod(self)
     end
 
@@ -52,7 +54,7 @@ class Node
   class ClosedScope
 
     def new_description
-      MethodDescription.new(@compiler.generator_class, self.locals)
+      MethodDescription.new(@compiler.generator_class, self.locals, @compiler.optimizer)
     end
 
     def to_description(name = nil)
@@ -634,7 +636,7 @@ class Node
     end
 
     def bytecode(g)
-      desc = MethodDescription.new @compiler.generator_class, @locals
+      desc = MethodDescription.new @compiler.generator_class, @locals, @compiler.optimizer
       desc.name = :__block__
       desc.required, desc.optional = argument_info
       sub = desc.generator
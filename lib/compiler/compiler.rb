@@ -18,6 +18,7 @@ class Compiler
     sexp = File.to_sexp(path, true)
 
     comp = new(Generator)
+    comp.optimizer = Optimizer.for_file(path, comp.optimizer)
     node = comp.into_script(sexp)
     return node.to_description(:__script__).to_cmethod
   end
@@ -82,6 +83,7 @@ class Compiler
     @context = context
 
     @kernel = Config['rbx-kernel']
+    @optimizer = Optimizer.new if Config['rbx-optimize']
     load_plugins
   end
 
@@ -145,7 +147,7 @@ class Compiler
   end
 
   attr_reader :plugins
-  attr_accessor :generator_class
+  attr_accessor :generator_class, :optimizer
 
   def set_position(file, line)
     @file, @line = file, line
@@ -185,6 +187,11 @@ class Compiler
     @plugins[cls.kind] << cls.new(self)
   end
 
+  def plugin_active?(name)
+    cls = Plugins.find_plugin(name)
+    @plugins[cls.kind].any? { |plugin| plugin.kind_of? cls }
+  end
+
   def inspect
     "#<#{self.class}>"
   end
@@ -262,4 +269,5 @@ require 'compiler/local'
 require 'compiler/bytecode'
 require 'compiler/generator'
 require 'compiler/plugins'
+require 'compiler/optimizer'
 
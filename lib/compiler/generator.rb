@@ -96,6 +96,47 @@ class Compiler
       end
     end
 
+    ##
+    # [start, handler] ips of each exception range, for the Optimizer.
+
+    def exception_bounds
+      @exceptions.map do |e|
+        start, last = e.range
+        [start, last + 1]
+      end
+    end
+
+    ##
+    # Swaps in +stream+, a rewrite of the current one in which whatever was
+    # at ip i is now at map[i], and moves labels, lines and exception ranges
+    # to match. Returns false, changing nothing, if that would leave an
+    # exception range empty or the same as another one.
+
+    def replace_stream(stream, map)
+      ranges = exception_bounds.map { |start, handler| [map[start], map[handler]] }
+      return false if ranges.any? { |start, handler| start >= handler }
+      return false unless ranges.uniq.size == ranges.size
+
+      labels = {}
+      stream.each do |part|
+        part.each { |x| labels[x] = map[x.position] if x.kind_of? Label }
+      end
+      labels.each { |label, pos| label.position = pos }
+
+      @exceptions.each_with_index do |e, i|
+        e.move_to(*ranges[i])
+      end
+
+      @lines.each do |ent|
+        ent[0] = map[ent[0]]
+        ent[1] = map[ent[1]] if ent[1]
+      end
+
+      @stream = stream
+      @ip = map[@ip]
+      return true
+    end
+
     def encode_lines
       tup = Tuple.new(@lines.size)
       i = 0
@@ -259,6 +300,12 @@ class Compiler
         Tuple[@start, @end, @handler]
       end
 
+      def move_to(start, handler)
+        @start = start
+        @handler = handler
+        @end = handler - 1
+      end
+
       def <=>(other)
         return 0 if self.equal?(other)
 
@@ -0,0 +1,570 @@
+class Compiler
+
+##
+# Runs passes over the instruction stream of a Generator before it is
+# encoded into a CompiledMethod. Passes rewrite or delete instructions in
+# place; jump labels, line numbers and exception ranges are moved to match
+# once they're all done.
+#
+# The compiler only optimizes when the "rbx-optimize" Config flag is set,
+# which the kernel is built with. Every registered pass runs then, except
+# those turned off with a "no-<pass>" flag. A file can choose for itself
+# with a comment among the ones it starts with:
+#
+#   # optimize: fold peephole
+#   # optimize: none
+
+class Optimizer
+
+  @passes = {}
+  @order = []
+  @stats = Hash.new(0)
+
+  def self.add_pass(name, cls)
+    @order << name unless @passes.key? name
+    @passes[name] = cls
+  end
+
+  def self.find_pass(name)
+    @passes[name]
+  end
+
+  def self.pass_names
+    @order
+  end
+
+  ##
+  # Instructions removed by each pass, along with the number of methods
+  # and instructions seen, over everything compiled so far.
+
+  def self.stats
+    @stats
+  end
+
+  def self.default_passes
+    @order.reject { |name| Config["no-#{name}"] }
+  end
+
+  Pragma = /^#\s*optimize:(.*)$/
+
+  ##
+  # The Optimizer asked for by the comments +path+ starts with, +default+
+  # if they don't say, or nil for "optimize: none".
+
+  def self.for_file(path, default)
+    File.open(path) do |f|
+      f.each do |line|
+        line = line.strip
+        next if line.empty?
+        break unless line.prefix? "#"
+
+        if m = Pragma.match(line)
+          names = m[1].split(/[\s,]+/).reject { |n| n.empty? }
+          return nil if names == ["none"]
+          return new(names.map { |n| n.to_sym })
+        end
+      end
+    end
+
+    return default
+  end
+
+  # Passes run again until none of them finds anything more to do, since
+  # one pass often sets up another, but never more often than this.
+  MaxRounds = 4
+
+  def initialize(names=nil)
+    names ||= Optimizer.default_passes
+    @passes = names.map do |name|
+      cls = Optimizer.find_pass(name)
+      raise Error, "Unknown optimizer pass '#{name}'" unless cls
+      cls.new
+    end
+  end
+
+  def run(gen)
+    code = Code.new(gen)
+    return false unless code.movable?
+
+    MaxRounds.times do
+      changed = false
+      @passes.each do |pass|
+        code.pass = pass.class.pass_name
+        changed = true if pass.run(code)
+      end
+      break unless changed
+    end
+
+    return false unless code.apply
+
+    stats = Optimizer.stats
+    stats[:methods] += 1
+    stats[:before] += code.size
+    stats[:after] += code.count
+    code.removed.each { |name, count| stats[name] += count }
+
+    return true
+  end
+
+  ##
+  # The instructions of a Generator as the passes see them. A deleted
+  # instruction leaves a nil behind so that indexes stay put while the
+  # passes run.
+
+  class Code
+    def initialize(gen)
+      @generator = gen
+      @insns = gen.stream.dup
+      @removed = Hash.new(0)
+      @changed = false
+      @movable = true
+
+      @index = {}
+      ip = 0
+      i = 0
+      @insns.each do |inst|
+        @index[ip] = i
+        ip += inst.size
+        i += 1
+      end
+      @index[ip] = i
+
+      @leaders = {}
+      @fixed = {}
+      @handlers = []
+      @insns.each do |inst|
+        if InstructionSet[inst.first].flow == :goto and !inst[1].kind_of? Generator::Label
+          @movable = false
+        end
+
+        inst.each do |arg|
+          next unless arg.kind_of? Generator::Label
+          @movable = false unless arg.position
+          @leaders[@index[arg.position]] = true
+        end
+      end
+
+      gen.exception_bounds.each do |start, handler|
+        @leaders[@index[start]] = true
+        @leaders[@index[handler]] = true
+        @handlers << @index[handler]
+
+        # The VM finds a handler by the ip after the instruction that
+        # raised, so the last instruction of a range is never covered.
+        # The generator ends ranges with a goto; if that went, whatever
+        # came before it would drop out of the range.
+        @fixed[@index[handler] - 1] = true
+      end
+    end
+
+    attr_reader :removed, :handlers
+    attr_accessor :pass
+
+    # False if a jump in the method names its target by ip rather than by
+    # a Label that was set, which the passes can't keep track of.
+    def movable?
+      @movable
+    end
+
+    # Number of instructions before the passes ran.
+    def size
+      @insns.size
+    end
+
+    # Number of instructions left.
+    def count
+      @insns.inject(0) { |n, inst| inst ? n + 1 : n }
+    end
+
+    def [](i)
+      @insns[i]
+    end
+
+    def op(i)
+      inst = @insns[i]
+      inst.first if inst
+    end
+
+    def delete(i)
+      @insns[i] = nil
+      @removed[@pass] += 1
+      @changed = true
+    end
+
+    def replace(i, inst)
+      @insns[i] = inst
+      @changed = true
+    end
+
+    # Index of the first instruction left after +i+, or nil.
+    def next_index(i)
+      i += 1
+      while i < @insns.size
+        return i if @insns[i]
+        i += 1
+      end
+      return nil
+    end
+
+    # Index of the instruction +label+ lands on, or nil if it lands at the
+    # end of the method.
+    def target(label)
+      i = @index[label.position]
+      return nil if i >= @insns.size
+      return i if @insns[i]
+      next_index(i)
+    end
+
+    # True if the instruction at +i+ must not be deleted.
+    def fixed?(i)
+      @fixed[i]
+    end
+
+    ##
+    # True if control can arrive at +i+ from anywhere but the instruction
+    # before it, in which case a rewrite can start at +i+ but not span it.
+
+    def leader?(i)
+      return true if @leaders[i]
+
+      i -= 1
+      while i >= 0 and @insns[i].nil?
+        return true if @leaders[i]
+        i -= 1
+      end
+
+      return false
+    end
+
+    # Indexes of the instructions left, starting at +i+ and only while
+    # none of those after the first is a leader and none is fixed.
+    def window(i, count)
+      return nil if fixed? i
+
+      found = [i]
+      while found.size < count
+        i = next_index(i)
+        return nil unless i and !leader?(i) and !fixed?(i)
+        found << i
+      end
+      found
+    end
+
+    def each
+      i = 0
+      while i < @insns.size
+        yield i if @insns[i]
+        i += 1
+      end
+    end
+
+    ##
+    # Hands the rewritten stream back to the generator. Returns false, and
+    # leaves the generator alone, if it couldn't take it.
+
+    def apply
+      return true unless @changed
+
+      stream = []
+      map = []
+      old = 0
+      ip = 0
+
+      @insns.each_with_index do |inst, i|
+        width = @generator.stream[i].size
+        if inst
+          stream << inst
+          width.times { |w| map[old + w] = ip + (w < inst.size ? w : inst.size - 1) }
+          ip += inst.size
+        else
+          width.times { |w| map[old + w] = ip }
+        end
+        old += width
+      end
+
+      map[old] = ip
+      map[old + 1] = ip + 1
+
+      @generator.replace_stream stream, map
+    end
+  end
+
+  ##
+  # A pass over Code. #run returns true if it changed anything.
+
+  class Pass
+    def self.pass(name)
+      @pass_name = name
+      Optimizer.add_pass name, self
+    end
+
+    def self.pass_name
+      @pass_name
+    end
+
+    def run(code)
+      false
+    end
+
+    Ints = {
+      :meta_push_neg_1 => -1,
+      :meta_push_0 => 0,
+      :meta_push_1 => 1,
+      :meta_push_2 => 2
+    }
+
+    # The Fixnum +inst+ pushes, or nil.
+    def int_value(inst)
+      return inst[1] if inst.first == :push_int
+      Ints[inst.first]
+    end
+
+    # Same as Generator#push_int, or nil if +int+ would be a literal.
+    def push_int(int)
+      Ints.each { |op, val| return [op] if val == int }
+      return [:push_int, int] if int.abs < 0x8000000
+      return nil
+    end
+
+    def goto?(inst)
+      inst and [:goto, :goto_if_true, :goto_if_false].include? inst.first
+    end
+  end
+
+  ##
+  # Works out Fixnum math on literal operands, as fastmath emits it, and
+  # branches on literal conditions. The VM doesn't look for redefined
+  # Fixnum operators in the meta_send_op instructions either.
+
+  class ConstantFolding < Pass
+    pass :fold
+
+    MetaMath = {
+      :meta_send_op_plus => :+,
+      :meta_send_op_minus => :-,
+      :meta_send_op_mul => :*,
+      :meta_send_op_div => :/,
+      :meta_send_op_mod => :%,
+      :meta_send_op_equal => :==,
+      :meta_send_op_nequal => :"!=",
+      :meta_send_op_tequal => :===,
+      :meta_send_op_lt => :<,
+      :meta_send_op_gt => :>,
+      :meta_send_op_le => :<=,
+      :meta_send_op_ge => :>=
+    }
+
+    # Not push_self, which is nil or false in NilClass and FalseClass.
+    Truthy = [:push_true, :push_int, :meta_push_neg_1,
+              :meta_push_0, :meta_push_1, :meta_push_2]
+    Falsy = [:push_nil, :push_false]
+
+    def run(code)
+      changed = false
+      code.each do |i|
+        changed = true if fold_math(code, i) or fold_branch(code, i)
+      end
+      changed
+    end
+
+    # fastmath pushes the argument, then the receiver, then sends.
+    def fold_math(code, i)
+      return false unless arg = int_value(code[i])
+      return false unless w = code.window(i, 3)
+      return false unless recv = int_value(code[w[1]])
+      return false unless meth = MetaMath[code.op(w[2])]
+      return false if arg == 0 and (meth == :/ or meth == :%)
+
+      value = recv.__send__ meth, arg
+      case value
+      when true
+        inst = [:push_true]
+      when false
+        inst = [:push_false]
+      else
+        return false unless inst = push_int(value)
+      end
+
+      code.replace w[0], inst
+      code.delete w[1]
+      code.delete w[2]
+      return true
+    end
+
+    def fold_branch(code, i)
+      return false unless w = code.window(i, 2)
+
+      kind = code.op(w[1])
+      return false unless kind == :goto_if_true or kind == :goto_if_false
+
+      if Truthy.include? code.op(i)
+        taken = kind == :goto_if_true
+      elsif Falsy.include? code.op(i)
+        taken = kind == :goto_if_false
+      else
+        return false
+      end
+
+      if taken
+        code.replace w[0], [:goto, code[w[1]][1]]
+      else
+        code.delete w[0]
+      end
+      code.delete w[1]
+      return true
+    end
+  end
+
+  ##
+  # Small rewrites of neighbouring instructions:
+  #
+  #   push_nil; pop                           =>
+  #   dup_top; pop                            =>
+  #   set_local 1; pop; push_local 1          => set_local 1
+
+  class Peephole < Pass
+    pass :peephole
+
+    Pure = [:push_nil, :push_true, :push_false, :push_self, :push_int,
+            :push_literal, :push_local, :push_local_depth, :push_ivar,
+            :push_my_field, :push_cpath_top, :push_block, :dup_top,
+            :meta_push_neg_1, :meta_push_0, :meta_push_1, :meta_push_2]
+
+    Reload = {
+      :set_local => :push_local,
+      :set_local_depth => :push_local_depth
+    }
+
+    def run(code)
+      changed = false
+      code.each do |i|
+        changed = true if drop_pushed(code, i) or reload(code, i)
+      end
+      changed
+    end
+
+    def drop_pushed(code, i)
+      return false unless Pure.include? code.op(i)
+      return false unless w = code.window(i, 2)
+      return false unless code.op(w[1]) == :pop
+
+      code.delete w[0]
+      code.delete w[1]
+      return true
+    end
+
+    # set_local leaves the value on the stack, so there's no need to pop
+    # it and read it straight back.
+    def reload(code, i)
+      return false unless push = Reload[code.op(i)]
+      return false unless w = code.window(i, 3)
+      return false unless code.op(w[1]) == :pop
+      return false unless code[w[2]] == [push, *code[i][1..-1]]
+
+      code.delete w[1]
+      code.delete w[2]
+      return true
+    end
+  end
+
+  ##
+  # Jumps straight to where a chain of gotos ends up, drops jumps to the
+  # next instruction and turns a conditional jump over a goto into the
+  # opposite conditional jump:
+  #
+  #   goto_if_true a; goto b; a:          => goto_if_false b; a:
+
+  class JumpThreading < Pass
+    pass :jumps
+
+    Opposite = {
+      :goto_if_true => :goto_if_false,
+      :goto_if_false => :goto_if_true
+    }
+
+    def run(code)
+      changed = false
+      code.each do |i|
+        inst = code[i]
+        next unless goto? inst
+
+        label = thread(code, inst[1])
+        unless label.equal? inst[1]
+          code.replace i, [inst.first, label]
+          changed = true
+        end
+
+        if opposite = Opposite[inst.first] and w = code.window(i, 2) and
+           code.op(w[1]) == :goto and code.target(label) == code.next_index(w[1])
+          label = code[w[1]][1]
+          code.replace i, [opposite, label]
+          code.delete w[1]
+          changed = true
+        end
+
+        if code.target(label) == code.next_index(i) and !code.fixed?(i)
+          if code.op(i) == :goto
+            code.delete i
+          else
+            code.replace i, [:pop]
+          end
+          changed = true
+        end
+      end
+      changed
+    end
+
+    def thread(code, label)
+      seen = []
+      while t = code.target(label) and code.op(t) == :goto
+        return label if seen.include? t
+        seen << t
+        label = code[t][1]
+      end
+      label
+    end
+  end
+
+  ##
+  # Deletes instructions no path through the method reaches, such as what
+  # follows a return inside a loop.
+
+  class DeadCode < Pass
+    pass :dead_code
+
+    Stops = [:return, :raise]
+
+    def run(code)
+      live = {}
+      work = [0] + code.handlers
+
+      until work.empty?
+        i = work.pop
+        i = code.next_index(i) unless i.nil? or code[i]
+        next if i.nil? or live[i]
+        live[i] = true
+
+        inst = code[i]
+        op = InstructionSet[inst.first]
+
+        if op.flow == :goto
+          work << code.target(inst[1])
+          work << code.next_index(i) unless inst.first == :goto
+        elsif !Stops.include? op.flow
+          work << code.next_index(i)
+        end
+      end
+
+      changed = false
+      code.each do |i|
+        unless live[i] or code.fixed?(i)
+          code.delete i
+          changed = true
+        end
+      end
+      changed
+    end
+  end
+
+end
+end
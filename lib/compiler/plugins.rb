@@ -138,12 +138,20 @@ module Plugins
       :"!=" => :meta_send_op_nequal,
       :=== =>  :meta_send_op_tequal,
       :< =>    :meta_send_op_lt,
-      :> =>    :meta_send_op_gt
+      :> =>    :meta_send_op_gt,
+      :<= =>   :meta_send_op_le,
+      :>= =>   :meta_send_op_ge,
+      :* =>    :meta_send_op_mul,
+      :/ =>    :meta_send_op_div,
+      :% =>    :meta_send_op_mod
     }
 
     def handle(g, call)
       name = MetaMath[call.method]
 
+      # safemath sends / as divide, so leave it be when that's active
+      name = nil if call.method == :/ and @compiler.plugin_active? :safemath
+
       if name and call.argcount == 1
         call.emit_args(g)
         call.receiver_bytecode(g)
@@ -271,7 +279,8 @@ module Plugins
 
       done = g.new_label
 
-      desc = MethodDescription.new @compiler.generator_class, call.block.locals
+      desc = MethodDescription.new @compiler.generator_class, call.block.locals,
+                                   @compiler.optimizer
       desc.name = :__inlined_block__
       desc.required, desc.optional = call.block.argument_info
       sub = desc.generator
@@ -8,9 +8,17 @@ module Profiler__
     @p.stop
   end
   
+  # PROFILE_FORMAT picks flat, collapsed or callgrind output, and
+  # PROFILE_OUTPUT a file to write it to instead of +f+.
   def print_profile(f)
     stop_profile
-    @p.display(f)
+    format = ENV['PROFILE_FORMAT'] || :flat
+
+    if name = ENV['PROFILE_OUTPUT']
+      File.open(name, "w") { |out| @p.write(out, format) }
+    else
+      @p.write(f, format)
+    end
   end
   
   module_function :start_profile, :stop_profile, :print_profile
@@ -147,7 +147,7 @@ def compile(name, output=nil, check_mtime=false)
   end
   
   inc = "-Iruntime/stable/compiler.rba -rcompiler/init"
-  flags = "-frbx-safe-math -frbx-kernel"
+  flags = "-frbx-safe-math -frbx-kernel -frbx-optimize"
 
   if ENV['GDB']
     sh "shotgun/rubinius --gdb #{inc} compile #{flags} #{name} #{output}", :verbose => $verbose
@@ -156,6 +156,31 @@ def compile(name, output=nil, check_mtime=false)
   end
 end
 
+def cpu_count
+  if File.exists? "/proc/cpuinfo"
+    count = File.read("/proc/cpuinfo").scan(/^processor/).size
+  else
+    count = `sysctl -n hw.ncpu 2>/dev/null`.to_i
+  end
+  count < 1 ? 1 : count
+end
+
+# Compiles the files of several CodeGroups in one VM, forked into JOBS
+# (default one per CPU) workers, rather than starting a VM for each file.
+# Files whose source hasn't changed since the last run are skipped.
+def precompile(groups)
+  inc = "-Iruntime/stable/compiler.rba -rcompiler/init"
+  flags = "-frbx-safe-math -frbx-kernel -frbx-optimize"
+  jobs = ENV['JOBS'] || cpu_count
+
+  files = groups.map do |group|
+    "-o #{group.compile_dir} #{group.files.join(' ')}"
+  end
+
+  sh "shotgun/rubinius #{inc} lib/bin/precompile -j#{jobs} #{flags} " \
+     "-d runtime/.rbc_digests #{files.join(' ')}", :verbose => $verbose
+end
+
 def compile_dir(dir)
   (Dir["#{dir}/*.rb"] + Dir["#{dir}/**/*.rb"]).each do |file|
     compile file, "#{file}c", true
@@ -187,7 +212,7 @@ class CodeGroup
     make_tasks
   end
 
-  attr_reader :output
+  attr_reader :output, :files, :compile_dir
 
   def clean
     sh "find #{@compile_dir} -name '*.rbc' -delete"
@@ -78,6 +78,10 @@ OBJECT array_pop(STATE, OBJECT self) {
   size_t idx;
   OBJECT val;
   
+  if(N2I(array_get_total(self)) == 0) {
+    return Qnil;
+  }
+
   idx = N2I(array_get_total(self)) - 1;
   val = array_get(state, self, idx);
   array_set(state, self, idx, Qnil);
@@ -85,3 +89,96 @@ OBJECT array_pop(STATE, OBJECT self) {
   array_set_total(self, ML2N(idx));
   return val;
 }
+
+OBJECT array_shift(STATE, OBJECT self) {
+  size_t start, total;
+  OBJECT tup, val;
+
+  total = N2I(array_get_total(self));
+  if(total == 0) {
+    return Qnil;
+  }
+
+  start = N2I(array_get_start(self));
+  tup = array_get_tuple(self);
+  val = tuple_at(state, tup, start);
+  tuple_put(state, tup, start, Qnil);
+
+  array_set_start(self, I2N(start + 1));
+  array_set_total(self, I2N(total - 1));
+  return val;
+}
+
+/* Puts val in front of the first element, using the room left at the
+ * front by array_shift if there is any. */
+OBJECT array_unshift(STATE, OBJECT self, OBJECT val) {
+  size_t i, start, total, size;
+  OBJECT tup, nt;
+
+  start = N2I(array_get_start(self));
+  total = N2I(array_get_total(self));
+  tup = array_get_tuple(self);
+
+  if(start == 0) {
+    size = NUM_FIELDS(tup);
+    start = size - total;
+    if(start == 0) {
+      start = total < 8 ? 8 : total;
+      size = total + start;
+    }
+    /* the elements go at the end, leaving the room in front */
+    nt = tuple_new(state, size);
+    for(i = 0; i < total; i++) {
+      tuple_put(state, nt, start + i, tuple_at(state, tup, i));
+    }
+    array_set_tuple(self, nt);
+    tup = nt;
+  }
+
+  start--;
+  tuple_put(state, tup, start, val);
+  array_set_start(self, I2N(start));
+  array_set_total(self, I2N(total + 1));
+  return self;
+}
+
+OBJECT array_clear(STATE, OBJECT self) {
+  array_set_tuple(self, tuple_new(state, 1));
+  array_set_total(self, I2N(0));
+  array_set_start(self, I2N(0));
+  return self;
+}
+
+OBJECT array_dup(STATE, OBJECT self) {
+  size_t total;
+  OBJECT ary;
+
+  total = N2I(array_get_total(self));
+  ary = array_new(state, total);
+  object_copy_fields_from(state, array_get_tuple(self), array_get_tuple(ary),
+                          N2I(array_get_start(self)), total);
+  array_set_total(ary, I2N(total));
+  SET_CLASS(ary, object_class(state, self));
+  ary->IsTainted = self->IsTainted;
+  return ary;
+}
+
+/* Reverses self in place. */
+OBJECT array_reverse(STATE, OBJECT self) {
+  size_t i, j;
+  OBJECT tup, tmp;
+
+  tup = array_get_tuple(self);
+  i = N2I(array_get_start(self));
+  j = i + N2I(array_get_total(self));
+
+  while(j > i + 1) {
+    j--;
+    tmp = tuple_at(state, tup, i);
+    tuple_put(state, tup, i, tuple_at(state, tup, j));
+    tuple_put(state, tup, j, tmp);
+    i++;
+  }
+
+  return self;
+}
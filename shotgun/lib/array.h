@@ -4,3 +4,8 @@ OBJECT array_set(STATE, OBJECT self, size_t idx, OBJECT val);
 OBJECT array_get(STATE, OBJECT self, size_t idx);
 OBJECT array_append(STATE, OBJECT self, OBJECT val);
 OBJECT array_pop(STATE, OBJECT self);
+OBJECT array_shift(STATE, OBJECT self);
+OBJECT array_unshift(STATE, OBJECT self, OBJECT val);
+OBJECT array_clear(STATE, OBJECT self);
+OBJECT array_dup(STATE, OBJECT self);
+OBJECT array_reverse(STATE, OBJECT self);
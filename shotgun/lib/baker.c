@@ -8,6 +8,7 @@
 #include "shotgun/lib/bytearray.h"
 #include "shotgun/lib/baker.h"
 #include "shotgun/lib/tuple.h"
+#include "shotgun/lib/string.h"
 
 /* how many times object should be traced before tenuring */
 #define DEFAULT_TENURE_AGE 6
@@ -70,6 +71,21 @@ int baker_gc_set_next(baker_gc g, rheap h) {
   return TRUE;
 }
 
+/* replaces an empty "to" space with one of sz bytes. The next collection
+   copies survivors into it, and the other space follows it on the swap.
+   Returns FALSE if objects have already spilled into "to" space. */
+int baker_gc_resize_next(baker_gc g, size_t sz) {
+  rheap old = g->next;
+
+  if(old->current != old->address) return FALSE;
+  if(old->size == sz) return TRUE;
+
+  baker_gc_enlarge_next(g, sz);
+  heap_deallocate(old);
+  free(old);
+  return TRUE;
+}
+
 /* gets start address of current "from" heap space */
 address baker_gc_start_address(baker_gc g) {
   return g->current->address;
@@ -102,6 +118,10 @@ int baker_gc_swap(baker_gc g) {
 int baker_gc_destroy(baker_gc g) {
   heap_deallocate(g->space_a);
   heap_deallocate(g->space_b);
+  if(g->retired) {
+    heap_deallocate(g->retired);
+    free(g->retired);
+  }
   free(g);
   return TRUE;
 }
@@ -147,6 +167,27 @@ void untrack_ref(OBJECT obj) {
   ptr_array_remove_fast(_track_refs, (xpointer)obj);
 }
 
+/* A mature String viewing a small part of a large young ByteArray gets a
+ * tenured copy of just its bytes, so the rest of the data can still die
+ * young instead of being kept alive, and tenured, by the view. */
+static void _trim_string_view(STATE, baker_gc g, OBJECT str) {
+  OBJECT data, dest;
+
+  if(!string_trim_view_p(state, str)) return;
+
+  data = string_get_data(str);
+  if(FORWARDED_P(data) || !heap_contains_p(g->current, data)) return;
+
+  dest = object_memory_tenure_bytes(state->om, data, string_start(str),
+                                    N2I(string_get_bytes(str)));
+  /* so its class gets updated */
+  ptr_array_append(g->tenured_objects, (xpointer)dest);
+
+  SET_FIELD_DIRECT(str, STRING_f_DATA, dest);
+  SET_FIELD_DIRECT(str, STRING_f_START, I2N(0));
+  SET_FIELD_DIRECT(str, STRING_f_SHARED, Qnil);
+}
+
 static void _mutate_references(STATE, baker_gc g, OBJECT iobj) {
   OBJECT cls, tmp, mut;
   int i, fields;
@@ -184,6 +225,10 @@ static void _mutate_references(STATE, baker_gc g, OBJECT iobj) {
   //printf("%d: Mutating references of %p\n", depth, iobj);
 
   if(!_object_stores_bytes(iobj)) {
+    if(iobj->obj_type == StringType && iobj->gc_zone == MatureObjectZone) {
+      _trim_string_view(state, g, iobj);
+    }
+
 		/* follow object field references and mutate them */
     fields = NUM_FIELDS(iobj);
     for(i = 0; i < fields; i++) {
@@ -319,7 +364,9 @@ OBJECT baker_gc_mutate_object(STATE, baker_gc g, OBJECT obj) {
   }
 #endif
 
-  if((AGE(obj) == g->tenure_age)) {
+  /* tenure_age can be lowered by the young gen ergonomics, so objects
+     may already be older than it. */
+  if((AGE(obj) >= g->tenure_age)) {
     xassert(obj->klass != state->global->fastctx);
     CLEAR_AGE(obj);
 
@@ -395,6 +442,7 @@ void baker_gc_mutate_rest(STATE, baker_gc g) {
 unsigned int baker_gc_collect(STATE, baker_gc g, ptr_array roots) {
   size_t i, sz;
   OBJECT tmp, root;
+  rni_handle *h;
   struct method_cache *end, *ent;
   /* rs for remember set */
   ptr_array rs;
@@ -452,9 +500,9 @@ unsigned int baker_gc_collect(STATE, baker_gc g, ptr_array roots) {
 
   /* Now the handle table. */
   for(i = 0; i < state->handle_tbl->total; i++) {
-    if(state->handle_tbl->entries[i]) {
-      state->handle_tbl->entries[i]->object =
-            baker_gc_mutate_from(state, g, state->handle_tbl->entries[i]->object);
+    h = handle_table_at(state->handle_tbl, i);
+    if(h->object) {
+      h->object = baker_gc_mutate_from(state, g, h->object);
     }
   }
 
@@ -462,6 +510,8 @@ unsigned int baker_gc_collect(STATE, baker_gc g, ptr_array roots) {
       (cpu_event_each_channel_cb) baker_gc_mutate_from, g);
   cpu_sampler_collect(state,
       (cpu_sampler_collect_cb) baker_gc_mutate_from, g);
+  cpu_profile_collect(state,
+      (cpu_sampler_collect_cb) baker_gc_mutate_from, g);
 
   /* This is a little odd, so I should explain. As we encounter
      objects which should be tenured while scanning, we put them
@@ -553,6 +603,11 @@ unsigned int baker_gc_collect(STATE, baker_gc g, ptr_array roots) {
   baker_gc_swap(g);
 
   if(g->current->size != g->next->size) {
+    if(g->retired) {
+      heap_deallocate(g->retired);
+      free(g->retired);
+    }
+    g->retired = g->next;
     baker_gc_enlarge_next(g, g->current->size);
   }
 
@@ -622,12 +677,11 @@ void baker_gc_find_lost_souls(STATE, baker_gc g) {
 
   }
 
-  // the 'next' heap has been enlarged (replaced by a new larger one).
-  // free the old buffer.
-  // the heap struct that holds a copy of the g->last_start pointer
-  // in its 'address' slot is unreachable so can't be freed.
-  if((OBJECT)g->last_start != g->next->address) {
-    free(g->last_start);
+  /* the space that was just scanned was replaced by one of another size */
+  if(g->retired) {
+    heap_deallocate(g->retired);
+    free(g->retired);
+    g->retired = NULL;
   }
 }
 
@@ -50,12 +50,18 @@ struct baker_gc_struct {
   ptr_array seen_weak_refs;
   OBJECT become_from, become_to;
   char *last_start, *last_end;
+  /* the old "from" space when it was replaced by one of another size,
+     freed once its dead objects have been cleaned up */
+  rheap retired;
   int num_collection;
   ptr_array tenured_objects;
 };
 
 typedef struct baker_gc_struct* baker_gc;
 
+/* copy_count is only 3 bits wide, so no object can get older than this */
+#define BAKER_MAX_TENURE_AGE 7
+
 baker_gc baker_gc_new(int size);
 address baker_gc_start_address(baker_gc g);
 size_t baker_gc_used(baker_gc g);
@@ -63,6 +69,7 @@ int baker_gc_swap(baker_gc g);
 int baker_gc_destroy(baker_gc g);
 address baker_gc_allocate(baker_gc g, int size);
 int baker_gc_set_next(baker_gc g, rheap h);
+int baker_gc_resize_next(baker_gc g, size_t sz);
 address baker_gc_allocate_spilled(baker_gc g, int size);
 void baker_gc_set_forwarding_address(OBJECT obj, OBJECT dest);
 OBJECT baker_gc_forwarded_object(OBJECT obj);
@@ -1,29 +1,186 @@
 #include <ctype.h>
 #include <math.h>
+#include <string.h>
 
 #include "shotgun/lib/shotgun.h"
 #include "shotgun/lib/string.h"
 
-#define NMP mp_int *n; OBJECT n_obj; \
-  NEW_STRUCT(n_obj, n, BASIC_CLASS(bignum), mp_int); \
-  mp_init(n);
-#define MMP mp_int *m; OBJECT m_obj; \
-  NEW_STRUCT(m_obj, m, BASIC_CLASS(bignum), mp_int); \
-  mp_init(m);
-
-
-#define MP(k) DATA_STRUCT(k, mp_int*)
+/*
+ * A Bignum keeps its digits inside the object, right after the mp_int
+ * header, so it needs no malloc and no cleanup when it dies. The object
+ * is sized for exactly the digits it holds, and since a Bignum is never
+ * changed once made, libtommath only ever reads from one. Results are
+ * built in a temporary mp_int (NMP) and copied into a new Bignum by
+ * bignum_normalize.
+ *
+ * Values that fit in a long long (ID and checksum sized ones, mostly)
+ * don't go through libtommath at all: the arithmetic is done with the
+ * C types, checking for overflow, and a 128 bit intermediate where the
+ * compiler has one.
+ */
+
+typedef struct {
+  mp_int mp;
+  mp_digit digits[1];
+} bignum_data;
+
+/* The digits needed to hold any long long. */
+#define LL_DIGITS ((64 + DIGIT_BIT - 1) / DIGIT_BIT)
+
+struct small_mp {
+  mp_int mp;
+  mp_digit digits[LL_DIGITS];
+};
+
+#ifdef __SIZEOF_INT128__
+typedef __int128 wide_int;
+typedef unsigned __int128 wide_uint;
+#define HAVE_WIDE_INT 1
+#endif
+
+#define NMP mp_int n[1]; mp_init(n)
+
+#define MP(k) bignum_mp(k)
 #define BDIGIT_DBL long long
 #define DIGIT_RADIX (1L << DIGIT_BIT)
 
-void bignum_cleanup(STATE, OBJECT obj) {
-  mp_int *n = MP(obj);
+/* The object may have been moved by the GC since dp was last set. */
+static inline mp_int *bignum_mp(OBJECT obj) {
+  bignum_data *b = DATA_STRUCT(obj, bignum_data*);
+  b->mp.dp = b->digits;
+  return &b->mp;
+}
+
+static OBJECT bignum_alloc(STATE, int digits) {
+  OBJECT obj;
+  mp_int *a;
+
+  if(digits < 1) digits = 1;
+  obj = object_memory_new_opaque(state, BASIC_CLASS(bignum),
+                                 sizeof(bignum_data) + (digits - 1) * sizeof(mp_digit));
+  a = MP(obj);
+  a->used = 0;
+  a->alloc = digits;
+  a->sign = MP_ZPOS;
+  return obj;
+}
+
+/* Moves the value in the temporary n into a new Bignum. */
+static OBJECT bignum_from_mp(STATE, mp_int *n) {
+  OBJECT obj;
+  mp_int *a;
+
+  mp_clamp(n);
+  obj = bignum_alloc(state, n->used);
+  a = MP(obj);
+  memcpy(a->dp, n->dp, n->used * sizeof(mp_digit));
+  a->used = n->used;
+  a->sign = n->used ? n->sign : MP_ZPOS;
   mp_clear(n);
+  return obj;
+}
+
+/* Like bignum_from_mp, but gives a Fixnum when the value fits in one. */
+static OBJECT bignum_normalize(STATE, mp_int *n) {
+  native_int val;
+  int i;
+
+  mp_clamp(n);
+  if(mp_count_bits(n) <= FIXNUM_WIDTH) {
+    val = 0;
+    for(i = n->used - 1; i >= 0; i--) {
+      val = (val << DIGIT_BIT) | DIGIT(n, i);
+    }
+    if(n->sign == MP_NEG) val = -val;
+    mp_clear(n);
+    return I2N(val);
+  }
+  return bignum_from_mp(state, n);
+}
+
+static void set_ull(mp_int *a, mp_digit *digits, int alloc, unsigned long long mag, int neg) {
+  a->dp = digits;
+  a->alloc = alloc;
+  a->used = 0;
+  while(mag) {
+    digits[a->used++] = (mp_digit)(mag & MP_MASK);
+    mag >>= DIGIT_BIT;
+  }
+  a->sign = neg && a->used ? MP_NEG : MP_ZPOS;
+}
+
+/* Returns a, or b as an mp_int in s if it is a Fixnum. */
+static mp_int *bignum_operand(OBJECT b, struct small_mp *s) {
+  native_int val;
+
+  if(!FIXNUM_P(b)) return MP(b);
+
+  val = N2I(b);
+  set_ull(&s->mp, s->digits, LL_DIGITS,
+          val < 0 ? -(unsigned long long)val : (unsigned long long)val, val < 0);
+  return &s->mp;
+}
+
+/* Sets *val and returns TRUE if obj, a Fixnum or Bignum, fits in a
+ * long long (leaving out LLONG_MIN, so it can always be negated). */
+static int bignum_small_p(OBJECT obj, long long *val) {
+  mp_int *a;
+  unsigned long long mag;
+  int i;
+
+  if(FIXNUM_P(obj)) {
+    *val = N2I(obj);
+    return TRUE;
+  }
+
+  a = MP(obj);
+  if(mp_count_bits(a) > 63) return FALSE;
+
+  mag = 0;
+  for(i = a->used - 1; i >= 0; i--) {
+    mag = (mag << DIGIT_BIT) | DIGIT(a, i);
+  }
+  *val = a->sign == MP_NEG ? -(long long)mag : (long long)mag;
+  return TRUE;
+}
+
+static OBJECT bignum_from_mag(STATE, unsigned long long mag, int neg) {
+  OBJECT obj;
+  mp_int *a;
+
+  obj = bignum_alloc(state, LL_DIGITS);
+  a = MP(obj);
+  set_ull(a, a->dp, LL_DIGITS, mag, neg);
+  return obj;
+}
+
+/* Gives a Fixnum on the same terms as bignum_normalize, by magnitude. */
+static OBJECT bignum_from_small(STATE, long long val) {
+  if(val >= -FIXNUM_MAX && val <= FIXNUM_MAX) return I2N((native_int)val);
+  return bignum_from_mag(state, val < 0 ? -(unsigned long long)val : (unsigned long long)val, val < 0);
 }
 
-void bignum_init(STATE) {
-  state_add_cleanup(state, BASIC_CLASS(bignum), bignum_cleanup);
+#ifdef HAVE_WIDE_INT
+#define WIDE_DIGITS ((128 + DIGIT_BIT - 1) / DIGIT_BIT)
+
+static OBJECT bignum_from_wide(STATE, wide_int val) {
+  OBJECT obj;
+  mp_int *a;
+  wide_uint mag;
+
+  if(val >= LLONG_MIN + 1 && val <= LLONG_MAX) return bignum_from_small(state, (long long)val);
+
+  obj = bignum_alloc(state, WIDE_DIGITS);
+  a = MP(obj);
+  mag = val < 0 ? -(wide_uint)val : (wide_uint)val;
+  while(mag) {
+    DIGIT(a, a->used++) = (mp_digit)(mag & MP_MASK);
+    mag >>= DIGIT_BIT;
+  }
+  a->sign = val < 0 ? MP_NEG : MP_ZPOS;
+  return obj;
 }
+#endif
 
 static void twos_complement(mp_int *a)
 {
@@ -44,68 +201,43 @@ static void twos_complement(mp_int *a)
 }
 
 OBJECT bignum_new(STATE, native_int num) {
-  mp_int *a;
-  OBJECT o;
-  o = object_memory_new_opaque(state, BASIC_CLASS(bignum), sizeof(mp_int));
-  a = (mp_int*)BYTES_OF(o);
-
-  if(num < 0) {
-    mp_init_set_long(a, (unsigned long)-num);
-    a->sign = MP_NEG;
-  } else {
-    mp_init_set_long(a, (unsigned long)num);
-  }
-  return o;
+  return bignum_from_mag(state, num < 0 ? -(unsigned long long)num : (unsigned long long)num, num < 0);
 }
 
 OBJECT bignum_new_unsigned(STATE, unsigned int num) {
-  OBJECT o;
-  o = object_memory_new_opaque(state, BASIC_CLASS(bignum), sizeof(mp_int));
-  mp_init_set_int(MP(o), num);
-  return o;
-}
-
-static inline OBJECT bignum_normalize(STATE, OBJECT b) {
-  mp_clamp(MP(b));
-
-  if(mp_count_bits(MP(b)) <= FIXNUM_WIDTH) {
-    native_int val;
-    val = (native_int)bignum_to_ll(state, b);
-    return I2N(val);
-  }
-  return b;
+  return bignum_from_mag(state, num, FALSE);
 }
 
 OBJECT bignum_add(STATE, OBJECT a, OBJECT b) {
-  NMP;
+  long long x, y, z;
+  struct small_mp sb;
 
-  if(FIXNUM_P(b)) {
-    if(N2I(b) < 0) { 
-      mp_sub_d(MP(a), -N2I(b), n);
-    } else {
-      mp_add_d(MP(a), N2I(b), n);
-    }
-  } else {
-    mp_add(MP(a), MP(b), n);
+  if(bignum_small_p(a, &x) && bignum_small_p(b, &y)) {
+    if(!__builtin_add_overflow(x, y, &z)) return bignum_from_small(state, z);
+#ifdef HAVE_WIDE_INT
+    return bignum_from_wide(state, (wide_int)x + y);
+#endif
   }
 
-  return bignum_normalize(state, n_obj);
+  NMP;
+  mp_add(MP(a), bignum_operand(b, &sb), n);
+  return bignum_normalize(state, n);
 }
 
 OBJECT bignum_sub(STATE, OBJECT a, OBJECT b) {
-  NMP;
+  long long x, y, z;
+  struct small_mp sb;
 
-  if(FIXNUM_P(b)) {
-    if(N2I(b) < 0) { 
-      mp_add_d(MP(a), -N2I(b), n);
-    } else {
-      mp_sub_d(MP(a), N2I(b), n);
-    }
-  } else {
-    mp_sub(MP(a), MP(b), n);
+  if(bignum_small_p(a, &x) && bignum_small_p(b, &y)) {
+    if(!__builtin_sub_overflow(x, y, &z)) return bignum_from_small(state, z);
+#ifdef HAVE_WIDE_INT
+    return bignum_from_wide(state, (wide_int)x - y);
+#endif
   }
 
-  return bignum_normalize(state, n_obj);
+  NMP;
+  mp_sub(MP(a), bignum_operand(b, &sb), n);
+  return bignum_normalize(state, n);
 }
 
 void bignum_debug(STATE, OBJECT n) {
@@ -117,107 +249,123 @@ void bignum_debug(STATE, OBJECT n) {
 }
 
 OBJECT bignum_mul(STATE, OBJECT a, OBJECT b) {
-  NMP;
+  long long x, y, z;
+  struct small_mp sb;
 
-  if(FIXNUM_P(b)) {
-    if(b == I2N(2)) {
-      mp_mul_2(MP(a), n);
-      return n_obj;
-    }
-    if(N2I(b) < 0) { 
-      /* mp_mul_d only accepts positive integers (unsigned long).
-       * Therefore we jump through some hoops to negate
-       * both parts so the final result is the same.
-       */
-      mp_neg(MP(a), n); 
-      mp_mul_d(n, -N2I(b), n);
-    } else {
-      mp_mul_d(MP(a), N2I(b), n);
-    }
+  if(bignum_small_p(a, &x) && bignum_small_p(b, &y)) {
+    if(!__builtin_mul_overflow(x, y, &z)) return bignum_from_small(state, z);
+#ifdef HAVE_WIDE_INT
+    return bignum_from_wide(state, (wide_int)x * y);
+#endif
+  }
+
+  NMP;
+  if(b == I2N(2)) {
+    mp_mul_2(MP(a), n);
   } else {
-    mp_mul(MP(a), MP(b), n);
+    mp_mul(MP(a), bignum_operand(b, &sb), n);
   }
 
-  return bignum_normalize(state, n_obj);
+  return bignum_normalize(state, n);
 }
 
-OBJECT bignum_div(STATE, OBJECT a, OBJECT b, mp_int *mod) {
-  NMP;
-  mp_int m, x, y, z;
+/* Division rounding toward negative infinity, as Ruby does it. The
+ * remainder is stored in *mod when mod isn't NULL. */
+OBJECT bignum_div(STATE, OBJECT a, OBJECT b, OBJECT *mod) {
+  long long x, y, q, r;
+  struct small_mp sb;
+  mp_int m, *bm;
 
-  if(FIXNUM_P(b)) {
-    b = bignum_new(state, N2I(b));
+  if(bignum_small_p(a, &x) && bignum_small_p(b, &y) && y != 0) {
+    q = x / y;
+    r = x % y;
+    if(r != 0 && ((r < 0) != (y < 0))) {
+      q -= 1;
+      r += y;
+    }
+    if(mod) *mod = bignum_from_small(state, r);
+    return bignum_from_small(state, q);
   }
 
+  NMP;
+  mp_int x1, y1, z;
+
+  bm = bignum_operand(b, &sb);
+
   mp_init(&m);
-  mp_init(&x);
-  mp_init(&y);
+  mp_init(&x1);
+  mp_init(&y1);
   mp_init(&z);
-  
-  if(mp_cmp_d(MP(b), 0) == MP_LT) {
+
+  if(mp_cmp_d(bm, 0) == MP_LT) {
     if(mp_cmp_d(MP(a), 0) == MP_LT) {
-      mp_neg(MP(a), &x);
-      mp_neg(MP(b), &y);
-      mp_div(&x, &y, &z, NULL);
+      mp_neg(MP(a), &x1);
+      mp_neg(bm, &y1);
+      mp_div(&x1, &y1, &z, NULL);
     } else {
-      mp_neg(MP(b), &x);
-      mp_div(MP(a), &x, &y, NULL);
-      mp_neg(&y, &z);
+      mp_neg(bm, &x1);
+      mp_div(MP(a), &x1, &y1, NULL);
+      mp_neg(&y1, &z);
     }
   } else {
     if (mp_cmp_d(MP(a), 0) == MP_LT) {
-      mp_neg(MP(a), &x);
-      mp_div(&x, MP(b), &y, NULL);
-      mp_neg(&y, &z);
+      mp_neg(MP(a), &x1);
+      mp_div(&x1, bm, &y1, NULL);
+      mp_neg(&y1, &z);
     } else {
-      mp_div(MP(a), MP(b), &z, NULL);
+      mp_div(MP(a), bm, &z, NULL);
     }
   }
 
-  mp_mul(&z, MP(b), &x);
-  mp_sub(MP(a), &x, &y);
+  mp_mul(&z, bm, &x1);
+  mp_sub(MP(a), &x1, &y1);
 
-  if((mp_cmp_d(&y, 0) == MP_LT && mp_cmp_d(MP(b), 0) == MP_GT)
-      || (mp_cmp_d(&y, 0) == MP_GT && mp_cmp_d(MP(b), 0) == MP_LT)) {
-    mp_add(&y, MP(b), &m);
+  if((mp_cmp_d(&y1, 0) == MP_LT && mp_cmp_d(bm, 0) == MP_GT)
+      || (mp_cmp_d(&y1, 0) == MP_GT && mp_cmp_d(bm, 0) == MP_LT)) {
+    mp_add(&y1, bm, &m);
     mp_sub_d(&z, 1, n);
   } else {
     mp_copy(&z, n);
-    mp_copy(&y, &m);
+    mp_copy(&y1, &m);
   }
-  
+
   if(mod) {
-    mp_copy(&m, mod);
+    *mod = bignum_normalize(state, &m);
+  } else {
+    mp_clear(&m);
   }
 
-  mp_clear(&m);
-  mp_clear(&x);
-  mp_clear(&y);
+  mp_clear(&x1);
+  mp_clear(&y1);
   mp_clear(&z);
 
-  return bignum_normalize(state, n_obj);
+  return bignum_normalize(state, n);
 }
 
 OBJECT bignum_divmod(STATE, OBJECT a, OBJECT b) {
-  MMP;
-  OBJECT div, ary;
+  OBJECT div, mod, ary;
+
+  div = bignum_div(state, a, b, &mod);
 
-  div = bignum_div(state, a, b, m);
-  
   ary = array_new(state, 2);
   array_set(state, ary, 0, div);
-  array_set(state, ary, 1, bignum_normalize(state, m_obj));
+  array_set(state, ary, 1, mod);
   return ary;
 }
 
 OBJECT bignum_mod(STATE, OBJECT a, OBJECT b) {
-  NMP;
-  
-  if(FIXNUM_P(b)) {
-    b = bignum_new(state, N2I(b));
+  long long x, y, r;
+  struct small_mp sb;
+
+  if(bignum_small_p(a, &x) && bignum_small_p(b, &y) && y != 0) {
+    r = x % y;
+    if(r != 0 && ((r < 0) != (y < 0))) r += y;
+    return bignum_from_small(state, r);
   }
-  mp_mod(MP(a), MP(b), n);
-  return bignum_normalize(state, n_obj);
+
+  NMP;
+  mp_mod(MP(a), bignum_operand(b, &sb), n);
+  return bignum_normalize(state, n);
 }
 
 int bignum_is_zero(STATE, OBJECT a) {
@@ -302,40 +450,52 @@ void bignum_bitwise_op(int op, mp_int *x, mp_int *y, mp_int *n)
 }
 
 OBJECT bignum_and(STATE, OBJECT a, OBJECT b) {
-  NMP;
+  long long x, y;
+  struct small_mp sb;
 
-  if(FIXNUM_P(b)) {
-    b = bignum_new(state, N2I(b));
+  if(bignum_small_p(a, &x) && bignum_small_p(b, &y)) {
+    return bignum_from_small(state, x & y);
   }
 
+  NMP;
   /* Perhaps this should use mp_and rather than our own version */
-  bignum_bitwise_op(BITWISE_OP_AND, MP(a), MP(b), n);
-  return bignum_normalize(state, n_obj);
+  bignum_bitwise_op(BITWISE_OP_AND, MP(a), bignum_operand(b, &sb), n);
+  return bignum_normalize(state, n);
 }
 
 OBJECT bignum_or(STATE, OBJECT a, OBJECT b) {
-  NMP;
+  long long x, y;
+  struct small_mp sb;
 
-  if(FIXNUM_P(b)) {
-    b = bignum_new(state, N2I(b));
+  if(bignum_small_p(a, &x) && bignum_small_p(b, &y)) {
+    return bignum_from_small(state, x | y);
   }
+
+  NMP;
   /* Perhaps this should use mp_or rather than our own version */
-  bignum_bitwise_op(BITWISE_OP_OR, MP(a), MP(b), n);
-  return bignum_normalize(state, n_obj);
+  bignum_bitwise_op(BITWISE_OP_OR, MP(a), bignum_operand(b, &sb), n);
+  return bignum_normalize(state, n);
 }
 
 OBJECT bignum_xor(STATE, OBJECT a, OBJECT b) {
-  NMP;
+  long long x, y;
+  struct small_mp sb;
 
-  if(FIXNUM_P(b)) {
-    b = bignum_new(state, N2I(b));
+  if(bignum_small_p(a, &x) && bignum_small_p(b, &y)) {
+    return bignum_from_small(state, x ^ y);
   }
+
+  NMP;
   /* Perhaps this should use mp_xor rather than our own version */
-  bignum_bitwise_op(BITWISE_OP_XOR, MP(a), MP(b), n);
-  return bignum_normalize(state, n_obj);
+  bignum_bitwise_op(BITWISE_OP_XOR, MP(a), bignum_operand(b, &sb), n);
+  return bignum_normalize(state, n);
 }
 
 OBJECT bignum_invert(STATE, OBJECT self) {
+  long long x;
+
+  if(bignum_small_p(self, &x)) return bignum_from_small(state, ~x);
+
   NMP;
 
   mp_int a; mp_init(&a);
@@ -346,33 +506,54 @@ OBJECT bignum_invert(STATE, OBJECT self) {
   mp_sub(&a, &b, n);
 
   mp_clear(&a); mp_clear(&b);
-  return bignum_normalize(state, n_obj);
+  return bignum_normalize(state, n);
 }
 
 OBJECT bignum_neg(STATE, OBJECT self) {
+  long long x;
+
+  if(bignum_small_p(self, &x)) return bignum_from_small(state, -x);
+
   NMP;
 
   mp_neg(MP(self), n);
-  return bignum_normalize(state, n_obj);
+  return bignum_normalize(state, n);
 }
 
 /* These 2 don't use mp_lshd because it shifts by internal digits,
    not bits. */
 
 OBJECT bignum_left_shift(STATE, OBJECT self, OBJECT bits) {
-  NMP;
   int shift = N2I(bits);
-  mp_int *a = MP(self);
+  mp_int *a;
+#ifdef HAVE_WIDE_INT
+  long long x;
+
+  if(shift >= 0 && shift < 64 && bignum_small_p(self, &x)) {
+    wide_uint mag = (wide_uint)(x < 0 ? -(unsigned long long)x : (unsigned long long)x) << shift;
+    return bignum_from_wide(state, x < 0 ? -(wide_int)mag : (wide_int)mag);
+  }
+#endif
+
+  NMP;
+  a = MP(self);
 
   mp_mul_2d(a, shift, n);
   n->sign = a->sign;
-  return bignum_normalize(state, n_obj);
+  return bignum_normalize(state, n);
 }
 
 OBJECT bignum_right_shift(STATE, OBJECT self, OBJECT bits) {
-  NMP;
   int shift = N2I(bits);
-  mp_int * a = MP(self);
+  mp_int *a;
+  long long x;
+
+  if(shift >= 0 && bignum_small_p(self, &x)) {
+    if(shift > 63) return I2N(x < 0 ? -1 : 0);
+    return bignum_from_small(state, x >> shift);
+  }
+
+  a = MP(self);
 
   if ((shift / DIGIT_BIT) >= a->used) {
     if (a->sign == MP_ZPOS)
@@ -381,12 +562,19 @@ OBJECT bignum_right_shift(STATE, OBJECT self, OBJECT bits) {
       return I2N(-1);
   }
 
+  NMP;
+
   if (shift == 0) {
     mp_copy(a, n);
   } else {
-    int need_floor = (a->sign == MP_NEG) && (DIGIT(a, 0) & 1);
+    mp_int rem;
+    int need_floor;
+
+    mp_init(&rem);
+    mp_div_2d(a, shift, n, &rem);
+    need_floor = (a->sign == MP_NEG) && !mp_iszero(&rem);
+    mp_clear(&rem);
 
-    mp_div_2d(a, shift, n, NULL);
     n->sign = a->sign;
     if (need_floor) {
       /* We sometimes have to simulate the rounding toward negative
@@ -407,39 +595,26 @@ OBJECT bignum_right_shift(STATE, OBJECT self, OBJECT bits) {
     }
   }
 
-  return bignum_normalize(state, n_obj);
+  return bignum_normalize(state, n);
 }
 
-OBJECT bignum_equal(STATE, OBJECT a, OBJECT b) {
-  int r;
-  if(FIXNUM_P(b)) {
-    if(N2I(b) < 0) {
-      mp_int n;
-      mp_init(&n);
-      mp_neg(MP(a), &n);
-      r = mp_cmp_d(&n, -N2I(b));
-      mp_clear(&n);
-    } else {
-      r = mp_cmp_d(MP(a), N2I(b));
-    }
-  } else {
-    r = mp_cmp(MP(a), MP(b));
-  }
+/* Compares a Bignum with a Fixnum or Bignum, giving MP_LT, MP_EQ or MP_GT. */
+static int bignum_cmp(OBJECT a, OBJECT b) {
+  long long x, y;
+  struct small_mp sb;
 
-  if(r == MP_EQ) {
-    return Qtrue;
+  if(bignum_small_p(a, &x) && bignum_small_p(b, &y)) {
+    return x < y ? MP_LT : (x > y ? MP_GT : MP_EQ);
   }
-  return Qfalse;
+  return mp_cmp(MP(a), bignum_operand(b, &sb));
+}
+
+OBJECT bignum_equal(STATE, OBJECT a, OBJECT b) {
+  return bignum_cmp(a, b) == MP_EQ ? Qtrue : Qfalse;
 }
 
 OBJECT bignum_compare(STATE, OBJECT a, OBJECT b) {
-  int r;
-  if(FIXNUM_P(b)) {
-    b = bignum_new(state, N2I(b));
-  } 
-  r = mp_cmp(MP(a), MP(b));
-  
-  switch(r) {
+  switch(bignum_cmp(a, b)) {
     case MP_LT:
       return I2N(-1);
     case MP_GT:
@@ -449,66 +624,19 @@ OBJECT bignum_compare(STATE, OBJECT a, OBJECT b) {
 }
 
 OBJECT bignum_gt(STATE, OBJECT a, OBJECT b) {
-  int r;
-  if(FIXNUM_P(b)) {
-    native_int bi;
-    r = mp_cmp_d(MP(a), (bi = N2I(b)) < 0 ? -bi : bi);
-  } else {
-    r = mp_cmp(MP(a), MP(b));
-  }
-
-  if(r == MP_GT) {
-    return Qtrue;
-  }
-  return Qfalse;
+  return bignum_cmp(a, b) == MP_GT ? Qtrue : Qfalse;
 }
 
 OBJECT bignum_ge(STATE, OBJECT a, OBJECT b) {
-  int r;
-  if(FIXNUM_P(b)) {
-    if(N2I(b) < 0) {
-      r = mp_cmp_d(MP(a), -N2I(b));
-    } else {
-      r = mp_cmp_d(MP(a), N2I(b));
-    }
-  } else {
-    r = mp_cmp(MP(a), MP(b));
-  }
-  
-  if(r == MP_GT || r == MP_EQ) {
-    return Qtrue;
-  }
-  return Qfalse;
+  return bignum_cmp(a, b) != MP_LT ? Qtrue : Qfalse;
 }
 
 OBJECT bignum_lt(STATE, OBJECT a, OBJECT b) {
-  int r;
-  if(FIXNUM_P(b)) {
-    native_int bi;
-    r = mp_cmp_d(MP(a), (bi = N2I(b)) < 0 ? -bi : bi);
-  } else {
-    r = mp_cmp(MP(a), MP(b));
-  }
-
-  if(r == MP_LT) {
-    return Qtrue;
-  }
-  return Qfalse;
+  return bignum_cmp(a, b) == MP_LT ? Qtrue : Qfalse;
 }
 
 OBJECT bignum_le(STATE, OBJECT a, OBJECT b) {
-  int r;
-  if(FIXNUM_P(b)) {
-    native_int bi;
-    r = mp_cmp_d(MP(a), (bi = N2I(b)) < 0 ? -bi : bi);
-  } else {
-    r = mp_cmp(MP(a), MP(b));
-  }
-  
-  if(r == MP_LT || r == MP_EQ) {
-    return Qtrue;
-  }
-  return Qfalse;
+  return bignum_cmp(a, b) != MP_GT ? Qtrue : Qfalse;
 }
 
 unsigned long bignum_to_int(STATE, OBJECT self) {
@@ -527,21 +655,15 @@ unsigned int bignum_to_ui(STATE, OBJECT self) {
   return (unsigned int)mp_get_int(MP(self));
 }
 
+/* The low 64 bits of the magnitude. */
 unsigned long long bignum_to_ull(STATE, OBJECT self) {
-  mp_int t;
   mp_int *s = MP(self);
-  unsigned long long out, tmp;
-
-  /* mp_get_int() gets only the lower 32 bits, on any platform. */
-  out = mp_get_int(s);
-
-  mp_init(&t);
-  mp_div_2d(s, 32, &t, NULL);
-
-  tmp = mp_get_int(&t);
-  out |= tmp << 32;
+  unsigned long long out = 0;
+  int i;
 
-  mp_clear(&t);
+  for(i = s->used - 1; i >= 0; i--) {
+    out = (out << DIGIT_BIT) | DIGIT(s, i);
+  }
   return out;
 }
 
@@ -555,34 +677,11 @@ long long bignum_to_ll(STATE, OBJECT self) {
 }
 
 OBJECT bignum_from_ull(STATE, unsigned long long val) {
-  OBJECT ret;
-  mp_int low, high;
-
-  mp_init_set_int(&low, val & 0xffffffff);
-  mp_init_set_int(&high, val >> 32);
-  mp_mul_2d(&high, 32, &high);
-
-  ret = bignum_new_unsigned(state, 0);
-
-  mp_or(&low, &high, MP(ret));
-
-  mp_clear(&low);
-  mp_clear(&high);
-
-  return ret;
+  return bignum_from_mag(state, val, FALSE);
 }
 
 OBJECT bignum_from_ll(STATE, long long val) {
-  OBJECT ret;
-
-  if(val < 0) {
-    ret = bignum_from_ull(state, (unsigned long long)-val);
-    MP(ret)->sign = MP_NEG;
-  } else {
-    ret = bignum_from_ull(state, (unsigned long long)val);
-  }
-
-  return ret;
+  return bignum_from_mag(state, val < 0 ? -(unsigned long long)val : (unsigned long long)val, val < 0);
 }
 
 OBJECT bignum_to_s(STATE, OBJECT self, OBJECT radix) {
@@ -643,13 +742,13 @@ OBJECT bignum_from_string_detect(STATE, char *str) {
     n->sign = MP_NEG;
   }
 
-  return bignum_normalize(state, n_obj);
+  return bignum_normalize(state, n);
 }
 
 OBJECT bignum_from_string(STATE, char *str, int radix) {
   NMP;
   mp_read_radix(n, str, radix);
-  return bignum_normalize(state, n_obj);
+  return bignum_normalize(state, n);
 }
 
 void bignum_into_string(STATE, OBJECT self, int radix, char *buf, int sz) {
@@ -673,9 +772,7 @@ double bignum_to_double(STATE, OBJECT self) {
   i = a->used;
   m = DIGIT_RADIX;
 
-  /* get most significant digit of result */
-  res = DIGIT(a,i);
-
+  res = 0;
   while (--i >= 0) {
     res = (res * m) + DIGIT(a,i);
   }
@@ -728,7 +825,7 @@ OBJECT bignum_from_double(STATE, double d)
     mp_neg(n, n);
   }
 
-  return bignum_normalize(state, n_obj);
+  return bignum_normalize(state, n);
 }
 
 OBJECT bignum_size(STATE, OBJECT self)
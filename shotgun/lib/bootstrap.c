@@ -11,10 +11,10 @@
 #include "shotgun/lib/subtend/ffi.h"
 #include "shotgun/lib/selector.h"
 #include "shotgun/lib/sendsite.h"
+#include "shotgun/lib/shape.h"
 
 #define BC(o) BASIC_CLASS(o)
 
-void bignum_init(STATE);
 void Init_cpu_task(STATE);
 void Init_list(STATE);
 void cpu_bootstrap_exceptions(STATE);
@@ -84,6 +84,9 @@ void cpu_bootstrap(STATE) {
   class_set_object_type(BC(hash), I2N(HashType));
   class_set_object_type(BC(lookuptable), I2N(LookupTableType));
   class_set_object_type(BC(autoload), I2N(AutoloadType));
+
+  /* Shapes are Tuples, so this has to wait until they're typed. */
+  state->global->root_shape = shape_new_root(state);
   
   /* The symbol table */
   state->global->symbols = symtbl_new(state);
@@ -123,7 +126,6 @@ void cpu_bootstrap(STATE) {
   
   BC(bignum) = rbs_class_new(state, "Bignum", 0, tmp2);
   class_set_object_type(BC(bignum), I2N(BignumType));
-  bignum_init(state);
   
   BC(floatpoint) = rbs_class_new(state, "Float", 0, tmp);
   class_set_object_type(BC(floatpoint), I2N(FloatType));
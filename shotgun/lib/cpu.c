@@ -12,6 +12,7 @@
 #include "shotgun/lib/class.h"
 #include "shotgun/lib/hash.h"
 #include "shotgun/lib/lookuptable.h"
+#include "shotgun/lib/shape.h"
 #include "shotgun/lib/symbol.h"
 
 cpu cpu_new(STATE) {
@@ -95,6 +96,11 @@ void cpu_initialize_context(STATE, cpu c) {
   state->global->sym_tequal = symbol_from_cstr(state, "===");
   state->global->sym_lt =    symbol_from_cstr(state, "<");
   state->global->sym_gt =    symbol_from_cstr(state, ">");
+  state->global->sym_le =    symbol_from_cstr(state, "<=");
+  state->global->sym_ge =    symbol_from_cstr(state, ">=");
+  state->global->sym_times = symbol_from_cstr(state, "*");
+  state->global->sym_divide = symbol_from_cstr(state, "/");
+  state->global->sym_modulo = symbol_from_cstr(state, "%");
   state->global->sym_send =    symbol_from_cstr(state, "__send__");
   state->global->sym_public = symbol_from_cstr(state, "public");
   state->global->sym_private = symbol_from_cstr(state, "private");
@@ -328,6 +334,60 @@ OBJECT cpu_const_get_from(STATE, cpu c, OBJECT sym, OBJECT under) {
   return Qundef;
 }
 
+/* push_const and find_const remember the constant they found in the
+   ivar_cache entry of its literal, together with the StaticScope or module
+   they looked it up from and the constant serial. Changing any constant
+   table or superclass bumps the serial, so a hit is valid exactly when
+   both match. Autoloads and missing constants are never cached. */
+static inline OBJECT cpu_const_cache_probe(STATE, OBJECT cm, int lit, OBJECT key) {
+  OBJECT cache;
+
+  cache = cmethod_get_ivar_cache(cm);
+  lit *= IVAR_CACHE_ENTRY;
+  if(NIL_P(cache) || lit >= NUM_FIELDS(cache)) return Qundef;
+  if(NTH_FIELD_DIRECT(cache, lit + CONST_CACHE_f_SERIAL) != I2N(state->constant_serial)) return Qundef;
+  if(NTH_FIELD_DIRECT(cache, lit + CONST_CACHE_f_KEY) != key) return Qundef;
+  return NTH_FIELD_DIRECT(cache, lit + CONST_CACHE_f_VALUE);
+}
+
+static void cpu_const_cache_fill(STATE, OBJECT cm, int lit, OBJECT key, OBJECT val) {
+  OBJECT cache;
+
+  if(val == Qundef || AUTOLOAD_P(val)) return;
+
+  cache = shape_cache_of(state, cm);
+  lit *= IVAR_CACHE_ENTRY;
+  SET_FIELD(cache, lit + CONST_CACHE_f_KEY, key);
+  SET_FIELD(cache, lit + CONST_CACHE_f_SERIAL, I2N(state->constant_serial));
+  SET_FIELD(cache, lit + CONST_CACHE_f_VALUE, val);
+}
+
+/* push_const: cpu_const_get_in_context for +sym+, the literal at +lit+
+   in +cm+. */
+OBJECT cpu_const_get_cached(STATE, cpu c, OBJECT cm, int lit, OBJECT sym) {
+  OBJECT scope, val;
+
+  scope = cpu_current_scope(state, c);
+  val = cpu_const_cache_probe(state, cm, lit, scope);
+  if(val != Qundef) return val;
+
+  val = cpu_const_get_in_context(state, c, sym);
+  cpu_const_cache_fill(state, cm, lit, scope, val);
+  return val;
+}
+
+/* find_const: cpu_const_get_from for +sym+, the literal at +lit+ in +cm+. */
+OBJECT cpu_const_get_from_cached(STATE, cpu c, OBJECT cm, int lit, OBJECT sym, OBJECT under) {
+  OBJECT val;
+
+  val = cpu_const_cache_probe(state, cm, lit, under);
+  if(val != Qundef) return val;
+
+  val = cpu_const_get_from(state, c, sym, under);
+  cpu_const_cache_fill(state, cm, lit, under, val);
+  return val;
+}
+
 OBJECT cpu_const_get(STATE, cpu c, OBJECT sym, OBJECT under) {
   return cpu_const_get_from(state, c, sym, under);
 }
@@ -337,6 +397,7 @@ OBJECT cpu_const_set(STATE, cpu c, OBJECT sym, OBJECT val, OBJECT under) {
 
   tbl = module_get_constants(under);
   lookuptable_store(state, tbl, sym, val);
+  cpu_constants_changed(state);
   return val;
 }
 
@@ -73,6 +73,9 @@ method_module: module or class that holds the method
 struct fast_context {
   CPU_REGISTERS
   unsigned int size;
+  /* method profiler bookkeeping, see cpu_profile.c */
+  int prof_entry;
+  uint64_t prof_start, prof_child;
 };
 /* fast context treats OBJECT as series of bytes instead of normal object */
 #define FASTCTX(ctx) ((struct fast_context*)BYTES_OF(ctx))
@@ -235,9 +238,12 @@ void cpu_yield_debugger_check(STATE, cpu c);
 
 OBJECT cpu_const_get_in_context(STATE, cpu c, OBJECT sym);
 OBJECT cpu_const_get_from(STATE, cpu c, OBJECT sym, OBJECT under);
+OBJECT cpu_const_get_cached(STATE, cpu c, OBJECT cm, int lit, OBJECT sym);
+OBJECT cpu_const_get_from_cached(STATE, cpu c, OBJECT cm, int lit, OBJECT sym, OBJECT under);
 
 OBJECT cpu_const_get(STATE, cpu c, OBJECT sym, OBJECT under);
 OBJECT cpu_const_set(STATE, cpu c, OBJECT sym, OBJECT val, OBJECT under);
+#define cpu_constants_changed(state) ((state)->constant_serial++)
 void cpu_run(STATE, cpu c, int setup);
 int cpu_dispatch(STATE, cpu c);
 void cpu_compile_instructions(STATE, OBJECT bc, OBJECT ba);
@@ -337,9 +343,20 @@ void cpu_find_waiters(STATE);
 #define channel_get_value(obj) NTH_FIELD(obj, 2)
 
 #include "shotgun/lib/machine.h"
+void cpu_profile_enable(STATE, int on);
+void cpu_profile_enter(STATE, OBJECT ctx, OBJECT module);
+void cpu_profile_leave(STATE, OBJECT ctx, OBJECT dest);
+void cpu_profile_collect(STATE, cpu_sampler_collect_cb, void *cb_data);
+OBJECT cpu_profile_snapshot(STATE, int reset);
+
+#define SAMPLER_WALL 0
+#define SAMPLER_CPU  1
+
 void cpu_sampler_init(STATE, cpu c);
-void cpu_sampler_activate(STATE, int hz, machine m);
+void cpu_sampler_flush(STATE);
+int cpu_sampler_activate(STATE, int hz, int mode, machine m);
 OBJECT cpu_sampler_disable(STATE, machine m);
+OBJECT cpu_sampler_module_name(STATE, OBJECT mod, int *meta);
 
 #define type_assert(obj, type, message) ({\
   if(type == FixnumType) {\
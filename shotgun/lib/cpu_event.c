@@ -218,6 +218,10 @@ static void _cpu_wake_channel_for_writable(EV_P_ struct ev_io *ev, int revents)
   
   ti->state->pending_events--;
 
+  if(PROBE_ON(ti->state->probes, PROBE_IO)) {
+    probe_emit(ti->state->probes, ProbeIOReady, ti->fd, 1, 0, 0);
+  }
+
   cpu_channel_send(ti->state, ti->c, ti->channel, Qnil);
   _cpu_event_unregister_info(ti->state, ti);
 }
@@ -233,11 +237,14 @@ static void _cpu_wake_channel_and_read(EV_P_ struct ev_io *ev, int revents) {
   ti->state->pending_events--;
   
   state = ti->state;
+
+  if(PROBE_ON(state->probes, PROBE_IO)) {
+    probe_emit(state->probes, ProbeIOReady, ti->fd, 0, 0, 0);
+  }
   
   if(NIL_P(ti->buffer)) {
     ret = I2N(ti->fd);
   } else {
-    ba = string_get_data(ti->buffer);
     enc = string_get_encoding(ti->buffer);
     sz = (size_t)ti->count;
     
@@ -247,6 +254,14 @@ static void _cpu_wake_channel_and_read(EV_P_ struct ev_io *ev, int revents) {
       offset = 0;
     }
 
+    /* Reading into bytes another String shares would change it too, so
+       read into a copy with room for what was asked for. Unshared bytes
+       start at 0. */
+    if(string_get_shared(ti->buffer) == Qtrue) {
+      string_detach_size(state, ti->buffer, offset + sz + 1);
+    }
+    ba = string_get_data(ti->buffer);
+
     /* Clamp the read size so we don't overrun */
     total = SIZE_OF_BODY(ba) - offset - 1;
     if(total < sz) {
@@ -328,6 +343,10 @@ OBJECT cpu_event_wait_readable(STATE, cpu c, OBJECT channel, int fd,
   ti->count = count;
   ti->stopper = (stopper_cb)ev_io_stop;
 
+  if(PROBE_ON(state->probes, PROBE_IO)) {
+    probe_emit(state->probes, ProbeIOWait, fd, 0, 0, 0);
+  }
+
   state->pending_events++;
   id = _cpu_event_register_info(state, ti);
   ev_io_init(&ti->ev.io, _cpu_wake_channel_and_read, fd, EV_READ);
@@ -347,6 +366,10 @@ OBJECT cpu_event_wait_writable(STATE, cpu c, OBJECT channel, int fd) {
   ti->c = c;
   ti->channel = channel;
   ti->stopper = (stopper_cb)ev_io_stop;
+
+  if(PROBE_ON(state->probes, PROBE_IO)) {
+    probe_emit(state->probes, ProbeIOWait, fd, 1, 0, 0);
+  }
   
   state->pending_events++;
   id = _cpu_event_register_info(state, ti);
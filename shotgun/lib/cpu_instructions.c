@@ -17,6 +17,7 @@
 #include "shotgun/lib/fixnum.h"
 #include "shotgun/lib/primitive_util.h"
 #include "shotgun/lib/sendsite.h"
+#include "shotgun/lib/shape.h"
 #include "shotgun/lib/subtend/ffi.h"
 #include "shotgun/lib/subtend/nmc.h"
 
@@ -479,6 +480,7 @@ static inline OBJECT _allocate_context(STATE, cpu c, OBJECT meth, int locals) {
   fc = FASTCTX(ctx);
   fc->flags = 0;
   fc->sender = c->active_context;
+  fc->prof_entry = -1;
 
   fc->method = meth;
   fc->custom_iseq = Qnil;
@@ -525,6 +527,14 @@ static inline OBJECT cpu_create_context(STATE, cpu c, const struct message *msg)
   fc->method_module = msg->module;
   fc->type = FASTCTX_NORMAL;
 
+  if(state->profile_methods) {
+    cpu_profile_enter(state, ctx, msg->module);
+  }
+
+  if(PROBE_ON(state->probes, PROBE_FUNCTION)) {
+    probe_function(state, ProbeFunctionEntry, ctx, msg->module);
+  }
+
 #if ENABLE_DTRACE
   if (RUBINIUS_FUNCTION_ENTRY_ENABLED()) {
     dtrace_function_entry(state, c, msg);
@@ -555,6 +565,10 @@ OBJECT cpu_create_block_context(STATE, cpu c, OBJECT env, int sp) {
   fc->method_module = Qnil;
   fc->type = FASTCTX_BLOCK;
 
+  if(state->profile_methods) {
+    cpu_profile_enter(state, ctx, Qnil);
+  }
+
   return ctx;
 }
 
@@ -751,6 +765,7 @@ inline void cpu_activate_context(STATE, cpu c, OBJECT ctx, OBJECT home, int so)
    Returning ends here. */
 
 void nmc_activate(STATE, cpu c, OBJECT nmc, OBJECT val, int reraise);
+int nmc_unwind_direct(STATE, cpu c, OBJECT exc);
 
 inline int cpu_simple_return(STATE, cpu c, OBJECT val) {
   OBJECT current, destination, home;
@@ -767,6 +782,14 @@ inline int cpu_simple_return(STATE, cpu c, OBJECT val) {
   c->active_context = Qnil;
   destination = cpu_current_sender(c);
 
+  if(state->method_profile) {
+    cpu_profile_leave(state, current, destination);
+  }
+
+  if(PROBE_ON(state->probes, PROBE_FUNCTION)) {
+    probe_function(state, ProbeFunctionReturn, current, FASTCTX(current)->method_module);
+  }
+
   // printf("Rtrnng frm %p (%d)\n", current, FASTCTX(current)->size);
 
   if(destination == Qnil) {
@@ -826,6 +849,14 @@ int cpu_unwind(STATE, cpu c) {
   c->active_context = Qnil;
   destination = cpu_current_sender(c);
 
+  if(state->method_profile) {
+    cpu_profile_leave(state, current, destination);
+  }
+
+  if(PROBE_ON(state->probes, PROBE_FUNCTION)) {
+    probe_function(state, ProbeFunctionReturn, current, FASTCTX(current)->method_module);
+  }
+
 #if ENABLE_DTRACE
   if (RUBINIUS_FUNCTION_RETURN_ENABLED()) {
     dtrace_function_return(state, c);
@@ -1341,7 +1372,10 @@ void cpu_raise_exception(STATE, cpu c, OBJECT exc) {
      of a task.. */
 
   while(!NIL_P(ctx)) {
-    if(c->type == FASTCTX_NMC) goto skip;
+    if(c->type == FASTCTX_NMC) {
+      if(nmc_unwind_direct(state, c, exc)) return;
+      goto skip;
+    }
 
     table = cmethod_get_exceptions(cpu_current_method(state, c));
 
@@ -1529,6 +1563,10 @@ check_interrupts:
 #endif
       int cm = state->om->collect_now;
 
+      if(PROBE_ON(state->probes, PROBE_GC)) {
+        probe_emit(state->probes, ProbeGCBegin, cm, 0, 0, 0);
+      }
+
       /* Collect the first generation. */
       if(cm & OMCollectYoung) {
         if(EXCESSIVE_TRACING) {
@@ -1558,6 +1596,10 @@ check_interrupts:
 
       state->om->collect_now = 0;
 
+      if(PROBE_ON(state->probes, PROBE_GC)) {
+        probe_emit(state->probes, ProbeGCEnd, cm, 0, 0, 0);
+      }
+
 #if ENABLE_DTRACE
       if (RUBINIUS_GC_END_ENABLED()) {
         dtrace_gc_end(state);
@@ -361,7 +361,12 @@ static void marshal_cmethod2(STATE, OBJECT obj, bstring buf, struct marshal_stat
   append_sz(1);
   
   for(i = 0; i < 16; i++) {
-    marshal(state, NTH_FIELD(obj, i), buf, ms);  
+    /* The ivar cache only means something to the running VM. */
+    if(i == CMETHOD_f_IVAR_CACHE) {
+      marshal(state, Qnil, buf, ms);
+    } else {
+      marshal(state, NTH_FIELD(obj, i), buf, ms);
+    }
   }
 }
 
@@ -592,7 +597,7 @@ OBJECT cpu_marshal_to_file(STATE, OBJECT obj, char *path, int version) {
 OBJECT cpu_unmarshal(STATE, uint8_t *str, int len, int version) {
   struct marshal_state ms;
   OBJECT ret;
-  int in_version;
+  int in_version, site;
   int offset = 4;
   unsigned char cur_digest[20];
   
@@ -622,7 +627,10 @@ OBJECT cpu_unmarshal(STATE, uint8_t *str, int len, int version) {
   ms.objects = ptr_array_new(8);
   ms.buf = str + offset;
 
+  site = object_memory_enter_site(state->om, OMSiteCompiledCode);
   ret = unmarshal(state, &ms);
+  object_memory_leave_site(state->om, site);
+
   ptr_array_free(ms.objects);
   return ret;
 }
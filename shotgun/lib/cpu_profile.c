@@ -0,0 +1,218 @@
+#include <time.h>
+#include <sys/time.h>
+#include <string.h>
+
+#include <hashtable.h>
+
+#include "shotgun/lib/shotgun.h"
+#include "shotgun/lib/cpu.h"
+#include "shotgun/lib/tuple.h"
+
+/* The method profiler.
+ *
+ * When it's on, every context that is created counts a call of its
+ * CompiledMethod, or block, and remembers the time it started in the
+ * context itself. When it returns or is unwound, the time since then is
+ * the inclusive time of the call, and that minus what its callees took
+ * is its exclusive time, which goes to the caller's callees time in turn.
+ * Calls of a method nested in another call of it (recursion) only add to
+ * the inclusive time once, at the outermost one.
+ *
+ * Time is counted in ticks of the cycle counter where there is one, so
+ * a call usually costs a cache lookup and two reads of it. There are no
+ * signals involved. The entries hold on to their methods until the VM
+ * exits, so they are marked and moved by the GC like everything else. */
+
+struct profile_entry {
+  OBJECT method;
+  OBJECT module;
+  int index;
+  int active;
+  uint64_t calls, inclusive, exclusive;
+};
+
+#define PROFILE_CACHE 256
+
+struct method_profile {
+  /* in front of the table, by the method's address */
+  struct profile_entry *cache[PROFILE_CACHE];
+
+  struct hashtable *table;
+  struct profile_entry **entries;
+  int num_entries, max_entries;
+
+  /* when the ticks started counting, to tell how long one is */
+  uint64_t start_ticks;
+  struct timeval start_time;
+};
+
+DEFINE_HASHTABLE_INSERT(profile_entry_insert, struct profile_entry, struct profile_entry);
+DEFINE_HASHTABLE_SEARCH(profile_entry_search, struct profile_entry, struct profile_entry);
+
+static unsigned int profile_entry_hash(const void *value) {
+  uintptr_t meth = (uintptr_t)((const struct profile_entry*)value)->method;
+  return (unsigned int)((meth >> 3) ^ (meth >> 17));
+}
+
+static int profile_entry_eq(const void *value1, const void *value2) {
+  return ((const struct profile_entry*)value1)->method ==
+    ((const struct profile_entry*)value2)->method;
+}
+
+static inline uint64_t profile_ticks() {
+#if defined(__i386__) || defined(__x86_64__)
+  uint32_t lo, hi;
+  __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t)hi << 32) | lo;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static struct method_profile *profile_new() {
+  struct method_profile *p = ALLOC_N(struct method_profile, 1);
+
+  p->table = create_hashtable(1024, profile_entry_hash, profile_entry_eq);
+  p->max_entries = 1024;
+  p->entries = ALLOC_N(struct profile_entry*, p->max_entries);
+  p->start_ticks = profile_ticks();
+  gettimeofday(&p->start_time, NULL);
+
+  return p;
+}
+
+/* The table stays around once it's made, contexts created while it was
+   on still point into it after it's turned off. */
+void cpu_profile_enable(STATE, int on) {
+  if(on && !state->method_profile) {
+    state->method_profile = profile_new();
+  }
+  state->profile_methods = on;
+}
+
+void cpu_profile_enter(STATE, OBJECT ctx, OBJECT module) {
+  struct method_profile *p = state->method_profile;
+  struct fast_context *fc = FASTCTX(ctx);
+  struct profile_entry key, *e;
+  struct profile_entry **slot;
+
+  slot = &p->cache[((uintptr_t)fc->method >> 3) % PROFILE_CACHE];
+  e = *slot;
+
+  if(!e || e->method != fc->method) {
+    key.method = fc->method;
+    e = profile_entry_search(p->table, &key);
+  }
+
+  if(!e) {
+    if(p->num_entries == p->max_entries) {
+      p->max_entries *= 2;
+      p->entries = realloc(p->entries, p->max_entries * sizeof(struct profile_entry*));
+    }
+
+    e = ALLOC_N(struct profile_entry, 1);
+    e->method = fc->method;
+    e->module = module;
+    e->index = p->num_entries;
+    p->entries[p->num_entries++] = e;
+    profile_entry_insert(p->table, e, e);
+  }
+  *slot = e;
+
+  /* cpu_goto_method doesn't know the module, a later send might */
+  if(NIL_P(e->module)) e->module = module;
+
+  e->calls++;
+  e->active++;
+
+  /* the index finds the entry again even if the GC moved the method */
+  fc->prof_entry = e->index;
+  fc->prof_child = 0;
+  fc->prof_start = profile_ticks();
+}
+
+void cpu_profile_leave(STATE, OBJECT ctx, OBJECT dest) {
+  struct method_profile *p = state->method_profile;
+  struct fast_context *fc = FASTCTX(ctx);
+  struct profile_entry *e;
+  uint64_t total;
+
+  if(fc->prof_entry < 0 || fc->prof_entry >= p->num_entries) return;
+
+  e = p->entries[fc->prof_entry];
+  if(e->method != fc->method) return;
+
+  total = profile_ticks() - fc->prof_start;
+  fc->prof_entry = -1;
+
+  if(--e->active <= 0) {
+    e->active = 0;
+    e->inclusive += total;
+  }
+  e->exclusive += total > fc->prof_child ? total - fc->prof_child : 0;
+
+  if(REFERENCE_P(dest)) {
+    FASTCTX(dest)->prof_child += total;
+  }
+}
+
+/* The methods moved, so the table has to be rebuilt. */
+void cpu_profile_collect(STATE, OBJECT (*cb)(STATE, void*, OBJECT), void *cb_data) {
+  struct method_profile *p = state->method_profile;
+  struct profile_entry *e;
+  int i;
+
+  if(!p) return;
+
+  memset(p->cache, 0, sizeof(p->cache));
+  hashtable_destroy(p->table, 0);
+  p->table = create_hashtable(p->num_entries + 1024, profile_entry_hash, profile_entry_eq);
+
+  for(i = 0; i < p->num_entries; i++) {
+    e = p->entries[i];
+    e->method = cb(state, cb_data, e->method);
+    if(REFERENCE_P(e->module)) e->module = cb(state, cb_data, e->module);
+    profile_entry_insert(p->table, e, e);
+  }
+}
+
+/* Returns (entries, ticks per second). Each entry is (method, module,
+   calls, inclusive ticks, exclusive ticks), for the methods called
+   since the profiler was turned on or last reset. */
+OBJECT cpu_profile_snapshot(STATE, int reset) {
+  struct method_profile *p = state->method_profile;
+  struct profile_entry *e;
+  struct timeval now;
+  uint64_t ticks;
+  double secs;
+  OBJECT tup;
+  int i, count;
+
+  if(!p) return tuple_new2(state, 2, tuple_new(state, 0), I2N(0));
+
+  ticks = profile_ticks() - p->start_ticks;
+  gettimeofday(&now, NULL);
+  secs = (now.tv_sec - p->start_time.tv_sec) +
+    (now.tv_usec - p->start_time.tv_usec) / 1000000.0;
+
+  for(i = 0, count = 0; i < p->num_entries; i++) {
+    if(p->entries[i]->calls) count++;
+  }
+
+  tup = tuple_new(state, count);
+  for(i = 0, count = 0; i < p->num_entries; i++) {
+    e = p->entries[i];
+    if(!e->calls) continue;
+
+    tuple_put(state, tup, count++, tuple_new2(state, 5, e->method, e->module,
+          ULL2N(e->calls), ULL2N(e->inclusive), ULL2N(e->exclusive)));
+
+    if(reset) {
+      e->calls = e->inclusive = e->exclusive = 0;
+    }
+  }
+
+  return tuple_new2(state, 2, tup, ULL2N(secs > 0 ? (uint64_t)(ticks / secs) : 0));
+}
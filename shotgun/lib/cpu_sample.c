@@ -1,5 +1,9 @@
 #include <time.h>
 #include <sys/time.h>
+#include <signal.h>
+#include <string.h>
+
+#include <hashtable.h>
 
 #include "shotgun/lib/shotgun.h"
 #include "shotgun/lib/cpu.h"
@@ -7,109 +11,365 @@
 #include "shotgun/lib/machine.h"
 #include "shotgun/lib/tuple.h"
 #include "shotgun/lib/string.h"
-#include "shotgun/lib/methctx.h"
+#include "shotgun/lib/class.h"
+#include "shotgun/lib/metaclass.h"
+#include "shotgun/lib/object.h"
+
+/* The sampling profiler.
+ *
+ * On every tick the SIGPROF handler walks the chain of contexts from
+ * active_context and copies the method, module and ip of each one into
+ * a ring buffer that was allocated when the sampler started, so the
+ * handler never allocates. The ring is drained at the start of every
+ * GC, before anything moves, and when the sampler stops. Draining turns
+ * each frame into immediates (module name, method name, file and line)
+ * and aggregates the stacks into two hashtables, one of the distinct
+ * frames and one of the distinct stacks with how often each was seen.
+ * Nothing the tables hold is a reference, so the GC can ignore them.
+ *
+ * In wall clock mode a thread sends SIGPROF hz times a second whatever
+ * the VM is doing, in cpu mode ITIMER_PROF does, which only counts the
+ * time the process spends on a CPU. A tick that lands while the GC is
+ * running records a stack with just a GC frame. */
+
+#define SAMPLE_RING 65536
+#define SAMPLE_MAX_DEPTH 128
+
+enum sample_kind {
+  SampleStack,      /* a sample, ip is the number of frames that follow */
+  SampleMethod,
+  SampleBlock,
+  SamplePrimitive,  /* method is the index of the primitive */
+  SampleGC
+};
 
-#define SAMPLE_INCS 1024
+struct sample_entry {
+  OBJECT method;
+  OBJECT module;
+  OBJECT name;      /* for a block, the name of its home method */
+  int ip;
+  int kind;
+};
 
-void cpu_sampler_init(STATE, cpu c) {
-  state->max_samples = SAMPLE_INCS;
-  state->cur_sample = 0;
-  state->samples = NULL;
-}
+struct sample_frame {
+  int id;
+  int kind;
+  int meta;
+  int line;
+  OBJECT module;
+  OBJECT name;
+  OBJECT file;
+};
 
-void cpu_sampler_collect(STATE, OBJECT (*cb)(STATE, void*, OBJECT), void *cb_data) {
-  int i;
-  OBJECT obj;
-  if(!state->samples) return;
+struct sample_stack {
+  int count;
+  int depth;
+  int frames[1];
+};
 
-  for(i = 0; i < state->cur_sample; i++) {
-    if(REFERENCE_P(state->samples[i])) {
-      obj = cb(state, cb_data, state->samples[i]);
-      state->samples[i] = obj;
-    }
-  }
+struct sampler {
+  int mode;
+  pthread_t owner;
+
+  struct sample_entry *ring;
+  volatile unsigned int head, tail;
+
+  volatile unsigned int samples, gc_samples, dropped;
+
+  struct hashtable *frame_table;
+  struct sample_frame **frames;
+  int num_frames, max_frames;
+
+  struct hashtable *stack_table;
+  struct sample_stack **stacks;
+  int num_stacks, max_stacks;
+};
+
+DEFINE_HASHTABLE_INSERT(sample_frame_insert, struct sample_frame, struct sample_frame);
+DEFINE_HASHTABLE_SEARCH(sample_frame_search, struct sample_frame, struct sample_frame);
+DEFINE_HASHTABLE_INSERT(sample_stack_insert, struct sample_stack, struct sample_stack);
+DEFINE_HASHTABLE_SEARCH(sample_stack_search, struct sample_stack, struct sample_stack);
+
+static unsigned int sample_frame_hash(const void *value) {
+  const struct sample_frame *f = (const struct sample_frame*)value;
+  unsigned int h = 0x64a3b9ac;
+
+  h = h * 31 + (unsigned int)(uintptr_t)f->module;
+  h = h * 31 + (unsigned int)(uintptr_t)f->name;
+  h = h * 31 + (unsigned int)(uintptr_t)f->file;
+  h = h * 31 + f->line;
+  h = h * 31 + (f->kind << 1 | f->meta);
+  return h;
 }
 
-/* 2 other recorders, not using them currently.
+static int sample_frame_eq(const void *value1, const void *value2) {
+  const struct sample_frame *a = (const struct sample_frame*)value1;
+  const struct sample_frame *b = (const struct sample_frame*)value2;
 
-void _cpu_sampler_record_method_object(int sig) {
-  STATE;
-  cpu c;
-  state = current_machine->s;
-  c = current_machine->c;
-  state->samples[state->cur_sample++] = cpu_current_method(state, c);
+  return a->module == b->module && a->name == b->name && a->file == b->file &&
+    a->line == b->line && a->kind == b->kind && a->meta == b->meta;
+}
+
+static unsigned int sample_stack_hash(const void *value) {
+  const struct sample_stack *s = (const struct sample_stack*)value;
+  unsigned int h = s->depth;
+  int i;
 
-  if(state->cur_sample == state->max_samples) {
-    state->max_samples += SAMPLE_INCS;
-    state->samples = (OBJECT*)realloc(state->samples, state->max_samples * sizeof(OBJECT));
+  for(i = 0; i < s->depth; i++) {
+    h = h * 31 + s->frames[i];
   }
+  return h;
 }
 
-void _cpu_sampler_record_method_name(int sig) {
-  STATE;
-  cpu c;
-  OBJECT tup;
+static int sample_stack_eq(const void *value1, const void *value2) {
+  const struct sample_stack *a = (const struct sample_stack*)value1;
+  const struct sample_stack *b = (const struct sample_stack*)value2;
 
-  state = current_machine->s;
-  c = current_machine->c;
+  return a->depth == b->depth &&
+    memcmp(a->frames, b->frames, a->depth * sizeof(int)) == 0;
+}
+
+void cpu_sampler_init(STATE, cpu c) {
+  state->sampler = NULL;
+}
 
-  if(!state->samples) return;
+/* Anything still in the ring holds references, let the GC see them. */
+void cpu_sampler_collect(STATE, OBJECT (*cb)(STATE, void*, OBJECT), void *cb_data) {
+  struct sampler *s = state->sampler;
+  struct sample_entry *e;
+  unsigned int i;
 
-  tup = tuple_new2(state, 3, c->self, cpu_current_module(state, c), cpu_current_name(state, c));
-  state->samples[state->cur_sample++] = tup;
+  if(!s) return;
 
-  if(state->cur_sample == state->max_samples) {
-    state->max_samples += SAMPLE_INCS;
-    state->samples = (OBJECT*)realloc(state->samples, state->max_samples * sizeof(OBJECT));
+  for(i = s->tail; i != s->head; i++) {
+    e = &s->ring[i % SAMPLE_RING];
+    if(REFERENCE_P(e->method)) e->method = cb(state, cb_data, e->method);
+    if(REFERENCE_P(e->module)) e->module = cb(state, cb_data, e->module);
   }
 }
 
-*/
+static inline void _sampler_put(struct sampler *s, unsigned int i, OBJECT method,
+                                OBJECT module, OBJECT name, int ip, int kind) {
+  struct sample_entry *e = &s->ring[i % SAMPLE_RING];
+  e->method = method;
+  e->module = module;
+  e->name = name;
+  e->ip = ip;
+  e->kind = kind;
+}
 
-void _cpu_sampler_record_context(int sig) {
+void _cpu_sampler_record_stack(int sig) {
   STATE;
   cpu c;
+  struct sampler *s;
+  struct fast_context *fc;
+  OBJECT ctx, home, module, name;
+  unsigned int i;
+  int depth, ip, kind;
 
   state = current_machine->s;
   c = current_machine->c;
+  s = state->sampler;
 
-  if(!state->samples) return;
+  if(!s) return;
+
+  /* ITIMER_PROF signals whichever thread is running, samples have to be
+     taken on the one running the VM. */
+  if(!pthread_equal(pthread_self(), s->owner)) {
+    pthread_kill(s->owner, SIGPROF);
+    return;
+  }
+
+  if(state->in_gc) {
+    if(s->head - s->tail + 2 > SAMPLE_RING) {
+      s->dropped++;
+      return;
+    }
+    _sampler_put(s, s->head, Qnil, Qnil, Qnil, 1, SampleStack);
+    _sampler_put(s, s->head + 1, Qnil, Qnil, Qnil, 0, SampleGC);
+    s->head += 2;
+    s->samples++;
+    s->gc_samples++;
+    return;
+  }
 
   /* If we weren't doing anything, nothing to do. */
-  if(NIL_P(c->active_context)) return;
+  if(!REFERENCE_P(c->active_context)) return;
+
+  depth = c->in_primitive ? 1 : 0;
+  for(ctx = c->active_context;
+      REFERENCE_P(ctx) && depth < SAMPLE_MAX_DEPTH;
+      ctx = FASTCTX(ctx)->sender) {
+    depth++;
+  }
+
+  if(s->head - s->tail + depth + 1 > SAMPLE_RING) {
+    s->dropped++;
+    return;
+  }
+
+  /* The frames go in leaf first, the stack is only there once head
+     moves past them. */
+  i = s->head;
+  _sampler_put(s, i++, Qnil, Qnil, Qnil, depth, SampleStack);
 
-  /* We don't recycle context's even still, but when we do, rather than using
-     this, we should tell the cpu to just disable all recycling while
-     we sample. */
-  methctx_reference(state, c->active_context);
   if(c->in_primitive) {
-    state->samples[state->cur_sample++] = APPLY_TAG(c->in_primitive, TAG_FIXNUM);
-  } else {
-    state->samples[state->cur_sample++] = c->active_context;
+    _sampler_put(s, i++, I2N(c->in_primitive), Qnil, Qnil, 0, SamplePrimitive);
+    depth--;
   }
 
-  /* Add more space for samples. */
-  if(state->cur_sample == state->max_samples) {
-    OBJECT* chunk;
-    state->max_samples += SAMPLE_INCS;
-    chunk = (OBJECT*)realloc(state->samples, state->max_samples * SIZE_OF_OBJECT);
-    if(chunk != state->samples) {
-      // free(state->samples);
+  ctx = c->active_context;
+  ip = (c->ip_ptr && *c->ip_ptr) ? (int)(*c->ip_ptr - c->data) : (int)c->ip;
+
+  while(depth--) {
+    fc = FASTCTX(ctx);
+    module = fc->method_module;
+    name = Qnil;
+    kind = SampleMethod;
+
+    /* A block has no module or name of its own, they're its home's. */
+    if(fc->type == FASTCTX_BLOCK) {
+      kind = SampleBlock;
+      if(REFERENCE_P(fc->name)) {
+        home = blokenv_get_home(fc->name);
+        if(REFERENCE_P(home)) {
+          module = FASTCTX(home)->method_module;
+          name = FASTCTX(home)->name;
+        }
+      }
     }
-    state->samples = chunk;
+
+    _sampler_put(s, i++, fc->method, module, name, ip, kind);
+
+    ctx = fc->sender;
+    if(REFERENCE_P(ctx)) ip = FASTCTX(ctx)->ip;
   }
+
+  s->head = i;
+  s->samples++;
 }
 
+/* The name of the module a frame ran in, and whether it is a metaclass.
+   For the metaclass of something other than a module, the name of the
+   thing's class. */
+OBJECT cpu_sampler_module_name(STATE, OBJECT mod, int *meta) {
+  OBJECT obj;
+
+  *meta = 0;
+  if(!REFERENCE_P(mod)) return Qnil;
 
-void cpu_sampler_suspend(STATE) {
-  if(state->samples) {
-    signal(SIGPROF, SIG_IGN);
+  if(mod->obj_type == IncModType) {
+    mod = included_module_get_module(mod);
+    if(!REFERENCE_P(mod)) return Qnil;
   }
+
+  if(metaclass_s_metaclass_p(state, mod)) {
+    *meta = 1;
+    obj = metaclass_get_attached_instance(mod);
+    if(!REFERENCE_P(obj)) return Qnil;
+
+    switch(obj->obj_type) {
+    case ModuleType:
+    case ClassType:
+    case MetaclassType:
+      return module_get_name(obj);
+    default:
+      obj = object_class(state, obj);
+      return REFERENCE_P(obj) ? module_get_name(obj) : Qnil;
+    }
+  }
+
+  return module_get_name(mod);
 }
 
-void cpu_sampler_resume(STATE) {
-  if(state->samples) {
-    signal(SIGPROF, _cpu_sampler_record_context);
+static int _sampler_frame_id(STATE, struct sampler *s, struct sample_entry *e) {
+  struct sample_frame key, *frame;
+
+  memset(&key, 0, sizeof(key));
+  key.kind = e->kind;
+  key.module = Qnil;
+  key.name = Qnil;
+  key.file = Qnil;
+
+  switch(e->kind) {
+  case SamplePrimitive:
+    key.name = e->method;
+    break;
+  case SampleMethod:
+  case SampleBlock:
+    key.module = cpu_sampler_module_name(state, e->module, &key.meta);
+    if(REFERENCE_P(e->method) && e->method->obj_type == CMethodType) {
+      key.name = SYMBOL_P(e->name) ? e->name : cmethod_get_name(e->method);
+      key.file = cmethod_get_file(e->method);
+      key.line = cpu_ip2line(state, e->method, e->ip);
+    }
+    break;
+  }
+
+  frame = sample_frame_search(s->frame_table, &key);
+  if(frame) return frame->id;
+
+  if(s->num_frames == s->max_frames) {
+    s->max_frames *= 2;
+    s->frames = realloc(s->frames, s->max_frames * sizeof(struct sample_frame*));
+  }
+
+  frame = ALLOC_N(struct sample_frame, 1);
+  *frame = key;
+  frame->id = s->num_frames;
+  s->frames[s->num_frames++] = frame;
+  sample_frame_insert(s->frame_table, frame, frame);
+
+  return frame->id;
+}
+
+static void _sampler_count_stack(struct sampler *s, int *ids, int depth) {
+  struct sample_stack *key, *stack;
+
+  key = (struct sample_stack*)malloc(sizeof(struct sample_stack) +
+                                     depth * sizeof(int));
+  key->count = 1;
+  key->depth = depth;
+  memcpy(key->frames, ids, depth * sizeof(int));
+
+  stack = sample_stack_search(s->stack_table, key);
+  if(stack) {
+    stack->count++;
+    free(key);
+    return;
+  }
+
+  if(s->num_stacks == s->max_stacks) {
+    s->max_stacks *= 2;
+    s->stacks = realloc(s->stacks, s->max_stacks * sizeof(struct sample_stack*));
+  }
+
+  s->stacks[s->num_stacks++] = key;
+  sample_stack_insert(s->stack_table, key, key);
+}
+
+/* Aggregates everything in the ring. Nothing is allocated in the object
+   memory, so it's safe at the start of a GC. */
+void cpu_sampler_flush(STATE) {
+  struct sampler *s = state->sampler;
+  int ids[SAMPLE_MAX_DEPTH];
+  unsigned int head;
+  int depth, j;
+
+  if(!s) return;
+
+  head = s->head;
+  while(s->tail != head) {
+    depth = s->ring[s->tail % SAMPLE_RING].ip;
+
+    /* ids are root first, the ring has the leaf first */
+    for(j = depth - 1; j >= 0; j--) {
+      ids[j] = _sampler_frame_id(state, s,
+                 &s->ring[(s->tail + depth - j) % SAMPLE_RING]);
+    }
+    _sampler_count_stack(s, ids, depth);
+
+    s->tail += depth + 1;
   }
 }
 
@@ -117,8 +377,6 @@ struct sampler_args {
   int hz;
   pthread_t other;
   unsigned int* active;
-  int* in_gc;
-  uint32_t gc_cycles;
 };
 
 void *_cpu_thread_tick(void* blah) {
@@ -135,66 +393,147 @@ void *_cpu_thread_tick(void* blah) {
   spec.tv_nsec = 1000000000 / args->hz / 3;
 
   unsigned int* active = args->active;
-  int* in_gc = args->in_gc;
-  uint32_t gc_cycles = 0;
 
   while(*active) {
     nanosleep(&spec, &actual);
-    if(*in_gc) {
-      gc_cycles++;
-    } else {
-      pthread_kill(args->other, SIGPROF);
-    }
+    pthread_kill(args->other, SIGPROF);
   }
 
-  args->gc_cycles = gc_cycles;
-
   pthread_exit(blah);
   return blah;
 }
 
-void cpu_sampler_activate(STATE, int hz, machine m) {
-  state->max_samples = SAMPLE_INCS;
-  state->cur_sample = 0;
-  state->samples = ALLOC_N(OBJECT, state->max_samples);
+static void _sampler_set_timer(int hz) {
+  struct itimerval timer;
+
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = hz ? 1000000 / hz : 0;
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+int cpu_sampler_activate(STATE, int hz, int mode, machine m) {
+  struct sampler *s;
+  struct sigaction action;
+  struct sampler_args *args;
+
+  if(state->sampler || hz <= 0 || hz > 100000) return FALSE;
+
+  s = ALLOC_N(struct sampler, 1);
+  s->mode = mode;
+  s->owner = pthread_self();
+  s->ring = ALLOC_N(struct sample_entry, SAMPLE_RING);
+
+  s->frame_table = create_hashtable(1024, sample_frame_hash, sample_frame_eq);
+  s->max_frames = 1024;
+  s->frames = ALLOC_N(struct sample_frame*, s->max_frames);
 
-  cpu_sampler_resume(state);
+  s->stack_table = create_hashtable(1024, sample_stack_hash, sample_stack_eq);
+  s->max_stacks = 1024;
+  s->stacks = ALLOC_N(struct sample_stack*, s->max_stacks);
+
+  state->sampler = s;
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = _cpu_sampler_record_stack;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, NULL);
+
+  if(mode == SAMPLER_CPU) {
+    _sampler_set_timer(hz);
+    return TRUE;
+  }
 
   m->sampler_active = 1;
-  struct sampler_args *args = ALLOC_N(struct sampler_args, 1);
+  args = ALLOC_N(struct sampler_args, 1);
 
   args->hz = hz;
   args->other = pthread_self();
   args->active = &m->sampler_active;
-  args->in_gc = &state->in_gc;
 
   pthread_create(&m->sampler_thread, NULL, _cpu_thread_tick, (void*)args);
+  return TRUE;
 }
 
-OBJECT cpu_sampler_disable(STATE, machine m) {
+static OBJECT _sampler_frames(STATE, struct sampler *s) {
+  struct sample_frame *f;
   OBJECT tup;
   int i;
-  clock_t fin;
 
-  fin = clock();
+  tup = tuple_new(state, s->num_frames);
+  for(i = 0; i < s->num_frames; i++) {
+    f = s->frames[i];
+    tuple_put(state, tup, i, tuple_new2(state, 6, I2N(f->kind), f->module,
+          f->meta ? Qtrue : Qfalse, f->name, f->file, I2N(f->line)));
+  }
+  return tup;
+}
+
+static OBJECT _sampler_stacks(STATE, struct sampler *s) {
+  struct sample_stack *st;
+  OBJECT tup, ids;
+  int i, j;
+
+  tup = tuple_new(state, s->num_stacks);
+  for(i = 0; i < s->num_stacks; i++) {
+    st = s->stacks[i];
+    ids = tuple_new(state, st->depth);
+    for(j = 0; j < st->depth; j++) {
+      tuple_put(state, ids, j, I2N(st->frames[j]));
+    }
+    tuple_put(state, tup, i, tuple_new2(state, 2, ids, I2N(st->count)));
+  }
+  return tup;
+}
 
-  /* tell the other thread to stop, then join it. */
-  m->sampler_active = 0;
+/* Stops the sampler and returns what it found as
+   (frames, stacks, samples, gc samples, dropped samples, clock). Each
+   frame is (kind, module name, metaclass?, method name, file, line) and
+   each stack is (frame indexes from the root, times seen). */
+OBJECT cpu_sampler_disable(STATE, machine m) {
+  struct sampler *s = state->sampler;
   struct sampler_args* args;
-  pthread_join(m->sampler_thread, (void*)&args);
+  struct sigaction action;
+  OBJECT tup;
+  clock_t fin;
+  int i;
+
+  fin = clock();
 
-  cpu_sampler_suspend(state);
+  if(!s) return Qnil;
 
-  if(!state->samples) return Qnil;
-  tup = tuple_new(state, state->cur_sample);
-  for(i = 0; i < state->cur_sample; i++) {
-    tuple_put(state, tup, i, state->samples[i]);
+  if(s->mode == SAMPLER_CPU) {
+    _sampler_set_timer(0);
+  } else {
+    /* tell the other thread to stop, then join it. */
+    m->sampler_active = 0;
+    pthread_join(m->sampler_thread, (void*)&args);
+    free(args);
   }
 
-  XFREE(state->samples);
-  state->samples = NULL;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = SIG_IGN;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, NULL);
+
+  cpu_sampler_flush(state);
+
+  tup = tuple_new2(state, 6, _sampler_frames(state, s), _sampler_stacks(state, s),
+      I2N(s->samples), I2N(s->gc_samples), I2N(s->dropped), I2N((int)fin));
+
+  state->sampler = NULL;
+
+  hashtable_destroy(s->frame_table, 0);
+  for(i = 0; i < s->num_frames; i++) free(s->frames[i]);
+  XFREE(s->frames);
+
+  hashtable_destroy(s->stack_table, 0);
+  for(i = 0; i < s->num_stacks; i++) free(s->stacks[i]);
+  XFREE(s->stacks);
+
+  XFREE(s->ring);
+  XFREE(s);
 
-  tup = tuple_new2(state, 3, tup, I2N((int)fin), I2N(args->gc_cycles));
-  free(args);
   return tup;
 }
@@ -213,6 +213,7 @@ void cpu_task_flush(STATE, cpu c) {
 int cpu_task_select(STATE, cpu c, OBJECT nw) {
   struct cpu_task *cur_task, *new_task, *ct;
   OBJECT home, cur;
+  IP_TYPE **ip_ptr;
 
   assert(cpu_task_alive_p(state, nw));
 
@@ -260,7 +261,11 @@ int cpu_task_select(STATE, cpu c, OBJECT nw) {
     cur_task->active = FALSE;
   }
 
+  /* ip_ptr points into the cpu_run that is running, which isn't the one
+     the task last ran in if that was a nested run (see nmc_call_nested). */
+  ip_ptr = c->ip_ptr;
   memcpy(ct, new_task, sizeof(struct cpu_task_shared));
+  c->ip_ptr = ip_ptr;
   new_task->active = TRUE;
   
   home = NIL_P(c->home_context) ? c->active_context : c->home_context;
@@ -497,6 +502,14 @@ void cpu_thread_switch(STATE, cpu c, OBJECT thr) {
   task = thread_get_task(thr);
   cpu_task_select(state, c, task);
   c->current_thread = thr;
+
+  if(state->probes->mask) {
+    uint32_t id = probe_thread_id(state, c, thr);
+    if(PROBE_ON(state->probes, PROBE_THREAD)) {
+      probe_emit(state->probes, ProbeThreadSwitch, state->probes->thread, id, 0, 0);
+    }
+    state->probes->thread = id;
+  }
 }
 
 /* Called because the current thread is waiting on something. */
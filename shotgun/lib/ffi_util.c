@@ -80,15 +80,6 @@ long ffi_read_long(long *ptr) {
   return *ptr;
 }
 
-double ffi_write_float(double *ptr, double val) {
-  *ptr = val;
-  return val;
-}
-
-double ffi_read_float(double *ptr) {
-  return *ptr;
-}
-
 char *ffi_read_string(char *ptr) {
   return ptr;
 }
@@ -1,109 +1,82 @@
 #ifndef RBS_FIXNUM_H
 #define RBS_FIXNUM_H
 
-/* Each of these operations intend to implement safe code according to
-   https://www.securecoding.cert.org/confluence/display/seccode/INT32-C.+Ensure+that+integer+operations+do+not+result+in+an+overflow
-   Thanks defn52 for the link.
+/* Fixnum arithmetic, shared by the primitives and the meta_send_op_*
+   instructions. Each operation gives a Fixnum, or a Bignum when the
+   result doesn't fit, so neither caller ever has to leave its fast path.
+
+   A Fixnum is FIXNUM_WIDTH bits, well short of a native_int, so sums and
+   differences can't overflow the C type and I2N does the range check.
+   Products and left shifts can, so they are checked with the compiler's
+   overflow builtins and redone as Bignums when they trip.
 */
 
 static inline OBJECT fixnum_add(STATE, OBJECT a, OBJECT b) {
-  native_int j, k, m;
-  
-  // + will never overflow an int because of the size of a Fixnum
-  j = N2I(a);
-  k = N2I(b);
-  m = j + k;
-  if(m > FIXNUM_MAX || m < FIXNUM_MIN) {
-    return bignum_new(state, m);
-  } else {
-    return APPLY_TAG(m, TAG_FIXNUM);
-  }
+  return I2N(N2I(a) + N2I(b));
 }
 
 static inline OBJECT fixnum_sub(STATE, OBJECT a, OBJECT b) {
-  OBJECT r;
-  native_int j, k, m;
-  
-  // - will never overflow a signed int because of the size of a Fixnum
-  j = N2I(a);
-  k = N2I(b);
-  m = j - k;
-  r = I2N(m);
-  if(m != N2I(r)) {
-    r = bignum_sub(state, bignum_new(state, j), bignum_new(state, k));
-  }
-  
-  return r;
+  return I2N(N2I(a) - N2I(b));
 }
 
 static inline OBJECT fixnum_mul(STATE, OBJECT a, OBJECT b) {
-  native_int na = N2I(a);
-  native_int nb = N2I(b);
-  unsigned int overflow = FALSE;
-
-  /* There is no C type large enough to (always) hold the result of
-   * multiplying two native_ints together
-   */
-
-  if (na > 0) { /* a is positive */
-    if (nb > 0) { /* a and b are positive */
-      if (na > (FIXNUM_MAX / nb)) { overflow = TRUE; }
-    } else { /* a is positive, b is non-positive */
-      if (nb < (FIXNUM_MIN / na)) { overflow = TRUE; }
-    }
-  } else { /* a is non-positive */
-    if (nb > 0) { /* a is non-positive, b is positive */
-      if (na < (FIXNUM_MIN / nb)) { overflow = TRUE; }
-    } else { /* a and b are non-positive */
-      if ( (na != 0) && (nb < (FIXNUM_MAX / na))) { overflow = TRUE; }
-    }
-  }
-  if (overflow) {
-    return bignum_mul(state, bignum_new(state, na), b);
-  } else {
-    return I2N(na * nb);
+  native_int m;
+
+  if(__builtin_mul_overflow(N2I(a), N2I(b), &m)) {
+    return bignum_mul(state, bignum_new(state, N2I(a)), b);
   }
+  return I2N(m);
 }
 
+/* Division rounding toward negative infinity, as Ruby does it. b must
+   not be 0. The quotient of FIXNUM_MIN / -1 still fits in a native_int,
+   so only the caller's I2N has to deal with it. */
 static inline native_int fixnum_div(STATE, OBJECT a, OBJECT b, native_int *mod) {
   native_int x, y;
   native_int div;
 
   x = N2I(a);
   y = N2I(b);
-  
-  // adapted from ruby 1.8.x
-  if (y < 0) {
-    if (x < 0)
-      div = -x / -y;
-    else
-      div = - (x / -y);
-  } else {
-    if (x < 0)
-      div = - (-x / y);
-    else
-      div = x / y;
-  }
 
-  *mod = x - div*y;
-  if ((*mod < 0 && y > 0) || (*mod > 0 && y < 0)) {
+  div = x / y;
+  *mod = x % y;
+  if(*mod != 0 && ((*mod < 0) != (y < 0))) {
     *mod += y;
     div -= 1;
   }
-  
+
   return div;
 }
 
 static inline OBJECT fixnum_divmod(STATE, OBJECT a, OBJECT b) {
   OBJECT ary;
   native_int div, mod;
-  
+
   div = fixnum_div(state, a, b, &mod);
-  
+
   ary = array_new(state, 2);
   array_set(state, ary, 0, I2N(div));
   array_set(state, ary, 1, I2N(mod));
   return ary;
 }
 
+/* a << width, for width >= 0. */
+static inline OBJECT fixnum_left_shift(STATE, OBJECT a, native_int width) {
+  native_int m;
+
+  if(width < FIXNUM_WIDTH &&
+     !__builtin_mul_overflow(N2I(a), (native_int)1 << width, &m)) {
+    return I2N(m);
+  }
+  return bignum_left_shift(state, bignum_new(state, N2I(a)), I2N(width));
+}
+
+/* a >> width, for width >= 0. */
+static inline OBJECT fixnum_right_shift(STATE, OBJECT a, native_int width) {
+  native_int value = N2I(a);
+
+  if(width >= FIXNUM_WIDTH) return I2N(value < 0 ? -1 : 0);
+  return I2N(value >> width);
+}
+
 #endif
@@ -1,14 +1,70 @@
+#include <stdint.h>
+#include <string.h>
+
 #include "shotgun/lib/shotgun.h"
 #include "shotgun/lib/tuple.h"
+#include "shotgun/lib/array.h"
+#include "shotgun/lib/string.h"
+#include "shotgun/lib/bytearray.h"
+#include "shotgun/lib/object.h"
 #include "shotgun/lib/hash.h"
 #include "shotgun/lib/lookuptable.h"
 
 /* MINSIZE MUST be a power of 2 */
-#define MINSIZE 16
+#define MINSIZE 8
 
-#define Increments 16
+/* Hash#key_hash reduces #hash results that aren't Fixnums by this */
+#define HASH_MAX 0x1fffffff
 
 #define find_bin(hash, total) (hash & (total - 1))
+#define next_bin(bin, total) ((bin + 1) & (total - 1))
+#define index_width(bins) ((bins) <= 256 ? 1 : (bins) <= 65536 ? 2 : 4)
+
+static unsigned int index_get(OBJECT index, unsigned int bins, unsigned int bin) {
+  void *slots = BYTEARRAY_ADDRESS(index);
+
+  switch(index_width(bins)) {
+  case 1:
+    return ((uint8_t*)slots)[bin];
+  case 2:
+    return ((uint16_t*)slots)[bin];
+  default:
+    return ((uint32_t*)slots)[bin];
+  }
+}
+
+static void index_set(OBJECT index, unsigned int bins, unsigned int bin, unsigned int val) {
+  void *slots = BYTEARRAY_ADDRESS(index);
+
+  switch(index_width(bins)) {
+  case 1:
+    ((uint8_t*)slots)[bin] = (uint8_t)val;
+    break;
+  case 2:
+    ((uint16_t*)slots)[bin] = (uint16_t)val;
+    break;
+  default:
+    ((uint32_t*)slots)[bin] = (uint32_t)val;
+    break;
+  }
+}
+
+/* Points the first free slot in the probe sequence of hsh at entry ent. */
+static void index_insert(OBJECT index, unsigned int bins, unsigned int hsh, int ent) {
+  unsigned int bin;
+
+  bin = find_bin(hsh, bins);
+  while(index_get(index, bins, bin)) {
+    bin = next_bin(bin, bins);
+  }
+  index_set(index, bins, bin, ent + 1);
+}
+
+static unsigned int round_bins(int size) {
+  unsigned int bins = MINSIZE;
+  while(bins < (unsigned int)size) bins <<= 1;
+  return bins;
+}
 
 OBJECT hash_new(STATE) {
   OBJECT hsh;
@@ -17,7 +73,7 @@ OBJECT hash_new(STATE) {
   return hsh;
 }
 
-/* size MUST be a power of 2 */
+/* size is rounded up to a power of 2 */
 OBJECT hash_new_sized(STATE, int size) {
   OBJECT hsh;
   hsh = hash_allocate(state);
@@ -25,185 +81,143 @@ OBJECT hash_new_sized(STATE, int size) {
   return hsh;
 }
 
-void hash_setup(STATE, OBJECT hsh, int size) {
-  int sz;
-  sz = size == 0 ? MINSIZE : size;
-  // TODO: Remove @keys field
-  hash_set_keys(hsh, Qnil);
-  hash_set_values(hsh, tuple_new(state, sz));
-  hash_set_bins(hsh, I2N(sz));
+static void setup_storage(STATE, OBJECT hsh, unsigned int bins) {
+  hash_set_index(hsh, bytearray_new(state, bins * index_width(bins)));
+  hash_set_values(hsh, tuple_new(state, hash_capacity(bins) * HASH_ENTRY_FIELDS));
+  hash_set_bins(hsh, I2N(bins));
   hash_set_entries(hsh, I2N(0));
+  hash_set_used(hsh, I2N(0));
+}
+
+void hash_setup(STATE, OBJECT hsh, int size) {
+  setup_storage(state, hsh, round_bins(size));
   hash_set_default(hsh, Qnil);
 }
 
-OBJECT hash_dup(STATE, OBJECT hsh) {
-  int sz, i;
-  OBJECT dup, cv, vals, ent, next, lst, tmp;
+/* Moves the live entries, still in order, into fresh storage for bins
+ * bins and rebuilds the index for them. */
+static void rebuild(STATE, OBJECT hsh, unsigned int bins) {
+  int i, used, ent;
+  OBJECT values, new_values, index, th;
 
-  sz = N2I(hash_get_bins(hsh));
-  dup = hash_new_sized(state, sz);
-  SET_CLASS(dup, object_class(state, hsh));
+  used = N2I(hash_get_used(hsh));
+  values = hash_get_values(hsh);
 
-  hash_set_bins(dup, I2N(sz));
-  hash_set_entries(dup, hash_get_entries(hsh));
-  hash_set_default(dup, hash_get_default(hsh));
-  // TODO: Remove @keys field
-  hash_set_keys(dup, Qnil);
+  new_values = tuple_new(state, hash_capacity(bins) * HASH_ENTRY_FIELDS);
+  index = bytearray_new(state, bins * index_width(bins));
 
-  cv = hash_get_values(hsh);
+  for(i = ent = 0; i < used; i++) {
+    th = tuple_at(state, values, i * HASH_ENTRY_FIELDS);
+    if(NIL_P(th)) continue;
 
-  vals = tuple_new(state, sz);
-  hash_set_values(dup, vals);
+    tuple_put(state, new_values, ent * HASH_ENTRY_FIELDS, th);
+    tuple_put(state, new_values, ent * HASH_ENTRY_FIELDS + 1,
+              tuple_at(state, values, i * HASH_ENTRY_FIELDS + 1));
+    tuple_put(state, new_values, ent * HASH_ENTRY_FIELDS + 2,
+              tuple_at(state, values, i * HASH_ENTRY_FIELDS + 2));
+    index_insert(index, bins, (unsigned int)N2I(th), ent);
+    ent++;
+  }
 
-  for(i = 0; i < sz; i++) {
-    tmp = tuple_at(state, cv, i);
-    if(NIL_P(tmp)) continue;
+  hash_set_values(hsh, new_values);
+  hash_set_index(hsh, index);
+  hash_set_bins(hsh, I2N(bins));
+  hash_set_used(hsh, I2N(ent));
+}
 
-    ent = tuple_dup(state, tmp);
-    tuple_put(state, vals, i, ent);
+OBJECT hash_dup(STATE, OBJECT hsh) {
+  OBJECT dup;
 
-    next = tuple_at(state, ent, 3);
-    lst = ent;
-    while(!NIL_P(next)) {
-      next = tuple_dup(state, next);
-      tuple_put(state, lst, 3, next);
-      lst = next;
-      next = tuple_at(state, next, 3);
-    }
-  }
+  dup = hash_allocate(state);
+  SET_CLASS(dup, object_class(state, hsh));
+  hash_replace(state, dup, hsh);
+  hash_set_default(dup, hash_get_default(hsh));
 
   return dup;
 }
 
-static OBJECT entry_new(STATE, unsigned int hsh, OBJECT key, OBJECT data) {
-  OBJECT tup = tuple_new(state, 4);
-  tuple_put(state, tup, 0, I2N(hsh));
-  tuple_put(state, tup, 1, key);
-  tuple_put(state, tup, 2, data);
-  tuple_put(state, tup, 3, Qnil);
-  return tup;
-}
-
-static OBJECT entry_append(STATE, OBJECT top, OBJECT nxt) {
-  OBJECT cur, last;
-  int depth = 1;
-  cur = tuple_at(state, top, 3);
-  last = top;
-  while(!NIL_P(cur)) {
-    last = cur;
-    cur = tuple_at(state, cur, 3);
-    depth++;
-  }
-
-  // printf("Inserted new key to hash %d levels deep.\n", depth);
-  tuple_put(state, last, 3, nxt);
-  return nxt;
+/* Makes h hold the same entries as other. The storage is copied whole,
+ * so no entry needs to be hashed or inserted again. */
+void hash_replace(STATE, OBJECT h, OBJECT other) {
+  hash_set_index(h, bytearray_dup(state, hash_get_index(other)));
+  hash_set_values(h, tuple_dup(state, hash_get_values(other)));
+  hash_set_bins(h, hash_get_bins(other));
+  hash_set_entries(h, hash_get_entries(other));
+  hash_set_used(h, hash_get_used(other));
 }
 
-static OBJECT add_entry(STATE, OBJECT h, unsigned int hsh, OBJECT ent) {
-  unsigned int bin, bins;
-  OBJECT entry;
-
-
-  bins = (unsigned int)N2I(hash_get_bins(h));
-  bin = find_bin(hsh, bins);
+/* Grows the table to twice as many bins. */
+void hash_redistribute(STATE, OBJECT hsh) {
+  rebuild(state, hsh, N2I(hash_get_bins(hsh)) * 2);
+}
 
-  entry = tuple_at(state, hash_get_values(h), bin);
+/* Adds an entry for key at the end of the entries. The caller has made
+ * sure key isn't in the table already. Returns the entry number. */
+int hash_append(STATE, OBJECT h, unsigned int hsh, OBJECT key, OBJECT data) {
+  int ent, bins;
+  OBJECT values;
 
-  if(NIL_P(entry)) {
-    tuple_put(state, hash_get_values(h), bin, ent);
-  } else {
-    entry_append(state, entry, ent);
+  if(hash_redistribute_p(h)) {
+    bins = N2I(hash_get_bins(h));
+    /* Removed entries are only reclaimed here. If they make up half of
+       the table, compacting it makes enough room. */
+    if(N2I(hash_get_entries(h)) >= hash_capacity(bins) / 2) {
+      bins *= 2;
+    }
+    rebuild(state, h, bins);
   }
 
+  ent = N2I(hash_get_used(h));
+  values = hash_get_values(h);
+  tuple_put(state, values, ent * HASH_ENTRY_FIELDS, I2N(hsh));
+  tuple_put(state, values, ent * HASH_ENTRY_FIELDS + 1, key);
+  tuple_put(state, values, ent * HASH_ENTRY_FIELDS + 2, data);
+  index_insert(hash_get_index(h), N2I(hash_get_bins(h)), hsh, ent);
+
+  hash_set_used(h, I2N(ent + 1));
   hash_set_entries(h, I2N(N2I(hash_get_entries(h)) + 1));
   return ent;
 }
 
-/* TODO: Why do we use signed int for bins and then use a
- * loop like for(i = 0; i < bins; i++) ?
- */
-void hash_redistribute(STATE, OBJECT hsh) {
-  int i, bins, size;
-  unsigned int bin, hash;
-  OBJECT values, new_values, entry, next, slot;
-
-  bins = N2I(hash_get_bins(hsh));
-  values = hash_get_values(hsh);
-
-  /* TODO: calculate the size both up and down.
-   * i.e. don't assume we're only growing
-   */
-  size = bins * 2;
-  new_values = tuple_new(state, size);
-
-  // printf("Hash redistribute %p, %d => %d (%d)\n", hsh, bins, size, N2I(hash_get_entries(hsh)));
-
-  for(i = 0; i < bins; i++) {
-    entry = tuple_at(state, values, i);
-
-    while(!NIL_P(entry)) {
-      next = tuple_at(state, entry, 3);
-      tuple_put(state, entry, 3, Qnil);
+/* Walks the probe sequence of hsh. Stops at the first entry with that
+ * hash for which compare returns true, or for any entry with that hash
+ * if compare is NULL. Returns the entry number or HASH_MISSING. */
+static int find_entry(STATE, OBJECT h, unsigned int hsh, OBJECT key,
+                      int (*compare)(STATE, OBJECT, OBJECT)) {
+  unsigned int bin, bins, slot;
+  OBJECT index, values, th;
 
-      hash = N2I(tuple_at(state, entry, 0));
-      bin = find_bin(hash, size);
-      slot = tuple_at(state, new_values, bin);
-
-      if(NIL_P(slot)) {
-        tuple_put(state, new_values, bin, entry);
-      } else {
-        entry_append(state, slot, entry);
-      }
-
-      entry = next;
+  bins = (unsigned int)N2I(hash_get_bins(h));
+  index = hash_get_index(h);
+  values = hash_get_values(h);
+  th = I2N(hsh);
+
+  for(bin = find_bin(hsh, bins); (slot = index_get(index, bins, bin)); bin = next_bin(bin, bins)) {
+    slot--;
+    if(tuple_at(state, values, slot * HASH_ENTRY_FIELDS) != th) continue;
+    if(!compare || compare(state, tuple_at(state, values, slot * HASH_ENTRY_FIELDS + 1), key)) {
+      return slot;
     }
   }
-
-  hash_set_values(hsh, new_values);
-  hash_set_bins(hsh, I2N(size));
+  return HASH_MISSING;
 }
 
-OBJECT hash_find_entry(STATE, OBJECT h, unsigned int hsh) {
-  unsigned int bin, bins;
-  OBJECT entry, th;
-
-  bins = (unsigned int)N2I(hash_get_bins(h));
-  bin = find_bin(hsh, bins);
-  entry = tuple_at(state, hash_get_values(h), bin);
-
-  // printf("start: %x, %ud, %d, %d\n", entry, hsh, bin, N2I(hash_get_bins(h)));
-
-  while(!NIL_P(entry)) {
-    // printf("entry: %x\n", entry);
-    th = tuple_at(state, entry, 0);
-    if(N2I(th) == hsh) {
-      return entry;
-    }
-    entry = tuple_at(state, entry, 3);
-  }
-  return Qnil;
+int hash_find_entry(STATE, OBJECT h, unsigned int hsh) {
+  return find_entry(state, h, hsh, Qnil, NULL);
 }
 
 OBJECT hash_add(STATE, OBJECT h, unsigned int hsh, OBJECT key, OBJECT data) {
-  OBJECT entry;
-  int i;
+  int ent;
 
   // printf("hash_add: adding %od\n",hsh);
-  entry = hash_find_entry(state, h, hsh);
+  ent = hash_find_entry(state, h, hsh);
 
-  if(RTEST(entry)) {
-    tuple_put(state, entry, 2, data);
+  if(ent != HASH_MISSING) {
+    tuple_put(state, hash_get_values(h), ent * HASH_ENTRY_FIELDS + 2, data);
     return data;
   }
 
-  if(hash_redistribute_p(h)) {
-    hash_redistribute(state, h);
-  }
-
-  i = N2I(hash_get_entries(h));
-  entry = entry_new(state, hsh, key, data);
-  add_entry(state, h, hsh, entry);
+  hash_append(state, h, hsh, key, data);
   return data;
 }
 
@@ -213,37 +227,25 @@ OBJECT hash_set(STATE, OBJECT hash, OBJECT key, OBJECT val) {
 }
 
 OBJECT hash_get(STATE, OBJECT hash, unsigned int hsh) {
-  OBJECT entry;
+  int ent;
 
-  entry = hash_find_entry(state, hash, hsh);
-  if(RTEST(entry)) {
-    return tuple_at(state, entry, 2);
+  ent = hash_find_entry(state, hash, hsh);
+  if(ent != HASH_MISSING) {
+    return hash_entry_value(state, hash, ent);
   }
 
   return Qnil;
 }
 
+static int identical_p(STATE, OBJECT a, OBJECT b) {
+  return a == b;
+}
+
 /* Find the +value+ for +key+, having hash value +hash+.
  * Uses +==+ to verify the key in the table matches +key+.
  * Return TRUE if key was found, and *value will be filled. */
 int hash_lookup(STATE, OBJECT tbl, OBJECT key, unsigned int hash, OBJECT *value) {
-  OBJECT ent, hk;
-
-  ent = hash_find_entry(state, tbl, hash);
-  if(REFERENCE_P(ent)) {
-    while(N2I(tuple_at(state, ent, 0)) == hash) {
-      hk = tuple_at(state, ent, 1);
-      if(hk == key) {
-        *value = tuple_at(state, ent, 2);
-        return TRUE;
-      }
-
-      ent = tuple_at(state, ent, 3);
-      if(NIL_P(ent)) break;
-    }
-  }
-
-  return FALSE;
+  return hash_lookup2(state, identical_p, tbl, key, hash, value);
 }
 
 /* Find the +value+ for +key+, having hash value +hash+.
@@ -251,20 +253,12 @@ int hash_lookup(STATE, OBJECT tbl, OBJECT key, unsigned int hash, OBJECT *value)
  * Return TRUE if key was found, and *value will be filled. */
 int hash_lookup2(STATE, int (*compare)(STATE, OBJECT, OBJECT),
     OBJECT tbl, OBJECT key, unsigned int hash, OBJECT *value) {
-  OBJECT ent, hk;
-
-  ent = hash_find_entry(state, tbl, hash);
-  if(REFERENCE_P(ent)) {
-    while(N2I(tuple_at(state, ent, 0)) == hash) {
-      hk = tuple_at(state, ent, 1);
-      if(compare(state, hk, key)) {
-        *value = tuple_at(state, ent, 2);
-        return TRUE;
-      }
-
-      ent = tuple_at(state, ent, 3);
-      if(NIL_P(ent)) break;
-    }
+  int ent;
+
+  ent = find_entry(state, tbl, hash, key, compare);
+  if(ent != HASH_MISSING) {
+    *value = hash_entry_value(state, tbl, ent);
+    return TRUE;
   }
 
   return FALSE;
@@ -272,36 +266,15 @@ int hash_lookup2(STATE, int (*compare)(STATE, OBJECT, OBJECT),
 
 void hash_assign(STATE, int (*compare)(STATE, OBJECT, OBJECT), OBJECT tbl,
     OBJECT key, unsigned int hash, OBJECT value) {
-  OBJECT base, ent, hk;
-
-  base = ent = hash_find_entry(state, tbl, hash);
-  if(REFERENCE_P(ent)) {
-    while(N2I(tuple_at(state, ent, 0)) == hash) {
-      hk = tuple_at(state, ent, 1);
-      if(compare(state, hk, key)) {
-        tuple_put(state, ent, 2, value);
-        return;
-      }
-
-      ent = tuple_at(state, ent, 3);
-      if(NIL_P(ent)) break;
-    }
-
-  }
+  int ent;
 
-  if(hash_redistribute_p(tbl)) {
-    hash_redistribute(state, tbl);
-  }
-
-  if(REFERENCE_P(base)) {
-    ent = entry_new(state, hash, key, value);
-    entry_append(state, base, ent);
-    hash_set_entries(tbl, I2N(N2I(hash_get_entries(tbl)) + 1));
+  ent = find_entry(state, tbl, hash, key, compare);
+  if(ent != HASH_MISSING) {
+    tuple_put(state, hash_get_values(tbl), ent * HASH_ENTRY_FIELDS + 2, value);
     return;
   }
 
-  ent = entry_new(state, hash, key, value);
-  add_entry(state, tbl, hash, ent);
+  hash_append(state, tbl, hash, key, value);
 }
 
 /* This version of hash_get returns Qundef if the entry was not found.
@@ -310,45 +283,145 @@ void hash_assign(STATE, int (*compare)(STATE, OBJECT, OBJECT), OBJECT tbl,
  */
 
 OBJECT hash_get_undef(STATE, OBJECT hash, unsigned int hsh) {
-  OBJECT entry;
+  int ent;
 
-  entry = hash_find_entry(state, hash, hsh);
-  if(RTEST(entry)) {
-    return tuple_at(state, entry, 2);
+  ent = hash_find_entry(state, hash, hsh);
+  if(ent != HASH_MISSING) {
+    return hash_entry_value(state, hash, ent);
   } else {
     return Qundef;
   }
 }
 
+/* Removes entry ent and returns its value. The index keeps pointing at
+ * the removed entry, which now just lengthens probe sequences, until the
+ * next rebuild. */
+OBJECT hash_delete_entry(STATE, OBJECT h, int ent) {
+  OBJECT values, val;
+
+  values = hash_get_values(h);
+  val = tuple_at(state, values, ent * HASH_ENTRY_FIELDS + 2);
+  tuple_put(state, values, ent * HASH_ENTRY_FIELDS, Qnil);
+  tuple_put(state, values, ent * HASH_ENTRY_FIELDS + 1, Qnil);
+  tuple_put(state, values, ent * HASH_ENTRY_FIELDS + 2, Qnil);
+
+  hash_set_entries(h, I2N(N2I(hash_get_entries(h)) - 1));
+  return val;
+}
+
 OBJECT hash_delete(STATE, OBJECT self, unsigned int hsh) {
-  unsigned int bin;
-  OBJECT entry, th, lk, val, lst;
+  int ent;
 
-  bin = find_bin(hsh, N2I(hash_get_bins(self)));
-  entry = tuple_at(state, hash_get_values(self), bin);
+  ent = hash_find_entry(state, self, hsh);
+  if(ent != HASH_MISSING) {
+    return hash_delete_entry(state, self, ent);
+  }
 
-  lst = Qnil;
+  return Qnil;
+}
 
-  while(!NIL_P(entry)) {
-    th = tuple_at(state, entry, 0);
-    lk = tuple_at(state, entry, 3);
+/* The hash Hash#key_hash computes for key, for keys whose #hash is
+ * Object#hash (see object_hash_int). */
+unsigned int hash_key_hash(STATE, OBJECT key) {
+  unsigned int hsh;
 
-    if(N2I(th) == hsh) {
-      val = tuple_at(state, entry, 2);
-      if(NIL_P(lst)) {
-        tuple_put(state, hash_get_values(self), bin, lk);
-      } else {
-        tuple_put(state, lst, 3, lk);
-      }
-      hash_set_entries(self, I2N(N2I(hash_get_entries(self)) - 1));
-      return val;
+  hsh = object_hash_int(state, key);
+  if((uintptr_t)hsh > FIXNUM_MAX) {
+    hsh %= HASH_MAX;
+  }
+  return hsh;
+}
+
+/* Whether key.eql?(other) is known without calling back into Ruby:
+ * TRUE, FALSE or -1 when it isn't. */
+static int keys_eql(STATE, OBJECT key, OBJECT other) {
+  /* eql? on immediates is identity */
+  if(!REFERENCE_P(key)) return key == other;
+
+  /* a String subclass may redefine eql? */
+  if(STRING_P(key) && object_class(state, key) == BASIC_CLASS(string)) {
+    if(key == other) return TRUE;
+    if(!STRING_P(other)) return FALSE;
+    if(string_get_bytes(key) != string_get_bytes(other)) return FALSE;
+    return memcmp(string_byte_address(state, key), string_byte_address(state, other),
+                  N2I(string_get_bytes(key))) == 0;
+  }
+
+  /* other keys get eql? called even when identical */
+  return -1;
+}
+
+/* Finds the entry for key, having hash value hsh, comparing keys the way
+ * eql? would. Returns the entry number, HASH_MISSING, or HASH_UNDECIDED if
+ * an entry with the same hash has a key that only eql? can tell apart. */
+int hash_find_eql(STATE, OBJECT h, unsigned int hsh, OBJECT key) {
+  unsigned int bin, bins, slot;
+  int undecided = FALSE;
+  OBJECT index, values, th;
+
+  bins = (unsigned int)N2I(hash_get_bins(h));
+  index = hash_get_index(h);
+  values = hash_get_values(h);
+  th = I2N(hsh);
+
+  for(bin = find_bin(hsh, bins); (slot = index_get(index, bins, bin)); bin = next_bin(bin, bins)) {
+    slot--;
+    if(tuple_at(state, values, slot * HASH_ENTRY_FIELDS) != th) continue;
+
+    switch(keys_eql(state, key, tuple_at(state, values, slot * HASH_ENTRY_FIELDS + 1))) {
+    case TRUE:
+      return slot;
+    case FALSE:
+      break;
+    default:
+      undecided = TRUE;
     }
+  }
+  return undecided ? HASH_UNDECIDED : HASH_MISSING;
+}
 
-    lst = entry;
-    entry = lk;
+/* Returns an Array of the numbers of the entries with hash value hsh,
+ * for checking their keys with eql? in Ruby. */
+OBJECT hash_candidates(STATE, OBJECT h, unsigned int hsh) {
+  unsigned int bin, bins, slot;
+  OBJECT index, values, ary, th;
+
+  bins = (unsigned int)N2I(hash_get_bins(h));
+  index = hash_get_index(h);
+  values = hash_get_values(h);
+  ary = array_new(state, 1);
+  th = I2N(hsh);
+
+  for(bin = find_bin(hsh, bins); (slot = index_get(index, bins, bin)); bin = next_bin(bin, bins)) {
+    slot--;
+    if(tuple_at(state, values, slot * HASH_ENTRY_FIELDS) == th) {
+      array_append(state, ary, I2N(slot));
+    }
   }
+  return ary;
+}
 
-  return Qnil;
+static OBJECT collect(STATE, OBJECT h, int field) {
+  int i, j, used;
+  OBJECT ary, values;
+
+  ary = array_new(state, N2I(hash_get_entries(h)));
+  used = N2I(hash_get_used(h));
+  values = hash_get_values(h);
+
+  for(i = j = 0; i < used; i++) {
+    if(NIL_P(tuple_at(state, values, i * HASH_ENTRY_FIELDS))) continue;
+    array_set(state, ary, j++, tuple_at(state, values, i * HASH_ENTRY_FIELDS + field));
+  }
+  return ary;
+}
+
+OBJECT hash_keys(STATE, OBJECT h) {
+  return collect(state, h, 1);
+}
+
+OBJECT hash_values(STATE, OBJECT h) {
+  return collect(state, h, 2);
 }
 
 OBJECT hash_s_from_tuple(STATE, OBJECT tup) {
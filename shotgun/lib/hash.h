@@ -8,7 +8,7 @@ OBJECT hash_get_undef(STATE, OBJECT hash, unsigned int hsh);
 OBJECT hash_delete(STATE, OBJECT self, unsigned int hsh);
 OBJECT hash_s_from_tuple(STATE, OBJECT tup);
 OBJECT hash_get_undef(STATE, OBJECT hash, unsigned int hsh);
-OBJECT hash_find_entry(STATE, OBJECT h, unsigned int hsh);
+int hash_find_entry(STATE, OBJECT h, unsigned int hsh);
 OBJECT hash_dup(STATE, OBJECT hsh);
 void hash_redistribute(STATE, OBJECT hsh);
 
@@ -16,15 +16,42 @@ int hash_lookup(STATE, OBJECT tbl, OBJECT key, unsigned int hash, OBJECT *value)
 int hash_lookup2(STATE, int (*compare)(STATE, OBJECT, OBJECT), OBJECT tbl, OBJECT key, unsigned int hash, OBJECT *value);
 void hash_assign(STATE, int (*compare)(STATE, OBJECT, OBJECT), OBJECT tbl, OBJECT key, unsigned int hash, OBJECT value);
 
+unsigned int hash_key_hash(STATE, OBJECT key);
+int hash_find_eql(STATE, OBJECT h, unsigned int hsh, OBJECT key);
+OBJECT hash_candidates(STATE, OBJECT h, unsigned int hsh);
+int hash_append(STATE, OBJECT h, unsigned int hsh, OBJECT key, OBJECT data);
+OBJECT hash_delete_entry(STATE, OBJECT h, int ent);
+void hash_replace(STATE, OBJECT h, OBJECT other);
+OBJECT hash_keys(STATE, OBJECT h);
+OBJECT hash_values(STATE, OBJECT h);
+
 
 #define hash_find(state, hash, key) (hash_get(state, hash, object_hash_int(state, key)))
 
 #define hash_find_undef(state, hash, key) (hash_get_undef(state, hash, object_hash_int(state, key)))
 
+/*
+ * A Hash keeps its entries in insertion order in the values Tuple, as
+ * consecutive (hash, key, value) triples. A removed entry has nil in its
+ * hash field. The index ByteArray has one slot per bin, holding the entry
+ * number + 1 of an entry whose hash maps to that bin (or a later one, for
+ * colliding entries), or 0 when the bin is free. Slots are 1, 2 or 4
+ * bytes wide depending on the number of bins. used counts the entries
+ * written so far, including removed ones.
+ */
+#define HASH_ENTRY_FIELDS 3
+#define hash_entry_hash(st, h, ent) tuple_at(st, hash_get_values(h), (ent) * HASH_ENTRY_FIELDS)
+#define hash_entry_key(st, h, ent) tuple_at(st, hash_get_values(h), (ent) * HASH_ENTRY_FIELDS + 1)
+#define hash_entry_value(st, h, ent) tuple_at(st, hash_get_values(h), (ent) * HASH_ENTRY_FIELDS + 2)
+
+/* hash_find_eql results besides an entry number */
+#define HASH_MISSING   -1
+#define HASH_UNDECIDED -2
+
 #define MAX_DENSITY 0.75
 
-/* TODO: fix to determine whether to redistribute both up and down */
-#define hash_redistribute_p(hash) (N2I(hash_get_entries(hash)) >= MAX_DENSITY * N2I(hash_get_bins(hash)))
+#define hash_capacity(bins) ((int)((bins) * MAX_DENSITY))
+#define hash_redistribute_p(hash) (N2I(hash_get_used(hash)) >= hash_capacity(N2I(hash_get_bins(hash))))
 
 #define CSM_SIZE 12
 
@@ -35,4 +62,3 @@ OBJECT csm_find(STATE, OBJECT csm, OBJECT key);
 OBJECT csm_add(STATE, OBJECT csm, OBJECT key, OBJECT val);
 OBJECT csm_into_hash(STATE, OBJECT csm);
 OBJECT csm_into_lookuptable(STATE, OBJECT csm);
-
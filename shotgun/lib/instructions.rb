@@ -568,11 +568,14 @@ CODE
   #   * ...
   # [Description]
   #   Pushes the instance variable identified by +lit+ onto the stack.
+  #   Where self keeps its ivars by shape, the method's inline cache for
+  #   +lit+ remembers where in self the value lives.
 
   def push_ivar
     <<-CODE
     next_literal;
-    stack_push(object_get_ivar(state, c->self, _lit));
+    stack_push(shape_cached_get_ivar(state, c->self,
+          cpu_current_method(state, c), _int, _lit));
     CODE
   end
 
@@ -1422,13 +1425,16 @@ CODE
   # [Description]
   #   Pops a value off the stack, and uses it to set the value of the instance
   #   variable identifies by the literal +ivar+ on the current +self+ object.
-  #   The value popped off the stack is then pushed back on again.
+  #   The value popped off the stack is then pushed back on again. Like
+  #   push_ivar, it caches where the value goes, along with the shape
+  #   self moves to when +ivar+ is new to it.
 
   def set_ivar
     <<-CODE
     next_literal;
     t2 = stack_pop();
-    object_set_ivar(state, c->self, _lit, t2);
+    shape_cached_set_ivar(state, c->self,
+          cpu_current_method(state, c), _int, _lit, t2);
     stack_push(t2);
     CODE
   end
@@ -1455,7 +1461,7 @@ CODE
   def push_const
     <<-CODE
     next_literal;
-    t1 = cpu_const_get_in_context(state, c, _lit);
+    t1 = cpu_const_get_cached(state, c, cpu_current_method(state, c), _int, _lit);
     if(AUTOLOAD_P(t1)) {
       cpu_send(state, c, t1, state->global->sym_call, 0, Qnil);
     } else if(t1 != Qundef) {
@@ -1489,7 +1495,7 @@ CODE
     <<-CODE
     t1 = stack_pop();
     next_literal;
-    t2 = cpu_const_get_from(state, c, _lit, t1);
+    t2 = cpu_const_get_from_cached(state, c, cpu_current_method(state, c), _int, _lit, t1);
     if(AUTOLOAD_P(t2)) {
       cpu_send(state, c, t2, state->global->sym_call, 0, Qnil);
     } else if(t2 != Qundef) {
@@ -2531,6 +2537,176 @@ CODE
     CODE
   end
 
+  # [Operation]
+  #   Implementation of * optimised for fixnums
+  # [Format]
+  #   \meta_send_op_mul
+  # [Stack Before]
+  #   * value1
+  #   * value2
+  #   * ...
+  # [Stack After]
+  #   * value1 * value2
+  #   * ...
+  # [Description]
+  #   Pops +value1+ and +value2+ off the stack, and pushes the logical result
+  #   of (+value1+ * +value2+). If +value1+ and +value2+ are both fixnums, the
+  #   multiplication is done directly via fixnum_mul, giving a bignum if it
+  #   overflows; otherwise, the * method is called on +value1+, passing
+  #   +value2+ as the argument.
+
+  def meta_send_op_mul
+    <<-CODE
+    t1 = stack_pop();
+    t2 = stack_back(0);
+    if(FIXNUM_P(t1) && FIXNUM_P(t2)) {
+      stack_set_top(fixnum_mul(state, t1, t2));
+    } else {
+      _lit = global->sym_times;
+      t2 = Qnil;
+      j = 1;
+      goto perform_no_ss_send;
+    }
+    CODE
+  end
+
+  # [Operation]
+  #   Implementation of / optimised for fixnums
+  # [Format]
+  #   \meta_send_op_div
+  # [Stack Before]
+  #   * value1
+  #   * value2
+  #   * ...
+  # [Stack After]
+  #   * value1 / value2
+  #   * ...
+  # [Description]
+  #   Pops +value1+ and +value2+ off the stack, and pushes the logical result
+  #   of (+value1+ / +value2+). If +value1+ and +value2+ are both fixnums and
+  #   +value2+ is not zero, the division is done directly via fixnum_div;
+  #   otherwise, the / method is called on +value1+, passing +value2+ as the
+  #   argument.
+
+  def meta_send_op_div
+    <<-CODE
+    t1 = stack_pop();
+    t2 = stack_back(0);
+    if(FIXNUM_P(t1) && FIXNUM_P(t2) && t2 != I2N(0)) {
+      native_int mod;
+      stack_set_top(I2N(fixnum_div(state, t1, t2, &mod)));
+    } else {
+      _lit = global->sym_divide;
+      t2 = Qnil;
+      j = 1;
+      goto perform_no_ss_send;
+    }
+    CODE
+  end
+
+  # [Operation]
+  #   Implementation of % optimised for fixnums
+  # [Format]
+  #   \meta_send_op_mod
+  # [Stack Before]
+  #   * value1
+  #   * value2
+  #   * ...
+  # [Stack After]
+  #   * value1 % value2
+  #   * ...
+  # [Description]
+  #   Pops +value1+ and +value2+ off the stack, and pushes the logical result
+  #   of (+value1+ % +value2+). If +value1+ and +value2+ are both fixnums and
+  #   +value2+ is not zero, the modulo is done directly via fixnum_div;
+  #   otherwise, the % method is called on +value1+, passing +value2+ as the
+  #   argument.
+
+  def meta_send_op_mod
+    <<-CODE
+    t1 = stack_pop();
+    t2 = stack_back(0);
+    if(FIXNUM_P(t1) && FIXNUM_P(t2) && t2 != I2N(0)) {
+      native_int mod;
+      fixnum_div(state, t1, t2, &mod);
+      stack_set_top(I2N(mod));
+    } else {
+      _lit = global->sym_modulo;
+      t2 = Qnil;
+      j = 1;
+      goto perform_no_ss_send;
+    }
+    CODE
+  end
+
+  # [Operation]
+  #   Implementation of <= optimised for fixnums
+  # [Format]
+  #   \meta_send_op_le
+  # [Stack Before]
+  #   * value1
+  #   * value2
+  #   * ...
+  # [Stack After]
+  #   * true | false
+  #   * ...
+  # [Description]
+  #   Pops +value1+ and +value2+ off the stack, and pushes the logical result
+  #   of (+value1+ <= +value2+). If +value1+ and +value2+ are both fixnums, the
+  #   comparison is done directly; otherwise, the <= method is called on
+  #   +value1+, passing +value2+ as the argument.
+
+  def meta_send_op_le
+    <<-CODE
+    t1 = stack_pop();
+    t2 = stack_back(0);
+    if(FIXNUM_P(t1) && FIXNUM_P(t2)) {
+      j = N2I(t1);
+      k = N2I(t2);
+      stack_set_top((j <= k) ? Qtrue : Qfalse);
+    } else {
+      _lit = global->sym_le;
+      t2 = Qnil;
+      j = 1;
+      goto perform_no_ss_send;
+    }
+    CODE
+  end
+
+  # [Operation]
+  #   Implementation of >= optimised for fixnums
+  # [Format]
+  #   \meta_send_op_ge
+  # [Stack Before]
+  #   * value1
+  #   * value2
+  #   * ...
+  # [Stack After]
+  #   * true | false
+  #   * ...
+  # [Description]
+  #   Pops +value1+ and +value2+ off the stack, and pushes the logical result
+  #   of (+value1+ >= +value2+). If +value1+ and +value2+ are both fixnums, the
+  #   comparison is done directly; otherwise, the >= method is called on
+  #   +value1+, passing +value2+ as the argument.
+
+  def meta_send_op_ge
+    <<-CODE
+    t1 = stack_pop();
+    t2 = stack_back(0);
+    if(FIXNUM_P(t1) && FIXNUM_P(t2)) {
+      j = N2I(t1);
+      k = N2I(t2);
+      stack_set_top((j >= k) ? Qtrue : Qfalse);
+    } else {
+      _lit = global->sym_ge;
+      t2 = Qnil;
+      j = 1;
+      goto perform_no_ss_send;
+    }
+    CODE
+  end
+
   def meta_send_call
     <<-CODE
     next_int;
@@ -5,14 +5,37 @@
 #include "shotgun/lib/symbol.h"
 #include "shotgun/lib/lookuptable.h"
 
+/*
+ * LookupTable is an open addressing table using Robin Hood hashing. Keys
+ * and values are stored inline in a single Tuple, key i in field 2*i and
+ * its value in field 2*i+1, so a lookup touches one object and no chains
+ * of entry Tuples. An empty slot has Qundef as its key. An entry's probe
+ * distance is how far its slot is from its home bin. Insertion lets an
+ * entry take the slot of one that is closer to home, which keeps probe
+ * sequences short and lets a failed lookup stop early. Deletion shifts
+ * the following entries back instead of leaving tombstones.
+ */
+
 /* MINSIZE MUST be a power of 2 */
-#define LOOKUPTABLE_MIN_SIZE 16
+#define LOOKUPTABLE_MIN_SIZE 8
 #define LOOKUPTABLE_MAX_DENSITY 0.75
 #define LOOKUPTABLE_MIN_DENSITY 0.3
+#define LOOKUPTABLE_EMPTY Qundef
 
-/* TODO: find out if this double cast is necessary. */
-#define key_hash(obj) (((unsigned int)(uintptr_t)obj) >> 2)
+/* Symbols hash to their symbol table index, which keeps the bins they
+   use dense. Stripping only the 2 bit tag would leave bit 0 always clear
+   and use only every other bin. */
+#define key_hash(obj) (SYMBOL_P(obj) ? (unsigned int)DATA_STRIP_TAG(obj) : \
+                       (unsigned int)((uintptr_t)(obj) >> TAG_SHIFT))
 #define find_bin(hash, bins) (hash & ((bins) - 1))
+#define next_bin(bin, bins) (((bin) + 1) & ((bins) - 1))
+#define probe_distance(key, bin, bins) (((bin) - find_bin(key_hash(key), bins)) & ((bins) - 1))
+#define key_at(values, bin) tuple_at(state, values, (bin) << 1)
+#define value_at(values, bin) tuple_at(state, values, ((bin) << 1) + 1)
+#define set_slot(values, bin, key, val) do { \
+  tuple_put(state, values, (bin) << 1, key); \
+  tuple_put(state, values, ((bin) << 1) + 1, val); \
+} while(0)
 #define get_bins(tbl) lookuptable_get_bins(tbl)
 #define get_values(tbl) lookuptable_get_values(tbl)
 #define get_entries(tbl) lookuptable_get_entries(tbl)
@@ -23,6 +46,17 @@
     key = symtbl_lookup(state, state->global->symbols, key); \
   } \
 
+static OBJECT new_values(STATE, unsigned int bins) {
+  unsigned int i;
+  OBJECT values;
+
+  values = tuple_new(state, bins << 1);
+  for(i = 0; i < bins; i++) {
+    tuple_put(state, values, i << 1, LOOKUPTABLE_EMPTY);
+  }
+  return values;
+}
+
 OBJECT lookuptable_new_sized(STATE, size_t size) {
   OBJECT tbl;
   tbl = lookuptable_allocate(state);
@@ -34,142 +68,130 @@ OBJECT lookuptable_setup(STATE, OBJECT tbl, size_t size) {
   size_t sz;
 
   sz = size == 0 ? LOOKUPTABLE_MIN_SIZE : size;
-  lookuptable_set_values(tbl, tuple_new(state, sz));
+  lookuptable_set_values(tbl, new_values(state, sz));
   lookuptable_set_bins(tbl, I2N(sz));
   lookuptable_set_entries(tbl, I2N(0));
   return tbl;
 }
 
 OBJECT lookuptable_dup(STATE, OBJECT tbl) {
-  unsigned int i, bins, num;
-  OBJECT new_tbl, entries, entry, key, value;
+  OBJECT new_tbl;
 
-  bins = N2I(get_bins(tbl));
-  num = N2I(get_entries(tbl));
-  
-  new_tbl = lookuptable_new_sized(state, bins);
+  new_tbl = lookuptable_allocate(state);
   SET_CLASS(new_tbl, object_class(state, tbl));
 
-  entries = lookuptable_entries(state, tbl);
-  for(i = 0; i < num; i++) {
-    entry = array_get(state, entries, i);
-    key = tuple_at(state, entry, 0);
-    value = tuple_at(state, entry, 1);
-    lookuptable_store(state, new_tbl, key, value);
-  }
+  /* entries sit in the same slots in a table with as many bins */
+  lookuptable_set_values(new_tbl, tuple_dup(state, get_values(tbl)));
+  lookuptable_set_bins(new_tbl, get_bins(tbl));
+  lookuptable_set_entries(new_tbl, get_entries(tbl));
   return new_tbl;
 }
 
-static OBJECT new_entry(STATE, OBJECT key, OBJECT val) {
-  OBJECT tup = tuple_new(state, 3);
-  tuple_put(state, tup, 0, key);
-  tuple_put(state, tup, 1, val);
-  tuple_put(state, tup, 2, Qnil);
-  return tup;
-}
+/* Places key, which must not be in the table yet, in values. */
+static void insert(STATE, OBJECT values, unsigned int bins, OBJECT key, OBJECT val) {
+  unsigned int bin, dist, cur_dist;
+  OBJECT cur_key, cur_val;
+
+  bin = find_bin(key_hash(key), bins);
+  dist = 0;
+
+  for(;;) {
+    cur_key = key_at(values, bin);
+
+    if(cur_key == LOOKUPTABLE_EMPTY) {
+      set_slot(values, bin, key, val);
+      return;
+    }
 
-static void append_entry(STATE, OBJECT top, OBJECT entry) {
-  OBJECT cur, next;
+    /* take the slot from an entry that is closer to its home bin and
+       carry on placing that one instead */
+    cur_dist = probe_distance(cur_key, bin, bins);
+    if(cur_dist < dist) {
+      cur_val = value_at(values, bin);
+      set_slot(values, bin, key, val);
+      key = cur_key;
+      val = cur_val;
+      dist = cur_dist;
+    }
 
-  cur = top;
-  next = tuple_at(state, cur, 2);
-  while(!NIL_P(next)) {
-    cur = next;
-    next = tuple_at(state, cur, 2);
+    bin = next_bin(bin, bins);
+    dist++;
   }
-  tuple_put(state, cur, 2, entry);
 }
 
 static void redistribute(STATE, OBJECT tbl, unsigned int size) {
-  unsigned int i, bin, bins;
-  OBJECT values, new_values, entry, next, slot;
+  unsigned int i, bins;
+  OBJECT values, new_vals, key;
 
   bins = N2I(get_bins(tbl));
   values = get_values(tbl);
-  new_values = tuple_new(state, size);
+  new_vals = new_values(state, size);
 
   for(i = 0; i < bins; i++) {
-    entry = tuple_at(state, values, i);
-
-    while(!NIL_P(entry)) {
-      next = tuple_at(state, entry, 2);
-      tuple_put(state, entry, 2, Qnil);
-
-      bin = find_bin(key_hash(tuple_at(state, entry, 0)), size);
-      slot = tuple_at(state, new_values, bin);
-
-      if(NIL_P(slot)) {
-        tuple_put(state, new_values, bin, entry);
-      } else {
-        append_entry(state, slot, entry);
-      }
-
-      entry = next;
+    key = key_at(values, i);
+    if(key != LOOKUPTABLE_EMPTY) {
+      insert(state, new_vals, size, key, value_at(values, i));
     }
   }
 
-  lookuptable_set_values(tbl, new_values);
+  lookuptable_set_values(tbl, new_vals);
   lookuptable_set_bins(tbl, I2N(size));
 }
 
-OBJECT lookuptable_store(STATE, OBJECT tbl, OBJECT key, OBJECT val) {
-  unsigned int entries, bins, bin;
-  OBJECT cur, entry, new_ent, values;
+/* Returns the bin holding key, or -1. key must already be a Symbol if it
+   was given as a String. */
+static inline int find_slot(STATE, OBJECT tbl, OBJECT key) {
+  unsigned int bin, bins, dist;
+  OBJECT values, cur;
 
-  key_to_sym(key);
-  entries = N2I(get_entries(tbl));
   bins = N2I(get_bins(tbl));
-
-  if(max_density_p(entries, bins)) {
-    redistribute(state, tbl, bins <<= 1);
-  }
-
-  bin = find_bin(key_hash(key), bins);
   values = get_values(tbl);
-  cur = entry = tuple_at(state, values, bin);
+  bin = find_bin(key_hash(key), bins);
 
-  while(!NIL_P(entry)) {
-    if(tuple_at(state, entry, 0) == key) {
-      tuple_put(state, entry, 1, val);
-      return val;
-    }
-    cur = entry;
-    entry = tuple_at(state, entry, 2);
-  }
+  for(dist = 0; dist < bins; dist++) {
+    cur = key_at(values, bin);
+    if(cur == key) return bin;
 
-  new_ent = new_entry(state, key, val);
-  if(NIL_P(cur)) {
-    tuple_put(state, values, bin, new_ent);
-  } else {
-    tuple_put(state, cur, 2, new_ent);
+    /* key would have displaced this entry if it were in the table */
+    if(cur == LOOKUPTABLE_EMPTY || probe_distance(cur, bin, bins) < dist) {
+      break;
+    }
+    bin = next_bin(bin, bins);
   }
-  lookuptable_set_entries(tbl, I2N(N2I(get_entries(tbl)) + 1));
-  return val;
+  return -1;
 }
 
-static inline OBJECT find_entry(STATE, OBJECT tbl, OBJECT key) {
-  unsigned int bin;
-  OBJECT entry;
+OBJECT lookuptable_store(STATE, OBJECT tbl, OBJECT key, OBJECT val) {
+  unsigned int entries, bins;
+  int bin;
 
   key_to_sym(key);
-  bin = find_bin(key_hash(key), N2I(get_bins(tbl)));
-  entry = tuple_at(state, get_values(tbl), bin);
 
-  while(!NIL_P(entry)) {
-    if(tuple_at(state, entry, 0) == key) {
-      return entry;
-    }
-    entry = tuple_at(state, entry, 2);
+  bin = find_slot(state, tbl, key);
+  if(bin >= 0) {
+    tuple_put(state, get_values(tbl), (bin << 1) + 1, val);
+    return val;
   }
-  return Qnil;
+
+  entries = N2I(get_entries(tbl));
+  bins = N2I(get_bins(tbl));
+
+  if(max_density_p(entries + 1, bins)) {
+    redistribute(state, tbl, bins <<= 1);
+  }
+
+  insert(state, get_values(tbl), bins, key, val);
+  lookuptable_set_entries(tbl, I2N(entries + 1));
+  return val;
 }
 
 OBJECT lookuptable_fetch(STATE, OBJECT tbl, OBJECT key) {
-  OBJECT entry;
+  int bin;
 
-  entry = find_entry(state, tbl, key);
-  if(!NIL_P(entry)) {
-    return tuple_at(state, entry, 1);
+  key_to_sym(key);
+  bin = find_slot(state, tbl, key);
+  if(bin >= 0) {
+    return value_at(get_values(tbl), bin);
   }
   return Qnil;
 }
@@ -180,98 +202,93 @@ OBJECT lookuptable_fetch(STATE, OBJECT tbl, OBJECT key) {
  * in cpu.c in e.g. cpu_const_get_in_context.
  */
 OBJECT lookuptable_find(STATE, OBJECT tbl, OBJECT key) {
-  OBJECT entry;
+  int bin;
 
-  entry = find_entry(state, tbl, key);
-  if(!NIL_P(entry)) {
-    return tuple_at(state, entry, 1);
+  key_to_sym(key);
+  bin = find_slot(state, tbl, key);
+  if(bin >= 0) {
+    return value_at(get_values(tbl), bin);
   }
   return Qundef;
 }
 
 OBJECT lookuptable_delete(STATE, OBJECT tbl, OBJECT key) {
-  unsigned int entries, bins, bin;
-  OBJECT cur, next, entry, val, values;
+  unsigned int entries, bins, next;
+  int bin;
+  OBJECT values, val, cur;
 
   key_to_sym(key);
-  entries = N2I(get_entries(tbl));
-  bins = N2I(get_bins(tbl));
+  bin = find_slot(state, tbl, key);
+  if(bin < 0) return Qnil;
 
-  if(min_density_p(entries, bins) && (bins >> 1) >= LOOKUPTABLE_MIN_SIZE) {
-    redistribute(state, tbl, bins >>= 1);
+  bins = N2I(get_bins(tbl));
+  values = get_values(tbl);
+  val = value_at(values, bin);
+
+  /* shift the rest of the probe sequence back a slot */
+  next = next_bin(bin, bins);
+  cur = key_at(values, next);
+  while(cur != LOOKUPTABLE_EMPTY && probe_distance(cur, next, bins) > 0) {
+    set_slot(values, bin, cur, value_at(values, next));
+    bin = next;
+    next = next_bin(next, bins);
+    cur = key_at(values, next);
   }
+  set_slot(values, bin, LOOKUPTABLE_EMPTY, Qnil);
 
-  bin = find_bin(key_hash(key), bins);
-  values = get_values(tbl);
-  cur = entry = tuple_at(state, values, bin);
-
-  while(!NIL_P(entry)) {
-    next = tuple_at(state, entry, 2);
-
-    if(tuple_at(state, entry, 0) == key) {
-      val = tuple_at(state, entry, 1);
-      if(entry == cur) {
-        tuple_put(state, values, bin, next);
-      } else {
-        tuple_put(state, cur, 2, next);
-      }
-      lookuptable_set_entries(tbl, I2N(N2I(get_entries(tbl)) - 1));
-      return val;
-    }
+  entries = N2I(get_entries(tbl)) - 1;
+  lookuptable_set_entries(tbl, I2N(entries));
 
-    cur = entry;
-    entry = next;
+  if(min_density_p(entries, bins) && (bins >> 1) >= LOOKUPTABLE_MIN_SIZE) {
+    redistribute(state, tbl, bins >> 1);
   }
-  return Qnil;
+  return val;
 }
 
 OBJECT lookuptable_has_key(STATE, OBJECT tbl, OBJECT key) {
-  OBJECT entry;
-
-  entry = find_entry(state, tbl, key);
-  if(!NIL_P(entry)) {
+  key_to_sym(key);
+  if(find_slot(state, tbl, key) >= 0) {
     return Qtrue;
   }
   return Qfalse;
 }
 
-static OBJECT collect(STATE, OBJECT tbl, OBJECT (*action)(STATE, OBJECT)) {
+static OBJECT collect(STATE, OBJECT tbl, OBJECT (*action)(STATE, OBJECT, OBJECT)) {
   unsigned int i, j, bins;
-  OBJECT ary, values, entry;
+  OBJECT ary, values, key;
 
   ary = array_new(state, N2I(get_entries(tbl)));
   bins = N2I(get_bins(tbl));
   values = get_values(tbl);
 
   for(i = j = 0; i < bins; i++) {
-    entry = tuple_at(state, values, i);
+    key = key_at(values, i);
 
-    while(!NIL_P(entry)) {
-      array_set(state, ary, j++, action(state, entry));
-      entry = tuple_at(state, entry, 2);
+    if(key != LOOKUPTABLE_EMPTY) {
+      array_set(state, ary, j++, action(state, key, value_at(values, i)));
     }
   }
   return ary;
 }
 
-static OBJECT get_key(STATE, OBJECT entry) {
-  return tuple_at(state, entry, 0);
+static OBJECT get_key(STATE, OBJECT key, OBJECT value) {
+  return key;
 }
 
 OBJECT lookuptable_keys(STATE, OBJECT tbl) {
   return collect(state, tbl, get_key);
 }
 
-static OBJECT get_value(STATE, OBJECT entry) {
-  return tuple_at(state, entry, 1);
+static OBJECT get_value(STATE, OBJECT key, OBJECT value) {
+  return value;
 }
 
 OBJECT lookuptable_values(STATE, OBJECT tbl) {
   return collect(state, tbl, get_value);
 }
 
-static OBJECT get_entry(STATE, OBJECT entry) {
-  return entry;
+static OBJECT get_entry(STATE, OBJECT key, OBJECT value) {
+  return tuple_new2(state, 2, key, value);
 }
 
 OBJECT lookuptable_entries(STATE, OBJECT tbl) {
@@ -146,6 +146,16 @@ void _machine_error_reporter(int sig, siginfo_t *info, void *ctx) {
      If so, we raise an exception about the error. */
   /* Grab Subtend context first */
   rni_ctx = subtend_retrieve_context();
+  if(rni_ctx->nmc && rni_ctx->nmc->direct) {
+    sigset_t blocked;
+    /* siglongjmp out of the handler leaves the signal blocked. */
+    sigemptyset(&blocked);
+    sigaddset(&blocked, sig);
+    sigprocmask(SIG_UNBLOCK, &blocked, NULL);
+    rni_ctx->fault_address = info->si_addr;
+    siglongjmp(rni_ctx->nmc->direct_env, SEGFAULT_DETECTED);
+  }
+
   if(rni_ctx->nmc && rni_ctx->nmc->system_set) {
     /* TODO: generate the C backtrace as a string array and pass it
        via the nmc or global_context so that the exception can include
@@ -381,6 +391,7 @@ void machine_set_const_under(machine m, const char *str, OBJECT val, OBJECT unde
   OBJECT tbl;
   tbl = module_get_constants(under);
   lookuptable_store(m->s, tbl, string_new(m->s, str), val);
+  cpu_constants_changed(m->s);
 }
 
 /* Sets constant under Object class */
@@ -584,6 +595,73 @@ void machine_migrate_config(machine m) {
   machine_setup_from_config(m);
 }
 
+/* returns the integer value of config variable name, or def if unset */
+static int machine_config_int(machine m, bstring s, const char *name, int def) {
+  bstring v;
+
+  bassigncstr (s, name);
+  v = ht_config_search(m->s->config, s);
+  if(!v || !is_number(bdata(v))) return def;
+
+  return atoi(bdatae(v, "0"));
+}
+
+/* applies young generation ergonomics options to the object memory */
+static void machine_setup_gc_from_config(machine m, bstring s) {
+  object_memory om = m->s->om;
+  int size;
+
+  om->adaptive = machine_config_int(m, s, "rbx.gc.adaptive", 0);
+  om->pause_target = machine_config_int(m, s, "rbx.gc.pause_target", 0);
+  om->survival_high = machine_config_int(m, s, "rbx.gc.survival_high", OMSurvivalHigh);
+  om->survival_low = machine_config_int(m, s, "rbx.gc.survival_low", OMSurvivalLow);
+
+  /* keep the heap sizes word aligned */
+  om->young_min = machine_config_int(m, s, "rbx.gc.young_min", OMMinimumYoungSize) & ~7;
+  om->young_max = machine_config_int(m, s, "rbx.gc.young_max", OMMaximumYoungSize) & ~7;
+
+  om->pretenuring = machine_config_int(m, s, "rbx.gc.pretenure", 1);
+
+  /* Giving a pause target only makes sense with the ergonomics on. */
+  if(om->pause_target) om->adaptive = 1;
+
+  size = machine_config_int(m, s, "rbx.gc.young_size", 0) & ~7;
+  if(size > 0) {
+    om->new_size = size;
+    om->enlarge_now = 1;
+  }
+}
+
+/* turns on the probes named by rbx.probes, which are written to
+   rbx.probes.output when the process exits */
+static void machine_setup_probes_from_config(machine m, bstring s) {
+  struct probe_buffer *pb = m->s->probes;
+  bstring v;
+  int mask;
+
+  bassigncstr (s, "rbx.probes");
+  v = ht_config_search(m->s->config, s);
+  if(!v) return;
+
+  if(!strcmp(bdatae(v, ""), "1")) {
+    mask = PROBE_ALL;
+  } else {
+    mask = probe_parse_mask(bdatae(v, ""));
+    if(mask < 0) {
+      printf("Unknown probes in rbx.probes: %s\n", bdatae(v, ""));
+      return;
+    }
+  }
+
+  probe_set_size(pb, machine_config_int(m, s, "rbx.probes.size", pb->size));
+
+  bassigncstr (s, "rbx.probes.output");
+  v = ht_config_search(m->s->config, s);
+  pb->output = strdup(v ? bdatae(v, "") : "rbx-probes.out");
+
+  probe_enable(m->s, m->c, mask);
+}
+
 /* applies debug configuraiton options to VM state */
 void machine_setup_from_config(machine m) {
   bstring s;
@@ -600,6 +678,15 @@ void machine_setup_from_config(machine m) {
     m->s->gc_stats = 1;
   }
 
+  bassigncstr (s, "rbx.profile.methods");
+
+  if(ht_config_search(m->s->config, s)) {
+    cpu_profile_enable(m->s, 1);
+  }
+
+  machine_setup_gc_from_config(m, s);
+  machine_setup_probes_from_config(m, s);
+
   bdestroy (s);
 }
 
@@ -450,6 +450,7 @@ void mark_sweep_clear_mark(STATE, OBJECT iobj) {
 void mark_sweep_mark_phase(STATE, mark_sweep_gc ms, ptr_array roots) {
   int i, sz;
   OBJECT root, tmp;
+  rni_handle *h;
     
   if(!NIL_P(ms->become_to)) {
     mark_sweep_mark_object(state, ms, ms->become_to);
@@ -498,10 +499,11 @@ void mark_sweep_mark_phase(STATE, mark_sweep_gc ms, ptr_array roots) {
   
   /* Now the handle table. */
   for(i = 0; i < state->handle_tbl->total; i++) {
-    if(state->handle_tbl->entries[i]) {
-      tmp = state->handle_tbl->entries[i]->object;
+    h = handle_table_at(state->handle_tbl, i);
+    if(h->object) {
+      tmp = h->object;
       if(BCM_P(tmp)) {
-        state->handle_tbl->entries[i]->object = BCM_TO;
+        h->object = BCM_TO;
       } else {
         mark_sweep_mark_object(state, ms, tmp);
       }
@@ -512,6 +514,8 @@ void mark_sweep_mark_phase(STATE, mark_sweep_gc ms, ptr_array roots) {
       (cpu_event_each_channel_cb) mark_sweep_mark_object, ms);
   cpu_sampler_collect(state,
       (cpu_sampler_collect_cb) mark_sweep_mark_object, ms);
+  cpu_profile_collect(state,
+      (cpu_sampler_collect_cb) mark_sweep_mark_object, ms);
                       
   object_memory_mark_contexts(state, state->om);
 }
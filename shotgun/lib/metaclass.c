@@ -3,7 +3,11 @@
 
 OBJECT metaclass_s_attach(STATE, OBJECT obj) {
   OBJECT meta;
+  int site;
+
+  site = object_memory_enter_site(state->om, OMSiteMetaclass);
   meta = metaclass_allocate(state);
+  object_memory_leave_site(state->om, site);
   meta->IsMeta = TRUE;
   metaclass_set_attached_instance(meta, obj);
   if(RTEST(state->global->hash) || RTEST(state->global->methtbl)) {
@@ -40,6 +40,7 @@ OBJECT methctx_dup(STATE, OBJECT self) {
   cur->ip = old->ip;
   cur->sp = old->sp;
   cur->fp = old->fp;
+  cur->prof_entry = -1;
  
   ctx->ForeverYoung = TRUE;
   
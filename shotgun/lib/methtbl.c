@@ -3,8 +3,11 @@
 
 OBJECT methtbl_new(STATE) {
   OBJECT obj;
-  
+  int site;
+
+  site = object_memory_enter_site(state->om, OMSiteMethodTable);
   obj = methtbl_allocate(state);
   lookuptable_setup(state, obj, 0);
+  object_memory_leave_site(state->om, site);
   return obj;
 }
@@ -6,8 +6,12 @@
 #include "shotgun/lib/module.h"
 
 void module_setup_fields(STATE, OBJECT module) {
+  int site;
+
   if(NIL_P(module_get_constants(module))) {
+    site = object_memory_enter_site(state->om, OMSiteConstants);
     module_set_constants(module, lookuptable_new(state));
+    object_memory_leave_site(state->om, site);
   }
   if(NIL_P(module_get_method_table(module))) {
     module_set_method_table(module, methtbl_new(state));
@@ -41,6 +45,7 @@ void module_const_set(STATE, OBJECT self, OBJECT sym, OBJECT obj) {
   
   tbl = module_get_constants(self);
   lookuptable_store(state, tbl, sym, obj);
+  cpu_constants_changed(state);
 }
 
 OBJECT module_const_get(STATE, OBJECT self, OBJECT sym) {
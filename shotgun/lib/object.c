@@ -8,6 +8,7 @@
 #include "shotgun/lib/string.h"
 #include "shotgun/lib/tuple.h"
 #include "shotgun/lib/class.h"
+#include "shotgun/lib/shape.h"
 
 OBJECT object_new(STATE) {
   return object_allocate(state);
@@ -196,9 +197,9 @@ OBJECT object_get_ivar(STATE, OBJECT self, OBJECT sym) {
   /* No table, no ivar! */
   if(!RTEST(tbl)) return Qnil;
 
-  /* It's a tuple, use csm */
-  if(ISA(tbl, state->global->tuple)) {
-    return csm_find(state, tbl, sym);
+  /* It's a tuple, the ivars are laid out by shape */
+  if(TUPLE_P(tbl)) {
+    return shape_get_ivar(state, tbl, sym);
   }
   
   /* It's a normal hash, no problem. */
@@ -238,35 +239,30 @@ OBJECT object_set_ivar(STATE, OBJECT self, OBJECT sym, OBJECT val) {
   
   tbl = object_get_instance_variables(self);
   
-  /* Lazy creation of hash to store instance variables. */
-  if(NIL_P(tbl)) {
-    tbl = csm_new(state);
-    object_set_instance_variables(self, tbl);
-    csm_add(state, tbl, sym, val);
+  /* Objects start out with their ivars laid out by shape, and
+     shape_set_ivar moves them into a normal hash if they get
+     too many. */
+  if(NIL_P(tbl) || TUPLE_P(tbl)) {
+    shape_set_ivar(state, self, sym, val);
     return val;
   }
-  
-  if(ISA(tbl, state->global->tuple)) {
-    if(TRUE_P(csm_add(state, tbl, sym, val))) {
-      return val;
-    }
-    /* csm_add said false, meaning there is no room. We convert
-       the csm into a normal hash and use it from now on. */
-    tbl = csm_into_lookuptable(state, tbl);
-    object_set_instance_variables(self, tbl);
-  }
+
   lookuptable_store(state, tbl, sym, val);
   return val;
 }
 
 OBJECT object_get_ivars(STATE, OBJECT self) {
+  OBJECT tbl;
+
   if(!REFERENCE_P(self)) {
     return lookuptable_fetch(state, state->global->external_ivars, self);
   } else if(!object_has_ivars(state, self)) {
     return metaclass_get_has_ivars(object_metaclass(state, self));
   }
   
-  return object_get_instance_variables(self);
+  tbl = object_get_instance_variables(self);
+  if(TUPLE_P(tbl)) return shape_ivars_to_pairs(state, tbl);
+  return tbl;
 }
 
 void object_copy_ivars(STATE, OBJECT self, OBJECT dest) {
@@ -285,10 +281,13 @@ void object_copy_ivars(STATE, OBJECT self, OBJECT dest) {
   
   if(NIL_P(tbl)) return;
   
-  if(ISA(tbl, state->global->tuple)) {
+  if(!ISA(tbl, state->global->tuple)) {
+    tbl = lookuptable_dup(state, tbl);
+  } else if(REFERENCE_P(dest) && object_has_ivars(state, dest)) {
     tbl = tuple_dup(state, tbl);
   } else {
-    tbl = lookuptable_dup(state, tbl);
+    /* ivars laid out by shape only work in an object's own slot */
+    tbl = shape_ivars_into_lookuptable(state, tbl);
   }
   
   if(!REFERENCE_P(dest)) {
@@ -14,6 +14,10 @@ static inline OBJECT _om_inline_new_object(object_memory om, OBJECT cls, unsigne
   unsigned int size;
   gc_zone loc;
   OBJECT obj;
+
+  if(om->cur_site) {
+    return object_memory_new_object_site(om, cls, fields);
+  }
   
   if(fields > LargeObjectThreshold) {
     mark_sweep_gc ms = om->ms;
@@ -72,6 +76,10 @@ static inline OBJECT _om_inline_new_object_init(object_memory om, OBJECT cls, un
   obj = _om_inline_new_object(om, cls, fields);
   fast_memfill((void*)BYTES_OF(obj), (uintptr_t)Qnil, fields);
 
+  if(PROBE_ON(om->probes, PROBE_ALLOC)) {
+    probe_allocation(om->probes, cls, fields);
+  }
+
 #if ENABLE_DTRACE
   if (RUBINIUS_OBJECT_CREATE_DONE_ENABLED() && om->bootstrap_loaded == 1) {
     object_create_done(cls);
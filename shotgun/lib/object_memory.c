@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <sys/time.h>
 
 #include "shotgun/lib/shotgun.h"
 #include "shotgun/lib/machine.h"
@@ -97,6 +98,7 @@ object_memory object_memory_new() {
   om->gc->om = om;
   
   om->ms = mark_sweep_new();
+  om->probes = probe_buffer_new();
   
   om->contexts = heap_new(CONTEXT_SIZE);
   om->context_bottom = (OBJECT)(om->contexts->address);
@@ -104,8 +106,18 @@ object_memory object_memory_new() {
   
   om->last_object_id = 0;
   om->bootstrap_loaded = 0;
-  // om->enlarge_new = 0;
-  // om->new_size = 0;
+  om->enlarge_now = 0;
+  om->new_size = 0;
+
+  om->adaptive = 0;
+  om->pause_target = 0;
+  om->young_min = OMMinimumYoungSize;
+  om->young_max = OMMaximumYoungSize;
+  om->survival_high = OMSurvivalHigh;
+  om->survival_low = OMSurvivalLow;
+
+  om->pretenuring = 1;
+  om->cur_site = OMSiteNone;
   return om;
 }
 
@@ -168,22 +180,152 @@ void object_memory_clear_become(STATE, object_memory om) {
   om->ms->become_to = Qnil;
 }
 
+#define heap_used(h) ((size_t)((uintptr_t)(h)->current - (uintptr_t)(h)->address))
+
 int object_memory_collect(STATE, object_memory om, ptr_array roots) {
-  int i;
+  int i, pause;
+  size_t before = 0;
+  struct timeval start, fin;
+
+  /* A resize is only possible while the "to" space is empty; if objects
+     have spilled into it, try again at the next collection. */
+  if(om->enlarge_now && baker_gc_resize_next(om->gc, om->new_size)) {
+    om->enlarge_now = 0;
+  }
+
+  if(om->adaptive) {
+    before = heap_used(om->gc->current) + heap_used(om->gc->next);
+  }
+
+  om->young_allocated += baker_gc_memory_in_use(om->gc) - om->young_survived;
+  gettimeofday(&start, NULL);
+
   om->gc->tenure_now = om->tenure_now;
   om->last_tenured = 0;
+  om->last_tenured_bytes = 0;
   i = baker_gc_collect(state, om->gc, roots);
   // object_memory_check_memory(om);
   om->gc->tenure_now = om->tenure_now = 0;
   om->collect_now = 0;
-  
+
+  gettimeofday(&fin, NULL);
+  pause = (int)((fin.tv_sec - start.tv_sec) * 1000000 +
+                (fin.tv_usec - start.tv_usec));
+  om->gc_usecs += pause;
+  om->young_survived = baker_gc_memory_in_use(om->gc);
+  om->total_tenured += om->last_tenured;
+
+  if(om->adaptive) {
+    om->last_pause = pause;
+    /* what got promoted survived too; leaving it out would make a low
+       tenure age look like low survival and push it lower still */
+    object_memory_adapt_young(om, before,
+        heap_used(om->gc->current) + om->last_tenured_bytes);
+  }
+
+  if(om->pretenuring) {
+    object_memory_update_sites(state, om);
+  }
+
   return i;
 }
 
+static const char *om_site_names[OMSiteCount] = {
+  "none", "method tables", "constant tables", "metaclasses", "compiled code"
+};
+
+/*
+ * Revisits the pretenuring decision of each allocation site after a young
+ * collection. Objects counted recently haven't had the chance to reach the
+ * tenure age yet, so a site is only judged once its counts have been
+ * collecting for longer than that.
+ */
+void object_memory_update_sites(STATE, object_memory om) {
+  int i, rate;
+  struct om_site_stats *site;
+
+  for(i = OMSiteNone + 1; i < OMSiteCount; i++) {
+    site = &om->sites[i];
+
+    if(site->allocated < OMSiteMinSamples) continue;
+    if(om->gc->num_collection - site->since <= om->gc->tenure_age) continue;
+
+    rate = (int)((site->tenured * 100) / site->allocated);
+
+    if(site->pretenure ? rate < OMSiteRetractRate : rate >= OMSitePretenureRate) {
+      site->pretenure = !site->pretenure;
+      site->allocated = site->tenured = site->skipped = 0;
+      site->since = om->gc->num_collection;
+
+      if(state->gc_stats) {
+        printf("[GC %s pretenuring %s, %d%% tenured]\n",
+               site->pretenure ? "started" : "stopped", om_site_names[i], rate);
+      }
+    } else if(site->allocated > OMSiteMaxSamples) {
+      /* decay, so the site keeps up with phase changes */
+      site->allocated /= 2;
+      site->tenured /= 2;
+    }
+  }
+}
+
+/*
+ * Young generation ergonomics. Looks at how much of the young space
+ * survived the last scavenge and how long it took, and picks the size
+ * of the young spaces and the tenure age for the following ones.
+ *
+ * A high survival rate means objects aren't being given enough time to
+ * die, so the spaces grow and objects stay young longer rather than being
+ * promoted. A low one means whatever survives is probably long lived, so
+ * it gets promoted sooner instead of being copied back and forth. Going
+ * over the pause target shrinks the spaces regardless.
+ */
+void object_memory_adapt_young(object_memory om, size_t before, size_t survived) {
+  baker_gc g = om->gc;
+  int size = (int)g->current->size;
+  int rate;
+
+  if(before == 0) return;
+
+  rate = (int)((survived * 100) / before);
+  om->last_survival = rate;
+
+  if(om->pause_target && om->last_pause > om->pause_target) {
+    if(size / 2 >= om->young_min) {
+      om->new_size = size / 2;
+      om->enlarge_now = 1;
+    }
+  } else if(rate > om->survival_high) {
+    if(size < om->young_max &&
+       (!om->pause_target || om->last_pause * 2 < om->pause_target)) {
+      om->new_size = size * 2 > om->young_max ? om->young_max : size * 2;
+      om->enlarge_now = 1;
+    }
+
+    if(g->tenure_age < BAKER_MAX_TENURE_AGE) g->tenure_age++;
+  } else if(rate < om->survival_low) {
+    if(g->tenure_age > 1) g->tenure_age--;
+  }
+}
+
 void object_memory_major_collect(STATE, object_memory om, ptr_array roots) {
+  struct timeval start, fin;
+
+  gettimeofday(&start, NULL);
   mark_sweep_collect(state, om->ms, roots);
   baker_gc_clear_marked(om->gc);
   object_memory_clear_marks(state, om);
+  gettimeofday(&fin, NULL);
+
+  om->major_collections++;
+  om->gc_usecs += (fin.tv_sec - start.tv_sec) * 1000000 +
+                  (fin.tv_usec - start.tv_usec);
+}
+
+/* Bytes allocated in the young space since startup, counting what has
+   been allocated since the last collection. */
+size_t object_memory_young_allocated(object_memory om) {
+  return om->young_allocated + baker_gc_memory_in_use(om->gc) - om->young_survived;
 }
 
 OBJECT object_memory_tenure_object(void *data, OBJECT obj) {
@@ -192,6 +334,11 @@ OBJECT object_memory_tenure_object(void *data, OBJECT obj) {
   mark_sweep_gc ms = om->ms;
   
   om->last_tenured++;
+  om->last_tenured_bytes += SIZE_IN_BYTES(obj);
+
+  if(obj->alloc_site) {
+    om->sites[obj->alloc_site].tenured++;
+  }
   
   dest = mark_sweep_allocate(ms, NUM_FIELDS(obj));
   
@@ -203,11 +350,41 @@ OBJECT object_memory_tenure_object(void *data, OBJECT obj) {
   
   fast_memcpy((void*)dest, (void*)obj, SIZE_IN_WORDS_FIELDS(NUM_FIELDS(obj)));
   dest->gc_zone = MatureObjectZone;
+  dest->alloc_site = OMSiteNone;
   //printf("Allocated %d fields to %p\n", NUM_FIELDS(obj), obj);
   // printf(" :: %p => %p (%d / %d )\n", obj, dest, NUM_FIELDS(obj), SIZE_IN_BYTES(obj));
   return dest;
 }
 
+/* Tenures a copy of just bytes bytes of the byte storage object obj,
+ * starting at start, followed by a 0. Used to keep a substring from
+ * tenuring all of a large young ByteArray it shares. */
+OBJECT object_memory_tenure_bytes(object_memory om, OBJECT obj, int start, int bytes) {
+  OBJECT dest;
+  unsigned int words;
+  mark_sweep_gc ms = om->ms;
+
+  om->last_tenured++;
+
+  words = (bytes + SIZE_OF_OBJECT) / SIZE_OF_OBJECT;
+  om->last_tenured_bytes += SIZE_IN_BYTES_FIELDS(words);
+  dest = mark_sweep_allocate(ms, words);
+
+  if(ms->enlarged) {
+    om->collect_now |= OMCollectMature;
+  }
+
+  fast_memcpy((void*)dest, (void*)obj, SIZE_IN_WORDS_FIELDS(0));
+  SET_NUM_FIELDS(dest, words);
+  CLEAR_AGE(dest);
+  dest->gc_zone = MatureObjectZone;
+  dest->alloc_site = OMSiteNone;
+
+  memset(BYTES_OF(dest), 0, words * SIZE_OF_OBJECT);
+  memcpy(BYTES_OF(dest), BYTES_OF(obj) + start, bytes);
+  return dest;
+}
+
 void object_memory_print_stats(object_memory om) {
   printf("Memory: %zd used, %zd total.\n", object_memory_used(om), om->gc->current->size);
 }
@@ -431,6 +608,43 @@ OBJECT object_memory_new_object_mature(object_memory om, OBJECT cls, unsigned in
   return obj;
 }
 
+/* Allocation while a site is entered (see object_memory_enter_site). Like
+   _om_inline_new_object, the fields are left uninitialized. */
+OBJECT object_memory_new_object_site(object_memory om, OBJECT cls, unsigned int fields) {
+  int id = om->cur_site;
+  struct om_site_stats *site = &om->sites[id];
+  mark_sweep_gc ms;
+  OBJECT obj;
+
+  if(site->pretenure && (++site->skipped % OMSiteSampleRate) != 0) {
+    ms = om->ms;
+    obj = mark_sweep_allocate(ms, fields);
+    if(ms->enlarged) {
+      om->collect_now |= OMCollectMature;
+    }
+
+    CLEAR_FLAGS(obj);
+    obj->gc_zone = MatureObjectZone;
+    rbs_set_class(om, obj, cls);
+    SET_NUM_FIELDS(obj, fields);
+    if(cls && REFERENCE_P(cls)) {
+      _om_apply_class_flags(obj, cls);
+    }
+    return obj;
+  }
+
+  om->cur_site = OMSiteNone;
+  obj = _om_inline_new_object(om, cls, fields);
+  om->cur_site = id;
+
+  if(obj->gc_zone == YoungObjectZone) {
+    obj->alloc_site = id;
+    site->allocated++;
+  }
+
+  return obj;
+}
+
 OBJECT object_memory_new_object_normal(object_memory om, OBJECT cls, unsigned int fields) {
   int size, i;
   OBJECT obj;
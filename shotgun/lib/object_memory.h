@@ -15,15 +15,53 @@
 #define OMCollectYoung  0x1
 #define OMCollectMature 0x2
 
+/* Bounds and defaults for the adaptive young generation (rbx.gc.adaptive).
+   Survival rates are percentages of the young space live after a scavenge. */
+#define OMMinimumYoungSize  (OMDefaultSize / 4)
+#define OMMaximumYoungSize  (OMDefaultSize * 8)
+#define OMSurvivalHigh      25
+#define OMSurvivalLow       5
+
+/* Allocation sites whose objects are tracked for pretenuring. Objects
+   allocated while a site is entered remember it in their header, and the
+   site learns what fraction of them get tenured. Sites where most
+   of them do allocate straight into the mature space. Must fit in the
+   3 bit alloc_site header field. */
+enum om_alloc_site {
+  OMSiteNone = 0,
+  OMSiteMethodTable,
+  OMSiteConstants,
+  OMSiteMetaclass,
+  OMSiteCompiledCode,
+  OMSiteCount
+};
+
+/* while pretenuring, 1 in this many objects is still allocated young
+   so the site can notice if its objects stop surviving */
+#define OMSiteSampleRate     64
+#define OMSiteMinSamples     256
+#define OMSiteMaxSamples     65536
+#define OMSitePretenureRate  60
+#define OMSiteRetractRate    35
+
+struct om_site_stats {
+  unsigned int allocated;
+  unsigned int tenured;
+  unsigned int skipped;
+  /* collection the counts were last reset at */
+  int since;
+  int pretenure;
+};
+
 /* set of flags */
 struct object_memory_struct {
   /*  */
   int collect_now;
-  /*  */
+  /* resize the young spaces to new_size at the next collection */
   int enlarge_now;
   /*  */
   int tenure_now;
-  /*  */
+  /* size the young spaces should be resized to */
   int new_size;
   /*  */
   int last_object_id;
@@ -41,6 +79,34 @@ struct object_memory_struct {
   OBJECT context_last;
 
   int context_offset;
+
+  /* Young generation ergonomics */
+  int adaptive;
+  /* pause budget for a young collection, in microseconds (0 = none) */
+  int pause_target;
+  int young_min, young_max;
+  int survival_high, survival_low;
+  /* survival rate (%) and pause (usecs) of the last young collection */
+  int last_survival;
+  int last_pause;
+  /* bytes promoted to the mature space by the last young collection */
+  size_t last_tenured_bytes;
+
+  /* Running totals, reported by Rubinius::VM.stats */
+  int major_collections;
+  long gc_usecs;
+  size_t young_allocated;
+  /* bytes left in the young space by the last collection */
+  size_t young_survived;
+  size_t total_tenured;
+
+  /* Pretenuring of allocation sites */
+  int pretenuring;
+  int cur_site;
+  struct om_site_stats sites[OMSiteCount];
+
+  /* The tracing probes, for the allocation probe */
+  struct probe_buffer *probes;
 };
 
 typedef struct object_memory_struct *object_memory;
@@ -49,14 +115,19 @@ object_memory object_memory_new();
 int object_memory_destroy(object_memory om);
 size_t object_memory_used(object_memory om);
 int object_memory_collect(STATE, object_memory om, ptr_array roots);
+void object_memory_adapt_young(object_memory om, size_t before, size_t survived);
 void object_memory_check_memory(object_memory om);
 OBJECT object_memory_new_object_normal(object_memory om, OBJECT cls, unsigned int fields);
 static inline OBJECT _om_inline_new_object(object_memory om, OBJECT cls, unsigned int fields);
 
 OBJECT object_memory_new_object_mature(object_memory om, OBJECT cls, unsigned int fields);
+OBJECT object_memory_new_object_site(object_memory om, OBJECT cls, unsigned int fields);
+void object_memory_update_sites(STATE, object_memory om);
 void object_memory_print_stats(object_memory om);
+size_t object_memory_young_allocated(object_memory om);
 OBJECT object_memory_new_opaque(STATE, OBJECT cls, unsigned int sz);
 OBJECT object_memory_tenure_object(void* data, OBJECT obj);
+OBJECT object_memory_tenure_bytes(object_memory om, OBJECT obj, int start, int bytes);
 void object_memory_major_collect(STATE, object_memory om, ptr_array roots);
 OBJECT object_memory_collect_references(STATE, object_memory om, OBJECT mark);
 void object_memory_setup_become(STATE, object_memory om, OBJECT from, OBJECT to);
@@ -78,6 +149,15 @@ void object_memory_reset_contexts(STATE, object_memory om);
 
 #define object_memory_new_dirty_object _om_inline_new_object
 
+/* Objects allocated between these are attributed to site. Returns the
+   previous site, which must be handed back to object_memory_leave_site. */
+#define object_memory_enter_site(om, site) ({ \
+  int _prev = (om)->cur_site; \
+  if((om)->pretenuring) (om)->cur_site = (site); \
+  _prev; })
+
+#define object_memory_leave_site(om, prev) ((om)->cur_site = (prev))
+
 #define CTX_SIZE SIZE_IN_BYTES_FIELDS(FASTCTX_FIELDS)
 
 #define BYTES_PAST(ctx, num) ((char*)ctx + num)
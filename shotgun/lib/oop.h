@@ -202,6 +202,8 @@ struct rubinius_object_t {
       unsigned int IsFrozen               : 1;
       unsigned int IsLittleEndian         : 1;
       unsigned int RefsAreWeak            : 1;
+      /* enum om_alloc_site the object came from, while it's young */
+      unsigned int    alloc_site  : 3;
     };
     uint32_t all_flags;
   };
@@ -594,7 +594,7 @@ class ShotgunPrimitives
     POP(t1, STRING);
 
     native_int j = io_to_fd(msg->recv);
-    char *buf = rbx_string_as_cstr(state, t1);
+    char *buf = string_byte_address(state, t1);
     native_int k = N2I(string_get_bytes(t1));
 
     k = write(j, buf, k);
@@ -1041,11 +1041,18 @@ class ShotgunPrimitives
     <<-CODE
     ARITY(2);
     OBJECT t1, t2, t3;
+    int ent;
     GUARD(HASH_P(msg->recv));
 
     POP(t1, FIXNUM);
     t2 = stack_pop();
-    t3 = hash_find_entry(state, msg->recv, N2I(t1));
+    ent = hash_find_entry(state, msg->recv, N2I(t1));
+    if(ent == HASH_MISSING) {
+      RET(Qnil);
+    }
+    t3 = tuple_new2(state, 4, hash_entry_hash(state, msg->recv, ent),
+                    hash_entry_key(state, msg->recv, ent),
+                    hash_entry_value(state, msg->recv, ent), Qnil);
     RET(t3);
     CODE
   end
@@ -1088,6 +1095,173 @@ class ShotgunPrimitives
     CODE
   end
 
+  defprim :hash_aref
+  def hash_aref
+    <<-CODE
+    ARITY(1);
+    OBJECT t1;
+    int ent;
+    GUARD(HASH_P(msg->recv));
+
+    /* Only keys whose #hash is computed here; String subclasses may
+       redefine #hash and #eql?, so they are left to Hash#[]. */
+    t1 = stack_pop();
+    GUARD(FIXNUM_P(t1) || SYMBOL_P(t1) ||
+          (STRING_P(t1) && object_class(state, t1) == BASIC_CLASS(string)));
+
+    ent = hash_find_eql(state, msg->recv, hash_key_hash(state, t1), t1);
+    GUARD(ent != HASH_UNDECIDED);
+    if(ent >= 0) RET(hash_entry_value(state, msg->recv, ent));
+
+    /* A miss on a plain Hash without a default proc is just the default.
+       Anything else fails so that Ruby calls #default, which a subclass
+       or singleton may have redefined. */
+    GUARD(msg->recv->klass == BASIC_CLASS(hash) &&
+          hash_get_default_proc(msg->recv) != Qtrue);
+    RET(hash_get_default(msg->recv));
+    CODE
+  end
+
+  defprim :hash_aset
+  def hash_aset
+    <<-CODE
+    ARITY(2);
+    OBJECT t1, t2;
+    unsigned int hsh;
+    int ent;
+    GUARD(HASH_P(msg->recv));
+
+    /* String subclasses are left to Hash#[]=, which dups them properly */
+    t1 = stack_pop();
+    GUARD(FIXNUM_P(t1) || SYMBOL_P(t1) ||
+          (STRING_P(t1) && object_class(state, t1) == BASIC_CLASS(string)));
+    t2 = stack_pop();
+
+    hsh = hash_key_hash(state, t1);
+    ent = hash_find_eql(state, msg->recv, hsh, t1);
+    GUARD(ent != HASH_UNDECIDED);
+
+    if(ent == HASH_MISSING) {
+      /* String keys are copied, so changing the original later doesn't
+         change the key. */
+      if(STRING_P(t1)) t1 = string_dup(state, t1);
+      hash_append(state, msg->recv, hsh, t1, t2);
+    } else {
+      tuple_put(state, hash_get_values(msg->recv), ent * HASH_ENTRY_FIELDS + 2, t2);
+    }
+    RET(t2);
+    CODE
+  end
+
+  defprim :hash_find_entry
+  def hash_find_entry
+    <<-CODE
+    ARITY(2);
+    OBJECT t1, t2;
+    int ent;
+    GUARD(HASH_P(msg->recv));
+
+    t1 = stack_pop();
+    POP(t2, FIXNUM);
+
+    ent = hash_find_eql(state, msg->recv, N2I(t2), t1);
+    GUARD(ent != HASH_UNDECIDED);
+    RET(ent == HASH_MISSING ? Qnil : I2N(ent));
+    CODE
+  end
+
+  defprim :hash_candidates
+  def hash_candidates
+    <<-CODE
+    ARITY(1);
+    OBJECT t1;
+    GUARD(HASH_P(msg->recv));
+
+    POP(t1, FIXNUM);
+    RET(hash_candidates(state, msg->recv, N2I(t1)));
+    CODE
+  end
+
+  defprim :hash_append
+  def hash_append
+    <<-CODE
+    ARITY(3);
+    OBJECT t1, t2, t3;
+    GUARD(HASH_P(msg->recv));
+
+    POP(t1, FIXNUM);
+    t2 = stack_pop();
+    t3 = stack_pop();
+
+    RET(I2N(hash_append(state, msg->recv, N2I(t1), t2, t3)));
+    CODE
+  end
+
+  defprim :hash_delete_entry
+  def hash_delete_entry
+    <<-CODE
+    ARITY(1);
+    OBJECT t1;
+    GUARD(HASH_P(msg->recv));
+
+    POP(t1, FIXNUM);
+    GUARD(N2I(t1) >= 0 && N2I(t1) < N2I(hash_get_used(msg->recv)));
+    GUARD(!NIL_P(hash_entry_hash(state, msg->recv, N2I(t1))));
+
+    RET(hash_delete_entry(state, msg->recv, N2I(t1)));
+    CODE
+  end
+
+  defprim :hash_keys
+  def hash_keys
+    <<-CODE
+    ARITY(0);
+    GUARD(HASH_P(msg->recv));
+
+    RET(hash_keys(state, msg->recv));
+    CODE
+  end
+
+  defprim :hash_values
+  def hash_values
+    <<-CODE
+    ARITY(0);
+    GUARD(HASH_P(msg->recv));
+
+    RET(hash_values(state, msg->recv));
+    CODE
+  end
+
+  defprim :hash_replace
+  def hash_replace
+    <<-CODE
+    ARITY(1);
+    OBJECT t1;
+    GUARD(HASH_P(msg->recv));
+
+    t1 = stack_pop();
+    GUARD(HASH_P(t1));
+
+    hash_replace(state, msg->recv, t1);
+    RET(msg->recv);
+    CODE
+  end
+
+  defprim :hash_clear
+  def hash_clear
+    <<-CODE
+    ARITY(0);
+    OBJECT t1;
+    GUARD(HASH_P(msg->recv));
+
+    /* keep the default */
+    t1 = hash_get_default(msg->recv);
+    hash_setup(state, msg->recv, 0);
+    hash_set_default(msg->recv, t1);
+    RET(msg->recv);
+    CODE
+  end
+
   defprim :hash_value_set
   def hash_value_set
     <<-CODE
@@ -1490,6 +1664,10 @@ class ShotgunPrimitives
       printf("[GC M %6dK total]\\n", state->om->ms->allocated_bytes / 1024);
     }
 
+    if(state->probes->output) {
+      probe_dump(state, state->probes->output);
+    }
+
     if(current_machine->sub) {
       environment_exit_machine();
     } else {
@@ -1743,6 +1921,23 @@ class ShotgunPrimitives
     CODE
   end
 
+  defprim :regexp_search_p
+  def regexp_search_p
+    <<-CODE
+    ARITY(3);
+    OBJECT t1, t2, t3;
+    GUARD(REGEXP_P(msg->recv));
+
+    POP(t1, STRING);
+    POP(t2, FIXNUM);
+    POP(t3, FIXNUM);
+    GUARD(N2I(t2) >= 0 && N2I(t2) <= N2I(t3));
+    GUARD(N2I(t3) <= N2I(string_get_bytes(t1)));
+
+    RET(regexp_search_p(state, msg->recv, t1, t2, t3));
+    CODE
+  end
+
   defprim :regexp_options
   def regexp_options
     <<-CODE
@@ -2021,29 +2216,13 @@ class ShotgunPrimitives
   def fixnum_right_shift
     <<-CODE
     ARITY(1);
-    OBJECT t1, t2;
-    native_int value, width;
+    OBJECT t1;
 
     GUARD(FIXNUM_P(msg->recv));
     POP(t1, FIXNUM);
+    GUARD(N2I(t1) >= 0);
 
-    value = N2I(msg->recv);
-    width = N2I(t1);
-
-    if (width > 0) {
-      if (width >= sizeof(value)*8-1) {
-        if (value < 0) {
-          value = -1;
-        } else {
-          value = 0;
-        }
-      } else {
-        value >>= width;
-      }
-    }
-
-    t2 = I2N(value);
-    RET(t2);
+    RET(fixnum_right_shift(state, msg->recv, N2I(t1)));
     CODE
   end
 
@@ -2051,18 +2230,13 @@ class ShotgunPrimitives
   def fixnum_left_shift
     <<-CODE
     ARITY(1);
-    OBJECT t1, t2;
-    native_int value, width;
+    OBJECT t1;
 
     GUARD(FIXNUM_P(msg->recv));
     POP(t1, FIXNUM);
+    GUARD(N2I(t1) >= 0);
 
-    value = N2I(msg->recv);
-    width = N2I(t1);
-
-    value <<= width;
-    t2 = I2N(value);
-    RET(t2);
+    RET(fixnum_left_shift(state, msg->recv, N2I(t1)));
     CODE
   end
 
@@ -2529,9 +2703,12 @@ class ShotgunPrimitives
   defprim :vm_stats
   def vm_stats
     <<-CODE
+    OBJECT t1;
+    object_memory om = state->om;
+
     ARITY(0);
+    t1 = tuple_new(state, 14);
 #ifdef TRACK_STATS
-    OBJECT t1 = tuple_new(state, 7);
     tuple_put(state, t1, 0, I2N(state->cache_hits));
     tuple_put(state, t1, 1, I2N(state->cache_misses));
     tuple_put(state, t1, 2, I2N(state->cache_used));
@@ -2539,10 +2716,15 @@ class ShotgunPrimitives
     tuple_put(state, t1, 4, I2N(state->cache_inline_hit));
     tuple_put(state, t1, 5, I2N(state->cache_inline_stale));
     tuple_put(state, t1, 6, I2N(state->cache_inline_const_hit));
-    RET(t1);
-#else
-    RET(Qfalse);
 #endif
+    tuple_put(state, t1, 7, I2N(om->gc->num_collection));
+    tuple_put(state, t1, 8, I2N(om->major_collections));
+    tuple_put(state, t1, 9, ML2N(om->gc_usecs));
+    tuple_put(state, t1, 10, ULL2N(object_memory_young_allocated(om)));
+    tuple_put(state, t1, 11, ULL2N(om->total_tenured));
+    tuple_put(state, t1, 12, UI2N(om->ms->allocated_bytes));
+    tuple_put(state, t1, 13, I2N(om->gc->tenure_age));
+    RET(t1);
     CODE
   end
 
@@ -3187,11 +3369,12 @@ class ShotgunPrimitives
   defprim :sampler_activate
   def sampler_activate
     <<-CODE
-    ARITY(1);
-    OBJECT t1;
+    ARITY(2);
+    OBJECT t1, t2;
 
     POP(t1, FIXNUM);
-    cpu_sampler_activate(state, N2I(t1), environment_current_machine());
+    POP(t2, FIXNUM);
+    GUARD(cpu_sampler_activate(state, N2I(t1), N2I(t2), environment_current_machine()));
     RET(ML2N(clock()));
     CODE
   end
@@ -3205,6 +3388,56 @@ class ShotgunPrimitives
     CODE
   end
 
+  defprim :method_profile_enable
+  def method_profile_enable
+    <<-CODE
+    ARITY(1);
+    OBJECT t1 = stack_pop();
+
+    cpu_profile_enable(state, RTEST(t1));
+    RET(t1);
+    CODE
+  end
+
+  defprim :method_profile_snapshot
+  def method_profile_snapshot
+    <<-CODE
+    ARITY(1);
+    OBJECT t1 = stack_pop();
+
+    RET(cpu_profile_snapshot(state, RTEST(t1)));
+    CODE
+  end
+
+  defprim :probe_enable
+  def probe_enable
+    <<-CODE
+    ARITY(1);
+    OBJECT t1;
+
+    POP(t1, FIXNUM);
+    GUARD(N2I(t1) >= 0 && N2I(t1) <= PROBE_ALL);
+
+    probe_enable(state, c, N2I(t1));
+    RET(t1);
+    CODE
+  end
+
+  defprim :probe_dump
+  def probe_dump
+    <<-CODE
+    ARITY(1);
+    OBJECT t1;
+    int count;
+
+    POP(t1, STRING);
+
+    count = probe_dump(state, rbx_string_as_cstr(state, t1));
+    GUARD(count >= 0);
+    RET(I2N(count));
+    CODE
+  end
+
   defprim :fork_process
   def fork_process
     <<-CODE
@@ -3308,6 +3541,24 @@ class ShotgunPrimitives
     CODE
   end
 
+  defprim :string_sha1
+  def string_sha1
+    <<-CODE
+    ARITY(0);
+    unsigned char digest[20];
+    char hex[41];
+    int i;
+
+    GUARD(STRING_P(msg->recv));
+    sha1_hash_string((unsigned char*)string_byte_address(state, msg->recv),
+                     N2I(string_get_bytes(msg->recv)), digest);
+    for(i = 0; i < 20; i++) {
+      sprintf(hex + i * 2, "%02x", digest[i]);
+    }
+    RET(string_new2(state, hex, 40));
+    CODE
+  end
+
   defprim :env_get
   def env_get
     <<-CODE
@@ -3427,6 +3678,15 @@ class ShotgunPrimitives
     CODE
   end
 
+  defprim :reset_constant_cache
+  def reset_constant_cache
+    <<-CODE
+    ARITY(0);
+    cpu_constants_changed(state);
+    RET(Qnil);
+    CODE
+  end
+
   defprim :bignum_from_float
   def bignum_from_float
     <<-CODE
@@ -3552,16 +3812,34 @@ class ShotgunPrimitives
       } else {
         j = N2I(t2);
         k = N2I(t3);
-        t2 = string_get_data(msg->recv);
-        t3 = string_get_data(t1);
-
-        m = memcmp(BYTEARRAY_ADDRESS(t2), BYTEARRAY_ADDRESS(t3), j < k ? j : k);
+        m = memcmp(string_byte_address(state, msg->recv),
+                   string_byte_address(state, t1), j < k ? j : k);
         RET(m == 0 ? Qtrue : Qfalse);
       }
     }
     CODE
   end
 
+  defprim :string_compare
+  def string_compare
+    <<-CODE
+    ARITY(1);
+    GUARD(STRING_P(msg->recv));
+    OBJECT t1;
+    native_int j, k, m;
+
+    POP(t1, STRING);
+
+    j = N2I(string_get_bytes(msg->recv));
+    k = N2I(string_get_bytes(t1));
+    m = memcmp(string_byte_address(state, msg->recv),
+               string_byte_address(state, t1), j < k ? j : k);
+    if(m == 0) m = j - k;
+
+    RET(I2N(m < 0 ? -1 : m > 0 ? 1 : 0));
+    CODE
+  end
+
   defprim :object_send
   def object_send
     <<-CODE
@@ -3744,6 +4022,54 @@ class ShotgunPrimitives
     CODE
   end
 
+  defprim :memptr_get_at
+  def memptr_get_at
+    <<-CODE
+    ARITY(2);
+    OBJECT t1, t2;
+    native_int j, k;
+    char *ptr;
+
+    GUARD( POINTER_P(msg->recv) );
+    POP(t1, FIXNUM);
+    POP(t2, FIXNUM);
+
+    j = N2I(t1);
+    k = N2I(t2);
+    ptr = *DATA_STRUCT(msg->recv, char**);
+    GUARD( ptr != NULL );
+    GUARD( k >= 0 && k <= RBX_FFI_TYPE_CHARARR );
+    GUARD( k != RBX_FFI_TYPE_VOID && k != RBX_FFI_TYPE_STATE );
+
+    RET(ffi_read_at(state, ptr + j, k));
+    CODE
+  end
+
+  defprim :memptr_put_at
+  def memptr_put_at
+    <<-CODE
+    ARITY(3);
+    OBJECT t1, t2, t3;
+    native_int j, k;
+    char *ptr;
+
+    GUARD( POINTER_P(msg->recv) );
+    POP(t1, FIXNUM);
+    POP(t2, FIXNUM);
+    t3 = stack_pop();
+
+    j = N2I(t1);
+    k = N2I(t2);
+    ptr = *DATA_STRUCT(msg->recv, char**);
+    GUARD( ptr != NULL );
+    GUARD( k >= 0 && k <= RBX_FFI_TYPE_STRING );
+    GUARD( k != RBX_FFI_TYPE_VOID );
+
+    ffi_write_at(state, ptr + j, k, t3);
+    RET(t3);
+    CODE
+  end
+
   defprim :opt_push_literal
   def opt_push_literal
     <<-CODE
@@ -4426,8 +4752,9 @@ class ShotgunPrimitives
     char *a, *b;
 
     POP(t1, STRING);
-    a = rbx_string_as_cstr(state, msg->recv);
-    b = rbx_string_as_cstr(state, t1);
+    string_unshare(state, msg->recv);
+    a = string_byte_address(state, msg->recv);
+    b = string_byte_address(state, t1);
     j = N2I(string_get_bytes(msg->recv));
     k = N2I(string_get_bytes(t1));
     size = j < k ? j : k;
@@ -4486,14 +4813,39 @@ class ShotgunPrimitives
     if(dest >= n) { RET(msg->recv); }
     if(size > n - dest) { size = n - dest; }
 
-    a = rbx_string_as_cstr(state, msg->recv);
-    b = rbx_string_as_cstr(state, t1);
-    memcpy(a + dest, b + start, size);
+    string_unshare(state, msg->recv);
+    a = string_byte_address(state, msg->recv);
+    b = string_byte_address(state, t1);
+    memmove(a + dest, b + start, size);
 
     RET(msg->recv);
     CODE
   end
 
+  defprim :string_substring
+  def string_substring
+    <<-CODE
+    ARITY(2);
+    GUARD(STRING_P(msg->recv));
+    OBJECT t1, t2;
+    native_int start, count, bytes;
+
+    POP(t1, FIXNUM);
+    POP(t2, FIXNUM);
+
+    start = N2I(t1);
+    count = N2I(t2);
+    bytes = N2I(string_get_bytes(msg->recv));
+
+    GUARD(count >= 0 && start <= bytes && -start <= bytes);
+
+    if(start < 0) { start += bytes; }
+    if(start + count > bytes) { count = bytes - start; }
+
+    RET(string_new_view(state, msg->recv, start, count));
+    CODE
+  end
+
   defprim :string_compare_substring
   def string_compare_substring
     <<-CODE
@@ -4518,8 +4870,8 @@ class ShotgunPrimitives
     bytes = N2I(string_get_bytes(msg->recv));
     if(size > bytes) { size = bytes; }
 
-    a = rbx_string_as_cstr(state, msg->recv);
-    b = rbx_string_as_cstr(state, t1);
+    a = string_byte_address(state, msg->recv);
+    b = string_byte_address(state, t1);
     cmp = memcmp(a, b + start, size);
     if(cmp < 0) {
       RET(I2N(-1));
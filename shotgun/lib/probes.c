@@ -0,0 +1,244 @@
+#include <time.h>
+#include <string.h>
+
+#include "shotgun/lib/shotgun.h"
+#include "shotgun/lib/cpu.h"
+#include "shotgun/lib/symbol.h"
+#include "shotgun/lib/probes.h"
+
+/* Tracing probes that need no DTrace.
+ *
+ * Each machine has a ring of fixed size binary events. A probe reserves
+ * the next slot with an atomic add on the head, so it takes no lock, and
+ * once the ring is full every event overwrites the oldest one. The slot
+ * holds the number of the event written into it, set last and cleared
+ * first, so a reader can tell a slot that was overwritten or is half
+ * written from a good one.
+ *
+ * Nothing in an event is a reference. Methods, modules and classes are
+ * stored as their names, which are symbols and don't move, so the GC can
+ * ignore the ring and a dump can be made at any time.
+ *
+ * The dump is a header, the events in the order they happened and the
+ * names of the symbols they refer to:
+ *
+ *   "RBXPROBE"  uint32 version  uint32 event size  uint64 events  uint64 lost
+ *   events:     uint64 time  uint32 type  uint32 thread  uint32 a, b, c, d
+ *   uint32 symbols, then each: uint32 index + 1  uint32 length  bytes
+ *
+ * in the byte order of the machine that wrote it. lib/bin/trace reads
+ * it. */
+
+#define PROBE_DEFAULT_SIZE (1 << 18)
+#define PROBE_VERSION 1
+#define PROBE_RECORD_SIZE 32
+
+static struct { const char *name; int mask; } probe_groups[] = {
+  { "function", PROBE_FUNCTION },
+  { "gc",       PROBE_GC },
+  { "alloc",    PROBE_ALLOC },
+  { "thread",   PROBE_THREAD },
+  { "io",       PROBE_IO },
+  { "all",      PROBE_ALL },
+  { NULL, 0 }
+};
+
+static inline uint64_t probe_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct probe_buffer *probe_buffer_new() {
+  struct probe_buffer *pb = ALLOC_N(struct probe_buffer, 1);
+  pb->size = PROBE_DEFAULT_SIZE;
+  return pb;
+}
+
+/* The mask for a comma separated list of group names, like "function,gc".
+   Returns -1 if a name is unknown. */
+int probe_parse_mask(const char *names) {
+  const char *p = names;
+  size_t len;
+  int i, mask = 0;
+
+  while(*p) {
+    len = strcspn(p, ",");
+    if(len > 0) {
+      for(i = 0; probe_groups[i].name; i++) {
+        if(strlen(probe_groups[i].name) == len &&
+           !strncmp(probe_groups[i].name, p, len)) break;
+      }
+      if(!probe_groups[i].name) return -1;
+      mask |= probe_groups[i].mask;
+    }
+    p += len;
+    if(*p) p++;
+  }
+
+  return mask;
+}
+
+/* Only until the ring is made, rounded up to a power of 2. */
+void probe_set_size(struct probe_buffer *pb, uint64_t size) {
+  uint64_t sz = 1024;
+
+  if(pb->events) return;
+  while(sz < size) sz <<= 1;
+  pb->size = sz;
+}
+
+void probe_emit(struct probe_buffer *pb, int type, uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+  uint64_t n;
+  struct probe_event *e;
+
+  n = __sync_fetch_and_add(&pb->head, 1);
+  e = &pb->events[n & (pb->size - 1)];
+
+  e->seq = 0;
+  __sync_synchronize();
+
+  e->time = probe_now() - pb->start;
+  e->type = type;
+  e->thread = pb->thread;
+  e->a = a;
+  e->b = b;
+  e->c = c;
+  e->d = d;
+
+  __sync_synchronize();
+  e->seq = n + 1;
+}
+
+uint32_t probe_symbol(OBJECT sym) {
+  if(!SYMBOL_P(sym)) return 0;
+  return (uint32_t)DATA_STRIP_TAG(sym) + 1;
+}
+
+void probe_allocation(struct probe_buffer *pb, OBJECT cls, unsigned int fields) {
+  OBJECT name = Qnil;
+
+  if(REFERENCE_P(cls) && (cls->obj_type == ClassType || cls->obj_type == ModuleType)) {
+    name = module_get_name(cls);
+  }
+  probe_emit(pb, ProbeAllocation, probe_symbol(name), fields, 0, 0);
+}
+
+/* The entry or return of a method's context. Blocks aren't traced, their
+   time is part of the method they run in. */
+void probe_function(STATE, int type, OBJECT ctx, OBJECT module) {
+  struct fast_context *fc = FASTCTX(ctx);
+  OBJECT file = Qnil;
+  int meta;
+
+  if(fc->type != FASTCTX_NORMAL) return;
+
+  if(REFERENCE_P(fc->method)) file = cmethod_get_file(fc->method);
+  module = cpu_sampler_module_name(state, module, &meta);
+
+  probe_emit(state->probes, type, probe_symbol(fc->name), probe_symbol(module),
+             probe_symbol(file), meta ? PROBE_FLAG_META : 0);
+}
+
+/* The ring is made the first time any probe is turned on and kept after
+   they are turned off, so it can still be dumped. */
+void probe_enable(STATE, cpu c, int mask) {
+  struct probe_buffer *pb = state->probes;
+
+  if(mask && !pb->events) {
+    pb->events = ALLOC_N(struct probe_event, pb->size);
+    pb->start = probe_now();
+  }
+
+  pb->thread = probe_thread_id(state, c, c->current_thread);
+  pb->mask = mask;
+}
+
+/* Threads are told apart by their object_id, the main thread is 0. */
+uint32_t probe_thread_id(STATE, cpu c, OBJECT thr) {
+  if(!REFERENCE_P(thr) || thr == c->main_thread) return 0;
+  return (uint32_t)N2I((OBJECT)object_get_id(state, thr));
+}
+
+static int probe_write(FILE *f, const void *data, size_t size) {
+  return fwrite(data, size, 1, f) == 1;
+}
+
+/* Writes the events in the ring to path, returns how many or -1 if the
+   file couldn't be written. */
+int probe_dump(STATE, const char *path) {
+  struct probe_buffer *pb = state->probes;
+  struct probe_event e;
+  uint64_t head, first, n, written = 0, lost;
+  uint32_t u32, i, syms = 0, max_sym = 0;
+  unsigned char *used = NULL;
+  const char *str;
+  int ok = 1;
+  FILE *f;
+
+  f = fopen(path, "wb");
+  if(!f) return -1;
+
+  head = pb->events ? pb->head : 0;
+  first = head > pb->size ? head - pb->size : 0;
+
+  /* the counts are filled in after the events */
+  ok &= probe_write(f, "RBXPROBE", 8);
+  u32 = PROBE_VERSION;
+  ok &= probe_write(f, &u32, 4);
+  u32 = PROBE_RECORD_SIZE;
+  ok &= probe_write(f, &u32, 4);
+  ok &= probe_write(f, &written, 8);
+  ok &= probe_write(f, &first, 8);
+
+  for(n = first; n < head && ok; n++) {
+    e = pb->events[n & (pb->size - 1)];
+    __sync_synchronize();
+    if(e.seq != n + 1 || pb->events[n & (pb->size - 1)].seq != n + 1) continue;
+
+    ok &= probe_write(f, &e.time, 8);
+    ok &= probe_write(f, &e.type, 4);
+    ok &= probe_write(f, &e.thread, 4);
+    ok &= probe_write(f, &e.a, 16);
+    written++;
+
+    if(e.type == ProbeFunctionEntry || e.type == ProbeFunctionReturn ||
+       e.type == ProbeAllocation) {
+      uint32_t ids[3] = { e.a, e.type == ProbeAllocation ? 0 : e.b,
+                          e.type == ProbeAllocation ? 0 : e.c };
+      for(i = 0; i < 3; i++) {
+        if(ids[i] >= max_sym) {
+          used = realloc(used, ids[i] + 1024);
+          memset(used + max_sym, 0, ids[i] + 1024 - max_sym);
+          max_sym = ids[i] + 1024;
+        }
+        if(ids[i] && !used[ids[i]]) {
+          used[ids[i]] = 1;
+          syms++;
+        }
+      }
+    }
+  }
+
+  ok &= probe_write(f, &syms, 4);
+  for(i = 1; i < max_sym && ok; i++) {
+    if(!used[i]) continue;
+
+    str = rbs_symbol_to_cstring(state, symbol_from_index(state, i - 1));
+    u32 = strlen(str);
+    ok &= probe_write(f, &i, 4);
+    ok &= probe_write(f, &u32, 4);
+    ok &= probe_write(f, str, u32);
+  }
+  free(used);
+
+  lost = head - written;
+  if(ok) {
+    ok &= fseek(f, 16, SEEK_SET) == 0;
+    ok &= probe_write(f, &written, 8);
+    ok &= probe_write(f, &lost, 8);
+  }
+
+  if(fclose(f) != 0) ok = 0;
+  return ok ? (int)written : -1;
+}
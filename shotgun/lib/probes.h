@@ -0,0 +1,72 @@
+#ifndef RBS_PROBES_H
+#define RBS_PROBES_H
+
+#include <stdint.h>
+
+/* Tracing probes that need no DTrace, see probes.c.
+ *
+ * The probes are turned on in groups. A probe site costs one test of the
+ * group's bit in the mask while its group is off. */
+
+#define PROBE_FUNCTION  1
+#define PROBE_GC        2
+#define PROBE_ALLOC     4
+#define PROBE_THREAD    8
+#define PROBE_IO        16
+#define PROBE_ALL       31
+
+enum probe_type {
+  ProbeFunctionEntry = 1, /* a: method, b: module, c: file, d: flags */
+  ProbeFunctionReturn,    /* same as the entry */
+  ProbeGCBegin,           /* a: what is collected (OMCollectYoung, ...) */
+  ProbeGCEnd,             /* a: same as the begin */
+  ProbeAllocation,        /* a: class, b: fields */
+  ProbeThreadSwitch,      /* a: thread switched from, b: thread switched to */
+  ProbeIOWait,            /* a: fd, b: 0 to read, 1 to write */
+  ProbeIOReady            /* same as the wait */
+};
+
+/* method and module names are in a class (singleton) method's module */
+#define PROBE_FLAG_META 1
+
+/* a, b and c of the function and allocation probes are symbols, stored
+   as the symbol's index + 1 so 0 can be nil. */
+struct probe_event {
+  /* number of the event + 1, 0 while it is being written */
+  volatile uint64_t seq;
+  /* nanoseconds since the probes were first turned on */
+  uint64_t time;
+  uint32_t type;
+  uint32_t thread;
+  uint32_t a, b, c, d;
+};
+
+struct probe_buffer {
+  /* the groups that are on */
+  volatile int mask;
+  /* number of the next event, the slot is that modulo size */
+  volatile uint64_t head;
+  uint64_t size;
+  struct probe_event *events;
+
+  uint64_t start;
+  /* the thread the events happen in, 0 is the main thread */
+  uint32_t thread;
+  /* where to write the events when the process exits */
+  char *output;
+};
+
+#define PROBE_ON(pb, group) ((pb)->mask & (group))
+
+struct probe_buffer *probe_buffer_new();
+int probe_parse_mask(const char *names);
+void probe_set_size(struct probe_buffer *pb, uint64_t size);
+void probe_emit(struct probe_buffer *pb, int type, uint32_t a, uint32_t b, uint32_t c, uint32_t d);
+uint32_t probe_symbol(OBJECT sym);
+void probe_allocation(struct probe_buffer *pb, OBJECT cls, unsigned int fields);
+void probe_function(STATE, int type, OBJECT ctx, OBJECT module);
+void probe_enable(STATE, struct rubinius_cpu *c, int mask);
+uint32_t probe_thread_id(STATE, struct rubinius_cpu *c, OBJECT thr);
+int probe_dump(STATE, const char *path);
+
+#endif
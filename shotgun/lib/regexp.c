@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "oniguruma.h"
 
 #include "shotgun/lib/shotgun.h"
@@ -18,7 +20,27 @@
 #define KCODE_UTF8        64
 #define KCODE_MASK        (KCODE_EUC|KCODE_SJIS|KCODE_UTF8)
 
-#define REG(k) (*DATA_STRUCT(k, regex_t**))
+/* The longest literal prefix kept for a regexp. */
+#define PREFIX_MAX        32
+
+/*
+ * What RegexpData holds. Besides the compiled onig regex, regexp_new
+ * records the literal bytes every match has to start with, so a search
+ * can skip ahead to them with memchr, or give up without running onig
+ * when they aren't there. A pattern that is nothing but a literal is
+ * matched without onig at all.
+ */
+struct regexp_info {
+  regex_t *reg;
+  int anchored;      /* the pattern starts with \A */
+  int literal;       /* the prefix is the whole pattern */
+  int prefix_len;
+  UChar prefix[PREFIX_MAX];
+};
+
+#define INFO(k) DATA_STRUCT(k, struct regexp_info*)
+#define REG(k) (INFO(k)->reg)
+#define MATCH_REGION(state) ((OnigRegion*)(state)->match_region)
 
 OBJECT get_match_data(STATE, OnigRegion *region, OBJECT string, OBJECT regex, int max);
 
@@ -28,6 +50,7 @@ void regexp_cleanup(STATE, OBJECT data) {
 
 void regexp_init(STATE) {
   onig_init();
+  state->match_region = onig_region_new();
   state_add_cleanup(state, BASIC_CLASS(regexpdata), regexp_cleanup);
 }
 
@@ -90,7 +113,97 @@ int get_kcode_from_enc(OnigEncoding enc)
   return r;
 }
 
+/* Finds the literal bytes at the start of the pattern. Only patterns
+ * whose bytes mean the same thing in the subject are considered: no
+ * ignorecase or extended option, and an encoding in which an ASCII byte
+ * is always a whole character. Any | anywhere gives up, rather than
+ * working out whether it is at the top level. */
+static void regexp_find_prefix(struct regexp_info *info, const UChar *pat,
+                               const UChar *end, OnigOptionType opts, OnigEncoding enc) {
+  const UChar *p;
+
+  info->anchored = 0;
+  info->literal = 0;
+  info->prefix_len = 0;
+
+  if(opts & (OPTION_IGNORECASE|OPTION_EXTENDED)) return;
+  if(enc != ONIG_ENCODING_ASCII && enc != ONIG_ENCODING_UTF8) return;
+  if(memchr(pat, '|', end - pat)) return;
+
+  p = pat;
+  if(end - p >= 2 && p[0] == '\\' && p[1] == 'A') {
+    info->anchored = 1;
+    p += 2;
+  }
+
+  while(p < end && info->prefix_len < PREFIX_MAX) {
+    if(*p >= 0x80 || strchr(".^$*+?{}[]()\\", *p)) break;
+    info->prefix[info->prefix_len++] = *p++;
+  }
+
+  if(p == end) {
+    info->literal = info->prefix_len > 0;
+  } else if(info->prefix_len > 0 && strchr("*+?{", *p)) {
+    /* the quantifier applies to the last byte */
+    info->prefix_len--;
+  }
+}
+
+/* Returns the first position in from..upto where the prefix starts, or -1. */
+static int regexp_scan_prefix(struct regexp_info *info, const UChar *str, int max,
+                              int from, int upto) {
+  const UChar *p;
+  int len = info->prefix_len;
+
+  if(upto > max - len) upto = max - len;
+  while(from <= upto) {
+    p = memchr(str + from, info->prefix[0], upto - from + 1);
+    if(!p) return -1;
+    if(!memcmp(p + 1, info->prefix + 1, len - 1)) return p - str;
+    from = p - str + 1;
+  }
+  return -1;
+}
+
+/*
+ * Searches forward like onig_search, for a match starting at or after
+ * start and no later than range, and fills in region (which may be NULL).
+ * The literal prefix is looked for first, so onig only runs from a place
+ * a match can start.
+ */
+static int regexp_search_forward(OBJECT regexp, const UChar *str, int max,
+                                 int start, int range, OnigRegion *region) {
+  struct regexp_info *info = INFO(regexp);
+  int len = info->prefix_len;
+  int at;
+
+  if(len == 0 || start < 0 || start > range || range > max) {
+    return onig_search(info->reg, str, str + max, str + start, str + range,
+                       region, ONIG_OPTION_NONE);
+  }
+
+  if(info->anchored) {
+    if(start > 0 || len > max || memcmp(str, info->prefix, len)) return ONIG_MISMATCH;
+    at = 0;
+  } else {
+    at = regexp_scan_prefix(info, str, max, start, range);
+    if(at < 0) return ONIG_MISMATCH;
+  }
+
+  if(info->literal && at < range) {
+    if(region) {
+      onig_region_resize(region, 1);
+      onig_region_set(region, 0, at, at + len);
+    }
+    return at;
+  }
+
+  return onig_search(info->reg, str, str + max, str + at, str + range,
+                     region, ONIG_OPTION_NONE);
+}
+
 OBJECT regexp_new(STATE, OBJECT pattern, OBJECT options, char *err_buf) {
+  struct regexp_info *info;
   regex_t **reg;
   const UChar *pat;
   const UChar *end;
@@ -109,7 +222,8 @@ OBJECT regexp_new(STATE, OBJECT pattern, OBJECT options, char *err_buf) {
      So for the time being a regexp object will just store the
      pointer to the real regex structure. */
      
-  NEW_STRUCT(o_regdata, reg, BASIC_CLASS(regexpdata), regex_t*);
+  NEW_STRUCT(o_regdata, info, BASIC_CLASS(regexpdata), struct regexp_info);
+  reg = &info->reg;
 
   opts  = N2I(options);
   kcode = opts & KCODE_MASK;
@@ -125,6 +239,8 @@ OBJECT regexp_new(STATE, OBJECT pattern, OBJECT options, char *err_buf) {
     snprintf(err_buf, 1024, "%s: %s", onig_err_buf, pat);
     return Qnil;
   }
+
+  regexp_find_prefix(info, pat, end, opts, enc);
   
   o_reg = regexp_allocate(state);
   regexp_set_source(o_reg, pattern);
@@ -180,81 +296,74 @@ OBJECT get_match_data(STATE, OnigRegion *region, OBJECT string, OBJECT regexp, i
 }
 
 OBJECT regexp_match_start(STATE, OBJECT regexp, OBJECT string, OBJECT start) {
-  int beg, max;
+  int beg, max, at;
   const UChar *str;
-  OnigRegion *region;
-  OBJECT md = Qnil;
-  
-  region = onig_region_new();
+  struct regexp_info *info;
+  OnigRegion *region = MATCH_REGION(state);
   
   max = N2I(string_get_bytes(string));
-  str = (UChar*)rbx_string_as_cstr(state, string);
-  
-  beg = onig_match(REG(regexp_get_data(regexp)), str, str + max, str + N2I(start), region, ONIG_OPTION_NONE);
+  str = (UChar*)string_byte_address(state, string);
+  at = N2I(start);
+  info = INFO(regexp_get_data(regexp));
 
-  if(beg != ONIG_MISMATCH) {
-    md = get_match_data(state, region, string, regexp, max);
+  /* A match here has to begin with the prefix. */
+  if(info->prefix_len > 0 && at >= 0 && at <= max &&
+     (max - at < info->prefix_len || memcmp(str + at, info->prefix, info->prefix_len))) {
+    return Qnil;
   }
+  
+  beg = onig_match(info->reg, str, str + max, str + at, region, ONIG_OPTION_NONE);
 
-  onig_region_free(region, 1);
-  return md;
+  if(beg == ONIG_MISMATCH) return Qnil;
+  return get_match_data(state, region, string, regexp, max);
 }
 
 OBJECT regexp_search_region(STATE, OBJECT regexp, OBJECT string, OBJECT start, OBJECT end, OBJECT forward) {
   int beg, max;
   const UChar *str;
-  OnigRegion *region;
-  OBJECT md = Qnil;
-  
-  region = onig_region_new();
+  OnigRegion *region = MATCH_REGION(state);
   
   max = N2I(string_get_bytes(string));
-  str = (UChar*)rbx_string_as_cstr(state, string);
+  str = (UChar*)string_byte_address(state, string);
   
   if (RTEST(forward)) {
-    beg = onig_search(REG(regexp_get_data(regexp)), str, str + max, str + N2I(start), str + N2I(end), region, ONIG_OPTION_NONE);
+    beg = regexp_search_forward(regexp_get_data(regexp), str, max, N2I(start), N2I(end), region);
   } else {
     beg = onig_search(REG(regexp_get_data(regexp)), str, str + max, str + N2I(end), str + N2I(start), region, ONIG_OPTION_NONE);  
   }
 
-  if (beg != ONIG_MISMATCH) {
-    md = get_match_data(state, region, string, regexp, max);
-  }
-  
-  onig_region_free(region, 1);
-  return md;
+  if (beg == ONIG_MISMATCH) return Qnil;
+  return get_match_data(state, region, string, regexp, max);
+}
+
+/* Like a forward regexp_search_region, but only says whether there is a
+ * match, so no region is filled in and no MatchData is made. */
+OBJECT regexp_search_p(STATE, OBJECT regexp, OBJECT string, OBJECT start, OBJECT end) {
+  int beg;
+
+  beg = regexp_search_forward(regexp_get_data(regexp),
+                              (UChar*)string_byte_address(state, string),
+                              N2I(string_get_bytes(string)), N2I(start), N2I(end), NULL);
+
+  return beg == ONIG_MISMATCH ? Qfalse : Qtrue;
 }
 
 OBJECT regexp_match(STATE, OBJECT regexp, OBJECT string) {
-  int err, max;
-  const UChar *str, *end, *start, *range;
-  OnigRegion *region;
-  regex_t *reg;
+  int beg, max;
+  OnigRegion *region = MATCH_REGION(state);
   OBJECT md;
   
-  region = onig_region_new();
-  
   max = N2I(string_get_bytes(string));
-  str = (UChar*)rbx_string_as_cstr(state, string);
-  end = str + max;
-  start = str;
-  range = end;
-  
-  reg = REG(regexp_get_data(regexp));
-  
-  err = onig_search(reg, str, end, start, range, region, ONIG_OPTION_NONE);
+  beg = regexp_search_forward(regexp_get_data(regexp),
+                              (UChar*)string_byte_address(state, string),
+                              max, 0, max, region);
   
-  if(err == ONIG_MISMATCH) {
-    onig_region_free(region, 1);
-    return Qnil;
-  }
+  if(beg == ONIG_MISMATCH) return Qnil;
   
   md = matchdata_allocate(state);
   matchdata_set_source(md, string);
   matchdata_set_regexp(md, regexp);
   matchdata_set_full(md, tuple_new2(state, 2, I2N(region->beg[0]), I2N(region->end[0])));
   matchdata_set_region(md, _md_region_to_tuple(state, region, max));
-  onig_region_free(region, 1);
   return md;
 }
-
@@ -5,4 +5,5 @@ OBJECT regexp_match_start  (STATE, OBJECT regexp, OBJECT string, OBJECT start);
 OBJECT regexp_new          (STATE, OBJECT pattern, OBJECT options, char *err_buf);
 OBJECT regexp_options      (STATE, OBJECT regexp);
 OBJECT regexp_search_region(STATE, OBJECT regexp, OBJECT string, OBJECT start, OBJECT end, OBJECT forward);
+OBJECT regexp_search_p     (STATE, OBJECT regexp, OBJECT string, OBJECT start, OBJECT end);
 char * regexp_version      (STATE);
@@ -0,0 +1,245 @@
+#include "shotgun/lib/shotgun.h"
+#include "shotgun/lib/tuple.h"
+#include "shotgun/lib/lookuptable.h"
+#include "shotgun/lib/object.h"
+#include "shotgun/lib/shape.h"
+
+static OBJECT shape_new(STATE, OBJECT names) {
+  OBJECT shape;
+
+  shape = NEW_OBJECT_MATURE(BASIC_CLASS(tuple), SHAPE_FIELDS);
+  SET_FIELD(shape, SHAPE_f_NAMES, names);
+  SET_FIELD(shape, SHAPE_f_TRANSITIONS, Qnil);
+  return shape;
+}
+
+OBJECT shape_new_root(STATE) {
+  return shape_new(state, NEW_OBJECT_MATURE(BASIC_CLASS(tuple), 0));
+}
+
+/* The shape an object with +shape+ moves to when +sym+ is assigned. */
+OBJECT shape_transition(STATE, OBJECT shape, OBJECT sym) {
+  OBJECT tbl, child, names;
+
+  tbl = NTH_FIELD(shape, SHAPE_f_TRANSITIONS);
+  if(NIL_P(tbl)) {
+    tbl = lookuptable_new(state);
+    SET_FIELD(shape, SHAPE_f_TRANSITIONS, tbl);
+  } else {
+    child = lookuptable_fetch(state, tbl, sym);
+    if(!NIL_P(child)) return child;
+  }
+
+  names = tuple_enlarge(state, shape_get_names(shape), 1);
+  SET_FIELD(names, NUM_FIELDS(names) - 1, sym);
+
+  child = shape_new(state, names);
+  lookuptable_store(state, tbl, sym, child);
+  return child;
+}
+
+/* Index of +sym+'s value in the ivars Tuple of an object with +shape+,
+   or 0 if +shape+ has no such ivar. */
+int shape_index_of(STATE, OBJECT shape, OBJECT sym) {
+  OBJECT names;
+  int i, count;
+
+  names = shape_get_names(shape);
+  count = NUM_FIELDS(names);
+
+  for(i = 0; i < count; i++) {
+    if(NTH_FIELD(names, i) == sym) return i + 1;
+  }
+
+  return 0;
+}
+
+OBJECT shape_get_ivar(STATE, OBJECT ivars, OBJECT sym) {
+  int idx;
+
+  if(NIL_P(ivars)) return Qnil;
+
+  idx = shape_index_of(state, NTH_FIELD(ivars, IVARS_f_SHAPE), sym);
+  return idx ? NTH_FIELD(ivars, idx) : Qnil;
+}
+
+/* Make room in the ivars Tuple of self for a value at +idx+. The Tuple
+   grows by doubling, so an object that keeps adding ivars only copies
+   them a few times. */
+static OBJECT shape_ivars_reserve(STATE, OBJECT self, OBJECT ivars, int idx) {
+  int size;
+
+  if(NIL_P(ivars)) {
+    ivars = tuple_new(state, SHAPE_INITIAL_IVARS + 1);
+  } else if(idx >= NUM_FIELDS(ivars)) {
+    size = (NUM_FIELDS(ivars) - 1) * 2;
+    if(size > SHAPE_MAX_IVARS) size = SHAPE_MAX_IVARS;
+    ivars = tuple_enlarge(state, ivars, size + 1 - NUM_FIELDS(ivars));
+  } else {
+    return ivars;
+  }
+
+  object_set_instance_variables(self, ivars);
+  return ivars;
+}
+
+/* Assign +sym+ on self, which keeps its ivars by shape. Returns the index
+   the value was stored at, or 0 when self had no room left for another
+   ivar and now keeps them all in a LookupTable instead. */
+int shape_set_ivar(STATE, OBJECT self, OBJECT sym, OBJECT val) {
+  OBJECT ivars, shape, tbl;
+  int idx;
+
+  ivars = object_get_instance_variables(self);
+  shape = NIL_P(ivars) ? state->global->root_shape : NTH_FIELD(ivars, IVARS_f_SHAPE);
+
+  idx = shape_index_of(state, shape, sym);
+  if(!idx) {
+    idx = shape_ivar_count(shape) + 1;
+
+    if(idx > SHAPE_MAX_IVARS) {
+      tbl = shape_ivars_into_lookuptable(state, ivars);
+      lookuptable_store(state, tbl, sym, val);
+      object_set_instance_variables(self, tbl);
+      return 0;
+    }
+
+    shape = shape_transition(state, shape, sym);
+    ivars = shape_ivars_reserve(state, self, ivars, idx);
+    SET_FIELD(ivars, IVARS_f_SHAPE, shape);
+  }
+
+  SET_FIELD(ivars, idx, val);
+  return idx;
+}
+
+/* The ivars as a Tuple of name, value pairs, which is what
+   Kernel#instance_variables and friends walk. */
+OBJECT shape_ivars_to_pairs(STATE, OBJECT ivars) {
+  OBJECT names, pairs;
+  int i, count;
+
+  names = shape_get_names(NTH_FIELD(ivars, IVARS_f_SHAPE));
+  count = NUM_FIELDS(names);
+
+  pairs = tuple_new(state, count * 2);
+  for(i = 0; i < count; i++) {
+    SET_FIELD(pairs, i * 2, NTH_FIELD(names, i));
+    SET_FIELD(pairs, i * 2 + 1, NTH_FIELD(ivars, i + 1));
+  }
+
+  return pairs;
+}
+
+OBJECT shape_ivars_into_lookuptable(STATE, OBJECT ivars) {
+  OBJECT names, tbl;
+  int i, count;
+
+  tbl = lookuptable_new(state);
+  if(NIL_P(ivars)) return tbl;
+
+  names = shape_get_names(NTH_FIELD(ivars, IVARS_f_SHAPE));
+  count = NUM_FIELDS(names);
+
+  for(i = 0; i < count; i++) {
+    lookuptable_store(state, tbl, NTH_FIELD(names, i), NTH_FIELD(ivars, i + 1));
+  }
+
+  return tbl;
+}
+
+/* The ivar_cache of +cm+, created the first time the method misses. */
+OBJECT shape_cache_of(STATE, OBJECT cm) {
+  OBJECT cache;
+  int size;
+
+  size = NUM_FIELDS(cmethod_get_literals(cm)) * IVAR_CACHE_ENTRY;
+  cache = cmethod_get_ivar_cache(cm);
+  if(NIL_P(cache) || NUM_FIELDS(cache) < size) {
+    cache = NEW_OBJECT_MATURE(BASIC_CLASS(tuple), size);
+    cmethod_set_ivar_cache(cm, cache);
+  }
+
+  return cache;
+}
+
+/* The ivar_cache of +cm+ if its entry for literal +lit+ was filled for
+   +shape+ in the half starting at +which+, else Qnil. */
+static inline OBJECT shape_cache_probe(OBJECT cm, int lit, int which, OBJECT shape) {
+  OBJECT cache;
+
+  cache = cmethod_get_ivar_cache(cm);
+  lit = lit * IVAR_CACHE_ENTRY + which;
+  if(NIL_P(cache) || lit >= NUM_FIELDS(cache)) return Qnil;
+  if(NTH_FIELD_DIRECT(cache, lit) != shape) return Qnil;
+  return cache;
+}
+
+/* push_ivar: read +sym+, the literal at +lit+ in +cm+, from self. */
+OBJECT shape_cached_get_ivar(STATE, OBJECT self, OBJECT cm, int lit, OBJECT sym) {
+  OBJECT ivars, shape, cache;
+  int idx;
+
+  ivars = shape_ivars_of(self);
+  if(UNDEF_P(ivars)) return object_get_ivar(state, self, sym);
+
+  shape = NIL_P(ivars) ? state->global->root_shape : NTH_FIELD(ivars, IVARS_f_SHAPE);
+
+  cache = shape_cache_probe(cm, lit, IVAR_CACHE_f_GET_SHAPE, shape);
+  lit *= IVAR_CACHE_ENTRY;
+  if(!NIL_P(cache)) {
+    idx = N2I(NTH_FIELD_DIRECT(cache, lit + IVAR_CACHE_f_GET_INDEX));
+  } else {
+    idx = shape_index_of(state, shape, sym);
+    cache = shape_cache_of(state, cm);
+    SET_FIELD(cache, lit + IVAR_CACHE_f_GET_SHAPE, shape);
+    SET_FIELD(cache, lit + IVAR_CACHE_f_GET_INDEX, I2N(idx));
+  }
+
+  return idx ? NTH_FIELD(ivars, idx) : Qnil;
+}
+
+/* set_ivar: assign +sym+, the literal at +lit+ in +cm+, on self. When the
+   cache has seen this shape it already knows where the value goes and
+   which shape self ends up with, so only a Tuple too small to hold the
+   value has to go the long way round. */
+void shape_cached_set_ivar(STATE, OBJECT self, OBJECT cm, int lit, OBJECT sym, OBJECT val) {
+  OBJECT ivars, shape, cache;
+  int idx;
+
+  ivars = shape_ivars_of(self);
+  if(UNDEF_P(ivars)) {
+    object_set_ivar(state, self, sym, val);
+    return;
+  }
+
+  shape = NIL_P(ivars) ? state->global->root_shape : NTH_FIELD(ivars, IVARS_f_SHAPE);
+
+  cache = shape_cache_probe(cm, lit, IVAR_CACHE_f_SET_SHAPE, shape);
+  if(!NIL_P(cache)) {
+    idx = N2I(NTH_FIELD_DIRECT(cache, lit * IVAR_CACHE_ENTRY + IVAR_CACHE_f_SET_INDEX));
+
+    /* The first ivar of a new object, typically set in initialize. */
+    if(NIL_P(ivars)) {
+      ivars = tuple_new(state, SHAPE_INITIAL_IVARS + 1);
+      object_set_instance_variables(self, ivars);
+    }
+
+    if(idx < NUM_FIELDS(ivars)) {
+      SET_FIELD(ivars, IVARS_f_SHAPE,
+                NTH_FIELD_DIRECT(cache, lit * IVAR_CACHE_ENTRY + IVAR_CACHE_f_SET_NEXT));
+      SET_FIELD(ivars, idx, val);
+      return;
+    }
+  }
+
+  idx = shape_set_ivar(state, self, sym, val);
+  if(!idx) return;
+
+  ivars = object_get_instance_variables(self);
+  cache = shape_cache_of(state, cm);
+  lit *= IVAR_CACHE_ENTRY;
+  SET_FIELD(cache, lit + IVAR_CACHE_f_SET_SHAPE, shape);
+  SET_FIELD(cache, lit + IVAR_CACHE_f_SET_INDEX, I2N(idx));
+  SET_FIELD(cache, lit + IVAR_CACHE_f_SET_NEXT, NTH_FIELD(ivars, IVARS_f_SHAPE));
+}
@@ -0,0 +1,94 @@
+#ifndef RBS_SHAPE_H
+#define RBS_SHAPE_H
+
+/*
+
+ Shapes describe where an object keeps its instance variables.
+
+ An object that can store ivars keeps them in a Tuple in its ivars field:
+ field 0 is the object's shape and the values follow, in the order the
+ ivars were first assigned. The shape knows the names of those ivars and
+ so the index of each value, meaning objects that set the same ivars in
+ the same order share one shape and carry no per-object keys at all.
+
+ Shapes form a tree. Every object starts at the root shape, and assigning
+ an ivar it doesn't yet have moves it to the child shape for that name,
+ created the first time it's needed. Shapes never change once created, so
+ a (shape, index) pair seen once stays valid forever.
+
+ An object that gets more than SHAPE_MAX_IVARS ivars has them moved into a
+ LookupTable, which is used from then on. Immediates and objects that can't
+ store ivars still use the external_ivars and has_ivars tables.
+
+
+ == Structure fields
+
+ names        : Tuple of the ivar names, in value order
+ transitions  : LookupTable of ivar name => child shape, or nil
+
+ == Inline caches
+
+ push_ivar and set_ivar cache what they learn in the ivar_cache Tuple of
+ the running CompiledMethod, one entry of IVAR_CACHE_ENTRY fields for
+ each literal. Reads and writes of an ivar name the same literal but
+ learn different things, so an entry has a half for each. Both record
+ the shape last seen and the index of the ivar in it; the write half also
+ records the shape the object moves to. A read index of 0 means the ivar
+ isn't set in that shape.
+
+ push_const and find_const use the same entries, which works out because
+ a constant name is never an ivar name. Theirs hold the StaticScope or
+ module the constant was looked up from, the constant serial at the time
+ and the constant found. See cpu_const_get_cached.
+
+*/
+
+#define SHAPE_FIELDS 2
+#define SHAPE_f_NAMES 0
+#define SHAPE_f_TRANSITIONS 1
+
+#define IVARS_f_SHAPE 0
+
+#define SHAPE_MAX_IVARS 32
+#define SHAPE_INITIAL_IVARS 4
+
+#define IVAR_CACHE_ENTRY 5
+#define IVAR_CACHE_f_GET_SHAPE 0
+#define IVAR_CACHE_f_GET_INDEX 1
+#define IVAR_CACHE_f_SET_SHAPE 2
+#define IVAR_CACHE_f_SET_INDEX 3
+#define IVAR_CACHE_f_SET_NEXT 4
+
+#define CONST_CACHE_f_KEY 0
+#define CONST_CACHE_f_SERIAL 1
+#define CONST_CACHE_f_VALUE 2
+
+#define shape_get_names(shape) NTH_FIELD(shape, SHAPE_f_NAMES)
+#define shape_ivar_count(shape) NUM_FIELDS(shape_get_names(shape))
+
+OBJECT shape_new_root(STATE);
+OBJECT shape_transition(STATE, OBJECT shape, OBJECT sym);
+int shape_index_of(STATE, OBJECT shape, OBJECT sym);
+
+OBJECT shape_get_ivar(STATE, OBJECT ivars, OBJECT sym);
+int shape_set_ivar(STATE, OBJECT self, OBJECT sym, OBJECT val);
+OBJECT shape_ivars_to_pairs(STATE, OBJECT ivars);
+OBJECT shape_ivars_into_lookuptable(STATE, OBJECT ivars);
+
+OBJECT shape_cache_of(STATE, OBJECT cm);
+OBJECT shape_cached_get_ivar(STATE, OBJECT self, OBJECT cm, int lit, OBJECT sym);
+void shape_cached_set_ivar(STATE, OBJECT self, OBJECT cm, int lit, OBJECT sym, OBJECT val);
+
+/* Returns the ivars Tuple of self when self keeps its ivars by shape,
+   Qnil when it can but has none yet, and Qundef otherwise. */
+static inline OBJECT shape_ivars_of(OBJECT self) {
+  OBJECT ivars;
+
+  if(!REFERENCE_P(self) || !self->CanStoreIvars) return Qundef;
+
+  ivars = NTH_FIELD(self, 0);
+  if(NIL_P(ivars) || TUPLE_P(ivars)) return ivars;
+  return Qundef;
+}
+
+#endif
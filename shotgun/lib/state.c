@@ -47,6 +47,7 @@ rstate rubinius_state_new() {
   rstate st;
   st = (rstate)calloc(1, sizeof(struct rubinius_state));
   st->om = object_memory_new();
+  st->probes = st->om->probes;
   st->global = (struct rubinius_globals*)calloc(1, sizeof(struct rubinius_globals));
   st->cleanup = ht_cleanup_create(11);
   st->config = ht_config_create(11);
@@ -80,8 +81,7 @@ static ptr_array _gather_roots(STATE, cpu c) {
   return roots;
 }
 
-void cpu_sampler_suspend(STATE);
-void cpu_sampler_resume(STATE);
+void cpu_sampler_flush(STATE);
 void cpu_hard_cache(STATE, cpu c);
 
 void state_collect(STATE, cpu c) {
@@ -107,7 +107,7 @@ void state_collect(STATE, cpu c) {
       global and being a special case one so that it's references
       can't keep objects alive. */
 
-  cpu_sampler_suspend(state);
+  cpu_sampler_flush(state);
   object_memory_formalize_contexts(state, state->om);
   roots = _gather_roots(state, c);
   object_memory_collect(state, state->om, roots);
@@ -119,19 +119,19 @@ void state_collect(STATE, cpu c) {
   ptr_array_free(roots);
 
   baker_gc_find_lost_souls(state, state->om->gc);
-  cpu_sampler_resume(state);
 
   if(stats) {
     double elapse;
     gettimeofday(&fin, NULL);
     elapse =  (fin.tv_sec - start.tv_sec);
     elapse += (((double)fin.tv_usec - start.tv_usec) / 1000000);
-    printf("[GC Y %f secs, %ldK total, %3dK used, %4d tenured, %d]\n",
+    printf("[GC Y %f secs, %ldK total, %3dK used, %4d tenured, %d, age %d]\n",
       elapse,
       (long int)(state->om->gc->current->size / 1024),
       (unsigned int)(((uintptr_t)state->om->gc->current->current - (uintptr_t)state->om->gc->current->address) / 1024),
       state->om->last_tenured,
-      state->om->gc->num_collection
+      state->om->gc->num_collection,
+      state->om->gc->tenure_age
     );
   }
 
@@ -153,6 +153,10 @@ void state_major_collect(STATE, cpu c) {
 
   state_collect(state, c);
 
+  /* state_collect is done with the young generation, but we're still
+     collecting. */
+  state->in_gc = 1;
+
   if(stats) {
     gettimeofday(&start, NULL);
   }
@@ -167,14 +171,13 @@ void state_major_collect(STATE, cpu c) {
   state->current_stack = c->stack_top;
   state->current_sp =    c->sp_ptr;
 
-  cpu_sampler_suspend(state);
+  cpu_sampler_flush(state);
   roots = _gather_roots(state, c);
   object_memory_major_collect(state, state->om, roots);
   memcpy(state->global, roots->array, sizeof(struct rubinius_globals));
   cpu_update_roots(state, c, roots, NUM_OF_GLOBALS);
 
   ptr_array_free(roots);
-  cpu_sampler_suspend(state);
 
   if(stats) {
     double elapse;
@@ -43,6 +43,7 @@ struct rubinius_globals {
   OBJECT sym_inherited, sym_opened_class;
   OBJECT sym_from_literal, sym_method_added, sym_s_method_added, sym_init_copy;
   OBJECT sym_plus, sym_minus, sym_equal, sym_nequal, sym_tequal, sym_lt, sym_gt;
+  OBJECT sym_times, sym_divide, sym_modulo, sym_le, sym_ge;
   OBJECT exc_arg, exc_segfault;
   OBJECT exc_loe, exc_type, exc_rex;
   OBJECT exc_stack_explosion;
@@ -54,7 +55,7 @@ struct rubinius_globals {
   OBJECT sym_object_id, sym_call;
   OBJECT exception, iseq, icache;
   OBJECT top_scope, on_gc_channel;
-  OBJECT selectors;
+  OBJECT selectors, root_shape;
 
   OBJECT special_classes[SPECIAL_CLASS_SIZE];
 };
@@ -100,7 +101,12 @@ struct type_info {
 };
 
 
+/* Enough fields to hold a struct fast_context */
+#if (CONFIG_WORDSIZE != 64)
+#define FASTCTX_FIELDS 22
+#else
 #define FASTCTX_FIELDS 19
+#endif
 #define FASTCTX_NORMAL 1
 #define FASTCTX_BLOCK  3
 #define FASTCTX_NMC    4
@@ -126,6 +132,10 @@ struct rubinius_state {
 
   struct rubinius_globals *global;
 
+  /* Bumped whenever a constant or a superclass changes, see
+     cpu_const_get_cached. */
+  native_int constant_serial;
+
   /* Used to pass information down to the garbage collectors */
   OBJECT *current_stack;
   OBJECT *current_sp;
@@ -148,8 +158,12 @@ struct rubinius_state {
   unsigned int event_id;
 
   /* Stuff sampling profiler uses, not critical for VM operations */
-  OBJECT *samples;
-  int max_samples, cur_sample;
+  struct sampler *sampler;
+  /* The method profiler, see cpu_profile.c */
+  struct method_profile *method_profile;
+  int profile_methods;
+  /* The tracing probes, see probes.c. The same as om->probes. */
+  struct probe_buffer *probes;
   /* again, profiler stats */
   int excessive_tracing, gc_stats;
   int check_events, pending_threads, pending_events;
@@ -159,6 +173,9 @@ struct rubinius_state {
 
   struct termios *termios;
 
+  /* OnigRegion that every regexp search fills in, see regexp.c */
+  void *match_region;
+
   /* Used to store the value of c->ip_ptr while cpu_run isn't running */
   IP_TYPE* external_ip;
 
@@ -322,7 +339,7 @@ void machine_handle_type_error(OBJECT, const char *message);
 
 #define current_machine (environment_current_machine())
 
-
+#include "shotgun/lib/probes.h"
 #include "shotgun/lib/object_memory-inline.h"
 
 void state_add_cleanup(STATE, OBJECT cls, state_cleanup_func func);
@@ -1,5 +1,6 @@
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <errno.h>
 #include <bstrlib.h>
 
@@ -19,6 +20,7 @@ OBJECT string_new2(STATE, const char *str, int sz) {
   string_set_bytes(obj, I2N(sz));
   string_set_characters(obj, I2N(sz));
   string_set_encoding(obj, Qnil);
+  string_set_start(obj, I2N(0));
 
   data = bytearray_new_dirty(state, sz+1);
   ba = bytearray_byte_address(state, data);
@@ -53,11 +55,74 @@ OBJECT string_new_shared(STATE, OBJECT cur) {
   string_set_encoding(obj, Qnil);
 
   string_set_data(obj, string_get_data(cur));
+  string_set_start(obj, string_get_start(cur));
   string_set_shared(obj, Qtrue);
   string_set_shared(cur, Qtrue);
   return obj;
 }
 
+/* Returns a String of count bytes of self from start, which the caller has
+ * checked are in range. Unless it's very short, it shares self's data until
+ * either of them is changed. */
+OBJECT string_new_view(STATE, OBJECT self, int start, int count) {
+  OBJECT obj;
+
+  if(count < STRING_VIEW_MIN) {
+    obj = string_new2(state, NULL, count);
+    memcpy(string_byte_address(state, obj), string_byte_address(state, self) + start, count);
+  } else {
+    obj = string_allocate(state);
+    string_set_bytes(obj, I2N(count));
+    string_set_characters(obj, I2N(count));
+    string_set_encoding(obj, Qnil);
+    string_set_data(obj, string_get_data(self));
+    string_set_start(obj, I2N(string_start(self) + start));
+    string_set_shared(obj, Qtrue);
+    string_set_shared(self, Qtrue);
+  }
+
+  SET_CLASS(obj, object_class(state, self));
+  obj->IsTainted = self->IsTainted;
+  return obj;
+}
+
+/* Gives self its own copy of its bytes, at the start of a new ByteArray
+   of at least size bytes. */
+void string_detach_size(STATE, OBJECT self, int size) {
+  OBJECT data;
+  int bytes;
+
+  bytes = N2I(string_get_bytes(self));
+  if(size < bytes+1) size = bytes+1;
+
+  data = bytearray_new_dirty(state, size);
+  memcpy(bytearray_byte_address(state, data), string_byte_address(state, self), bytes);
+  ((char*)bytearray_byte_address(state, data))[bytes] = 0;
+
+  string_set_data(self, data);
+  string_set_start(self, I2N(0));
+  string_set_shared(self, Qnil);
+}
+
+/* Gives self its own copy of its bytes, at the start of a new ByteArray. */
+void string_detach(STATE, OBJECT self) {
+  string_detach_size(state, self, 0);
+}
+
+/* Whether self only uses a small part of a large shared ByteArray. */
+int string_trim_view_p(STATE, OBJECT self) {
+  OBJECT data;
+  int size;
+
+  if(string_get_shared(self) != Qtrue) return FALSE;
+  data = string_get_data(self);
+  if(!REFERENCE_P(data)) return FALSE;
+
+  size = bytearray_bytes(state, data);
+  return size >= STRING_TRIM_MIN &&
+    N2I(string_get_bytes(self)) < size / STRING_TRIM_RATIO;
+}
+
 OBJECT string_newfrombstr(STATE, bstring str)
 {
   if(str == NULL) {
@@ -76,34 +141,48 @@ OBJECT string_dup(STATE, OBJECT self) {
   return obj;
 }
 
+/* Room left for later appends when string_append has to move a String's
+ * data, as a fraction of what was already there. Growing geometrically
+ * keeps building a String with repeated << linear in its final size. */
+#define STRING_GROWTH_DIVISOR 2
+#define STRING_MIN_EXTRA 16
+
 OBJECT string_append(STATE, OBJECT self, OBJECT other) {
-  OBJECT cur, obs, nd;
-  int cur_sz, oth_sz, ns, tmp, extra;
+  xassert(STRING_P(other));
+  return string_append_bytes(state, self, string_byte_address(state, other),
+                             N2I(string_get_bytes(other)));
+}
+
+/* Appends the oth_sz bytes at str to self in place. */
+OBJECT string_append_bytes(STATE, OBJECT self, const char *str, int oth_sz) {
+  OBJECT cur, nd;
+  int cur_sz, ns, tmp, extra;
   char *ba;
 
   xassert(STRING_P(self));
-  xassert(STRING_P(other));
-
-  string_unshare(state, self);
 
   cur = string_get_data(self);
-  obs = string_get_data(other);
   cur_sz = N2I(string_get_bytes(self));
-  oth_sz = N2I(string_get_bytes(other));
 
   ns = cur_sz + oth_sz;
-  tmp = bytearray_bytes(state, cur);
-  if(ns+1 > tmp) {
-    extra = ns * 0.01;
-    if(extra < 10) extra = 10;
+  tmp = NIL_P(cur) ? 0 : bytearray_bytes(state, cur);
+
+  /* Shared data has to be copied anyway, so copy it straight into a
+   * larger ByteArray rather than unsharing it first. Unshared data
+   * always starts at 0. */
+  if(ns+1 > tmp || string_get_shared(self) == Qtrue) {
+    extra = cur_sz / STRING_GROWTH_DIVISOR;
+    if(extra < STRING_MIN_EXTRA) extra = STRING_MIN_EXTRA;
     nd = bytearray_new_dirty(state, ns+extra);
-    object_copy_bytes_into(state, cur, nd, cur_sz, 0);
-    object_copy_bytes_into(state, obs, nd, oth_sz, cur_sz);
     ba = bytearray_byte_address(state, nd);
+    if(cur_sz > 0) memcpy(ba, string_byte_address(state, self), cur_sz);
+    if(oth_sz > 0) memcpy(ba + cur_sz, str, oth_sz);
     string_set_data(self, nd);
+    string_set_start(self, I2N(0));
+    string_set_shared(self, Qnil);
   } else {
-    object_copy_bytes_into(state, obs, cur, oth_sz, cur_sz);
     ba = bytearray_byte_address(state, cur);
+    memmove(ba + cur_sz, str, oth_sz);
   }
   ba[ns] = 0;
   string_set_bytes(self, I2N(ns));
@@ -120,7 +199,7 @@ char *string_byte_address(STATE, OBJECT self) {
     return (char*)"";
   }
 
-  return bytearray_byte_address(state, data);
+  return (char*)bytearray_byte_address(state, data) + string_start(self);
 }
 
 /* Direct pointer to underlying string: handle with care! */
@@ -130,7 +209,16 @@ char* rbx_string_as_cstr(STATE, OBJECT self)
 
   /* Terminator may be incorrect due to explicit length being used usually */
   char* cstr = string_byte_address(state, self);
-  cstr[((size_t)N2I(string_get_bytes(self)))] = '\0';
+  size_t bytes = (size_t)N2I(string_get_bytes(self));
+
+  /* a view's terminator is a byte of the String it shares the data with */
+  if(cstr[bytes] != '\0') {
+    if(string_get_shared(self) == Qtrue) {
+      string_detach(state, self);
+      cstr = string_byte_address(state, self);
+    }
+    cstr[bytes] = '\0';
+  }
 
   return cstr;
 }
@@ -142,7 +230,7 @@ double string_to_double(STATE, OBJECT self) {
   xassert(STRING_P(self));
 
   // We'll modify the buffer, so we need our own copy.
-  ba = bytearray_as_string(state, string_get_data(self));
+  ba = strdup(rbx_string_as_cstr(state, self));
 
   p = ba;
   while (ISSPACE(*p)) p++;
@@ -218,6 +306,7 @@ static OBJECT tr_replace(STATE, OBJECT string, int bytes, unsigned char *str,
     str = bytearray_byte_address(state, ba);
     memset(str, 0, SIZE_OF_BODY(ba));
     string_set_data(string, ba);
+    string_set_start(string, I2N(0));
     string_set_shared(string, Qnil);
   }
 
@@ -292,38 +381,53 @@ OBJECT string_tr_expand(STATE, OBJECT string, OBJECT limit) {
   return tr_replace(state, string, bytes, str, tr, last, steps);
 }
 
-#define HashPrime 16777619
+#define HashMultiplier 0x9e3779b97f4a7c15ULL
 #define MASK_28 (((unsigned int)1<<28)-1)
 
+/* Hashes a word (8 bytes) at a time, then runs the result through the
+ * murmur3 finalizer so every input bit affects the low 28 bits that are
+ * kept. Words are read in host byte order, so the values differ between
+ * big and little endian machines; they are never stored. */
 unsigned int string_hash_str(unsigned char *bp, unsigned int sz) {
   unsigned char *be;
-  unsigned int hv;
+  uint64_t hv, w;
 
   be = bp + sz;
 
-  hv = 0;
+  hv = (uint64_t)sz * HashMultiplier;
+
+  while(be - bp >= 8) {
+    memcpy(&w, bp, 8);
+    hv = (((hv << 5) | (hv >> 59)) ^ w) * HashMultiplier;
+    bp += 8;
+  }
 
-  while(bp < be) {
-    hv *= HashPrime;
-    hv ^= *bp++;
+  if(bp < be) {
+    w = 0;
+    memcpy(&w, bp, be - bp);
+    hv = (((hv << 5) | (hv >> 59)) ^ w) * HashMultiplier;
   }
-  hv = (hv>>28) ^ (hv & MASK_28);
 
-  return hv;
+  hv ^= hv >> 33;
+  hv *= 0xff51afd7ed558ccdULL;
+  hv ^= hv >> 33;
+  hv *= 0xc4ceb9fe1a85ec53ULL;
+  hv ^= hv >> 33;
+
+  return (unsigned int)hv & MASK_28;
 }
 
 unsigned int string_hash_int(STATE, OBJECT self) {
   unsigned char *bp;
   unsigned int sz, h;
-  OBJECT data, hsh;
+  OBJECT hsh;
 
   xassert(STRING_P(self));
-  data = string_get_data(self);
   hsh = string_get_hash(self);
   if(hsh != Qnil) {
     return N2I(hsh);
   }
-  bp = (unsigned char*)bytearray_byte_address(state, data);
+  bp = (unsigned char*)string_byte_address(state, self);
   sz = N2I(string_get_bytes(self));
 
   h = string_hash_str(bp, sz);
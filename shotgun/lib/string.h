@@ -22,6 +22,7 @@ OBJECT string_new(STATE, const char *str);
 OBJECT string_new2(STATE, const char *str, int sz);
 OBJECT string_dup(STATE, OBJECT self);
 OBJECT string_append(STATE, OBJECT self, OBJECT other);
+OBJECT string_append_bytes(STATE, OBJECT self, const char *str, int sz);
 
 char* rbx_string_as_cstr(STATE, OBJECT self);
 char *string_byte_address(STATE, OBJECT self);
@@ -36,8 +37,26 @@ OBJECT string_newfrombstr(STATE, bstring output);
 int string_equal_p(STATE, OBJECT self, OBJECT other);
 OBJECT string_tr_expand(STATE, OBJECT string, OBJECT limit);
 OBJECT string_cstr_overwrite(STATE, OBJECT self, char *str, int len);
+OBJECT string_new_view(STATE, OBJECT self, int start, int count);
+void string_detach_size(STATE, OBJECT self, int size);
+void string_detach(STATE, OBJECT self);
+int string_trim_view_p(STATE, OBJECT self);
+
+/* Offset of a String's first byte in its data. Substrings share their
+ * parent's ByteArray and only differ in start and bytes. */
+#define string_start(self) \
+  (FIXNUM_P(string_get_start(self)) ? N2I(string_get_start(self)) : 0)
+
+/* Views shorter than this are copied instead of sharing the data. */
+#define STRING_VIEW_MIN 24
+
+/* A view kept alive by the mature space doesn't keep its parent's data
+ * alive if it uses less than 1 / STRING_TRIM_RATIO of it and the data is
+ * at least STRING_TRIM_MIN bytes. */
+#define STRING_TRIM_RATIO 4
+#define STRING_TRIM_MIN 4096
 
 #define string_unshare(state, cur) \
-if(string_get_shared(cur) == Qtrue) { string_set_data(cur, bytearray_dup(state, string_get_data(cur))); string_set_shared(cur, Qnil); }
+if(string_get_shared(cur) == Qtrue) { string_detach(state, cur); }
 
 #endif
@@ -209,6 +209,10 @@ OBJECT ffi_function_create(STATE, OBJECT library, OBJECT name, OBJECT args, OBJE
   ret_type = N2I(ret);
 
   ptr = ffi_libffi_generate(state, tot, arg_types, ret_type, handle);
+  if(NIL_P(ptr)) {
+    XFREE(arg_types);
+    return Qnil;
+  }
 
   sym = string_to_sym(state, name);
   func = ffi_function_new(state, ptr, sym, arg_count);
@@ -216,11 +220,11 @@ OBJECT ffi_function_create(STATE, OBJECT library, OBJECT name, OBJECT args, OBJE
   return func;
 }
 
-OBJECT ffi_get_field(char *ptr, int offset, int type) {
+/* Reads the value of the given FFI type at ptr. This backs
+ * MemoryPointer#get_at, and through it FFI::Struct field access, so
+ * reading a field doesn't go through a stub. */
+OBJECT ffi_read_at(STATE, char *ptr, int type) {
   OBJECT ret;
-  STATE = current_machine->s;
-
-  ptr += offset;
 
 #define READ(type) (*((type*)(ptr)))
 
@@ -300,6 +304,9 @@ OBJECT ffi_get_field(char *ptr, int offset, int type) {
     array_set(state, ret, 1, p);
     break;
   }
+  case RBX_FFI_TYPE_CHARARR:
+    ret = string_new(state, ptr);
+    break;
   default:
   case RBX_FFI_TYPE_VOID:
     ret = Qnil;
@@ -309,11 +316,8 @@ OBJECT ffi_get_field(char *ptr, int offset, int type) {
   return ret;
 }
 
-void ffi_set_field(char *ptr, int offset, int type, OBJECT val) {
-  STATE = current_machine->s;
-
-  ptr += offset;
-
+/* Writes val at ptr as a value of the given FFI type. */
+void ffi_write_at(STATE, char *ptr, int type, OBJECT val) {
 #define WRITE(type, val) *((type*)ptr) = (type)val
 
   switch(type) {
@@ -10,6 +10,8 @@ OBJECT ffi_function_create(STATE, OBJECT library, OBJECT name, OBJECT args, OBJE
 
 OBJECT ffi_new_pointer(STATE, void *ptr);
 void ffi_autorelease(OBJECT ptr, int ar);
+OBJECT ffi_read_at(STATE, char *ptr, int type);
+void ffi_write_at(STATE, char *ptr, int type, OBJECT val);
 #define ffi_pointer(ptr) (*DATA_STRUCT(ptr, void**))
 
 #define RBX_FFI_TYPE_OBJECT  0
@@ -7,6 +7,7 @@
 #include "shotgun/lib/symbol.h"
 #include "shotgun/lib/object.h"
 #include "shotgun/lib/string.h"
+#include "shotgun/lib/bytearray.h"
 #include "shotgun/lib/hash.h"
 #include "shotgun/lib/primitive_indexes.h"
 
@@ -18,14 +19,318 @@
 #undef ffi_call
 #include <ffi.h>
 
+/* Room for one argument or return value of any FFI type. */
+union ffi_value {
+  signed char c;
+  unsigned char uc;
+  short s;
+  unsigned short us;
+  int i;
+  unsigned int ui;
+  long l;
+  unsigned long ul;
+  long long ll;
+  unsigned long long ull;
+  float f;
+  double d;
+  void *p;
+  OBJECT o;
+  ffi_arg a;
+};
+
+/* Pops an argument off the stack and converts it for libffi. */
+typedef void (*ffi_arg_conv)(STATE, cpu c, union ffi_value *v);
+/* Pops an argument off the stack and converts it to a word. */
+typedef long (*ffi_word_conv)(STATE, cpu c);
+/* Converts the value a function returned to an object. */
+typedef OBJECT (*ffi_ret_conv)(STATE, union ffi_value *v);
+
+/* Functions with up to this many arguments that are all passed in a word
+ * are called directly, without libffi. */
+#define FFI_MAX_WORD_ARGS 6
+
+typedef long (*ffi_word_fn)();
+
 struct ffi_stub {
   ffi_cif cif;
   int arg_count;
   int *arg_types;
   int ret_type;
   void *ep;
+  /* The conversions for this signature, picked when the stub is made so a
+   * call doesn't have to look at the types again. Only one of convert and
+   * words is used. */
+  ffi_arg_conv *convert;
+  ffi_word_conv *words;
+  ffi_ret_conv ret;
 };
 
+#define POP_INTEGER(type, conv, name) ({ \
+  OBJECT _obj = stack_pop(); \
+  type _v; \
+  if(FIXNUM_P(_obj)) { \
+    _v = (type)N2I(_obj); \
+  } else { \
+    type_assert(_obj, BignumType, "converting to " name); \
+    _v = (type)conv(state, _obj); \
+  } \
+  _v; })
+
+static long pop_char(STATE, cpu c) {
+  OBJECT obj = stack_pop();
+  type_assert(obj, FixnumType, "converting to char");
+  return (signed char)N2I(obj);
+}
+
+static long pop_uchar(STATE, cpu c) {
+  OBJECT obj = stack_pop();
+  type_assert(obj, FixnumType, "converting to unsigned char");
+  return (unsigned char)N2I(obj);
+}
+
+static long pop_short(STATE, cpu c) {
+  return POP_INTEGER(short, bignum_to_i, "short");
+}
+
+static long pop_ushort(STATE, cpu c) {
+  return POP_INTEGER(unsigned short, bignum_to_i, "unsigned short");
+}
+
+static long pop_int(STATE, cpu c) {
+  return POP_INTEGER(int, bignum_to_i, "int");
+}
+
+static long pop_uint(STATE, cpu c) {
+  return POP_INTEGER(unsigned int, bignum_to_i, "unsigned int");
+}
+
+static long pop_long(STATE, cpu c) {
+  if(sizeof(long) == sizeof(long long)) {
+    return POP_INTEGER(long, bignum_to_ll, "long");
+  }
+  return POP_INTEGER(long, bignum_to_i, "long");
+}
+
+static long pop_ulong(STATE, cpu c) {
+  if(sizeof(long) == sizeof(long long)) {
+    return POP_INTEGER(unsigned long, bignum_to_ll, "unsigned long");
+  }
+  return POP_INTEGER(unsigned long, bignum_to_i, "unsigned long");
+}
+
+static long pop_object(STATE, cpu c) {
+  return (long)stack_pop();
+}
+
+/* A ByteArray is passed as the address of its own bytes, without a copy.
+ * The callee must not hold on to it after returning, because the GC is
+ * free to move the ByteArray once the call is over. */
+static long pop_ptr(STATE, cpu c) {
+  OBJECT obj = stack_pop();
+  if(NIL_P(obj)) return 0;
+  if(REFERENCE_P(obj) && obj->obj_type == ByteArrayType) {
+    return (long)bytearray_byte_address(state, obj);
+  }
+  type_assert(obj, MemPtrType, "converting to pointer");
+  return (long)*DATA_STRUCT(obj, void**);
+}
+
+static long pop_string(STATE, cpu c) {
+  OBJECT obj = stack_pop();
+  if(NIL_P(obj)) return 0;
+  return (long)rbx_string_as_cstr(state, obj);
+}
+
+static long pop_state(STATE, cpu c) {
+  return (long)state;
+}
+
+static void conv_char(STATE, cpu c, union ffi_value *v) { v->c = pop_char(state, c); }
+static void conv_uchar(STATE, cpu c, union ffi_value *v) { v->uc = pop_uchar(state, c); }
+static void conv_short(STATE, cpu c, union ffi_value *v) { v->s = pop_short(state, c); }
+static void conv_ushort(STATE, cpu c, union ffi_value *v) { v->us = pop_ushort(state, c); }
+static void conv_int(STATE, cpu c, union ffi_value *v) { v->i = pop_int(state, c); }
+static void conv_uint(STATE, cpu c, union ffi_value *v) { v->ui = pop_uint(state, c); }
+static void conv_long(STATE, cpu c, union ffi_value *v) { v->l = pop_long(state, c); }
+static void conv_ulong(STATE, cpu c, union ffi_value *v) { v->ul = pop_ulong(state, c); }
+static void conv_object(STATE, cpu c, union ffi_value *v) { v->o = stack_pop(); }
+static void conv_ptr(STATE, cpu c, union ffi_value *v) { v->p = (void*)pop_ptr(state, c); }
+static void conv_string(STATE, cpu c, union ffi_value *v) { v->p = (void*)pop_string(state, c); }
+static void conv_state(STATE, cpu c, union ffi_value *v) { v->p = state; }
+
+static void conv_ll(STATE, cpu c, union ffi_value *v) {
+  v->ll = POP_INTEGER(long long, bignum_to_ll, "long long");
+}
+
+static void conv_ull(STATE, cpu c, union ffi_value *v) {
+  v->ull = POP_INTEGER(unsigned long long, bignum_to_ll, "unsigned long long");
+}
+
+static void conv_float(STATE, cpu c, union ffi_value *v) {
+  OBJECT obj = stack_pop();
+  type_assert(obj, FloatType, "converting to float");
+  v->f = (float)FLOAT_TO_DOUBLE(obj);
+}
+
+static void conv_double(STATE, cpu c, union ffi_value *v) {
+  OBJECT obj = stack_pop();
+  type_assert(obj, FloatType, "converting to double");
+  v->d = FLOAT_TO_DOUBLE(obj);
+}
+
+/* Narrow integers come back from libffi widened to an ffi_arg, and from a
+ * direct call in a long; both are read as a long here. */
+static OBJECT ret_char(STATE, union ffi_value *v) { return I2N((signed char)v->l); }
+static OBJECT ret_uchar(STATE, union ffi_value *v) { return UI2N((unsigned char)v->l); }
+static OBJECT ret_short(STATE, union ffi_value *v) { return I2N((short)v->l); }
+static OBJECT ret_ushort(STATE, union ffi_value *v) { return UI2N((unsigned short)v->l); }
+static OBJECT ret_int(STATE, union ffi_value *v) { return I2N((int)v->l); }
+static OBJECT ret_uint(STATE, union ffi_value *v) { return UI2N((unsigned int)v->l); }
+static OBJECT ret_long(STATE, union ffi_value *v) { return I2N(v->l); }
+static OBJECT ret_ulong(STATE, union ffi_value *v) { return UI2N(v->ul); }
+static OBJECT ret_ll(STATE, union ffi_value *v) { return LL2N(v->ll); }
+static OBJECT ret_ull(STATE, union ffi_value *v) { return ULL2N(v->ull); }
+static OBJECT ret_float(STATE, union ffi_value *v) { return float_new(state, (double)v->f); }
+static OBJECT ret_double(STATE, union ffi_value *v) { return float_new(state, v->d); }
+static OBJECT ret_object(STATE, union ffi_value *v) { return v->o; }
+static OBJECT ret_void(STATE, union ffi_value *v) { return Qnil; }
+
+static OBJECT ret_ptr(STATE, union ffi_value *v) {
+  if(v->p == NULL) return Qnil;
+  return ffi_new_pointer(state, v->p);
+}
+
+static OBJECT ret_string(STATE, union ffi_value *v) {
+  if(v->p == NULL) return Qnil;
+  return string_new(state, (char*)v->p);
+}
+
+static OBJECT ret_strptr(STATE, union ffi_value *v) {
+  OBJECT s, p, ret;
+
+  if(v->p == NULL) {
+    s = p = Qnil;
+  } else {
+    p = ffi_new_pointer(state, v->p);
+    s = string_new(state, (char*)v->p);
+  }
+
+  ret = array_new(state, 2);
+  array_set(state, ret, 0, s);
+  array_set(state, ret, 1, p);
+  return ret;
+}
+
+static ffi_word_conv ffi_word_conv_for(int type) {
+  switch(type) {
+  case RBX_FFI_TYPE_CHAR:   return pop_char;
+  case RBX_FFI_TYPE_UCHAR:  return pop_uchar;
+  case RBX_FFI_TYPE_SHORT:  return pop_short;
+  case RBX_FFI_TYPE_USHORT: return pop_ushort;
+  case RBX_FFI_TYPE_INT:    return pop_int;
+  case RBX_FFI_TYPE_UINT:   return pop_uint;
+  case RBX_FFI_TYPE_LONG:   return pop_long;
+  case RBX_FFI_TYPE_ULONG:  return pop_ulong;
+  case RBX_FFI_TYPE_OBJECT: return pop_object;
+  case RBX_FFI_TYPE_PTR:    return pop_ptr;
+  case RBX_FFI_TYPE_STRING: return pop_string;
+  case RBX_FFI_TYPE_STATE:  return pop_state;
+  case RBX_FFI_TYPE_LL:
+    if(sizeof(long) == sizeof(long long)) return pop_long;
+    return NULL;
+  case RBX_FFI_TYPE_ULL:
+    if(sizeof(long) == sizeof(long long)) return pop_ulong;
+    return NULL;
+  default:
+    return NULL;
+  }
+}
+
+static ffi_arg_conv ffi_arg_conv_for(int type) {
+  switch(type) {
+  case RBX_FFI_TYPE_CHAR:   return conv_char;
+  case RBX_FFI_TYPE_UCHAR:  return conv_uchar;
+  case RBX_FFI_TYPE_SHORT:  return conv_short;
+  case RBX_FFI_TYPE_USHORT: return conv_ushort;
+  case RBX_FFI_TYPE_INT:    return conv_int;
+  case RBX_FFI_TYPE_UINT:   return conv_uint;
+  case RBX_FFI_TYPE_LONG:   return conv_long;
+  case RBX_FFI_TYPE_ULONG:  return conv_ulong;
+  case RBX_FFI_TYPE_LL:     return conv_ll;
+  case RBX_FFI_TYPE_ULL:    return conv_ull;
+  case RBX_FFI_TYPE_FLOAT:  return conv_float;
+  case RBX_FFI_TYPE_DOUBLE: return conv_double;
+  case RBX_FFI_TYPE_OBJECT: return conv_object;
+  case RBX_FFI_TYPE_PTR:    return conv_ptr;
+  case RBX_FFI_TYPE_STRING: return conv_string;
+  case RBX_FFI_TYPE_STATE:  return conv_state;
+  default:
+    return NULL;
+  }
+}
+
+static ffi_ret_conv ffi_ret_conv_for(int type) {
+  switch(type) {
+  case RBX_FFI_TYPE_CHAR:   return ret_char;
+  case RBX_FFI_TYPE_UCHAR:  return ret_uchar;
+  case RBX_FFI_TYPE_SHORT:  return ret_short;
+  case RBX_FFI_TYPE_USHORT: return ret_ushort;
+  case RBX_FFI_TYPE_INT:    return ret_int;
+  case RBX_FFI_TYPE_UINT:   return ret_uint;
+  case RBX_FFI_TYPE_LONG:   return ret_long;
+  case RBX_FFI_TYPE_ULONG:  return ret_ulong;
+  case RBX_FFI_TYPE_LL:     return ret_ll;
+  case RBX_FFI_TYPE_ULL:    return ret_ull;
+  case RBX_FFI_TYPE_FLOAT:  return ret_float;
+  case RBX_FFI_TYPE_DOUBLE: return ret_double;
+  case RBX_FFI_TYPE_OBJECT: return ret_object;
+  case RBX_FFI_TYPE_PTR:    return ret_ptr;
+  case RBX_FFI_TYPE_STRING: return ret_string;
+  case RBX_FFI_TYPE_STRPTR: return ret_strptr;
+  default:
+    return ret_void;
+  }
+}
+
+/* True if a function returning type can be called as returning a long. */
+static int ffi_word_return_p(int type) {
+  switch(type) {
+  case RBX_FFI_TYPE_FLOAT:
+  case RBX_FFI_TYPE_DOUBLE:
+    return FALSE;
+  case RBX_FFI_TYPE_LL:
+  case RBX_FFI_TYPE_ULL:
+    return sizeof(long) == sizeof(long long);
+  default:
+    return TRUE;
+  }
+}
+
+/* Picks the conversions for the stub's signature. */
+static void ffi_stub_specialize(struct ffi_stub *stub) {
+  int i, words;
+
+  words = stub->arg_count <= FFI_MAX_WORD_ARGS && ffi_word_return_p(stub->ret_type);
+  for(i = 0; words && i < stub->arg_count; i++) {
+    if(!ffi_word_conv_for(stub->arg_types[i])) words = FALSE;
+  }
+
+  stub->convert = NULL;
+  stub->words = NULL;
+  if(words) {
+    stub->words = ALLOC_N(ffi_word_conv, stub->arg_count + 1);
+    for(i = 0; i < stub->arg_count; i++) {
+      stub->words[i] = ffi_word_conv_for(stub->arg_types[i]);
+    }
+  } else {
+    stub->convert = ALLOC_N(ffi_arg_conv, stub->arg_count + 1);
+    for(i = 0; i < stub->arg_count; i++) {
+      stub->convert[i] = ffi_arg_conv_for(stub->arg_types[i]);
+    }
+  }
+  stub->ret = ffi_ret_conv_for(stub->ret_type);
+}
+
 OBJECT ffi_libffi_generate(STATE, int arg_count, int *arg_types,
     int ret_type, void *func) {
 
@@ -35,6 +340,12 @@ OBJECT ffi_libffi_generate(STATE, int arg_count, int *arg_types,
   struct ffi_stub *stub;
   int i;
 
+  /* void, strptr and char_array can't be passed, and a stub without a
+   * conversion for every argument would call through NULL. */
+  for(i = 0; i < arg_count; i++) {
+    if(!ffi_arg_conv_for(arg_types[i])) return Qnil;
+  }
+
   types = ALLOC_N(ffi_type*, arg_count);
 
   for(i = 0; i < arg_count; i++) {
@@ -147,320 +458,64 @@ OBJECT ffi_libffi_generate(STATE, int arg_count, int *arg_types,
     sassert(status == FFI_OK);
   }
 
+  ffi_stub_specialize(stub);
+
   return ffi_new_pointer(state, stub);
 }
 
+/* Arguments are converted into buffers on the C stack, so a call doesn't
+ * allocate anything but the object it returns. */
 void ffi_call_libffi(STATE, cpu c, OBJECT ptr) {
   struct ffi_stub *stub;
-  void **values;
-  OBJECT obj, ret;
+  union ffi_value result;
   int i;
 
   stub = (struct ffi_stub*)(*DATA_STRUCT(ptr, void**));
 
-  values = ALLOC_N(void*, stub->arg_count);
-  for(i = 0; i < stub->arg_count; i++) {
-    switch(stub->arg_types[i]) {
-    case RBX_FFI_TYPE_CHAR: {
-      char *tmp = (char*)alloca(sizeof(char));
-      obj = stack_pop();
-      type_assert(obj, FixnumType, "converting to char");
-      *tmp = (char)N2I(obj);
-      values[i] = tmp;
-      break;
-    }
-    case RBX_FFI_TYPE_UCHAR: {
-      unsigned char *tmp = (unsigned char*)alloca(sizeof(char));
-      obj = stack_pop();
-      type_assert(obj, FixnumType, "converting to unsigned char");
-      *tmp = (unsigned char)N2I(obj);
-      values[i] = tmp;
-      break;
-    }
-    case RBX_FFI_TYPE_SHORT: {
-      short *tmp = (short*)alloca(sizeof(short));
-      obj = stack_pop();
-      if(FIXNUM_P(obj)) {
-        *tmp = (short)N2I(obj);
-      } else {
-        type_assert(obj, BignumType, "converting to short");
-        *tmp = (short)bignum_to_i(state, obj);
-      }
-      *tmp = (short)N2I(obj);
-      values[i] = tmp;
-      break;
-    }
-    case RBX_FFI_TYPE_USHORT: {
-      unsigned short *tmp = (unsigned short*)alloca(sizeof(short));
-      obj = stack_pop();
-      if(FIXNUM_P(obj)) {
-        *tmp = (unsigned short)N2I(obj);
-      } else {
-        type_assert(obj, BignumType, "converting to unsigned short");
-        *tmp = (unsigned short)bignum_to_i(state, obj);
-      }
-      *tmp = (unsigned short)N2I(obj);
-      values[i] = tmp;
-      break;
-    }
-    case RBX_FFI_TYPE_INT: {
-      int *tmp = (int*)alloca(sizeof(int));
-      obj = stack_pop();
-      if(FIXNUM_P(obj)) {
-        *tmp = (int)N2I(obj);
-      } else {
-        type_assert(obj, BignumType, "converting to int");
-        *tmp = bignum_to_i(state, obj);
-      }
-      values[i] = tmp;
-      break;
-    }
-    case RBX_FFI_TYPE_UINT: {
-      unsigned int *tmp = (unsigned int*)alloca(sizeof(unsigned int));
-      obj = stack_pop();
-      if(FIXNUM_P(obj)) {
-        *tmp = (int)N2I(obj);
-      } else {
-        type_assert(obj, BignumType, "converting to int");
-        *tmp = bignum_to_i(state, obj);
-      }
-      values[i] = tmp;
-      break;
-    }
-    case RBX_FFI_TYPE_LONG: {
-      long *tmp = (long*)alloca(sizeof(long));
-      obj = stack_pop();
-      if(FIXNUM_P(obj)) {
-        *tmp = (long)N2I(obj);
-      } else {
-        type_assert(obj, BignumType, "converting to long");
-        if(sizeof(long) == sizeof(long long)) {
-          *tmp = (long)bignum_to_ll(state, obj);
-        } else {
-          *tmp = bignum_to_i(state, obj);
-        }
-      }
-      values[i] = tmp;
-      break;
-    }
-    case RBX_FFI_TYPE_ULONG: {
-      unsigned long *tmp = (unsigned long*)alloca(sizeof(long));
-      obj = stack_pop();
-      if(FIXNUM_P(obj)) {
-        *tmp = (unsigned long)N2I(obj);
-      } else {
-        type_assert(obj, BignumType, "converting to unsigned long");
-        if(sizeof(long) == sizeof(long long)) {
-          *tmp = (unsigned long)bignum_to_ll(state, obj);
-        } else {
-          *tmp = bignum_to_i(state, obj);
-        }
-      }
-      values[i] = tmp;
-      break;
-    }
-    case RBX_FFI_TYPE_FLOAT: {
-      float *tmp = (float*)alloca(sizeof(float));
-      obj = stack_pop();
-      type_assert(obj, FloatType, "converting to float");
-      *tmp = (float)FLOAT_TO_DOUBLE(obj);
-      values[i] = tmp;
-      break;
+  if(stub->words) {
+    long w[FFI_MAX_WORD_ARGS];
+    ffi_word_fn fn = (ffi_word_fn)stub->ep;
+
+    for(i = 0; i < stub->arg_count; i++) {
+      w[i] = stub->words[i](state, c);
     }
-    case RBX_FFI_TYPE_DOUBLE: {
-      double *tmp = (double*)alloca(sizeof(double));
-      obj = stack_pop();
-      type_assert(obj, FloatType, "converting to double");
-      *tmp = FLOAT_TO_DOUBLE(obj);
-      values[i] = tmp;
+
+    switch(stub->arg_count) {
+    case 0:
+      result.l = (*fn)();
       break;
-    }
-    case RBX_FFI_TYPE_LL: {
-      long long *tmp = (long long*)alloca(sizeof(long long));
-      obj = stack_pop();
-      if(FIXNUM_P(obj)) {
-        *tmp = (long long)N2I(obj);
-      } else {
-        type_assert(obj, BignumType, "converting to unsigned long");
-        *tmp = (long long)bignum_to_ll(state, obj);
-      }
-      values[i] = tmp;
+    case 1:
+      result.l = (*fn)(w[0]);
       break;
-    }
-    case RBX_FFI_TYPE_ULL: {
-      unsigned long long *tmp = (unsigned long long*)alloca(sizeof(long long));
-      obj = stack_pop();
-      if(FIXNUM_P(obj)) {
-        *tmp = (unsigned long long)N2I(obj);
-      } else {
-        type_assert(obj, BignumType, "converting to unsigned long");
-        *tmp = (unsigned long long)bignum_to_ll(state, obj);
-      }
-      values[i] = tmp;
+    case 2:
+      result.l = (*fn)(w[0], w[1]);
       break;
-    }
-    case RBX_FFI_TYPE_STATE:
-      values[i] = &state;
+    case 3:
+      result.l = (*fn)(w[0], w[1], w[2]);
       break;
-    case RBX_FFI_TYPE_OBJECT: {
-      OBJECT *tmp = (OBJECT*)alloca(sizeof(OBJECT));
-      obj = stack_pop();
-      *tmp = obj;
-      values[i] = tmp;
+    case 4:
+      result.l = (*fn)(w[0], w[1], w[2], w[3]);
       break;
-    }
-    case RBX_FFI_TYPE_PTR: {
-      void **tmp = (void**)alloca(sizeof(void*));
-      obj = stack_pop();
-      if(NIL_P(obj)) {
-        *tmp = NULL;
-      } else {
-        type_assert(obj, MemPtrType, "converting to pointer");
-        *tmp = *DATA_STRUCT(obj, void**);
-      }
-      values[i] = tmp;
+    case 5:
+      result.l = (*fn)(w[0], w[1], w[2], w[3], w[4]);
       break;
-    }
-    case RBX_FFI_TYPE_STRING: {
-      char **tmp = (char**)alloca(sizeof(char*));
-      obj = stack_pop();
-      if(NIL_P(obj)) {
-        *tmp = NULL;
-      } else {
-        *tmp = rbx_string_as_cstr(state, obj);
-      }
-      values[i] = tmp;
+    case 6:
+      result.l = (*fn)(w[0], w[1], w[2], w[3], w[4], w[5]);
       break;
     }
-    }
-  }
+  } else {
+    union ffi_value *args = alloca(sizeof(union ffi_value) * stub->arg_count);
+    void **values = alloca(sizeof(void*) * stub->arg_count);
 
-  switch(stub->ret_type) {
-  case RBX_FFI_TYPE_CHAR: {
-    ffi_arg result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = I2N((char)result);
-    break;
-  }
-  case RBX_FFI_TYPE_UCHAR: {
-    ffi_arg result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = UI2N((unsigned char)result);
-    break;
-  }
-  case RBX_FFI_TYPE_SHORT: {
-    ffi_arg result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = I2N((short)result);
-    break;
-  }
-  case RBX_FFI_TYPE_USHORT: {
-    ffi_arg result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = UI2N((unsigned short)result);
-    break;
-  }
-  case RBX_FFI_TYPE_INT: {
-    ffi_arg result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = I2N((int)result);
-    break;
-  }
-  case RBX_FFI_TYPE_UINT: {
-    ffi_arg result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = UI2N((unsigned int)result);
-    break;
-  }
-  case RBX_FFI_TYPE_LONG: {
-    long result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = I2N(result);
-    break;
-  }
-  case RBX_FFI_TYPE_ULONG: {
-    unsigned long result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = UI2N(result);
-    break;
-  }
-  case RBX_FFI_TYPE_FLOAT: {
-    float result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = float_new(state, (double)result); 
-    break;
-  }
-  case RBX_FFI_TYPE_DOUBLE: {
-    double result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = float_new(state, result);
-    break;
-  }
-  case RBX_FFI_TYPE_LL: {
-    long long result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = LL2N(result);
-    break;
-  }
-  case RBX_FFI_TYPE_ULL: {
-    unsigned long long result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = ULL2N(result);
-    break;
-  }
-  case RBX_FFI_TYPE_OBJECT: {
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &ret, values);
-    break;
-  }
-  case RBX_FFI_TYPE_PTR: {
-    void *result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    if(result == NULL) {
-      ret = Qnil;
-    } else {
-      ret = ffi_new_pointer(state, result);
-    }
-    break;
-  }
-  case RBX_FFI_TYPE_STRING: {
-    char* result;
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    if(result == NULL) {
-      ret = Qnil;
-    } else {
-      ret = string_new(state, result);
+    for(i = 0; i < stub->arg_count; i++) {
+      stub->convert[i](state, c, &args[i]);
+      values[i] = &args[i];
     }
-    break;
-  }
-  case RBX_FFI_TYPE_STRPTR: {
-    char* result;
-    OBJECT s, p;
-    
-    ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
 
-    if(result == NULL) {
-      s = p = Qnil;
-    } else {
-      p = ffi_new_pointer(state, result);
-      s = string_new(state, result);
-    }
-    
-    ret = array_new(state, 2);
-    array_set(state, ret, 0, s);
-    array_set(state, ret, 1, p);
-    break;
-  }
-  default:
-  case RBX_FFI_TYPE_VOID: {
-    ffi_arg result;
     ffi_call(&stub->cif, FFI_FN(stub->ep), &result, values);
-    ret = Qnil;
-    break;
-  }
   }
 
-  XFREE(values);
-  stack_push(ret);
+  stack_push(stub->ret(state, &result));
 }
 
 int ffi_get_arg_count(OBJECT ptr)
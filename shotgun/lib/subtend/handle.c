@@ -43,57 +43,50 @@ rni_handle_table *handle_table_new() {
   rni_handle_table *tbl;
   
   tbl = ALLOC(rni_handle_table);
-  tbl->next = 0;
-  tbl->id = 1;
-  tbl->total = 100;
-  tbl->entries = ALLOC_N(rni_ht_entry*, tbl->total);
+  tbl->total = 0;
+  tbl->used = 0;
+  tbl->num_slabs = 0;
+  tbl->slabs = NULL;
+  tbl->free = NULL;
+  tbl->rstructs = ptr_array_new(8);
   return tbl;
 }
 
-rni_handle *handle_allocate() {
-  rni_handle *h;
-  
-  h = ALLOC(rni_handle);
-  h->flags = 0;
-  h->handle_id = 0;
-  h->table_idx = 0;
-  h->data = 0;
-  
-  return h;
+/* Adds a slab of handles to tbl and puts them all on the free list, in
+ * order so the first one is handed out first. */
+static void handle_table_grow(rni_handle_table *tbl) {
+  rni_handle *slab;
+  int i;
+
+  slab = ALLOC_N(rni_handle, HANDLE_SLAB_SIZE);
+  for(i = 0; i < HANDLE_SLAB_SIZE; i++) {
+    slab[i].flags = 0;
+    slab[i].generation = 0;
+    slab[i].object = NULL;
+    slab[i].data = 0;
+    slab[i].next = i + 1 < HANDLE_SLAB_SIZE ? &slab[i + 1] : tbl->free;
+  }
+
+  tbl->slabs = realloc(tbl->slabs, sizeof(rni_handle*) * (tbl->num_slabs + 1));
+  tbl->slabs[tbl->num_slabs++] = slab;
+  tbl->total += HANDLE_SLAB_SIZE;
+  tbl->free = slab;
 }
 
 rni_handle *handle_new(rni_handle_table *tbl, OBJECT obj) {
   rni_handle *h;
-  rni_ht_entry *e;
     
-  /* Create the handle. By default, handles are local only. */
-  h = handle_allocate();
-  h->handle_id = tbl->id++;
-  h->table_idx = tbl->next;
-  
-  /* Create the table entry. */
-  e = ALLOC(rni_ht_entry);
-  e->handle_id = h->handle_id;
-  e->object = obj;
-  e->rh = h;
-  
-  /* Put the entry in the table. */
-  tbl->entries[h->table_idx] = e;
-  
-  /* Move next forward to the next empty slot. */
-  while(tbl->next < tbl->total && tbl->entries[tbl->next]) {
-    tbl->next++;
-  }
-  
-  /* Resize the entries array if it's not big enough. */
-  if(tbl->next == tbl->total) {
-    int s = tbl->total;
-    tbl->total = tbl->total + 25;
-    tbl->entries = realloc(tbl->entries, tbl->total * sizeof(rni_ht_entry*));
-    for(;s < tbl->total; s++) {
-      tbl->entries[s] = NULL;
-    }
-  }
+  if(!tbl->free) handle_table_grow(tbl);
+
+  /* By default, handles are local only. */
+  h = tbl->free;
+  tbl->free = h->next;
+  tbl->used++;
+
+  h->flags = 0;
+  h->object = obj;
+  h->data = 0;
+  h->next = NULL;
   
   return h;
 }
@@ -197,57 +190,41 @@ void check_rstruct_data(STATE, rni_handle_table *tbl, rni_handle *h, OBJECT o) {
   }
 }
 
-/* Check all created handles looking for RStruct data on them. */
+/* Attaches RStruct data to h, to be copied back to its object before the
+ * native method returns. */
+void handle_set_data(rni_handle_table *tbl, rni_handle *h, void *data) {
+  h->data = data;
+  ptr_array_append(tbl->rstructs, (xpointer)h);
+}
+
+/* Check the handles that have been given RStruct data. */
 void check_rstruct_data_in_handles(STATE, rni_handle_table *tbl) {
-  rni_ht_entry *e;
   rni_handle *h;
   int i;
 
-  for(i = 0; i < tbl->total; ++i) {
-    e = tbl->entries[i];
-    if(!e) {
-      continue;
+  for(i = 0; i < ptr_array_length(tbl->rstructs); ++i) {
+    h = (rni_handle*)ptr_array_get_index(tbl->rstructs, i);
+    if(h->object) {
+      check_rstruct_data(state, tbl, h, h->object);
     }
-    h = e->rh;
-    check_rstruct_data(state, tbl, h, e->object);
   }
+  ptr_array_clear(tbl->rstructs);
 }
 
 OBJECT handle_to_object(STATE, rni_handle_table *tbl, rni_handle *h) {
-  rni_ht_entry *e;
-  
   if(!REFERENCE_P((OBJECT)h)) {
     return (OBJECT)h;
   }
   
-  /* Oh! a detached handle! */
-  if(!h->handle_id) {
-    /*
-    if(IS_FLAG(h, STRING_FLAG)) {
-      return _handle_convert_string(state, tbl, h);
-    } else if(IS_FLAG(h, ARRAY_FLAG)) {
-      return _handle_convert_array(state, tbl, h);
-    }
-    */
-    
-    printf("Oh dear!  A detached handle with no data.\n");
-    return Qnil;
-  }
-  
-  e = tbl->entries[h->table_idx];
-  
-  /* Check that the handle and the table entry have the same handle_id.
-     if they don't, someone is using this handle improperly. */
-
-  if(e->handle_id != h->handle_id) {
-    /* ERROR! */
+  /* A released handle. Someone is using this handle improperly. */
+  if(!h->object) {
     abort();
     return Qnil;
   }
   
-  check_rstruct_data(state, tbl, h, e->object);
+  check_rstruct_data(state, tbl, h, h->object);
 
-  return e->object;
+  return h->object;
 }
 
 void handle_make_global(rni_handle *h) {
@@ -262,25 +239,21 @@ int handle_is_global(rni_handle *h) {
   return IS_FLAG(h, GLOBAL_FLAG);
 }
 
+/* Releases h back to tbl, returning the object it referred to. */
 OBJECT handle_remove(rni_handle_table *tbl, rni_handle *h) {
-  rni_ht_entry *e;
-  e = tbl->entries[h->table_idx];
-  
-  if(e->handle_id != h->handle_id) {
+  OBJECT obj;
+
+  obj = h->object;
+  if(!obj) {
     return Qnil;
   }
-  
-  tbl->entries[h->table_idx] = NULL;
-  return e->object;
-}
 
-void handle_delete(rni_handle *h) {
-  /*
-  if(IS_FLAG(h, STRING_FLAG)) {
-    bdestroy((bstring)h->data);
-  } else if(IS_FLAG(h, ARRAY_FLAG)) {
-    ptr_array_free(ptr_array)h->data);
-  }
-  */
-  free(h);
+  h->object = NULL;
+  h->flags = 0;
+  h->generation++;
+  h->next = tbl->free;
+  tbl->free = h;
+  tbl->used--;
+
+  return obj;
 }
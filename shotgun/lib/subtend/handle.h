@@ -1,30 +1,37 @@
+/* Handles are the VALUEs C extensions see for Rubinius objects. They live
+ * in slabs that are never freed or moved, so a handle stays a valid pointer
+ * however many more are made. Released handles go on a free list and are
+ * reused most recently released first. A handle's generation goes up each
+ * time it's released, so a holder that saved it can tell whether the handle
+ * still refers to the same object. */
+
 struct rni_handle {
   int flags;
-  int handle_id;
-  int table_idx;
+  unsigned int generation;
+  OBJECT object;            /* NULL when the handle is free */
   void *data;
+  struct rni_handle *next;  /* next on the free list */
 };
 
 typedef struct rni_handle rni_handle;
 
-struct rni_ht_entry {
-  int handle_id;
-  rni_handle *rh;
-  OBJECT object;
-};
-
-typedef struct rni_ht_entry rni_ht_entry;
+#define HANDLE_SLAB_SIZE 256
 
 struct rni_handle_table {
   int total;
   int used;
-  int id;
-  int next;
-  rni_ht_entry **entries;
+  int num_slabs;
+  rni_handle **slabs;
+  rni_handle *free;
+  ptr_array rstructs;       /* handles that may have RStruct data */
 };
 
 typedef struct rni_handle_table rni_handle_table;
 
+/* The i'th handle of tbl, for 0 <= i < tbl->total. */
+#define handle_table_at(tbl, i) \
+  (&(tbl)->slabs[(i) / HANDLE_SLAB_SIZE][(i) % HANDLE_SLAB_SIZE])
+
 #define AS_STR(handle) ((bstring)(handle->data))
 #define AS_ARY(handle) ((ptr_array)handle->data)
 #define SET_FLAG(ha,fl) ha->flags |= fl
@@ -38,7 +45,7 @@ typedef struct rni_handle_table rni_handle_table;
 rni_handle *handle_new(rni_handle_table *tbl, OBJECT obj);
 int handle_is_global(rni_handle *h);
 OBJECT handle_remove(rni_handle_table *tbl, rni_handle *h);
-void handle_delete(rni_handle *h);
+void handle_set_data(rni_handle_table *tbl, rni_handle *h, void *data);
 OBJECT handle_to_object(STATE, rni_handle_table *tbl, rni_handle *h);
 void handle_make_global(rni_handle *h);
 void handle_clear_global(rni_handle *h);
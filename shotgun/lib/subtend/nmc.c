@@ -4,6 +4,7 @@
 #include "shotgun/lib/string.h"
 #include "shotgun/lib/cpu.h"
 #include "shotgun/lib/methctx.h"
+#include "shotgun/lib/machine.h"
 #include "shotgun/lib/subtend/nmc.h"
 
 /* TODO: replace this static with a pthread local */
@@ -56,6 +57,7 @@ OBJECT nmc_new(STATE, OBJECT nmethod, OBJECT sender, OBJECT recv, OBJECT name, O
   fc->locals = (OBJECT)Qnil;
   fc->argcount = args;
   fc->type = FASTCTX_NMC;
+  fc->prof_entry = -1;
   
   n = nmc_new_standalone();
   sys = nmethod_get_data(nmethod);
@@ -75,7 +77,7 @@ rni_nmc *nmc_new_standalone() {
   
   n->num_handles = 16;
   n->used = 0;
-  n->handles = ALLOC_N(rni_handle*, n->num_handles);
+  n->handles = ALLOC_N(struct rni_nmc_handle, n->num_handles);
   n->system_set = 0;
   n->cont_set = 0;
   n->value = 0;
@@ -84,8 +86,8 @@ rni_nmc *nmc_new_standalone() {
 }
 
 void nmc_enlarge(rni_nmc *n) {  
-  n->num_handles += 8;
-  n->handles = realloc(n->handles, sizeof(rni_handle*) * n->num_handles);
+  n->num_handles *= 2;
+  n->handles = realloc(n->handles, sizeof(struct rni_nmc_handle) * n->num_handles);
 }
 
 rni_handle *nmc_handle_new(rni_nmc *n, rni_handle_table *tbl, OBJECT obj) {
@@ -96,7 +98,9 @@ rni_handle *nmc_handle_new(rni_nmc *n, rni_handle_table *tbl, OBJECT obj) {
   }
   
   h = handle_new(tbl, obj);
-  n->handles[n->used++] = h;
+  n->handles[n->used].handle = h;
+  n->handles[n->used].generation = h->generation;
+  n->used++;
   if(n->used == n->num_handles) {
     nmc_enlarge(n);
   }
@@ -108,14 +112,18 @@ void nmc_cleanup(rni_nmc *nmc, rni_handle_table *tbl) {
   int i;
   rni_handle *h;
 
-  for(i = 0; i < nmc->used; i++) {
-      h = nmc->handles[i];
+  /* Released last to first, so the next call gets the same handles back
+   * in the same order. */
+  for(i = nmc->used - 1; i >= 0; i--) {
+      h = nmc->handles[i].handle;
+      /* Already released, and maybe in use for something else now. */
+      if(h->generation != nmc->handles[i].generation) continue;
+
       /* If all handles are global, don't clean any up. */
       if(nmc->all_global) {
         handle_make_global(h);
       } else if(!handle_is_global(h)) {
         handle_remove(tbl, h);
-        handle_delete(h);
       }
   }
   
@@ -141,24 +149,17 @@ void nmc_delete(rni_nmc *nmc) {
    
 typedef void * VALUE;
 
-void _nmc_start() {
-  rni_nmc *n;
-  struct fast_context *fc;
-  cpu c;
+/* Makes handles for the receiver and arguments of the native method n is
+ * running, and calls it on whichever stack is current. */
+static rni_handle *_nmc_call(STATE, cpu c, rni_nmc *n, struct fast_context *fc) {
   rni_handle *retval, *recv;  
   int i;
   void **args = NULL;
   VALUE *va = NULL;
   rni_handle **handles_used = NULL;
-  STATE;
   
   long *data;
     
-  n =  global_context->nmc;
-  fc = global_context->fc;
-  c =  global_context->cpu;
-  state = global_context->state;
-
   recv = nmc_handle_new(n, global_context->state->handle_tbl, fc->self);
   
   va = NULL;
@@ -272,13 +273,30 @@ void _nmc_start() {
     }
   }
 
-  check_rstruct_data_in_handles(state, global_context->state->handle_tbl);
-
   /*
   if(args) XFREE(args);
   if(va) XFREE(va);
   if(handles_used) XFREE(handles_used);
   */
+
+  return retval;
+}
+
+void _nmc_start() {
+  rni_nmc *n;
+  struct fast_context *fc;
+  cpu c;
+  rni_handle *retval;
+  STATE;
+
+  n =  global_context->nmc;
+  fc = global_context->fc;
+  c =  global_context->cpu;
+  state = global_context->state;
+
+  retval = _nmc_call(state, c, n, fc);
+
+  check_rstruct_data_in_handles(state, global_context->state->handle_tbl);
   
   n->cont_set--;
   n->system_set--;
@@ -294,6 +312,205 @@ void _nmc_start() {
   setcontext(&n->system);
 }
 
+static void _nmc_set_registers(cpu c, OBJECT nmc, struct fast_context *fc) {
+  c->self = fc->self;
+  c->type = fc->type;
+  c->sender = fc->sender;
+  c->argcount = fc->argcount;
+  c->home_context = nmc;
+  c->active_context = nmc;
+}
+
+/* Raises a SegfaultError for a fault in the native method n is running. */
+static void _nmc_segfault(STATE, cpu c, OBJECT nmc, rni_nmc *n, struct fast_context *fc) {
+  char msg[1024];
+  OBJECT cur, tmp;
+  snprintf(msg, sizeof(msg), "Segfault detected in function %p (accessing %p)", 
+      n->method->entry, global_context->fault_address);
+      
+  /* We swap around the active_context so the exception thats created
+     references the NativeMethodContext, but raise_exception doesn't
+     see it so we go directly up. */
+  cur = c->active_context;
+  c->active_context = nmc;
+  tmp = cpu_new_exception(state, c, BASIC_CLASS(exc_segfault), msg);
+  nmc_cleanup(n, state->handle_tbl);
+  n->stack = NULL;
+  nmc_delete(n);
+  fc->opaque_data = NULL;
+  c->active_context = cur;
+  cpu_raise_exception(state, c, tmp);
+}
+
+/* Ends the innermost nested run if a thread waits to return into its
+ * method, by switching to that thread. The current thread is scheduled
+ * to run again unless it is waiting too. */
+static int _nmc_resume_nested(STATE, cpu c, int reschedule) {
+  rni_nmc *n = global_context->nested;
+  OBJECT thr;
+
+  if(!n || !n->waiting) return FALSE;
+
+  thr = handle_to_object(state, state->handle_tbl, n->waiting);
+  n->waiting = NULL;
+
+  if(reschedule) cpu_thread_schedule(state, c->current_thread);
+  cpu_thread_switch(state, c, thr);
+  c->active_context = Qnil;
+  return TRUE;
+}
+
+/* The current thread returned into n, but the nested run n started is
+ * under another thread's, which has to end first. The thread waits in
+ * n's context until _nmc_resume_nested switches back to it. */
+static void _nmc_wait_nested(STATE, cpu c, rni_nmc *n) {
+  _nmc_set_registers(c, n->context, FASTCTX(n->context));
+  n->waiting = nmc_handle_new(n, state->handle_tbl, c->current_thread);
+
+  if(!_nmc_resume_nested(state, c, FALSE)) {
+    cpu_thread_run_best(state, c);
+  }
+}
+
+/* Calls the method on the VM's own stack, which saves allocating a stack
+ * and switching to it and back. rb_raise and the segfault handler jump
+ * back here with siglongjmp instead of setcontext. */
+static void _nmc_run_direct(STATE, cpu c, OBJECT nmc, rni_nmc *n, struct fast_context *fc) {
+  rni_handle *retval;
+  OBJECT tmp;
+  int jump;
+
+  _nmc_set_registers(c, nmc, fc);
+  c->depth++;
+
+  n->context = nmc;
+  n->direct = 1;
+  jump = sigsetjmp(n->direct_env, 0);
+  if(!jump) {
+    retval = _nmc_call(state, c, n, fc);
+    check_rstruct_data_in_handles(state, state->handle_tbl);
+
+    if(n->ignore_return) {
+      n->value = (rni_handle*)Qtrue;
+    } else {
+      n->value = retval;
+    }
+    jump = ALL_DONE;
+  }
+  n->direct = 0;
+
+  /* A call back into Ruby can have moved the context. */
+  nmc = n->context;
+  fc = FASTCTX(nmc);
+
+  switch(jump) {
+  case RAISED_EXCEPTION:
+    tmp = handle_to_object(state, state->handle_tbl, n->value);
+    nmc_cleanup(n, state->handle_tbl);
+    nmc_delete(n);
+    fc->opaque_data = NULL;
+    cpu_raise_exception(state, c, tmp);
+    break;
+
+  case SEGFAULT_DETECTED:
+    _nmc_segfault(state, c, nmc, n, fc);
+    break;
+
+  default:
+    tmp = handle_to_object(state, state->handle_tbl, n->value);
+    nmc_cleanup(n, state->handle_tbl);
+    cpu_simple_return(state, c, tmp);
+    nmc_delete(n);
+    fc->opaque_data = NULL;
+  }
+
+  global_context->nmc = NULL;
+  global_context->fc =  NULL;
+
+  /* Another thread may have been held up returning into the method of
+   * the nested run this one ran on top of. */
+  _nmc_resume_nested(state, c, TRUE);
+}
+
+/* rb_funcall and rb_call_super for a method running directly. Without a
+ * stack of its own to switch away from, the interpreter is run from here
+ * until the call returns, which nmc_activate sees via n->direct.
+ *
+ * Other threads keep running meanwhile, and may call back into Ruby from
+ * methods of their own, so nested runs stack up on the C stack. Only the
+ * innermost can end; a thread returning into the method of one under it
+ * waits in _nmc_wait_nested until the ones on top are done. */
+rni_handle *nmc_call_nested(rni_nmc *n, OBJECT recv, OBJECT symbol, int args, int super) {
+  STATE;
+  cpu c;
+  OBJECT ctx;
+  IP_TYPE **ip_ptr;
+  ucontext_t firesuit;
+
+  state = global_context->state;
+  c = global_context->cpu;
+
+  /* Later calls of it get their own stack, which is cheaper than this. */
+  n->method->mode = NMETHOD_REENTERS;
+
+  ctx = c->active_context;
+  if(super) {
+    cpu_send_super(state, c, recv, symbol, args, (OBJECT)Qnil);
+  } else {
+    cpu_send(state, c, recv, symbol, args, (OBJECT)Qnil);
+  }
+
+  /* No new context means the send is done, and the value is on the stack. */
+  if(c->active_context == ctx) {
+    return nmc_handle_new(n, state->handle_tbl, cpu_stack_pop(state, c));
+  }
+
+  ip_ptr = c->ip_ptr;
+  firesuit = current_machine->g_firesuit;
+  n->nested_outer = global_context->nested;
+  global_context->nested = n;
+
+  cpu_run(state, c, 0);
+
+  global_context->nested = n->nested_outer;
+  current_machine->g_firesuit = firesuit;
+  c->ip_ptr = ip_ptr;
+
+  global_context->state = state;
+  global_context->cpu = c;
+  global_context->nmc = n;
+  global_context->fc = FASTCTX(n->context);
+  _nmc_set_registers(c, n->context, global_context->fc);
+
+  if(n->direct_raised) {
+    n->direct_raised = 0;
+    siglongjmp(n->direct_env, RAISED_EXCEPTION);
+  }
+
+  return n->value;
+}
+
+/* Called by cpu_raise_exception for each native method context it unwinds
+ * to. If the method there runs directly, the exception ends the nested run
+ * of the interpreter in nmc_call_nested and is raised again from the
+ * method's rb_funcall. */
+int nmc_unwind_direct(STATE, cpu c, OBJECT exc) {
+  rni_nmc *n;
+
+  n = (rni_nmc*)FASTCTX(c->active_context)->opaque_data;
+  if(!n || !n->direct) return FALSE;
+
+  n->context = c->active_context;
+  n->value = nmc_handle_new(n, state->handle_tbl, exc);
+  n->direct_raised = 1;
+  if(n == global_context->nested) {
+    c->active_context = Qnil;
+  } else {
+    _nmc_wait_nested(state, c, n);
+  }
+  return TRUE;
+}
+
 void nmc_activate(STATE, cpu c, OBJECT nmc, OBJECT val, int reraise) {
   int travel;
   rni_nmc *n;
@@ -307,6 +524,24 @@ void nmc_activate(STATE, cpu c, OBJECT nmc, OBJECT val, int reraise) {
   global_context->cpu = c;
   global_context->nmc = n;
   global_context->fc = fc;
+
+  /* Returned into from a call made by a method running directly, so the
+   * nested run of the interpreter in nmc_call_nested is done. */
+  if(n->direct) {
+    n->context = nmc;
+    n->value = nmc_handle_new(n, state->handle_tbl, val);
+    if(n == global_context->nested) {
+      c->active_context = Qnil;
+    } else {
+      _nmc_wait_nested(state, c, n);
+    }
+    return;
+  }
+
+  if(n->method->mode == NMETHOD_DIRECT) {
+    _nmc_run_direct(state, c, nmc, n, fc);
+    return;
+  }
       
   /* Reraise indicates that this request to activate is actually
      because an exception is trying to propagate up. Currently,
@@ -324,12 +559,7 @@ void nmc_activate(STATE, cpu c, OBJECT nmc, OBJECT val, int reraise) {
   
   /* If we haven't traveled yet, call the method. */
   if(!travel) {
-    c->self = fc->self;
-    c->type = fc->type;
-    c->sender = fc->sender;
-    c->argcount = fc->argcount;
-    c->home_context = nmc;
-    c->active_context = nmc;
+    _nmc_set_registers(c, nmc, fc);
     c->depth++;
     
     /* Oh! It's already running, lets reactivate it. */
@@ -381,6 +611,7 @@ void nmc_activate(STATE, cpu c, OBJECT nmc, OBJECT val, int reraise) {
       // n->setup_context++;
       /* With call method, the rb_funcall shim pushs the arguments
          on the stack already, so we just have to perform the send. */
+      n->method->mode = NMETHOD_REENTERS;
       t2 = c->active_context;
       tmp = handle_to_object(state, state->handle_tbl, n->value);
       cpu_send(state, c, tmp, n->symbol, n->args, (OBJECT)Qnil);
@@ -408,6 +639,7 @@ void nmc_activate(STATE, cpu c, OBJECT nmc, OBJECT val, int reraise) {
 
     case CALL_SUPER_METHOD:
       /* As per CALL_METHOD, but we want to call cpu_send_super instead. */
+      n->method->mode = NMETHOD_REENTERS;
       t2 = c->active_context;
       tmp = handle_to_object(state, state->handle_tbl, n->value);
       cpu_send_super(state, c, tmp, n->symbol, n->args, (OBJECT)Qnil);
@@ -432,32 +664,19 @@ void nmc_activate(STATE, cpu c, OBJECT nmc, OBJECT val, int reraise) {
         assert(0 && "Should never get here!");
       }
     case SEGFAULT_DETECTED:
-      {
-        char msg[1024];
-        OBJECT cur;
-        snprintf(msg, sizeof(msg), "Segfault detected in function %p (accessing %p)", 
-            n->method->entry, global_context->fault_address);
-            
-        /* We swap around the active_context so the exception thats created
-           references the NativeMethodContext, but raise_exception doesn't
-           see it so we go directly up. */
-        cur = c->active_context;
-        c->active_context = nmc;
-        tmp = cpu_new_exception(state, c, BASIC_CLASS(exc_segfault), msg);
-        nmc_cleanup(n, state->handle_tbl);
-        n->stack = NULL;
-        nmc_delete(n);
-        fc->opaque_data = NULL;
-        c->active_context = cur;
-        cpu_raise_exception(state, c, tmp);
-        return;
-      }
+      _nmc_segfault(state, c, nmc, n, fc);
+      return;
       
     case ALL_DONE:
       /* Push the return value onto the stack. */
       tmp = handle_to_object(global_context->state, global_context->state->handle_tbl, n->value);
       nmc_cleanup(n, state->handle_tbl);
       n->stack = NULL;
+      /* It returned without calling back into Ruby, so call it directly
+       * from now on. */
+      if(n->method->mode == NMETHOD_LEARN) {
+        n->method->mode = NMETHOD_DIRECT;
+      }
       cpu_simple_return(state, c, tmp);
       nmc_delete(n);
       fc->opaque_data = NULL;
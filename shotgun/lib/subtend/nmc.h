@@ -4,11 +4,18 @@
 
 #include "shotgun/lib/cpu.h"
 #include "shotgun/lib/subtend/nmethod.h"
+/* A handle made for a native method context, and its generation then. It
+ * is only released when the context finishes if it hasn't been since. */
+struct rni_nmc_handle {
+  rni_handle *handle;
+  unsigned int generation;
+};
+
 /* Rubinius native interface: native method context */
 struct rni_nmc {
   int num_handles;
   int used;
-  rni_handle **handles;
+  struct rni_nmc_handle *handles;
   native_method *method;
   rni_handle *value;
   int args;
@@ -34,6 +41,20 @@ struct rni_nmc {
   int stack_size;
 
   void *local_data;
+
+  /* Set while the method runs on the VM's stack. The native method
+   * context it runs in is kept in context, as it moves when a call back
+   * into Ruby runs a collection. */
+  int direct;
+  int direct_raised;
+  OBJECT context;
+  sigjmp_buf direct_env;
+
+  /* While a call back into Ruby runs the interpreter from nmc_call_nested,
+   * the method whose nested run is under this one's, and the thread that
+   * waits to return into this method until the runs on top are done. */
+  struct rni_nmc *nested_outer;
+  rni_handle *waiting;
 };
 
 typedef struct rni_nmc rni_nmc;
@@ -44,6 +65,8 @@ struct rni_context {
   rni_nmc *nmc;
   struct fast_context *fc;
   void *fault_address;
+  /* the method of the innermost nested run, see nmc_call_nested */
+  rni_nmc *nested;
 };
 
 typedef struct rni_context rni_context;
@@ -55,6 +78,8 @@ void nmc_activate(STATE, cpu c, OBJECT nmc, OBJECT val, int reraise);
 OBJECT nmc_new(STATE, OBJECT nmethod, OBJECT sender, OBJECT recv, OBJECT name, OBJECT block, int args);
 void _nmc_save_stack(rni_nmc *nmc, unsigned long *bottom, unsigned long *top);
 rni_handle *nmc_handle_new(rni_nmc *n, rni_handle_table *tbl, OBJECT obj);
+rni_handle *nmc_call_nested(rni_nmc *n, OBJECT recv, OBJECT symbol, int args, int super);
+int nmc_unwind_direct(STATE, cpu c, OBJECT exc);
 
 #define CALL_METHOD 1
 #define CLEANUP 2
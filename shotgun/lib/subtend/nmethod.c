@@ -23,6 +23,7 @@ OBJECT nmethod_new(STATE, OBJECT mod, const char *file, const char *name, void *
 
   sys_nm->entry = func;
   sys_nm->args = args;
+  sys_nm->mode = NMETHOD_LEARN;
 
   nm = nmethod_allocate(state);
   cmethod_set_primitive(nm, I2N(CPU_PRIMITIVE_NMETHOD_CALL));
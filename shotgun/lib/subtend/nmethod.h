@@ -10,8 +10,17 @@ struct native_method {
   void *entry;
   int args;
   nm_stub_ffi stub;
+  int mode;
 };
 
+/* How a native method is called. A method starts out on a stack of its own
+ * (NMETHOD_LEARN). Once a call returns without calling back into Ruby it is
+ * called on the VM's stack instead (NMETHOD_DIRECT), and when a call does
+ * call back it goes back to its own stack for good (NMETHOD_REENTERS). */
+#define NMETHOD_LEARN 0
+#define NMETHOD_DIRECT 1
+#define NMETHOD_REENTERS 2
+
 typedef struct native_method native_method;
 OBJECT nmethod_new(STATE, OBJECT mod, const char *file, const char *name, void *func, int args);
 #define NMETHOD_FIELDS 7
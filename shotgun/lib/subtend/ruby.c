@@ -3,6 +3,8 @@
 #include "shotgun/lib/shotgun.h"
 #include "shotgun/lib/symbol.h"
 #include "shotgun/lib/string.h"
+#include "shotgun/lib/array.h"
+#include "shotgun/lib/bytearray.h"
 #include "shotgun/lib/hash.h"
 #include "shotgun/lib/class.h"
 #include "shotgun/lib/module.h"
@@ -187,6 +189,11 @@ static VALUE _push_and_call(VALUE recv, ID meth, int args, VALUE *ary) {
   }
   
   n = ctx->nmc;
+
+  if(n->direct) {
+    tmp = handle_to_object(ctx->state, ctx->state->handle_tbl, AS_HNDL(recv));
+    return (VALUE)nmc_call_nested(n, tmp, (OBJECT)meth, args, FALSE);
+  }
   
   n->value = AS_HNDL(recv);
   n->symbol = (OBJECT)meth;
@@ -328,6 +335,10 @@ VALUE rb_call_super(int nargs, VALUE *args) {
 
   n = ctx->nmc;
 
+  if(n->direct) {
+    return (VALUE)nmc_call_nested(n, ctx->fc->self, (OBJECT)meth, nargs, TRUE);
+  }
+
   n->value = nmc_handle_new(ctx->nmc, ctx->state->handle_tbl, ctx->fc->self);
   n->symbol = (OBJECT)meth;
   n->args = nargs;
@@ -628,7 +639,7 @@ RFloat *RFLOAT(VALUE obj) {
   if (!ret) {
     ret = ALLOC(RFloat);
     ret->value = *((double*)BYTES_OF(HNDL(obj)));
-    AS_HNDL(obj)->data = (void*)ret;
+    handle_set_data(ctx->state->handle_tbl, AS_HNDL(obj), (void*)ret);
   }
   return ret;
 }
@@ -725,27 +736,36 @@ VALUE rb_ary_entry(VALUE array, int offset) {
 }
 
 VALUE rb_ary_clear(VALUE array) {
-  return rb_funcall2(array, rb_intern("clear"), 0, NULL);
+  CTX;
+  array_clear(ctx->state, HNDL(array));
+  return array;
 }
 
 VALUE rb_ary_dup(VALUE array) {
-  return rb_funcall2(array, rb_intern("dup"), 0, NULL);
+  CTX;
+  return NEW_HANDLE(ctx, array_dup(ctx->state, HNDL(array)));
 }
 
 VALUE rb_ary_join(VALUE array1, VALUE array2) {
   return rb_funcall(array1, rb_intern("join"), 1, array2);
 }
 
+/* Like MRI's, this reverses the array in place. */
 VALUE rb_ary_reverse(VALUE array) {
-  return rb_funcall(array, rb_intern("reverse"), 0);
+  CTX;
+  array_reverse(ctx->state, HNDL(array));
+  return array;
 }
 
 VALUE rb_ary_unshift(VALUE array, VALUE val) {
-  return rb_funcall2(array, rb_intern("unshift"), 1, &val);
+  CTX;
+  array_unshift(ctx->state, HNDL(array), HNDL(val));
+  return array;
 }
 
 VALUE rb_ary_shift(VALUE array) {
-  return rb_funcall2(array, rb_intern("shift"), 0, NULL);
+  CTX;
+  return NEW_HANDLE(ctx, array_shift(ctx->state, HNDL(array)));
 }
 
 void rb_ary_store(VALUE array, int offset, VALUE val) {
@@ -786,7 +806,7 @@ RArray* RARRAY(VALUE arg) {
   if(!ret) {
     ret = ALLOC(RArray);
     fill_rarray_helper(ctx, ret, arg);
-    AS_HNDL(arg)->data = (void *)ret;
+    handle_set_data(ctx->state->handle_tbl, AS_HNDL(arg), (void*)ret);
   }
   return ret;
 }
@@ -815,8 +835,7 @@ VALUE rb_str_dup(VALUE str) {
 }
 
 VALUE rb_str_buf_cat(VALUE str, const char *ptr, long len) {
-  CTX;
-  return NEW_HANDLE(ctx, string_append(ctx->state, HNDL(str), string_new2(ctx->state, ptr, len)));
+  return rb_str_cat(str, ptr, len);
 }
 
 VALUE rb_str_buf_cat2(VALUE str, const char *ptr) {
@@ -825,10 +844,17 @@ VALUE rb_str_buf_cat2(VALUE str, const char *ptr) {
 
 VALUE rb_str_buf_new(long capa)
 {
-  /* Rubinius does not yet support strings with capacities different
-   * from their length, so just return an empty string.
-   */
-  return rb_str_new2("");
+  CTX;
+  STATE;
+  OBJECT str;
+
+  state = ctx->state;
+  /* An empty String with room for capa bytes before it has to grow. */
+  str = string_new2(state, NULL, 0);
+  if(capa > 0) {
+    string_set_data(str, bytearray_new(state, capa + 1));
+  }
+  return NEW_HANDLE(ctx, str);
 }
 
 VALUE rb_str_buf_append(VALUE str, VALUE str2) {
@@ -837,12 +863,16 @@ VALUE rb_str_buf_append(VALUE str, VALUE str2) {
 
 VALUE rb_str_append(VALUE str, VALUE str2) {
   CTX;
-  return NEW_HANDLE(ctx, string_append(ctx->state, HNDL(str), HNDL(str2)));
+  string_append(ctx->state, HNDL(str), HNDL(str2));
+  return str;
 }
 
 VALUE rb_str_cat(VALUE str, const char *ptr, long len) {
+  CTX;
   if(len < 0) rb_raise(rb_eArgError, "negative string size (or size too big)");
-  return rb_funcall(str, rb_intern("+"), 1, rb_str_new(ptr, len));
+  if(len > INT_MAX) rb_raise(rb_eArgError, "string size too big");
+  string_append_bytes(ctx->state, HNDL(str), ptr, (int)len);
+  return str;
 }
 
 VALUE rb_str_cat2(VALUE str, const char *ptr) {
@@ -892,7 +922,19 @@ VALUE rb_str_plus(VALUE str1, VALUE str2) {
 }
 
 int rb_str_cmp(VALUE str1, VALUE str2) {
-  return NUM2INT(rb_funcall(str1, rb_intern("<=>"), 1, str2));
+  CTX;
+  OBJECT s1, s2;
+  int len1, len2, ret;
+
+  s1 = HNDL(str1);
+  s2 = HNDL(str2);
+  len1 = N2I(string_get_bytes(s1));
+  len2 = N2I(string_get_bytes(s2));
+
+  ret = memcmp(string_byte_address(ctx->state, s1),
+               string_byte_address(ctx->state, s2), len1 < len2 ? len1 : len2);
+  if(ret == 0) ret = len1 - len2;
+  return ret < 0 ? -1 : ret > 0;
 }
 
 VALUE rb_str_split(VALUE str, const char *sep) {
@@ -910,7 +952,21 @@ VALUE rb_cstr2inum(const char *str, int base) {
 }
 
 VALUE rb_str_substr(VALUE str, long beg, long len) {
-  return rb_funcall(str,  rb_intern("substring"), 2, INT2NUM(beg), INT2NUM(len));
+  CTX;
+  OBJECT self;
+  long total;
+
+  self = HNDL(str);
+  total = N2I(string_get_bytes(self));
+
+  if(len < 0 || beg > total) return Qnil;
+  if(beg < 0) {
+    beg += total;
+    if(beg < 0) return Qnil;
+  }
+  if(len > total - beg) len = total - beg;
+
+  return NEW_HANDLE(ctx, string_new_view(ctx->state, self, beg, len));
 }
 
 char *StringValuePtr(VALUE str) {
@@ -950,14 +1006,22 @@ VALUE rb_String(VALUE val) {
 
 RString* RSTRING(VALUE arg) {
   RString *ret;
+  OBJECT str;
   CTX;
 
   ret = (RString *)AS_HNDL(arg)->data;
   if(!ret) {
+    str = HNDL(arg);
+    /* C code may write through ptr, so it can't point into bytes that
+       another String shares */
+    if(string_get_shared(str) == (OBJECT)Qtrue) {
+      string_detach(ctx->state, str);
+    }
+
     ret = ALLOC(RString);
-    ret->ptr = rbx_string_as_cstr(ctx->state, HNDL(arg));
+    ret->ptr = rbx_string_as_cstr(ctx->state, str);
     ret->len = strlen(ret->ptr);
-    AS_HNDL(arg)->data = (void *)ret;
+    handle_set_data(ctx->state->handle_tbl, AS_HNDL(arg), (void*)ret);
   }
   return ret;
 }
@@ -990,8 +1054,8 @@ RHash* RHASH(VALUE obj) {
   if (!ret) {
     STATE;
     OBJECT hsh = HNDL(obj);
-    int i, bins;
-    OBJECT values, entry, key, value;
+    int i, used;
+    OBJECT key, value;
     
     (void)state; /* Stop complaining about unused variable, it's used below */
 
@@ -999,22 +1063,17 @@ RHash* RHASH(VALUE obj) {
     ret->tbl = st_init_table(&objhash);
     
     /* Now, let's copy the data from Rubinius */
-    bins = N2I(hash_get_bins(hsh));
-    values = hash_get_values(hsh);
+    used = N2I(hash_get_used(hsh));
     
-    for (i = 0; i < bins; i++) {
-      entry = tuple_at(state, values, i);
-      
-      while ((VALUE)entry != Qnil) {
-        key = tuple_at(state, entry, 1);
-        value = tuple_at(state, entry, 2);
-        st_insert(ret->tbl, NEW_HANDLE(ctx, key), NEW_HANDLE(ctx, value));
-        
-        entry = tuple_at(state, entry, 3); /* Get the next entry in bin */
-      }
+    for (i = 0; i < used; i++) {
+      if ((VALUE)hash_entry_hash(state, hsh, i) == Qnil) continue; /* removed */
+
+      key = hash_entry_key(state, hsh, i);
+      value = hash_entry_value(state, hsh, i);
+      st_insert(ret->tbl, NEW_HANDLE(ctx, key), NEW_HANDLE(ctx, value));
     }
 
-    AS_HNDL(obj)->data = (void*)ret;
+    handle_set_data(ctx->state->handle_tbl, AS_HNDL(obj), (void*)ret);
   }
   return ret;
 }
@@ -1059,6 +1118,9 @@ void rb_raise(VALUE exc, const char *fmt, ...) {
   va_end(args);
   
   ctx->nmc->value = AS_HNDL(NEW_HANDLE(ctx, cpu_new_exception(ctx->state, ctx->cpu, HNDL(exc), buf)));
+  if(ctx->nmc->direct) {
+    siglongjmp(ctx->nmc->direct_env, RAISED_EXCEPTION);
+  }
   ctx->nmc->jump_val = RAISED_EXCEPTION;
   setcontext(&ctx->nmc->system);
 }
@@ -1152,6 +1214,8 @@ void rb_str_flush_char_ptr(VALUE arg, char* ptr) {
   OBJECT str = HNDL(arg);
   OBJECT new_string = string_new(ctx->state, ptr);
   string_set_data(str, string_get_data(new_string));
+  string_set_start(str, I2N(0));
+  string_set_shared(str, (OBJECT)Qnil);
   // XXX This free may be resulting in double frees.
   XFREE(ptr);
 }
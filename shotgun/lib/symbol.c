@@ -1,6 +1,9 @@
+#include <string.h>
+#include <stdint.h>
+
 #include "shotgun/lib/shotgun.h"
 #include "shotgun/lib/tuple.h"
-#include "shotgun/lib/hash.h"
+#include "shotgun/lib/bytearray.h"
 #include "shotgun/lib/string.h"
 #include "shotgun/lib/symbol.h"
 
@@ -8,6 +11,11 @@
 #define Increments 32
 
 /*
+ * Symbols are interned through @index, an open addressed table kept in a
+ * ByteArray. Each slot holds the hash of a symbol's string and the
+ * symbol's index + 1 (0 for an empty slot). The string itself lives in
+ * the @symbols Tuple, so a hit only needs the hash compare and a memcmp,
+ * and nothing is allocated unless the symbol is new.
  *
  * The case that prompted code the symbol table to check the key value.
  * str:  __uint_fast64_t
@@ -15,16 +23,112 @@
  *
  * str:  TkIF_MOD
  * hash: 112644932
- */ 
+ */
+
+struct intern_slot {
+  uint32_t hash;
+  uint32_t sym;
+};
+
+#define intern_slots(index) ((struct intern_slot*)bytearray_byte_address(state, index))
+
+/* A ByteArray can be a word longer than asked for, so round down to the
+ * power of two the index was created with. */
+#define intern_bins(index) \
+  (1U << (31 - __builtin_clz((unsigned int)(bytearray_bytes(state, index) / sizeof(struct intern_slot)))))
+
+static OBJECT intern_index_new(STATE, unsigned int bins) {
+  return bytearray_new(state, bins * sizeof(struct intern_slot));
+}
 
 OBJECT symtbl_new(STATE) {
   OBJECT tbl;
   tbl = symtbl_allocate(state);
   symtbl_set_symbols(tbl, tuple_new(state, StartSize));
-  symtbl_set_strings(tbl, hash_new_sized(state, StartSize));
+  symtbl_set_index(tbl, intern_index_new(state, StartSize * 2));
+  symtbl_set_entries(tbl, I2N(0));
   return tbl;
 }
 
+/* Returns the slot holding the symbol for the size bytes at str, or the
+ * empty slot it would go in. Doesn't allocate. */
+static struct intern_slot *intern_find(STATE, OBJECT self, unsigned int hash,
+                                       const char *str, int size) {
+  OBJECT index, syms, key;
+  struct intern_slot *slots;
+  unsigned int mask, bin;
+
+  index = symtbl_get_index(self);
+  syms = symtbl_get_symbols(self);
+  slots = intern_slots(index);
+  mask = intern_bins(index) - 1;
+
+  for(bin = hash & mask; slots[bin].sym; bin = (bin + 1) & mask) {
+    if(slots[bin].hash != hash) continue;
+
+    key = tuple_at(state, syms, slots[bin].sym - 1);
+    if(N2I(string_get_bytes(key)) == size &&
+       !memcmp(string_byte_address(state, key), str, size)) break;
+  }
+
+  return &slots[bin];
+}
+
+/* Moves the slots into an index twice the size. */
+static void intern_grow(STATE, OBJECT self) {
+  OBJECT old, index;
+  struct intern_slot *from, *to;
+  unsigned int i, bins, mask, bin;
+
+  old = symtbl_get_index(self);
+  bins = intern_bins(old) * 2;
+  index = intern_index_new(state, bins);
+
+  from = intern_slots(old);
+  to = intern_slots(index);
+  mask = bins - 1;
+
+  for(i = 0; i < bins / 2; i++) {
+    if(!from[i].sym) continue;
+    for(bin = from[i].hash & mask; to[bin].sym; bin = (bin + 1) & mask) ;
+    to[bin] = from[i];
+  }
+
+  symtbl_set_index(self, index);
+}
+
+/* Adds string, which isn't in the table yet, as a new symbol. */
+static OBJECT intern_add(STATE, OBJECT self, OBJECT string, unsigned int hash) {
+  OBJECT syms, ns;
+  struct intern_slot *slot;
+  unsigned int idx, sz;
+
+  idx = N2I(symtbl_get_entries(self));
+  syms = symtbl_get_symbols(self);
+  sz = tuple_fields(state, syms);
+  if(idx == sz) {
+    ns = tuple_new(state, sz + Increments);
+    object_copy_fields_from(state, syms, ns, 0, sz);
+    symtbl_set_symbols(self, ns);
+    syms = ns;
+  }
+
+  /* keep the index at most half full, so probes stay short */
+  if((idx + 1) * 2 > intern_bins(symtbl_get_index(self))) {
+    intern_grow(state, self);
+  }
+
+  tuple_put(state, syms, idx, string);
+  symtbl_set_entries(self, I2N(idx + 1));
+
+  slot = intern_find(state, self, hash, string_byte_address(state, string),
+                     N2I(string_get_bytes(string)));
+  slot->hash = hash;
+  slot->sym = idx + 1;
+
+  return symbol_from_index(state, idx);
+}
+
 OBJECT symtbl_lookup_cstr(STATE, OBJECT self, const char *str) {
   return symtbl_lookup_str_with_size(state, self, str, strlen(str));
 }
@@ -32,59 +136,25 @@ OBJECT symtbl_lookup_cstr(STATE, OBJECT self, const char *str) {
 OBJECT symtbl_lookup_str_with_size(STATE, OBJECT self,
                                    const char *str, int size) {
   unsigned int hash;
-  OBJECT strs, idx, syms, ent;
+  struct intern_slot *slot;
 
   hash = string_hash_str_with_size(state, str, size);
-  strs = symtbl_get_strings(self);
-  syms = symtbl_get_symbols(self);
-  
-  ent = hash_find_entry(state, strs, hash);
-  
-  /* If it wasn't present, use the longer, more correct version. */
-  if(NIL_P(ent) || ent == Qundef) {
-    return symtbl_lookup(state, self, string_new2(state, str, size));
-  } else {
-    OBJECT key = tuple_at(state, ent, 1);
-    char *cur = rbx_string_as_cstr(state, key);
-
-    /* Check that this is actually the right string. */
-    if(size != N2I(string_get_bytes(key)) || strncmp(cur, str, size)) {
-      return symtbl_lookup(state, self, string_new2(state, str, size));
-    }
-
-    idx = tuple_at(state, ent, 2);
-  }
-  
-  return symbol_from_index(state, N2I(idx));
+  slot = intern_find(state, self, hash, str, size);
+  if(slot->sym) return symbol_from_index(state, slot->sym - 1);
+
+  return intern_add(state, self, string_new2(state, str, size), hash);
 }
 
 OBJECT symtbl_lookup(STATE, OBJECT self, OBJECT string) {
-  unsigned int hash, sz;
-  OBJECT idx, strs, syms, ns, obj;
-  
+  unsigned int hash;
+  struct intern_slot *slot;
+
   hash = string_hash_int(state, string);
-  strs = symtbl_get_strings(self);
-  syms = symtbl_get_symbols(self);
-  
- 
-  idx = Qnil;
-
-  if(!hash_lookup2(state, string_equal_p, strs, string, hash, &idx)) {
-    idx = hash_get_entries(strs);
-    sz = tuple_fields(state, syms);
-    if(N2I(idx) == sz) {
-      ns = tuple_new(state, sz + Increments);
-      object_copy_fields_from(state, syms, ns, 0, sz);
-      symtbl_set_symbols(self, ns);
-      syms = ns;
-    }
-
-    tuple_put(state, syms, N2I(idx), string);
-    hash_assign(state, string_equal_p, strs, string, hash, idx);
-  }
+  slot = intern_find(state, self, hash, string_byte_address(state, string),
+                     N2I(string_get_bytes(string)));
+  if(slot->sym) return symbol_from_index(state, slot->sym - 1);
 
-  obj = symbol_from_index(state, N2I(idx));
-  return obj;
+  return intern_add(state, self, string, hash);
 }
 
 OBJECT symbol_to_string(STATE, OBJECT self) {
@@ -94,7 +164,7 @@ OBJECT symbol_to_string(STATE, OBJECT self) {
 OBJECT symtbl_find_string(STATE, OBJECT self, OBJECT sym) {
   size_t idx;
   OBJECT str;
-  
+
   idx = symbol_to_index(state, sym);
   str = tuple_at(state, symtbl_get_symbols(self), idx);
   return str;
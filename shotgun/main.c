@@ -109,6 +109,10 @@ int main(int argc, char **argv) {
   if(m->s->gc_stats) {
     printf("[GC M %6dK total]\n", m->s->om->ms->allocated_bytes);
   }
+
+  if(m->s->probes->output) {
+    probe_dump(m->s, m->s->probes->output);
+  }
   
   return 0;
 }
@@ -0,0 +1,555 @@
+/*
+ * Micro-benchmarks for the C core of the VM.
+ *
+ *   shotgun/vmbench [-n SAMPLES] [-s SCALE] [-j] [NAME ...]
+ *
+ * Each benchmark runs once to warm up and then SAMPLES times (5 by
+ * default), against a machine that has been bootstrapped but hasn't
+ * loaded the kernel. SCALE multiplies the number of operations in every
+ * sample. Only benchmarks whose name starts with one of the NAMEs are
+ * run. The report has the best and median time of one operation and,
+ * for the benchmarks that move bytes around, the throughput of the best
+ * sample; -j prints it as JSON instead so runs can be compared by
+ * scripts.
+ *
+ * A benchmark measures only what is between bench_start and bench_stop,
+ * which it may call several times to leave its setup out. The objects
+ * a benchmark keeps across an allocation are kept on the stack of the
+ * frame the benchmarks run in, because a collection only happens in
+ * bench_safepoint and moves them.
+ */
+
+#include <string.h>
+#include <sys/time.h>
+
+#include "shotgun/config.h"
+#include "shotgun/lib/shotgun.h"
+#include "shotgun/lib/machine.h"
+#include "shotgun/lib/environment.h"
+#include "shotgun/lib/tuple.h"
+#include "shotgun/lib/string.h"
+#include "shotgun/lib/symbol.h"
+#include "shotgun/lib/hash.h"
+#include "shotgun/lib/lookuptable.h"
+#include "shotgun/lib/bytearray.h"
+
+void cpu_send_message(STATE, cpu c, struct message *msg);
+void state_collect(STATE, cpu c);
+void state_major_collect(STATE, cpu c);
+
+struct bench_run {
+  long ops;
+  long bytes;
+  uint64_t usecs;
+  uint64_t started;
+};
+
+typedef void (*bench_func)(STATE, cpu c, struct bench_run *run);
+
+struct bench {
+  const char *name;
+  bench_func func;
+  long ops;
+};
+
+static uint64_t bench_usecs() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static inline void bench_start(struct bench_run *run) {
+  run->started = bench_usecs();
+}
+
+static inline void bench_stop(struct bench_run *run) {
+  run->usecs += bench_usecs() - run->started;
+}
+
+/* Runs the collections the allocations so far asked for, the way the
+   interpreter does between instructions. */
+static void bench_safepoint(STATE, cpu c) {
+  int cm = state->om->collect_now;
+
+  if(cm & OMCollectYoung) state_collect(state, c);
+  if(cm & OMCollectMature) state_major_collect(state, c);
+  state->om->collect_now = 0;
+}
+
+/* Activates an empty method, so the benchmarks have a context and a
+   stack, as they would in a running program. */
+static void bench_enter_frame(STATE, cpu c) {
+  OBJECT cm;
+
+  cm = cmethod_allocate(state);
+  cmethod_set_bytecodes(cm, iseq_new(state, 4));
+  cmethod_set_literals(cm, tuple_new(state, 0));
+  cmethod_set_local_count(cm, I2N(0));
+  cmethod_set_name(cm, SYM("__vmbench__"));
+
+  c->depth = 0;
+  cpu_stack_push(state, c, cm, FALSE);
+  cpu_run_script(state, c, cm);
+}
+
+/* Allocation: tuples of 4 fields, collecting when the young space fills
+   up. */
+static void bench_alloc(STATE, cpu c, struct bench_run *run) {
+  long i;
+
+  bench_start(run);
+  for(i = 0; i < run->ops; i++) {
+    tuple_new(state, 4);
+    if(state->om->collect_now) bench_safepoint(state, c);
+  }
+  bench_stop(run);
+
+  run->bytes = run->ops * SIZE_IN_BYTES_FIELDS(4);
+}
+
+static OBJECT bench_live_set(STATE, int count, int mature) {
+  OBJECT set, obj;
+  int i;
+
+  set = tuple_new(state, count);
+  for(i = 0; i < count; i++) {
+    if(mature) {
+      obj = object_memory_new_object_mature(state->om, BASIC_CLASS(tuple), 4);
+    } else {
+      obj = tuple_new(state, 4);
+    }
+    tuple_put(state, set, i, obj);
+  }
+  return set;
+}
+
+/* Young collections copying a live set of 10000 tuples. ops is the
+   number of collections. */
+static void bench_gc_young(STATE, cpu c, struct bench_run *run) {
+  long i;
+  int count = 10000;
+
+  for(i = 0; i < run->ops; i++) {
+    bench_safepoint(state, c);
+    stack_push(bench_live_set(state, count, FALSE));
+
+    bench_start(run);
+    state_collect(state, c);
+    bench_stop(run);
+
+    (void)stack_pop();
+  }
+
+  run->bytes = run->ops * count * (SIZE_IN_BYTES_FIELDS(4) + sizeof(OBJECT));
+}
+
+/* Mark/sweep collections over a mature live set of 100000 tuples. */
+static void bench_gc_mature(STATE, cpu c, struct bench_run *run) {
+  long i;
+  int count = 100000;
+
+  bench_safepoint(state, c);
+  stack_push(bench_live_set(state, count, TRUE));
+  state_major_collect(state, c);
+
+  bench_start(run);
+  for(i = 0; i < run->ops; i++) {
+    state_major_collect(state, c);
+  }
+  bench_stop(run);
+
+  (void)stack_pop();
+  run->bytes = run->ops * count * SIZE_IN_BYTES_FIELDS(4);
+}
+
+#define BENCH_KEYS 1024
+
+static void bench_keys(STATE, OBJECT *keys, const char *prefix) {
+  char buf[64];
+  int i;
+
+  for(i = 0; i < BENCH_KEYS; i++) {
+    snprintf(buf, sizeof(buf), "%s%d", prefix, i);
+    keys[i] = SYM(buf);
+  }
+}
+
+/* lookuptable_store into a fresh table, growing it, for 1024 Symbol
+   keys over and over. */
+static void bench_lookuptable_store(STATE, cpu c, struct bench_run *run) {
+  OBJECT keys[BENCH_KEYS], tbl;
+  long i;
+
+  bench_keys(state, keys, "lt_key_");
+  bench_safepoint(state, c);
+  tbl = lookuptable_new(state);
+
+  bench_start(run);
+  for(i = 0; i < run->ops; i++) {
+    lookuptable_store(state, tbl, keys[i % BENCH_KEYS], I2N(i));
+  }
+  bench_stop(run);
+}
+
+static void bench_lookuptable_fetch(STATE, cpu c, struct bench_run *run) {
+  OBJECT keys[BENCH_KEYS], tbl;
+  long i;
+
+  bench_keys(state, keys, "lt_key_");
+  bench_safepoint(state, c);
+  tbl = lookuptable_new(state);
+  for(i = 0; i < BENCH_KEYS; i++) {
+    lookuptable_store(state, tbl, keys[i], I2N(i));
+  }
+
+  bench_start(run);
+  for(i = 0; i < run->ops; i++) {
+    lookuptable_fetch(state, tbl, keys[i % BENCH_KEYS]);
+  }
+  bench_stop(run);
+}
+
+/* hash_add of Fixnum keys into a Hash that starts out empty. */
+static void bench_hash_add(STATE, cpu c, struct bench_run *run) {
+  OBJECT hsh;
+  long i;
+
+  bench_safepoint(state, c);
+  hsh = hash_new(state);
+
+  bench_start(run);
+  for(i = 0; i < run->ops; i++) {
+    hash_add(state, hsh, (unsigned int)i, I2N(i), I2N(i));
+  }
+  bench_stop(run);
+}
+
+static void bench_hash_get(STATE, cpu c, struct bench_run *run) {
+  OBJECT hsh;
+  long i;
+
+  bench_safepoint(state, c);
+  hsh = hash_new(state);
+  for(i = 0; i < BENCH_KEYS; i++) {
+    hash_add(state, hsh, (unsigned int)i, I2N(i), I2N(i));
+  }
+
+  bench_start(run);
+  for(i = 0; i < run->ops; i++) {
+    hash_get(state, hsh, (unsigned int)(i % BENCH_KEYS));
+  }
+  bench_stop(run);
+}
+
+/* symtbl_lookup of Strings that haven't been interned yet. Every sample
+   needs new names, so they include a count of the samples run. Growing
+   the table leaves garbage behind, so this collects as it goes. */
+static void bench_symtbl_intern(STATE, cpu c, struct bench_run *run) {
+  static int round = 0;
+  OBJECT strs;
+  char buf[64];
+  long i;
+
+  bench_safepoint(state, c);
+  strs = tuple_new(state, run->ops);
+  for(i = 0; i < run->ops; i++) {
+    snprintf(buf, sizeof(buf), "intern_%d_%ld", round, i);
+    tuple_put(state, strs, i, string_new(state, buf));
+  }
+  stack_push(strs);
+  round++;
+
+  bench_start(run);
+  for(i = 0; i < run->ops; i++) {
+    symtbl_lookup(state, state->global->symbols, tuple_at(state, stack_back(0), i));
+    if(state->om->collect_now) bench_safepoint(state, c);
+  }
+  bench_stop(run);
+
+  (void)stack_pop();
+}
+
+/* symtbl_lookup of Strings that are already Symbols. */
+static void bench_symtbl_lookup(STATE, cpu c, struct bench_run *run) {
+  OBJECT strs;
+  char buf[64];
+  long i;
+
+  bench_safepoint(state, c);
+  strs = tuple_new(state, BENCH_KEYS);
+  for(i = 0; i < BENCH_KEYS; i++) {
+    snprintf(buf, sizeof(buf), "lt_key_%ld", i);
+    tuple_put(state, strs, i, string_new(state, buf));
+    symtbl_lookup(state, state->global->symbols, tuple_at(state, strs, i));
+  }
+
+  bench_start(run);
+  for(i = 0; i < run->ops; i++) {
+    symtbl_lookup(state, state->global->symbols, tuple_at(state, strs, i % BENCH_KEYS));
+  }
+  bench_stop(run);
+}
+
+/* Something shaped like the literals of a compiled method: Strings,
+   Symbols, Fixnums, Floats and nested Tuples. */
+static OBJECT bench_graph(STATE) {
+  OBJECT graph, inner;
+  char buf[64];
+  int i;
+
+  graph = tuple_new(state, 500);
+  for(i = 0; i < 500; i++) {
+    switch(i % 5) {
+    case 0:
+      snprintf(buf, sizeof(buf), "a literal string %d", i);
+      tuple_put(state, graph, i, string_new(state, buf));
+      break;
+    case 1:
+      snprintf(buf, sizeof(buf), "marshal_sym_%d", i);
+      tuple_put(state, graph, i, SYM(buf));
+      break;
+    case 2:
+      tuple_put(state, graph, i, I2N(i * 1000));
+      break;
+    case 3:
+      tuple_put(state, graph, i, float_new(state, i / 7.0));
+      break;
+    case 4:
+      inner = tuple_new2(state, 3, I2N(i), Qtrue, Qnil);
+      tuple_put(state, graph, i, inner);
+      break;
+    }
+  }
+  return graph;
+}
+
+static void bench_marshal(STATE, cpu c, struct bench_run *run) {
+  OBJECT str;
+  long i;
+
+  bench_safepoint(state, c);
+  stack_push(bench_graph(state));
+
+  for(i = 0; i < run->ops; i++) {
+    bench_start(run);
+    str = cpu_marshal(state, stack_back(0), 0);
+    bench_stop(run);
+
+    run->bytes += N2I(string_get_bytes(str));
+    bench_safepoint(state, c);
+  }
+
+  (void)stack_pop();
+}
+
+static void bench_unmarshal(STATE, cpu c, struct bench_run *run) {
+  bstring buf;
+  long i;
+
+  bench_safepoint(state, c);
+  buf = cpu_marshal_to_bstring(state, bench_graph(state), 0);
+
+  for(i = 0; i < run->ops; i++) {
+    bench_start(run);
+    cpu_unmarshal(state, (uint8_t*)bdata(buf), blength(buf), 0);
+    bench_stop(run);
+
+    bench_safepoint(state, c);
+  }
+
+  run->bytes = run->ops * blength(buf);
+  bdestroy(buf);
+}
+
+/* string_append of 16 byte pieces, starting over at 64K. */
+static void bench_string_append(STATE, cpu c, struct bench_run *run) {
+  long i;
+
+  bench_safepoint(state, c);
+  stack_push(string_new(state, "0123456789abcdef"));
+  stack_push(string_new(state, ""));
+
+  bench_start(run);
+  for(i = 0; i < run->ops; i++) {
+    if(N2I(string_get_bytes(stack_back(0))) >= 65536) {
+      (void)stack_pop();
+      stack_push(string_new(state, ""));
+      bench_safepoint(state, c);
+    }
+    string_append(state, stack_back(0), stack_back(1));
+  }
+  bench_stop(run);
+
+  (void)stack_pop();
+  (void)stack_pop();
+  run->bytes = run->ops * 16;
+}
+
+/* Sends through a SendSite to a method that's a primitive, the fastest
+   way a send completes. With one receiver class the site stays
+   monomorphic; with two it misses every time and looks the method up
+   again in the global method cache. */
+static void bench_send(STATE, cpu c, struct bench_run *run, int classes) {
+  struct message msg;
+  OBJECT cm, name, recv[2];
+  long i;
+
+  name = SYM("__vmbench_class__");
+  cm = cmethod_allocate(state);
+  cmethod_set_primitive(cm, SYM("logical_class"));
+  cmethod_set_name(cm, name);
+  cpu_add_method(state, c, BASIC_CLASS(object), name, cm);
+
+  bench_safepoint(state, c);
+  stack_push(send_site_create(state, name));
+  recv[0] = I2N(1);
+  recv[1] = classes > 1 ? Qtrue : I2N(2);
+
+  memset(&msg, 0, sizeof(msg));
+  msg.block = Qnil;
+  msg.args = 0;
+
+  bench_start(run);
+  for(i = 0; i < run->ops; i++) {
+    msg.send_site = stack_back(0);
+    msg.recv = recv[i & 1];
+    msg.klass = _real_class(state, msg.recv);
+    cpu_send_message(state, c, &msg);
+    (void)stack_pop();
+  }
+  bench_stop(run);
+
+  (void)stack_pop();
+}
+
+static void bench_send_mono(STATE, cpu c, struct bench_run *run) {
+  bench_send(state, c, run, 1);
+}
+
+static void bench_send_poly(STATE, cpu c, struct bench_run *run) {
+  bench_send(state, c, run, 2);
+}
+
+static struct bench benchmarks[] = {
+  { "alloc_tuple",       bench_alloc,             2000000 },
+  { "gc_young",          bench_gc_young,          200 },
+  { "gc_mature",         bench_gc_mature,         20 },
+  { "lookuptable_store", bench_lookuptable_store, 2000000 },
+  { "lookuptable_fetch", bench_lookuptable_fetch, 5000000 },
+  { "hash_add",          bench_hash_add,          200000 },
+  { "hash_get",          bench_hash_get,          5000000 },
+  { "symtbl_intern",     bench_symtbl_intern,     20000 },
+  { "symtbl_lookup",     bench_symtbl_lookup,     1000000 },
+  { "marshal",           bench_marshal,           500 },
+  { "unmarshal",         bench_unmarshal,         500 },
+  { "string_append",     bench_string_append,     2000000 },
+  { "send_mono",         bench_send_mono,         5000000 },
+  { "send_poly",         bench_send_poly,         5000000 },
+  { NULL, NULL, 0 }
+};
+
+static int bench_compare(const void *a, const void *b) {
+  double x = *(const double*)a, y = *(const double*)b;
+  return x < y ? -1 : x > y;
+}
+
+static int bench_selected(const char *name, int argc, char **argv, int first) {
+  int i;
+
+  if(first == argc) return TRUE;
+  for(i = first; i < argc; i++) {
+    if(!strncmp(name, argv[i], strlen(argv[i]))) return TRUE;
+  }
+  return FALSE;
+}
+
+int main(int argc, char **argv) {
+  environment e;
+  machine m;
+  struct bench *b;
+  struct bench_run run;
+  double *nsecs, best_rate;
+  int samples = 5, json = FALSE, first = 1, count = 0, i;
+  double scale = 1.0;
+  long ops;
+
+  while(first < argc && argv[first][0] == '-') {
+    if(!strcmp(argv[first], "-j")) {
+      json = TRUE;
+    } else if(!strcmp(argv[first], "-n") && first + 1 < argc) {
+      samples = atoi(argv[++first]);
+    } else if(!strcmp(argv[first], "-s") && first + 1 < argc) {
+      scale = atof(argv[++first]);
+    } else {
+      fprintf(stderr, "Usage: %s [-n SAMPLES] [-s SCALE] [-j] [NAME ...]\n", argv[0]);
+      return 1;
+    }
+    first++;
+  }
+  if(samples < 1) samples = 1;
+
+  environment_at_startup();
+  e = environment_new();
+  m = machine_new(e);
+  environment_setup_thread(e, m);
+  bench_enter_frame(m->s, m->c);
+
+  nsecs = calloc(samples, sizeof(double));
+
+  if(json) {
+    printf("{\"samples\": %d, \"scale\": %g, \"benchmarks\": [", samples, scale);
+  } else {
+    printf("%-20s %12s %12s %12s %10s\n", "benchmark", "ops", "best ns/op",
+        "median", "MB/s");
+  }
+
+  for(b = benchmarks; b->name; b++) {
+    if(!bench_selected(b->name, argc, argv, first)) continue;
+
+    ops = (long)(b->ops * scale);
+    if(ops < 1) ops = 1;
+    best_rate = 0.0;
+
+    for(i = -1; i < samples; i++) {
+      memset(&run, 0, sizeof(run));
+      run.ops = ops;
+      b->func(m->s, m->c, &run);
+      bench_safepoint(m->s, m->c);
+
+      if(i < 0) continue;
+      if(run.usecs == 0) run.usecs = 1;
+      nsecs[i] = run.usecs * 1000.0 / ops;
+      if(run.bytes / (double)run.usecs > best_rate) {
+        best_rate = run.bytes / (double)run.usecs;
+      }
+    }
+
+    qsort(nsecs, samples, sizeof(double), bench_compare);
+
+    if(json) {
+      printf("%s\n  {\"name\": \"%s\", \"ops\": %ld, \"best_ns\": %.2f, "
+          "\"median_ns\": %.2f, \"mb_per_sec\": %.2f, \"ns_per_op\": [",
+          count ? "," : "", b->name, ops, nsecs[0], nsecs[samples / 2],
+          best_rate);
+      for(i = 0; i < samples; i++) {
+        printf("%s%.2f", i ? ", " : "", nsecs[i]);
+      }
+      printf("]}");
+    } else {
+      printf("%-20s %12ld %12.2f %12.2f", b->name, ops, nsecs[0],
+          nsecs[samples / 2]);
+      if(best_rate > 0) {
+        printf(" %10.1f\n", best_rate);
+      } else {
+        printf(" %10s\n", "-");
+      }
+    }
+    fflush(stdout);
+    count++;
+  }
+
+  if(json) printf("\n]}\n");
+
+  free(nsecs);
+  return 0;
+}
@@ -57,13 +57,60 @@ describe Compiler do
     end
   end
   
+  it "compiles '1 <= 1' using fastmath" do
+    gen [:call, [:fixnum, 1], :<=, [:array, [:fixnum, 1]]], [:fastmath] do |g|
+      g.push 1
+      g.push 1
+      g.meta_send_op_le
+    end
+  end
+
+  it "compiles '1 >= 1' using fastmath" do
+    gen [:call, [:fixnum, 1], :>=, [:array, [:fixnum, 1]]], [:fastmath] do |g|
+      g.push 1
+      g.push 1
+      g.meta_send_op_ge
+    end
+  end
+
+  it "compiles '1 * 1' using fastmath" do
+    gen [:call, [:fixnum, 1], :*, [:array, [:fixnum, 1]]], [:fastmath] do |g|
+      g.push 1
+      g.push 1
+      g.meta_send_op_mul
+    end
+  end
+
   it "compiles '1 / 1' using :/ without safemath" do
-    gen [:call, [:fixnum, 1], :/, [:array, [:fixnum, 1]]] do |g|
+    # fastmath is on by default and would use meta_send_op_div
+    Compiler::Config['no-fastmath'] = true
+    begin
+      gen [:call, [:fixnum, 1], :/, [:array, [:fixnum, 1]]] do |g|
+        g.push 1
+        g.push 1
+        g.send :/, 1, false
+      end
+    ensure
+      Compiler::Config.delete 'no-fastmath'
+    end
+  end
+
+  it "compiles '1 / 1' using fastmath without safemath" do
+    gen [:call, [:fixnum, 1], :/, [:array, [:fixnum, 1]]], [:fastmath] do |g|
+      g.push 1
+      g.push 1
+      g.meta_send_op_div
+    end
+  end
+
+  it "compiles '1 % 1' using fastmath" do
+    gen [:call, [:fixnum, 1], :%, [:array, [:fixnum, 1]]], [:fastmath] do |g|
       g.push 1
       g.push 1
-      g.send :/, 1, false
+      g.meta_send_op_mod
     end
   end
+
   
   it "compiles '1 / 1' using :divide with safemath" do
     gen [:call, [:fixnum, 1], :/, [:array, [:fixnum, 1]]], [:safemath] do |g|
@@ -72,5 +119,13 @@ describe Compiler do
       g.send :divide, 1, false
     end
   end
-  
+
+  it "compiles '1 / 1' using :divide with safemath and fastmath" do
+    gen [:call, [:fixnum, 1], :/, [:array, [:fixnum, 1]]], [:safemath, :fastmath] do |g|
+      g.push 1
+      g.push 1
+      g.send :divide, 1, false
+    end
+  end
+
 end
@@ -0,0 +1,216 @@
+require File.dirname(__FILE__) + "/spec_helper"
+
+def optimize(*passes)
+  g = Compiler::Generator.new
+  yield g
+  g.close
+  Compiler::Optimizer.new(passes.empty? ? nil : passes).run(g)
+  g
+end
+
+describe Compiler::Optimizer do
+  it "folds Fixnum math on literals" do
+    g = optimize(:fold) do |g|
+      g.push 3
+      g.push 2
+      g.meta_send_op_mul
+      g.push 1
+      g.meta_send_op_plus
+      g.sret
+    end
+
+    g.stream.should == [[:push_int, 7], [:sret]]
+  end
+
+  it "folds comparisons of literals to true or false" do
+    g = optimize(:fold) do |g|
+      g.push 2
+      g.push 1
+      g.meta_send_op_lt
+      g.sret
+    end
+
+    g.stream.should == [[:push_true], [:sret]]
+  end
+
+  it "leaves division by zero for the VM to raise" do
+    g = optimize(:fold) do |g|
+      g.push 0
+      g.push 1
+      g.meta_send_op_div
+      g.sret
+    end
+
+    g.stream.should == [[:meta_push_0], [:meta_push_1], [:meta_send_op_div], [:sret]]
+  end
+
+  it "doesn't fold across an instruction something jumps to" do
+    g = optimize(:fold) do |g|
+      there = g.new_label
+      g.push 2
+      there.set!
+      g.push 1
+      g.meta_send_op_plus
+      g.goto there
+    end
+
+    g.stream.first.should == [:meta_push_2]
+  end
+
+  it "drops a branch on a literal condition" do
+    g = optimize(:fold) do |g|
+      done = g.new_label
+      g.push :true
+      g.gif done
+      g.push 1
+      done.set!
+      g.sret
+    end
+
+    g.stream.should == [[:meta_push_1], [:sret]]
+  end
+
+  it "keeps both arms of a branch on self in a NilClass method" do
+    name = tmp("optimizer_self.rb")
+    File.open(name, "w") do |f|
+      f.puts "# optimize: fold"
+      f.puts "class NilClass; def optimizer_spec_self; self ? :yes : :no; end; end"
+    end
+
+    Compiler.compile_file(name).as_script
+    nil.optimizer_spec_self.should == :no
+
+    NilClass.send :remove_method, :optimizer_spec_self
+    File.delete name
+  end
+
+  it "removes values that are pushed and popped straight away" do
+    g = optimize(:peephole) do |g|
+      g.push :nil
+      g.pop
+      g.push_local 0
+      g.dup
+      g.pop
+      g.sret
+    end
+
+    g.stream.should == [[:push_local, 0], [:sret]]
+  end
+
+  it "keeps an assigned local on the stack instead of reading it back" do
+    g = optimize(:peephole) do |g|
+      g.push 1
+      g.set_local 0
+      g.pop
+      g.push_local 0
+      g.sret
+    end
+
+    g.stream.should == [[:meta_push_1], [:set_local, 0], [:sret]]
+  end
+
+  it "jumps straight to where a chain of gotos ends up" do
+    g = optimize(:jumps) do |g|
+      first = g.new_label
+      second = g.new_label
+      g.push :true
+      g.gif first
+      g.push 1
+      g.sret
+      first.set!
+      g.goto second
+      g.push 2
+      second.set!
+      g.push 3
+      g.sret
+    end
+
+    g.collapse_labels
+    g.stream[1].should == [:goto_if_false, 8]
+  end
+
+  it "turns a conditional jump over a goto into the opposite jump" do
+    g = optimize(:jumps) do |g|
+      yes = g.new_label
+      no = g.new_label
+      g.push_local 0
+      g.git yes
+      g.goto no
+      yes.set!
+      g.push 1
+      g.sret
+      no.set!
+      g.push 2
+      g.sret
+    end
+
+    g.collapse_labels
+    g.stream.should == [[:push_local, 0], [:goto_if_false, 6], [:meta_push_1],
+                        [:sret], [:meta_push_2], [:sret]]
+  end
+
+  it "removes code nothing reaches" do
+    g = optimize(:dead_code) do |g|
+      g.push 1
+      g.sret
+      g.push 2
+      g.sret
+    end
+
+    g.stream.should == [[:meta_push_1], [:sret]]
+  end
+
+  it "keeps exception handlers and moves their ranges" do
+    g = optimize do |g|
+      g.push :nil
+      g.pop
+      g.exceptions do |ex|
+        done = g.new_label
+        g.push_local 0
+        g.goto done
+        ex.handle!
+        g.push_exception
+        g.raise_exc
+        done.set!
+        g.sret
+      end
+    end
+
+    g.stream.should == [[:push_local, 0], [:goto, g.stream[1][1]],
+                        [:push_exception], [:raise_exc], [:sret]]
+    g.exception_bounds.should == [[0, 4]]
+  end
+
+  it "keeps the goto a protected range ends with even if nothing reaches it" do
+    g = optimize do |g|
+      g.exceptions do |ex|
+        done = g.new_label
+        g.push_local 0
+        g.raise_exc
+        g.goto done
+        ex.handle!
+        g.push_nil
+        done.set!
+        g.sret
+      end
+    end
+
+    g.stream.should == [[:push_local, 0], [:raise_exc], [:goto, g.stream[2][1]],
+                        [:push_nil], [:sret]]
+  end
+
+  it "reads the passes to run from the comments a file starts with" do
+    name = tmp("optimizer_pragma.rb")
+
+    File.open(name, "w") { |f| f.puts "# optimize: none", "1" }
+    Compiler::Optimizer.for_file(name, :default).should == nil
+
+    File.open(name, "w") { |f| f.puts "# optimize: fold", "1" }
+    Compiler::Optimizer.for_file(name, :default).should be_kind_of(Compiler::Optimizer)
+
+    File.open(name, "w") { |f| f.puts "1", "# optimize: none" }
+    Compiler::Optimizer.for_file(name, :default).should == :default
+
+    File.delete name
+  end
+end
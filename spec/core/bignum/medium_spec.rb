@@ -0,0 +1,46 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe "Bignum arithmetic near the machine word" do
+  before :each do
+    @max = 9223372036854775807
+    @big = 2 ** 62 + 5
+  end
+
+  it "carries into a wider Bignum on overflow" do
+    (@max + 1).should == 9223372036854775808
+    (-@max - 2).should == -9223372036854775809
+    (@max * @max).should == 85070591730234615847396907784232501249
+    (@big * -@big).should == -21267647932558654012577773148759392281
+  end
+
+  it "returns a Fixnum when the result fits in one" do
+    (@big - @big + 5).class.should == Fixnum
+    (@big / 2 ** 40).class.should == Fixnum
+    (@big & 0xff).should == 5
+  end
+
+  it "rounds division toward negative infinity" do
+    (-@big / 7).should == -658812288346769702
+    (-@big % 7).should == 5
+    (@big % -7).should == -5
+    @big.divmod(-7).should == [-658812288346769702, -5]
+  end
+
+  it "floors right shifts of negative values" do
+    (-@big >> 1).should == -2305843009213693955
+    (-(2 ** 64) >> 70).should == -1
+    (-(2 ** 64) >> 61).should == -8
+    (-@big >> 80).should == -1
+  end
+
+  it "shifts left past 64 bits" do
+    (@big << 10).should == 4722366482869645218816
+    (-@big << 3).should == -36893488147419103272
+  end
+
+  it "negates and inverts" do
+    (-@big).should == -4611686018427387909
+    (~@big).should == -4611686018427387910
+    (-(-@max - 1)).should == 9223372036854775808
+  end
+end
@@ -71,7 +71,7 @@ describe "StepBreakpoint#calculate_next_breakpoint" do
 
   it "given a next line count with an intervening send opcode, steps right over the send opcode" do
     create_bp(@block_cm, {:step_by => :line, :step_type => :next, :steps => 2}, 4)
-    @step_bp.calculate_next_breakpoint.should == 19
+    @step_bp.calculate_next_breakpoint.should == 17
     @step_bp.steps.should == 0
     @step_bp.break_type.should == :opcode_replacement
   end
@@ -166,13 +166,13 @@ describe "StepBreakpoint#calculate_next_breakpoint" do
   end
 
   it "given a step ip count with an intervening return opcode, breaks at return, after call site, and when steps reach 0" do
-    create_bp(@block_cm, {:step_by => :ip, :steps => 4}, 38)
+    create_bp(@block_cm, {:step_by => :ip, :steps => 4}, 36)
     @ctxt.sender = sender = BreakpointSpecs::ContextStub.new(@cm, 29)
-    @step_bp.calculate_next_breakpoint.should == 39
+    @step_bp.calculate_next_breakpoint.should == 37
     @step_bp.steps.should == 3
     @step_bp.context.should == @ctxt
     @step_bp.break_type.should == :opcode_replacement
-    @ctxt.ip = 39
+    @ctxt.ip = 37
     @step_bp.calculate_next_breakpoint.should == 29
     @step_bp.context.should == sender
     @step_bp.steps.should == 2
@@ -180,13 +180,13 @@ describe "StepBreakpoint#calculate_next_breakpoint" do
   end
 
   it "given a step line count with an intervening return opcode, breaks at return, after call site, and when steps reach 0" do
-    create_bp(@block_cm, {:step_by => :line, :steps => 1}, 38)
+    create_bp(@block_cm, {:step_by => :line, :steps => 1}, 36)
     @ctxt.sender = sender = BreakpointSpecs::ContextStub.new(@cm, 29)
-    @step_bp.calculate_next_breakpoint.should == 39
+    @step_bp.calculate_next_breakpoint.should == 37
     @step_bp.steps.should == 1
     @step_bp.context.should == @ctxt
     @step_bp.break_type.should == :opcode_replacement
-    @ctxt.ip = 39
+    @ctxt.ip = 37
     @step_bp.calculate_next_breakpoint.should == 29
     @step_bp.context.should == sender
     @step_bp.steps.should == 1
@@ -126,25 +126,25 @@ end
             # line 22
      0005:  push_local_depth           0, :i
      0008:  push_local                 0
-     0010:  send_stack                 :*, 1
-     0013:  push_local                 1
-     0015:  meta_send_op_plus
-     0016:  set_local                  1
-     0018:  pop
+     0010:  meta_send_op_mul
+     0011:  push_local                 1
+     0013:  meta_send_op_plus
+     0014:  set_local                  1
+     0016:  pop
             # line 23
-     0019:  push_int                   50
-     0021:  push_local                 1
-     0023:  meta_send_op_gt
-     0024:  goto_if_false              38
-     0026:  push_nil
-     0027:  push_local                 2
-     0029:  send_stack                 :"break_value=", 1
-     0032:  pop
-     0033:  push_local                 2
-     0035:  raise_exc
-     0036:  goto                       39
-     0038:  push_nil
-     0039:  soft_return
+     0017:  push_int                   50
+     0019:  push_local                 1
+     0021:  meta_send_op_gt
+     0022:  goto_if_false              36
+     0024:  push_nil
+     0025:  push_local                 2
+     0027:  send_stack                 :"break_value=", 1
+     0030:  pop
+     0031:  push_local                 2
+     0033:  raise_exc
+     0034:  goto                       37
+     0036:  push_nil
+     0037:  soft_return
 
 
      ### Bytecode for if_method ###
@@ -0,0 +1,63 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe "Compile::Cache" do
+  before :each do
+    @dir = tmp("rbx_cache_spec")
+    @source = tmp("rbx_cache_source.rb")
+    File.open(@source, "w") { |f| f.puts "def cache_spec_value; 42; end" }
+    @cache = Compile::Cache.new @dir, 1024 * 1024
+  end
+
+  after :each do
+    File.delete @source if File.exists? @source
+    Dir["#{@dir}/*/*/*"].each { |f| File.delete f if File.file? f }
+    Dir["#{@dir}/*/*"].sort.reverse.each { |d| Dir.rmdir d if File.directory? d }
+    Dir.rmdir @dir if File.directory? @dir
+  end
+
+  it "compiles a source it hasn't seen and keeps the result" do
+    @cache.load(@source).should be_kind_of(CompiledMethod)
+    @cache.misses.should == 1
+    File.file?(@cache.path_for(File.read(@source))).should == true
+  end
+
+  it "finds a source it has seen by its contents" do
+    @cache.load @source
+    cache = Compile::Cache.new @dir, 1024 * 1024
+    cm = cache.load @source
+    cache.hits.should == 1
+    cache.misses.should == 0
+    cm.file.should == @source.to_sym
+  end
+
+  it "keeps different sources apart" do
+    @cache.path_for("a = 1").should_not == @cache.path_for("a = 2")
+  end
+
+  it "keeps code compiled with different compiler flags apart" do
+    config = Compile.compiler::Config
+    plain = @cache.path_for("a = 1")
+    begin
+      config["no-inline"] = true
+      @cache.path_for("a = 1").should_not == plain
+    ensure
+      config.delete "no-inline"
+    end
+    @cache.path_for("a = 1").should == plain
+  end
+
+  it "removes the least recently used entries when it grows too big" do
+    @cache.load @source
+    old = @cache.path_for(File.read(@source))
+    File.utime Time.now - 3600, Time.now - 3600, old
+
+    File.open(@source, "w") { |f| f.puts "def cache_spec_value; 43; end" }
+    @cache.load @source
+    new = @cache.path_for(File.read(@source))
+
+    cache = Compile::Cache.new @dir, File.size(new) * 3 / 2
+    cache.evict
+    File.exists?(old).should == false
+    File.exists?(new).should == true
+  end
+end
@@ -0,0 +1,29 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe "Hash#each" do
+  it "yields the entries in insertion order" do
+    h = {}
+    keys = (0...100).map { |i| i % 2 == 0 ? "k#{i}" : i * 64 }
+    keys.each { |k| h[k] = k }
+    r = []
+    h.each { |k, v| r << k }
+    r.should == keys
+  end
+
+  it "yields a reinserted key after the others" do
+    h = {:a => 1, :b => 2, :c => 3}
+    h.delete :a
+    h[:a] = 4
+    r = []
+    h.each { |k, v| r << [k, v] }
+    r.should == [[:b, 2], [:c, 3], [:a, 4]]
+  end
+
+  it "does not yield entries added by the block" do
+    h = {1 => 1, 2 => 2}
+    r = []
+    h.each { |k, v| r << k; h[k + 10] = v }
+    r.should == [1, 2]
+    h.size.should == 4
+  end
+end
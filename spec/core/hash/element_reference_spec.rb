@@ -0,0 +1,38 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+class HashSpecsUnequalString < String
+  def eql?(other)
+    false
+  end
+end
+
+class HashSpecsDefaulting < Hash
+  def default(key = nil)
+    :subclass_default
+  end
+end
+
+describe "Hash#[]" do
+  it "uses #eql? of a String subclass key" do
+    h = {"abc" => 1}
+    h[HashSpecsUnequalString.new("abc")].should == nil
+  end
+
+  it "returns the default for a missing key" do
+    Hash.new(5)["missing"].should == 5
+    {}[:missing].should == nil
+  end
+
+  it "calls the default proc for a missing key" do
+    h = Hash.new { |hash, key| key.to_s * 2 }
+    h[:ab].should == "abab"
+  end
+
+  it "calls #default when redefined by a subclass or singleton" do
+    HashSpecsDefaulting.new[1].should == :subclass_default
+
+    h = {}
+    def h.default(key = nil) :singleton_default end
+    h[1].should == :singleton_default
+  end
+end
@@ -22,4 +22,13 @@ describe "LookupTable#delete" do
     @lt.size.should == 2
     @lt[:c].should == nil
   end
+
+  it "leaves the remaining entries reachable" do
+    lt = LookupTable.new
+    100.times { |i| lt[i * 16] = i }
+    (0...100).step(2) { |i| lt.delete(i * 16).should == i }
+    lt.size.should == 50
+    100.times { |i| lt[i * 16].should == (i % 2 == 0 ? nil : i) }
+    lt.keys.sort.should == (0...100).select { |i| i % 2 == 1 }.map { |i| i * 16 }
+  end
 end
@@ -0,0 +1,52 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+require File.dirname(__FILE__) + '/fixtures/classes'
+
+# push_const and find_const cache the constant they find, so each of
+# these reads a constant once to fill the cache before changing it.
+describe "Module#const_set" do
+  after :each do
+    ModuleSpecs::ConstReader.send :remove_const, :VALUE
+  end
+
+  it "is seen by a constant reference that already found the old value" do
+    ModuleSpecs::ConstReader.const_set :VALUE, 1
+    ModuleSpecs::ConstReader.value.should == 1
+    ModuleSpecs::ConstReader.const_set :VALUE, 2
+    ModuleSpecs::ConstReader.value.should == 2
+  end
+
+  it "is seen by a scoped constant reference that already found the old value" do
+    ModuleSpecs::ConstReader.const_set :VALUE, 1
+    ModuleSpecs::ConstReader.from(ModuleSpecs::ConstReader).should == 1
+    ModuleSpecs::ConstReader.const_set :VALUE, 2
+    ModuleSpecs::ConstReader.from(ModuleSpecs::ConstReader).should == 2
+  end
+
+  it "does not mix up scoped constant references into different modules" do
+    ModuleSpecs::ConstReader.const_set :VALUE, 1
+    ModuleSpecs::Consts.const_set :VALUE, 2
+    ModuleSpecs::ConstReader.from(ModuleSpecs::ConstReader).should == 1
+    ModuleSpecs::ConstReader.from(ModuleSpecs::Consts).should == 2
+    ModuleSpecs::Consts.send :remove_const, :VALUE
+  end
+end
+
+describe "Module#remove_const" do
+  it "is seen by a constant reference that already found the constant" do
+    ModuleSpecs::ConstSubReader.shadowed.should == :reader
+    ModuleSpecs::ConstReader.send :remove_const, :SHADOWED
+    lambda { ModuleSpecs::ConstSubReader.shadowed }.should raise_error(NameError)
+    ModuleSpecs::ConstReader.const_set :SHADOWED, :reader
+  end
+end
+
+describe "Module#include" do
+  it "is seen by a constant reference that already found a constant further up" do
+    ModuleSpecs::ConstSubReader.const_set :SHADOWED, :sub
+    ModuleSpecs::ConstSubReader.shadowed.should == :sub
+    ModuleSpecs::ConstSubReader.send :remove_const, :SHADOWED
+    ModuleSpecs::ConstSubReader.shadowed.should == :reader
+    ModuleSpecs::ConstSubReader.send :include, ModuleSpecs::Consts
+    ModuleSpecs::ConstSubReader.shadowed.should == :consts
+  end
+end
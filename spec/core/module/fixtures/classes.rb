@@ -17,4 +17,30 @@ module ModuleSpecs
   class F
     include A
   end
+
+  module Consts
+    SHADOWED = :consts
+  end
+
+  class ConstReader
+    SHADOWED = :reader
+
+    def self.value
+      VALUE
+    end
+
+    def self.shadowed
+      SHADOWED
+    end
+
+    def self.from(mod)
+      mod::VALUE
+    end
+  end
+
+  class ConstSubReader < ConstReader
+    def self.shadowed
+      SHADOWED
+    end
+  end
 end
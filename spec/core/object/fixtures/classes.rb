@@ -4,3 +4,28 @@ module ObjectSpecs
     def class_variable_get(*); :cvget; end 
   end
 end
+
+module ObjectSpecs
+  class IVars
+    def initialize(order)
+      order.each { |name| send "set_#{name}", name }
+    end
+
+    def set_a(v); @a = v; end
+    def set_b(v); @b = v; end
+    def set_c(v); @c = v; end
+
+    def a; @a; end
+    def b; @b; end
+    def c; @c; end
+  end
+
+  class ManyIVars
+    def initialize(count)
+      count.times { |i| instance_variable_set "@v#{i}", i }
+    end
+
+    def v1; @v1; end
+    def v1=(v); @v1 = v; end
+  end
+end
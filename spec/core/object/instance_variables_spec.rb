@@ -0,0 +1,47 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+require File.dirname(__FILE__) + '/fixtures/classes'
+
+describe "Object instance variables" do
+  it "reads the right value whatever order the ivars were set in" do
+    objs = [[:a, :b, :c], [:c, :b, :a], [:b], [:c, :a]].map do |order|
+      ObjectSpecs::IVars.new order
+    end
+
+    objs.map { |o| [o.a, o.b, o.c] }.should == [
+      [:a, :b, :c], [:a, :b, :c], [nil, :b, nil], [:a, nil, :c]]
+  end
+
+  it "lists ivars in the order they were first set" do
+    ObjectSpecs::IVars.new([:c, :a, :b]).instance_variables.should == ["@c", "@a", "@b"]
+  end
+
+  it "keeps objects separate when they share a layout" do
+    x = ObjectSpecs::IVars.new [:a, :b]
+    y = ObjectSpecs::IVars.new [:a, :b]
+    y.set_b 5
+    x.b.should == :b
+    y.b.should == 5
+  end
+
+  it "copies ivars with dup without sharing later assignments" do
+    x = ObjectSpecs::IVars.new [:a]
+    y = x.dup
+    y.set_b 1
+    x.set_c 2
+    x.instance_variables.should == ["@a", "@c"]
+    y.instance_variables.should == ["@a", "@b"]
+  end
+
+  it "still works for an object with a great many ivars" do
+    o = ObjectSpecs::ManyIVars.new 100
+    o.v1.should == 1
+    o.v1 = :x
+    o.v1.should == :x
+    o.instance_variable_get(:@v99).should == 99
+    o.instance_variables.size.should == 100
+  end
+
+  it "includes shape-stored ivars in #inspect" do
+    ObjectSpecs::IVars.new([:a, :b]).inspect.should =~ /@a=:a @b=:b>\z/
+  end
+end
@@ -0,0 +1,70 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe "Regexp#match?" do
+  it "returns true if the pattern matches" do
+    /world/.match?("hello world").should == true
+    /w(or)ld/.match?("hello world").should == true
+    /o\s+w/.match?("hello world").should == true
+  end
+
+  it "returns false if the pattern doesn't match" do
+    /nope/.match?("hello world").should == false
+    /\Aworld/.match?("hello world").should == false
+  end
+
+  it "returns false for nil" do
+    /a/.match?(nil).should == false
+  end
+
+  it "starts looking at pos" do
+    /o/.match?("hello", 4).should == true
+    /l/.match?("hello", 4).should == false
+    /o/.match?("hello", -1).should == true
+    /o/.match?("hello", 6).should == false
+  end
+
+  it "doesn't change $~" do
+    "hello" =~ /e/
+    /l/.match?("hello")
+    $~[0].should == "e"
+  end
+end
+
+describe "Regexp matching with a literal prefix" do
+  it "finds a literal pattern anywhere in the string" do
+    ("abcabd" =~ /abd/).should == 3
+    ("ababab" =~ /bab/).should == 1
+    "abcabc".scan(/bc/).should == ["bc", "bc"]
+    ("" =~ /a/).should == nil
+  end
+
+  it "applies a quantifier after the prefix to its last character" do
+    ("ac" =~ /abc?/).should == nil
+    ("ab" =~ /abc?/).should == 0
+    ("ac" =~ /ab*c/).should == 0
+    ("xac" =~ /ab?c/).should == 1
+    ("abbbc" =~ /ab{2,}c/).should == 0
+  end
+
+  it "only matches an \\A anchored prefix at the start" do
+    ("hello" =~ /\Ahel/).should == 0
+    ("ahello" =~ /\Ahel/).should == nil
+    /\Ahel/.match_from("hellohel", 5).should == nil
+  end
+
+  it "isn't used for alternation" do
+    ("xd" =~ /abc|d/).should == 1
+  end
+
+  it "isn't used for case-insensitive patterns" do
+    ("xABC" =~ /abc/i).should == 1
+  end
+
+  it "gives the same MatchData as a search by onig" do
+    m = /o w/.match("hello world")
+    m.pre_match.should == "hell"
+    m.post_match.should == "orld"
+    m.begin(0).should == 4
+    m.captures.should == []
+  end
+end
@@ -0,0 +1,35 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe "Sampler#stop" do
+  def sampler_spin
+    a = []
+    200_000.times { |i| a << i }
+  end
+
+  it "records the whole stack of each sample" do
+    s = Sampler.new 1000
+    s.start
+    sampler_spin
+    s.stop
+
+    names = s.stacks.map { |frames, count| frames.map { |f| f.name } }
+    names.empty?.should == false
+    names.any? { |n| n.include? "Integer#times" }.should == true
+    names.any? { |n| n.first == "__script__" or n.first == "VM.garbage_collection" }.should == true
+  end
+
+  it "writes the stacks in the collapsed format" do
+    s = Sampler.new 1000, :cpu
+    s.start
+    sampler_spin
+    s.stop
+
+    out = ""
+    s.collapsed out
+    out.split("\n").each { |line| line.should =~ /\A\S.* \d+\z/ }
+  end
+
+  it "raises an ArgumentError for an unknown mode" do
+    lambda { Sampler.new 100, :bogus }.should raise_error(ArgumentError)
+  end
+end
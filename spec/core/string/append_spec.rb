@@ -0,0 +1,30 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe "String#append" do
+  it "appends the other String" do
+    a = "abc"
+    a.append("def").should equal(a)
+    a.should == "abcdef"
+  end
+
+  it "keeps earlier appends when the data has to grow" do
+    a = ""
+    200.times { |i| a.append(i.to_s) }
+    a.should == (0...200).map { |i| i.to_s }.join
+  end
+
+  it "does not change a String that shares the data" do
+    a = "abc"
+    b = a.dup
+    b.append("def")
+    a.append("ghi")
+    a.should == "abcghi"
+    b.should == "abcdef"
+  end
+
+  it "appends the String to itself" do
+    a = "abc"
+    a.append(a)
+    a.should == "abcabc"
+  end
+end
@@ -0,0 +1,12 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe "String#__sha1__" do
+  it "returns the SHA1 of the bytes as hex digits" do
+    "".__sha1__.should == "da39a3ee5e6b4b0d3255bfef95601890afd80709"
+    "abc".__sha1__.should == "a9993e364706816aba3e25717850c26c9cd0d89d"
+  end
+
+  it "covers only the bytes of a substring" do
+    "xabcx".substring(1, 3).__sha1__.should == "abc".__sha1__
+  end
+end
@@ -25,4 +25,29 @@ describe "String#substring" do
     "halb".substring(0, 5).should == "halb"
     "halb".substring(3, 2).should == "b"
   end
+
+  it "is not changed by changes to the original String" do
+    a = "abcdefghijklmnopqrstuvwxyz0123456789"
+    b = a.substring(2, 30)
+    a.upcase!
+    a << "!"
+    b.should == "cdefghijklmnopqrstuvwxyz012345"
+  end
+
+  it "does not change the original String when it is changed" do
+    a = "abcdefghijklmnopqrstuvwxyz0123456789"
+    b = a.substring(2, 30)
+    b.upcase!
+    b << "!"
+    a.should == "abcdefghijklmnopqrstuvwxyz0123456789"
+    b.should == "CDEFGHIJKLMNOPQRSTUVWXYZ012345!"
+  end
+
+  it "returns substrings of a substring" do
+    a = "abcdefghijklmnopqrstuvwxyz0123456789"
+    b = a.substring(2, 30).substring(4, 25)
+    b.should == "ghijklmnopqrstuvwxyz01234"
+    b.index("z").should == 19
+    b[0].should == ?g
+  end
 end
@@ -0,0 +1,43 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe "Rubinius::VM.method_profile" do
+  class MethodProfileSpec
+    def outer
+      10.times { inner }
+    end
+
+    def inner
+      a = []
+      1000.times { |i| a << i }
+    end
+  end
+
+  after :each do
+    Rubinius::VM.profile_methods = false
+  end
+
+  it "counts the calls of each method and the time spent in them" do
+    Rubinius::VM.profile_methods = true
+    Rubinius::VM.method_profile true
+    MethodProfileSpec.new.outer
+    profile = Rubinius::VM.method_profile
+
+    outer = profile.find { |e| e[0].name == :outer }
+    inner = profile.find { |e| e[0].name == :inner }
+
+    outer[1].should == MethodProfileSpec
+    outer[2].should == 1
+    inner[2].should == 10
+    (outer[3] >= inner[3]).should == true
+    (outer[4] < outer[3]).should == true
+  end
+
+  it "starts again from zero after a reset" do
+    Rubinius::VM.profile_methods = true
+    MethodProfileSpec.new.inner
+    Rubinius::VM.method_profile true
+    Rubinius::VM.profile_methods = false
+
+    Rubinius::VM.method_profile.find { |e| e[0].name == :inner }.should == nil
+  end
+end
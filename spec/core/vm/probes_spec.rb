@@ -0,0 +1,34 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe "Rubinius::VM.dump_probes" do
+  class ProbesSpec
+    def run
+      a = []
+      10.times { a << "probe" }
+    end
+  end
+
+  before :each do
+    @path = tmp("probes_spec.out")
+  end
+
+  after :each do
+    Rubinius::VM.probes = []
+    File.delete @path if File.exist? @path
+  end
+
+  it "writes the events recorded while the probes were on" do
+    Rubinius::VM.probes = [:function, :alloc]
+    ProbesSpec.new.run
+    Rubinius::VM.probes = []
+
+    Rubinius::VM.dump_probes(@path).should > 0
+    data = File.open(@path, "rb") { |f| f.read }
+    data[0, 8].should == "RBXPROBE"
+    data.include?("ProbesSpec").should == true
+  end
+
+  it "raises an ArgumentError for an unknown probe" do
+    lambda { Rubinius::VM.probes = [:bogus] }.should raise_error(ArgumentError)
+  end
+end
@@ -0,0 +1,40 @@
+require File.dirname(__FILE__) + '/../../spec_helper'
+
+describe "Rubinius::VM.stats" do
+  it "counts young collections and the bytes allocated in the young space" do
+    before = Rubinius::VM.stats
+    100_000.times { |i| "x#{i}" }
+    after = Rubinius::VM.stats
+
+    (after[7] > before[7]).should == true
+    (after[10] - before[10] > 1_000_000).should == true
+  end
+
+  it "counts major collections and the time spent collecting" do
+    before = Rubinius::VM.stats
+    GC.start
+    after = Rubinius::VM.stats
+
+    (after[8] > before[8]).should == true
+    (after[9] >= before[9]).should == true
+  end
+
+  it "keeps the tenure age up while most of the young space survives" do
+    script = "/tmp/vm_stats_tenure_#{Process.pid}.rb"
+    File.open(script, "w") do |f|
+      f.puts "keep = []"
+      f.puts "500_000.times { |i| keep << [i] }"
+      f.puts "print Rubinius::VM.stats[13]"
+    end
+
+    # Starting up can lower the age, but once everything allocated is kept
+    # survival stays above even a high survival_low. It only looks lower
+    # if the objects being promoted aren't counted.
+    config = "rbx.gc.adaptive=1;rbx.gc.survival_low=60;rbx.gc.survival_high=80;" \
+             "rbx.gc.young_max=4194304"
+    age = `RBX='#{config}' ./shotgun/rubinius #{script}`.to_i
+    File.delete script
+
+    (age > 1).should == true
+  end
+end
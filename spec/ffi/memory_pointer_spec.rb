@@ -0,0 +1,91 @@
+require File.dirname(__FILE__) + '/../spec_helper'
+
+module MemoryPointerSpecs
+  class Pair < FFI::Struct
+    layout :count, :short, 0, :total, :long, 8, :ratio, :double, 16
+  end
+
+  module Libc
+    attach_function "memset", :memset, [:pointer, :int, :long], :pointer
+  end
+end
+
+describe "MemoryPointer#get_at" do
+  it "reads a value of the given type at an offset" do
+    MemoryPointer.new :int, 4 do |ptr|
+      ptr.write_array_of_int [1, 2, 3, 4]
+      ptr.get_at(8, :int).should == 3
+      ptr.get_at(12, FFI::TYPE_INT).should == 4
+    end
+  end
+
+  it "reads a NULL pointer as nil" do
+    MemoryPointer.new :pointer do |ptr|
+      ptr.get_at(0, :pointer).should == nil
+    end
+  end
+
+  it "raises ArgumentError for a type that can't be read" do
+    MemoryPointer.new :int do |ptr|
+      lambda { ptr.get_at(0, :void) }.should raise_error(ArgumentError)
+    end
+  end
+
+  it "raises FFI::TypeError for an unknown type" do
+    MemoryPointer.new :int do |ptr|
+      lambda { ptr.get_at(0, :nonesuch) }.should raise_error(FFI::TypeError)
+    end
+  end
+end
+
+describe "MemoryPointer#put_at" do
+  it "writes a value of the given type at an offset" do
+    MemoryPointer.new :char, 16 do |ptr|
+      ptr.put_at(2, :short, -2).should == -2
+      ptr.put_at(8, :double, 1.5)
+      ptr.get_at(2, :short).should == -2
+      ptr.get_at(0, :short).should == 0
+      ptr.get_at(8, :double).should == 1.5
+    end
+  end
+
+  it "raises TypeError when the value doesn't convert" do
+    MemoryPointer.new :double do |ptr|
+      lambda { ptr.put_at(0, :double, "1.5") }.should raise_error(TypeError)
+    end
+  end
+end
+
+describe "MemoryPointer#read_array_of" do
+  it "reads back what write_array_of wrote" do
+    MemoryPointer.new :long, 3 do |ptr|
+      ptr.write_array_of(:long, [-1, 0, 2**40])
+      ptr.read_array_of(:long, 3).should == [-1, 0, 2**40]
+    end
+  end
+end
+
+describe "FFI::Struct field access" do
+  it "reads and writes fields at their offsets" do
+    pair = MemoryPointerSpecs::Pair.new
+    pair[:count] = 7
+    pair[:total] = 1_000_000
+    pair[:ratio] = 0.25
+
+    pair[:count].should == 7
+    pair[:total].should == 1_000_000
+    pair[:ratio].should == 0.25
+    pair.pointer.get_at(8, :long).should == 1_000_000
+    pair.free
+  end
+end
+
+describe "FFI passing a ByteArray as a pointer" do
+  it "passes the ByteArray's own bytes" do
+    bytes = ByteArray.new 8
+    MemoryPointerSpecs::Libc.memset bytes, 65, 4
+    bytes.get_byte(0).should == 65
+    bytes.get_byte(3).should == 65
+    bytes.get_byte(4).should == 0
+  end
+end
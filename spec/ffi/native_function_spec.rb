@@ -33,3 +33,12 @@ describe "NativeFunction#call" do
     lambda { func.call() }.should_not raise_error(ArgumentError)
   end
 end
+
+describe "FFI.create_function" do
+  it "returns nil when an argument type can't be passed" do
+    [:void, :strptr, :char_array].each do |type|
+      FFI.create_function(FFI::USE_THIS_PROCESS_AS_LIBRARY,
+                          'abs', [type], :int).should == nil
+    end
+  end
+end
@@ -39,6 +39,12 @@ describe "SubtendArray" do
     @s.rb_ary_reverse(a).should == [3,2,1]
   end
 
+  it "rb_ary_reverse should reverse the array in place" do
+    a = [1, 2, 3, 4]
+    @s.rb_ary_reverse(a).should equal(a)
+    a.should == [4, 3, 2, 1]
+  end
+
   it "rb_ary_entry should return nil when called with an empty array" do
     @s.rb_ary_entry([], 0).should == nil
   end
@@ -84,6 +90,18 @@ describe "SubtendArray" do
     @s.rb_ary_shift([]).should == nil
   end
 
+  it "rb_ary_unshift should prepend to an array that has been shifted" do
+    a = [1, 2, 3]
+    @s.rb_ary_shift(a).should == 1
+    @s.rb_ary_unshift(a, :x).should equal(a)
+    10.times { |i| @s.rb_ary_unshift(a, i) }
+    a.should == [9, 8, 7, 6, 5, 4, 3, 2, 1, 0, :x, 2, 3]
+  end
+
+  it "rb_ary_pop should return nil when the array is empty" do
+    @s.rb_ary_pop([]).should == nil
+  end
+
   it "rb_ary_store should overwrite the element at the given position" do
     a = [1, 2, 3]
 
@@ -0,0 +1,55 @@
+require File.dirname(__FILE__) + '/../spec_helper'
+require File.dirname(__FILE__) + '/subtend_helper'
+
+compile_extension('subtend_call')
+require File.dirname(__FILE__) + '/ext/subtend_call'
+
+describe "SubtendCall" do
+  before :each do
+    @s = SubtendCall.new
+  end
+
+  it "calls back into Ruby from a method that has not done so before" do
+    3.times { @s.maybe_call(1, false).should == 1 }
+    @s.maybe_call(1, true).should == "1"
+    @s.maybe_call(2, true).should == "2"
+    @s.maybe_call(3, false).should == 3
+  end
+
+  it "yields from a method that has not done so before" do
+    3.times { @s.maybe_yield(false).should == nil }
+    @s.maybe_yield(true) { |x| x + 1 }.should == 2
+    @s.maybe_yield(true) { |x| x + 2 }.should == 3
+  end
+
+  it "raises an exception from a block through a method that has not called back before" do
+    3.times { @s.maybe_yield_raise(false).should == nil }
+    lambda { @s.maybe_yield_raise(true) { raise TypeError } }.should raise_error(TypeError)
+    @s.maybe_yield_raise(true) { |x| x + 1 }.should == 2
+  end
+
+  it "keeps the value of a call back into Ruby that runs a collection" do
+    3.times { @s.maybe_yield_gc(false).should == nil }
+    @s.maybe_yield_gc(true) { |x| 20000.times { "garbage" * 10 }; "value" }.should == "value"
+  end
+
+  it "returns into a method whose call back began under another thread's" do
+    3.times { @s.maybe_yield_outer(false); @s.maybe_yield_inner(false) }
+    entered = false
+    t = nil
+    @s.maybe_yield_outer(true) do |x|
+      t = Thread.new do
+        @s.maybe_yield_inner(true) { |y| entered = true; sleep 0.1; y + 2 }
+      end
+      Thread.pass until entered
+      x + 1
+    end.should == 2
+    t.value.should == 3
+  end
+
+  it "raises with rb_raise from a method that has been called before" do
+    3.times { @s.maybe_raise(false).should == nil }
+    lambda { @s.maybe_raise(true) }.should raise_error(ArgumentError)
+    lambda { @s.maybe_raise(true) }.should raise_error(ArgumentError)
+  end
+end
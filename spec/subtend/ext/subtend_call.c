@@ -0,0 +1,31 @@
+#include <ruby.h>
+
+/* Each method only calls back into Ruby when told to, so the specs can run
+ * it a few times without doing so first. */
+
+static VALUE sc_maybe_call(VALUE self, VALUE obj, VALUE call) {
+  if(RTEST(call)) return rb_funcall(obj, rb_intern("to_s"), 0);
+  return obj;
+}
+
+static VALUE sc_maybe_yield(VALUE self, VALUE yield) {
+  if(RTEST(yield)) return rb_yield(INT2FIX(1));
+  return Qnil;
+}
+
+static VALUE sc_maybe_raise(VALUE self, VALUE raise) {
+  if(RTEST(raise)) rb_raise(rb_eArgError, "raised from C");
+  return Qnil;
+}
+
+void Init_subtend_call() {
+  VALUE cls;
+  cls = rb_define_class("SubtendCall", rb_cObject);
+  rb_define_method(cls, "maybe_call", sc_maybe_call, 2);
+  rb_define_method(cls, "maybe_yield", sc_maybe_yield, 1);
+  rb_define_method(cls, "maybe_yield_raise", sc_maybe_yield, 1);
+  rb_define_method(cls, "maybe_yield_gc", sc_maybe_yield, 1);
+  rb_define_method(cls, "maybe_yield_outer", sc_maybe_yield, 1);
+  rb_define_method(cls, "maybe_yield_inner", sc_maybe_yield, 1);
+  rb_define_method(cls, "maybe_raise", sc_maybe_raise, 1);
+}
@@ -58,6 +58,12 @@ describe "SubtendString" do
     @s.cat_as_question("Your house is on fire").should == "Your house is on fire?"
   end
 
+  it "rb_str_cat should append to the string it is given" do
+    str = "Your house is on fire"
+    @s.cat_as_question(str).should equal(str)
+    str.should == "Your house is on fire?"
+  end
+
   it "rb_str_cat2 should concat C strings to ruby strings" do
     @s.cat2_as_question("Your house is on fire").should == "Your house is on fire?"
   end
@@ -68,6 +74,7 @@ describe "SubtendString" do
     @s.rb_str_cmp("xxx", "yyy").should == -1
     @s.rb_str_cmp("yyy", "xxx").should == 1
     @s.rb_str_cmp("ppp", "ppp").should == 0
+    @s.rb_str_cmp("a\000b", "a\000c").should == -1
   end
   
   it "rb_str_split should split strings over a splitter" do
@@ -90,6 +97,20 @@ describe "SubtendString" do
     end
   end
 
+  it "rb_str_substr should count a negative start from the end" do
+    @s.rb_str_substr("hello", -3, 2).should == "ll"
+  end
+
+  it "rb_str_substr should return nil when the start is out of range" do
+    @s.rb_str_substr("hello", 6, 1).should == nil
+    @s.rb_str_substr("hello", -6, 1).should == nil
+    @s.rb_str_substr("hello", 5, 1).should == ""
+  end
+
+  it "rb_str_substr should stop at the end of the string" do
+    @s.rb_str_substr("hello", 3, 10).should == "lo"
+  end
+
   it "RSTRING(str)->ptr should return the string on the object" do
     @s.rb_rstring_see("foo").should == "foo"
   end
@@ -115,6 +136,14 @@ describe "SubtendString" do
     t.should == "FOO"
   end
 
+  it "Writing to RSTRING(str)->ptr of a substring should not change the string it came from" do
+    t = ("a" * 5000) + "\0" + ("b" * 5000)
+    sub = t[0, 5000]
+    @s.rb_rstring_write_x(sub)
+    sub[0, 2].should == "xa"
+    t[0, 2].should == "aa"
+  end
+
   it "rb_str_to_str should try to coerce to String, otherwise raise a TypeError" do
     @s.rb_str_to_str("foo").should == "foo"
     @s.rb_str_to_str(ValidTostrTest.new).should == "ruby"
@@ -0,0 +1,52 @@
+# Compiles Ruby files the way the kernel is built and reports how many
+# instructions each optimizer pass removed. Nothing is written to disk.
+#
+# Example Usage:
+#
+# shotgun/rubinius tools/optimizer_report.rb              # all of kernel/
+# shotgun/rubinius tools/optimizer_report.rb -v kernel/delta
+# shotgun/rubinius tools/optimizer_report.rb -fno-peephole lib/compiler
+
+flags = ['rbx-safe-math', 'rbx-kernel', 'rbx-optimize']
+verbose = false
+
+while ARGV.first and ARGV.first.prefix? "-"
+  arg = ARGV.shift
+  if arg == "-v"
+    verbose = true
+  elsif arg.prefix? "-f"
+    flags << arg[2..-1]
+  end
+end
+
+ARGV << "kernel" if ARGV.empty?
+
+files = ARGV.map do |path|
+  File.directory?(path) ? Dir["#{path}/**/*.rb"].sort : path
+end.flatten
+
+compiler = Compile.compiler
+stats = compiler::Optimizer.stats
+
+files.each do |file|
+  before, after = stats[:before], stats[:after]
+  compiler.compile_file file, flags
+
+  if verbose
+    seen = stats[:before] - before
+    puts "%-50s %6d %6d" % [file, seen, seen - (stats[:after] - after)]
+  end
+end
+
+total = stats[:before]
+puts "" if verbose
+puts "#{files.size} files, #{stats[:methods]} methods, #{total} instructions"
+puts ""
+
+compiler::Optimizer.pass_names.each do |name|
+  puts "%-12s %6d removed" % [name, stats[name]]
+end
+
+removed = total - stats[:after]
+percent = total == 0 ? 0.0 : removed * 100.0 / total
+puts "%-12s %6d removed (%.1f%%)" % ["total", removed, percent]